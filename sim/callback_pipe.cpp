@@ -1,5 +1,6 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-        
 #include "callback_pipe.h"
+#include "checkpoint.h"
 #include <iostream>
 #include <sstream>
 
@@ -40,3 +41,9 @@ CallbackPipe::doNextEvent() {
         _eventlist.sourceIsPending(*this, nexteventtime);
     }
 }
+
+void
+CallbackPipe::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(CallbackPipe));
+    checkpoint_inflight(archive);
+}
@@ -18,6 +18,7 @@ class CallbackPipe : public Pipe {
 public:
     CallbackPipe(simtime_picosec delay, EventList& eventlist, PacketSink* callback);
     virtual void doNextEvent(); // inherited from Pipe
+    virtual void checkpoint(CheckpointArchive& archive);
 private:
     PacketSink* _callback;
 };
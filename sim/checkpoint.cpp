@@ -0,0 +1,351 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "checkpoint.h"
+#include <algorithm>
+#include <iostream>
+#include <cxxabi.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "network.h"
+#include "constant_cca_packet.h"
+
+Brancher::Brancher()
+    : _running(0), _failures(0)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    _max_running = cpus > 0 ? cpus : 1;
+}
+
+uint32_t
+Brancher::branch(uint32_t n) {
+    cout.flush();
+    fflush(stdout);
+
+    _pids.clear();
+    for (uint32_t b = 0; b < n; b++) {
+        if (_running >= _max_running)
+            reap_one();
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            exit(1);
+        }
+        if (pid == 0)
+            return b;
+        _pids.push_back(pid);
+        _running++;
+    }
+    while (_running > 0)
+        reap_one();
+    if (_failures)
+        cout << _failures << " of " << n << " branches failed" << endl;
+    return PARENT;
+}
+
+void
+Brancher::reap_one() {
+    int status;
+    pid_t pid = wait(&status);
+    if (pid < 0) {
+        perror("wait");
+        exit(1);
+    }
+    _running--;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        uint32_t b = find(_pids.begin(), _pids.end(), pid) - _pids.begin();
+        cout << "Branch " << b << " (pid " << pid << ") failed" << endl;
+        _failures++;
+    }
+}
+
+Checkpoint::Checkpoint(EventList& eventlist, simtime_picosec when)
+    : EventSource(eventlist, "checkpoint"), _reached(false)
+{
+    eventlist.sourceIsPending(*this, when);
+}
+
+uint32_t
+Checkpoint::branch(uint32_t n) {
+    cout << "Checkpoint at " << timeAsUs(eventlist().now()) << "us: starting "
+         << n << " branches" << endl;
+    return _brancher.branch(n);
+}
+
+void
+Checkpoint::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(Checkpoint));
+    checkpoint_random(archive);
+    archive.io(_reached);
+}
+
+static const char CHECKPOINT_MAGIC[8] = {'h', 't', 's', 'i', 'm', 'c', 'k', 'p'};
+// bumped whenever what a checkpoint holds changes
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+CheckpointArchive::CheckpointArchive(const string& filename, bool saving)
+    : _filename(filename), _saving(saving)
+{
+    _file.open(filename.c_str(), (saving ? ios::out | ios::trunc : ios::in) | ios::binary);
+    if (!_file)
+        fail(saving ? "can't open for writing" : "can't open");
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    copy(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC + sizeof(magic), magic);
+    bytes(magic, sizeof(magic));
+    if (!equal(magic, magic + sizeof(magic), CHECKPOINT_MAGIC))
+        fail("not a checkpoint");
+    check(CHECKPOINT_VERSION, "checkpoint version");
+}
+
+CheckpointArchive::~CheckpointArchive() {
+    _file.close();
+}
+
+void
+CheckpointArchive::checkpoint(EventList& eventlist, const vector<Logged*>& objects) {
+    _objects = objects;
+    _object_index.clear();
+    for (size_t i = 0; i < _objects.size(); i++)
+        _object_index[_objects[i]] = i;
+
+    // the restoring process must have built the same objects
+    uint64_t count = _objects.size();
+    check(count, "the number of objects");
+    for (size_t i = 0; i < _objects.size(); i++)
+        check(class_name(typeid(*_objects[i])), "the class of each object");
+
+    eventlist.checkpoint(*this);
+    eventlist.context().checkpoint(*this);
+    for (size_t i = 0; i < _objects.size(); i++)
+        _objects[i]->checkpoint(*this);
+    check(CHECKPOINT_VERSION, "the end of the checkpoint");
+    if (_saving) {
+        _file.flush();
+        if (!_file)
+            fail("write failed");
+    }
+}
+
+void
+CheckpointArchive::bytes(void* p, size_t n) {
+    if (_saving)
+        _file.write(static_cast<const char*>(p), n);
+    else
+        _file.read(static_cast<char*>(p), n);
+    if (!_file)
+        fail(_saving ? "write failed" : "truncated");
+}
+
+void
+CheckpointArchive::io(string& s) {
+    uint64_t n = s.size();
+    io(n);
+    s.resize(n);
+    if (n)
+        bytes(&s[0], n);
+}
+
+void
+CheckpointArchive::io(vector<bool>& v) {
+    uint64_t n = v.size();
+    io(n);
+    v.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        bool b = v[i];
+        io(b);
+        v[i] = b;
+    }
+}
+
+uint32_t
+CheckpointArchive::index_of(const Logged* obj, const type_info& t) {
+    unordered_map<const Logged*, uint32_t>::const_iterator i = _object_index.find(obj);
+    if (i == _object_index.end())
+        fail("a pointer to a " + class_name(t) + " that isn't one of the objects");
+    return i->second;
+}
+
+Logged*
+CheckpointArchive::object(uint32_t i) {
+    if (i >= _objects.size())
+        fail("object " + to_string(i) + " doesn't exist");
+    return _objects[i];
+}
+
+void
+CheckpointArchive::route(const Route*& rt) {
+    uint32_t i = NO_INDEX;
+    if (_saving && rt) {
+        unordered_map<const Route*, uint32_t>::const_iterator f = _route_index.find(rt);
+        i = (f == _route_index.end()) ? _routes.size() : f->second;
+    }
+    io(i);
+    if (i == NO_INDEX) {
+        rt = NULL;
+        return;
+    }
+    if (i < _routes.size()) {
+        if (restoring())
+            rt = _routes[i];
+        return;
+    }
+    if (i != _routes.size())
+        fail("route " + to_string(i) + " out of order");
+
+    // A new one: its hops, path id and reverse, which may well lead
+    // back here, so it's listed before its reverse is saved.
+    Route* copy = NULL;
+    if (_saving) {
+        _route_index[rt] = i;
+        _routes.push_back(rt);
+    } else {
+        copy = new Route();
+        _routes.push_back(copy);
+        rt = copy;
+    }
+    uint32_t size = _saving ? rt->size() : 0;
+    io(size);
+    for (uint32_t h = 0; h < size; h++) {
+        PacketSink* hop = _saving ? rt->at(h) : NULL;
+        ref(hop);
+        if (restoring()) {
+            if (!hop)
+                fail("a route with a missing hop");
+            copy->push_back(hop);
+        }
+    }
+    int path_id = _saving ? rt->path_id() : 0;
+    int no_of_paths = _saving ? rt->no_of_paths() : 0;
+    io(path_id);
+    io(no_of_paths);
+    const Route* reverse = _saving ? rt->reverse() : NULL;
+    route(reverse);
+    if (restoring()) {
+        copy->set_path_id(path_id, no_of_paths);
+        copy->set_reverse(const_cast<Route*>(reverse));
+    }
+}
+
+// The packet types a checkpoint can hold, by packet_type.
+static const type_info*
+packet_class(packet_type type) {
+    switch (type) {
+    case CONSTCCA:
+        return &typeid(ConstantCcaPacket);
+    case CONSTCCAACK:
+        return &typeid(ConstantCcaAck);
+    default:
+        return NULL;
+    }
+}
+
+static Packet*
+new_packet(packet_type type) {
+    switch (type) {
+    case CONSTCCA:
+        return SimContext::current().state<PacketPool<ConstantCcaPacket> >().allocPacket();
+    case CONSTCCAACK:
+        return SimContext::current().state<PacketPool<ConstantCcaAck> >().allocPacket();
+    default:
+        return NULL;
+    }
+}
+
+void
+CheckpointArchive::packet(Packet*& pkt) {
+    uint32_t i = NO_INDEX;
+    if (_saving && pkt) {
+        unordered_map<const Packet*, uint32_t>::const_iterator f = _packet_index.find(pkt);
+        i = (f == _packet_index.end()) ? _packets.size() : f->second;
+    }
+    io(i);
+    if (i == NO_INDEX) {
+        pkt = NULL;
+        return;
+    }
+    if (i < _packets.size()) {
+        if (restoring())
+            pkt = _packets[i];
+        return;
+    }
+    if (i != _packets.size())
+        fail("packet " + to_string(i) + " out of order");
+
+    packet_type type = _saving ? pkt->type() : IP;
+    io(type);
+    if (_saving) {
+        const type_info* t = packet_class(type);
+        if (!t || typeid(*pkt) != *t)
+            fail("can't save a " + class_name(typeid(*pkt)));
+        _packet_index[pkt] = i;
+    } else {
+        pkt = new_packet(type);
+        if (!pkt)
+            fail("packet type " + to_string(type) + " can't be restored");
+    }
+    _packets.push_back(pkt);
+    pkt->checkpoint(*this);
+}
+
+void
+CheckpointArchive::packets(CircularBuffer<Packet*>& buf) {
+    uint64_t n = buf.size();
+    io(n);
+    if (restoring())
+        buf.clear();
+    for (uint64_t i = 0; i < n; i++) {
+        Packet* pkt = _saving ? buf.at(i) : NULL;
+        packet(pkt);
+        if (restoring())
+            buf.push(pkt);
+    }
+}
+
+void
+CheckpointArchive::packets(list<Packet*>& pkts) {
+    uint64_t n = pkts.size();
+    io(n);
+    if (_saving) {
+        for (list<Packet*>::iterator i = pkts.begin(); i != pkts.end(); i++)
+            packet(*i);
+        return;
+    }
+    pkts.clear();
+    for (uint64_t i = 0; i < n; i++) {
+        Packet* pkt;
+        packet(pkt);
+        pkts.push_back(pkt);
+    }
+}
+
+void
+CheckpointArchive::handle(EventHandle& handle) {
+    // A handle goes stale once its event fires, so one that isn't
+    // among the pending events restores as the null handle.
+    uint64_t seq = handle.seq;
+    io(seq);
+    if (_saving)
+        return;
+    unordered_map<uint64_t, EventHandle>::const_iterator i = _handles.find(seq);
+    handle = (seq != 0 && i != _handles.end()) ? i->second : EventList::nullHandle();
+}
+
+void
+CheckpointArchive::fail(const string& why) {
+    cerr << "Checkpoint " << _filename << ": " << why << endl;
+    exit(1);
+}
+
+void
+CheckpointArchive::unsupported(Logged& obj) {
+    fail("can't save or restore " + obj.str() + ", a " + class_name(typeid(obj)));
+}
+
+string
+CheckpointArchive::class_name(const type_info& t) {
+    int status;
+    char* name = abi::__cxa_demangle(t.name(), NULL, NULL, &status);
+    string s = (status == 0) ? name : t.name();
+    free(name);
+    return s;
+}
@@ -0,0 +1,201 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/*
+ * Running several copies of one simulation, by forking it or from a
+ * file.
+ *
+ * Runs that share a prefix - the topology and connection setup, or
+ * the whole start-up transient - can simulate it once and fork.  Each
+ * child is a complete copy of the network at that point - the pending
+ * events, packets in pipes and queues, transport and RNG state -
+ * shared copy-on-write with its siblings.
+ *
+ * Brancher does the forking: branch(n) forks the process n times, and
+ * each child carries on from there as branch 0..n-1.  The parent just
+ * waits for the branches, at most max_running() of them at a time, and
+ * branch() returns PARENT to it when they have all finished.  A driver
+ * that forks straight after setup, for independent replicas of a run,
+ * uses one directly.
+ *
+ * A Checkpoint is an event at time T, for branching experiments off a
+ * warmed-up network: once the driver sees it has been reached(), it
+ * calls branch(n).  Each branch then reseeds the RNG, changes whatever
+ * its experiment varies - main_const's -variant can set the pacing
+ * rate, dupack threshold, fast recovery and end time - and points its
+ * output somewhere of its own before continuing.
+ *
+ * A CheckpointArchive writes the same state to a file instead, for a
+ * later process to carry on from.  That process builds the network
+ * again exactly as the one that saved it did - same arguments, same
+ * seed - and then restores the state into it, so the file only holds
+ * what changes as the simulation runs: the time and pending events,
+ * the context's random numbers, and each object's own state.  The
+ * objects are listed in the order they were created (see
+ * LoggedManager::keep_idmap()), and pointers between them are saved as
+ * positions in that list.  Packets and the routes they carry are
+ * saved once each, however many pointers there are to them, and
+ * restored as new ones.  Every class a checkpoint may hold implements
+ * Logged::checkpoint(); for anything else, saving fails naming it,
+ * rather than quietly writing a file that can't be restored.
+ *
+ * Flush any buffered output before branching, or every branch will
+ * write it again.  branch() flushes cout.
+ */
+
+#include <vector>
+#include <list>
+#include <string>
+#include <fstream>
+#include <typeinfo>
+#include <type_traits>
+#include <unordered_map>
+#include <sys/types.h>
+#include "config.h"
+#include "eventlist.h"
+#include "circular_buffer.h"
+
+class Packet;
+class Route;
+
+class Brancher {
+public:
+    static const uint32_t PARENT = UINT32_MAX;
+
+    Brancher();
+
+    // Returns the branch number in each child, and PARENT in the parent
+    // once all n children have exited.
+    uint32_t branch(uint32_t n);
+    // branches that exited with an error or were killed
+    uint32_t failures() const {return _failures;}
+
+    // defaults to the number of CPUs online
+    void set_max_running(uint32_t max_running) {_max_running = max_running;}
+    uint32_t max_running() const {return _max_running;}
+
+private:
+    void reap_one();
+
+    uint32_t _max_running;
+    uint32_t _running;
+    uint32_t _failures;
+    vector<pid_t> _pids; // indexed by branch
+};
+
+class Checkpoint : public EventSource {
+public:
+    Checkpoint(EventList& eventlist, simtime_picosec when);
+    void doNextEvent() {_reached = true;}
+    bool reached() const {return _reached;}
+    virtual void checkpoint(CheckpointArchive& archive);
+
+    // fork the branches; see Brancher::branch()
+    uint32_t branch(uint32_t n);
+    uint32_t failures() const {return _brancher.failures();}
+    Brancher& brancher() {return _brancher;}
+
+private:
+    bool _reached;
+    Brancher _brancher;
+};
+
+class CheckpointArchive {
+public:
+    // Opens filename to save to or restore from; fails if it can't.
+    CheckpointArchive(const string& filename, bool saving);
+    ~CheckpointArchive();
+    bool saving() const {return _saving;}
+    bool restoring() const {return !_saving;}
+
+    // Save or restore the event list, the context's random numbers and
+    // then objects, in turn.  Restoring needs the same objects, built
+    // the same way; anything else fails.
+    void checkpoint(EventList& eventlist, const vector<Logged*>& objects);
+
+    // a plain value
+    template<class T> void io(T& v) {
+        static_assert(std::is_trivially_copyable<T>::value && !std::is_pointer<T>::value,
+                      "use ref(), route() or packet() for pointers");
+        bytes(&v, sizeof(T));
+    }
+    void io(string& s);
+    void io(vector<bool>& v);
+    template<class T> void io(vector<T>& v) {
+        uint64_t n = v.size();
+        io(n);
+        v.resize(n);
+        for (size_t i = 0; i < n; i++)
+            io(v[i]);
+    }
+    // something the restoring process has already set up; it must match
+    template<class T> void check(const T& v, const char* what) {
+        T saved = v;
+        io(saved);
+        if (!(saved == v))
+            fail(string(what) + " doesn't match the saved run");
+    }
+
+    // a pointer to one of the objects, or NULL
+    template<class T> void ref(T*& p) {
+        uint32_t i = NO_INDEX;
+        if (_saving && p)
+            i = index_of(dynamic_cast<const Logged*>(p), typeid(*p));
+        io(i);
+        if (_saving)
+            return;
+        p = NULL;
+        if (i != NO_INDEX) {
+            p = dynamic_cast<T*>(object(i));
+            if (!p)
+                fail("object " + to_string(i) + " isn't a " + class_name(typeid(T)));
+        }
+    }
+    // a route, or NULL; restored routes last for the rest of the run
+    void route(const Route*& route);
+    // a packet, or NULL; restored packets come from their pools
+    void packet(Packet*& pkt);
+    // a queue of packets, in the order they leave it
+    void packets(CircularBuffer<Packet*>& buf);
+    void packets(list<Packet*>& pkts);
+    // a handle to a pending event, or to one no longer pending
+    void handle(EventHandle& handle);
+
+    // for EventList: the event saved as seq is pending again as handle
+    void requeued(uint64_t seq, const EventHandle& handle) {_handles[seq] = handle;}
+
+    // give up, saying why
+    [[noreturn]] void fail(const string& why);
+    // obj's class can't be saved or restored
+    [[noreturn]] void unsupported(Logged& obj);
+    // For checkpoint() overrides: fails unless obj is exactly a t, so
+    // a subclass with state of its own can't slip through unsaved.
+    void check_class(Logged& obj, const type_info& t) {
+        if (typeid(obj) != t)
+            unsupported(obj);
+    }
+
+    static string class_name(const type_info& t);
+
+private:
+    static const uint32_t NO_INDEX = UINT32_MAX;
+
+    void bytes(void* p, size_t n);
+    uint32_t index_of(const Logged* obj, const type_info& t);
+    Logged* object(uint32_t i);
+
+    string _filename;
+    bool _saving;
+    fstream _file;
+
+    vector<Logged*> _objects;
+    unordered_map<const Logged*, uint32_t> _object_index;
+    vector<const Route*> _routes;
+    unordered_map<const Route*, uint32_t> _route_index;
+    vector<Packet*> _packets;
+    unordered_map<const Packet*, uint32_t> _packet_index;
+    unordered_map<uint64_t, EventHandle> _handles; // by saved seq
+};
+
+#endif
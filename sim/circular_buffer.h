@@ -86,6 +86,18 @@ public:
         return _queue.at(_next_pop);
     }
 
+    // the i'th item pop() will return
+    T& at(int i) {
+        assert(i < _count);
+        return _queue[(_next_pop + i) % _size];
+    }
+
+    void clear() {
+        _count = 0;
+        _next_push = 0;
+        _next_pop = 0;
+    }
+
     bool empty() {return _count == 0;}
     int size() {return _count;}
 private:
@@ -2,6 +2,7 @@
 #include <iostream>
 #include "clock.h"
 #include "eventlist.h"
+#include "checkpoint.h"
 
 Clock::Clock(simtime_picosec period, EventList& eventlist)
   : EventSource(eventlist,"clock"), 
@@ -22,3 +23,11 @@ Clock::doNextEvent() {
         _smallticks=0;
     }
 }
+
+void
+Clock::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(Clock));
+    checkpoint_random(archive);
+    archive.check(_period, "clock period");
+    archive.io(_smallticks);
+}
@@ -13,6 +13,7 @@ class Clock : public EventSource {
 public:
         Clock(simtime_picosec period, EventList& eventlist); 
         void doNextEvent();
+        virtual void checkpoint(CheckpointArchive& archive);
 private:
         simtime_picosec _period;
         int _smallticks;
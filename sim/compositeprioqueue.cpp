@@ -106,7 +106,7 @@ CompositePrioQueue::receivePacket(Packet& pkt)
         return;
     }
 
-    if (drand() < _stochastic_loss_rate) {
+    if (drand() < getStochasticLossRate()) {
         pkt.free();
         return;
     }
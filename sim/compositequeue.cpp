@@ -4,6 +4,7 @@
 #include <iostream>
 #include <sstream>
 #include "ecn.h"
+#include "checkpoint.h"
 
 CompositeQueue::CompositeQueue(linkspeed_bps bitrate, mem_b maxsize, EventList& eventlist, 
                                QueueLogger* logger)
@@ -144,7 +145,7 @@ CompositeQueue::receivePacket(Packet& pkt)
         return;
     }
 
-    if (drand() < _stochastic_loss_rate) {
+    if (drand() < getStochasticLossRate()) {
         pkt.free();
         return;
     }
@@ -287,3 +288,28 @@ mem_b
 CompositeQueue::queuesize() const {
     return _queuesize_low + _queuesize_high;
 }
+
+void
+CompositeQueue::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(CompositeQueue));
+    checkpoint_base(archive);
+    checkpoint_fifo(archive);
+    archive.check(_ecn_minthresh, "ECN threshold");
+    archive.check(_ecn_maxthresh, "ECN threshold");
+    archive.check(_return_to_sender, "return to sender");
+    archive.io(_queuesize_low);
+    archive.io(_queuesize_high);
+    archive.io(_num_packets);
+    archive.io(_num_headers);
+    archive.io(_num_acks);
+    archive.io(_num_nacks);
+    archive.io(_num_pulls);
+    archive.io(_num_stripped);
+    archive.io(_num_bounced);
+    archive.io(_serv);
+    archive.io(_ratio_high);
+    archive.io(_ratio_low);
+    archive.io(_crt);
+    archive.packets(_enqueued_low);
+    archive.packets(_enqueued_high);
+}
@@ -40,6 +40,7 @@ class CompositeQueue : public Queue {
     }
 
     void setRTS(bool return_to_sender){ _return_to_sender = return_to_sender;}
+    virtual void checkpoint(CheckpointArchive& archive);
 
     virtual const string& nodename() { return _nodename; }
     void set_ecn_threshold(mem_b ecn_thresh) {
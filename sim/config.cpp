@@ -8,12 +8,15 @@
 
 void srand(unsigned seed)
 {
-    random_engine = mt19937(seed);
+    SimContext::current().seed_random(seed);
 }
 
 int rand()
 {
-    return random_engine() & INT_MAX;
+    SimContext& ctx = SimContext::current();
+    if (ctx.random_source())
+        return ctx.random_source()->random() & INT_MAX;
+    return ctx.random_engine()() & INT_MAX;
 }
 
 void srandom(unsigned seed)
@@ -26,9 +29,10 @@ long random()
     return rand();
 }
 
+// a generator of the caller's own, seeded from the stream rand() draws from
 std::mt19937 get_random_engine()
 {
-    return random_engine;
+    return std::mt19937(rand());
 }
 
 double drand() {
@@ -12,8 +12,8 @@
 #include <sstream>
 #include <random>
 
-static std::mt19937 random_engine;
-
+// rand() and friends draw from the running event source's stream, or
+// between events from the current simulation's generator; see simcontext.h
 void srand(unsigned seed);
 
 int rand();
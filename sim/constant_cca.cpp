@@ -1,5 +1,6 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*- 
 #include "constant_cca.h"
+#include "checkpoint.h"
 #include <iostream>
 #include <math.h>
 
@@ -12,6 +13,7 @@ ConstantCcaPacer::ConstantCcaPacer(ConstantCcaSubflowSrc& src, EventList& event_
     : EventSource(event_list,"constant_cca_pacer"), _src(&src), _interpacket_delay(interpacket_delay) {
     _last_send = eventlist().now();
     _next_send = 0;
+    _next_send_handle = eventlist().nullHandle();
 }
 
 void
@@ -38,7 +40,7 @@ ConstantCcaPacer::schedule_send(simtime_picosec delay) {
     }
     // cout << "Setting next send to " << timeAsUs(new_next_send) << endl;
     _next_send = new_next_send;
-    eventlist().sourceIsPending(*this, _next_send);
+    _next_send_handle = eventlist().sourceIsPendingGetHandle(*this, _next_send);
 }
 
 bool 
@@ -55,7 +57,16 @@ void
 ConstantCcaPacer::cancel() {
     _interpacket_delay = 0;
     _next_send = 0;
-    eventlist().cancelPendingSource(*this);
+    eventlist().cancelPendingSourceByHandle(*this, _next_send_handle);
+}
+
+void
+ConstantCcaPacer::reset(simtime_picosec interpacket_delay) {
+    eventlist().cancelPendingSourceByHandle(*this, _next_send_handle);
+    _interpacket_delay = interpacket_delay;
+    _last_send = eventlist().now();
+    _next_send = 0;
+    _next_send_handle = eventlist().nullHandle();
 }
 
 // called when we're in window-mode to update the send time so it's always correct if we
@@ -88,6 +99,16 @@ ConstantCcaPacer::doNextEvent() {
     }
 }
 
+void
+ConstantCcaPacer::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ConstantCcaPacer));
+    checkpoint_random(archive);
+    archive.io(_interpacket_delay);
+    archive.io(_last_send);
+    archive.io(_next_send);
+    archive.handle(_next_send_handle);
+}
+
 ////////////////////////////////////////////////////////////////
 //  CONSTANT CCA SRC
 ////////////////////////////////////////////////////////////////
@@ -95,6 +116,13 @@ ConstantCcaPacer::doNextEvent() {
 ConstantCcaSubflowSrc::ConstantCcaSubflowSrc(ConstantCcaSrc& src, TrafficLogger* pktlogger, int subflow_id, simtime_picosec pacing_delay)
     : EventSource(src.eventlist(), "swift_subflow_src"), _flow(pktlogger), _src(src), _pacer(*this, src.eventlist(), pacing_delay)
 {
+    _mss = Packet::data_packet_size();
+    _nodename = "constcca_subflowsrc_" + std::to_string(get_id()) + "_" + std::to_string(subflow_id);
+    reset(pacing_delay);
+}
+
+void
+ConstantCcaSubflowSrc::reset(simtime_picosec pacing_delay) {
     _highest_sent = 0;
     _packets_sent = 0;
     _established = false;
@@ -115,38 +143,41 @@ ConstantCcaSubflowSrc::ConstantCcaSubflowSrc(ConstantCcaSrc& src, TrafficLogger*
     _total_dupacks = 0;
 
     _retransmit_cnt = 0;
+    _rtx_reset_threshold = 0; // every timeout drops back to _min_cwnd
     _pacing_delay = pacing_delay;  // 
     _deferred_send = false; // true if we wanted to send, but no scheduler said no.
 
     // PLB init
     _plb_interval = timeFromMs(10);  // disable PLB til we've seen some traffic
     _path_index = 0;  
-    _last_good_path = src.eventlist().now();
-    _plb_threshold_ecn = src._plb_threshold_ecn;
+    _pathid = 0;
+    _last_good_path = eventlist().now();
+    _plb_threshold_ecn = _src._plb_threshold_ecn;
+    _ecn_marks = 0;
 
-    _path_qualities.assign(src._ev_count, 0.0);
-    _path_skipped.assign(src._ev_count, false);
+    _path_qualities.assign(_src._ev_count, 0.0);
+    _path_skipped.assign(_src._ev_count, false);
     
     _rtx_timeout_pending = false;
     _RFC2988_RTO_timeout = timeInf;
+    rtx_timer_update();
 
-    _mss = Packet::data_packet_size();
     _const_cwnd = 100 * _mss; 
     _maxcwnd = 0xffffffff;//200*_mss;
 
     _min_cwnd = 10 * _mss;  // guess - if we go less than 10 bytes, we probably get into rounding 
     _max_cwnd = 1000 * _mss;  // maximum cwnd we can use.  Guess - how high should we allow cwnd to go?  Presumably something like B*target_delay?
 
-    _nodename = "constcca_subflowsrc_" + std::to_string(get_id()) + "_" + std::to_string(subflow_id);
-
     _min_rtt = timeFromMs(1000);
 
-    // _pending_retransmit = 0;
+    _dsn_map.clear();
+    _pending_retransmit.clear();
     _nack_rtxs = 0;
 
     deferred_retransmit = false;
 
     _repeated_nack_rtxs = 0;
+    _pacer.reset(pacing_delay);
 }
 
 void
@@ -200,12 +231,14 @@ ConstantCcaSubflowSrc::handle_ack(ConstantCcaAck::seq_t ackno) {
     simtime_picosec now = eventlist().now();
     if (ackno > _last_acked) { // a brand new ack
         _RFC2988_RTO_timeout = now + _rto;// RFC 2988 5.3
+        rtx_timer_update();
     
         if (ackno >= _highest_sent) {
             
             _highest_sent = ackno;
             //cout << timeAsUs(now) << " " << nodename() << " highest_sent now  " << _highest_sent << endl;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
+            rtx_timer_update();
         }
 
         if (!_in_fast_recovery) {
@@ -312,17 +345,16 @@ ConstantCcaSubflowSrc::send_packets() {
     //     return 1;
     // }
 
-    if (_pending_retransmit.size() > 0) { // should also check pacer? How else could this be called?
+    if (!_pending_retransmit.empty()) { // should also check pacer? How else could this be called?
         // Only do a pending retransmit if it's not already been acked
-        while (_pending_retransmit.size() > 0 && *_pending_retransmit.begin() <= _last_acked && *_pending_retransmit.begin()-1 <= _highest_sent) {
-            _pending_retransmit.erase(_pending_retransmit.begin());
-        }
-        if (_pending_retransmit.size() > 0 && *_pending_retransmit.begin() > _last_acked && *_pending_retransmit.begin()-1 <= _highest_sent) {
-            uint64_t seqno = *_pending_retransmit.begin();
-            retransmit_packet(seqno);
-            return 1;
+        _pending_retransmit.discard(_last_acked / mss());
+        if (!_pending_retransmit.empty()) {
+            uint64_t seqno = _pending_retransmit.first() * mss() + 1;
+            if (seqno - 1 <= _highest_sent) {
+                retransmit_packet(seqno);
+                return 1;
+            }
         }
-        
     }
     // maybe should just rewrite this. What should the logic be?
     // Only send if the pacer allows it and the window has room
@@ -339,6 +371,7 @@ ConstantCcaSubflowSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return sent_count;
@@ -360,6 +393,7 @@ ConstantCcaSubflowSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
             //cout << timeAsUs(eventlist().now()) << " " << nodename() << " RTO at " << timeAsUs(_RFC2988_RTO_timeout) << "us" << endl;
         }
     }
@@ -386,16 +420,12 @@ ConstantCcaSubflowSrc::send_next_packet() {
         return false;
     }
 
-    ConstantCcaPacket::seq_t dsn;
-    if (!_dsn_map.empty() && _dsn_map.count(_highest_sent + 1) > 0) {
-        dsn = _dsn_map[_highest_sent+1];
-        if (dsn == 0) {
-            cout << "highest_sent " << _highest_sent << " last_acked " << _last_acked << " ,highest in map: " << (uint64_t) prev(_dsn_map.end())->first << endl;
-            assert(false);
-        }
-    } else {
+    // nothing up to _last_acked will be sent again
+    _dsn_map.advance(_last_acked / mss());
+    ConstantCcaPacket::seq_t dsn = _dsn_map.get(_highest_sent / mss());
+    if (dsn == 0) {
         dsn = _src._highest_dsn_sent+1;
-        _dsn_map[_highest_sent+1] = dsn;
+        _dsn_map[_highest_sent / mss()] = dsn;
         _src._highest_dsn_sent += mss();
         _highest_sent_abs = _highest_sent; // it can be possible for neither hsent or recoverq to be the actual highest sent (multiple losses before recovering), so we need this
     }
@@ -449,7 +479,7 @@ ConstantCcaSubflowSrc::retransmit_packet() {
     // }
     // cout << timeAsUs(eventlist().now()) << " " << nodename() << " retransmit_packet " << endl;
     // cout << timeAsUs(eventlist().now()) << " sending seqno " << _last_acked+1 << endl;
-    ConstantCcaPacket::seq_t dsn = _dsn_map[_last_acked+1];
+    ConstantCcaPacket::seq_t dsn = _dsn_map.get(_last_acked / mss());
     ConstantCcaPacket* p = ConstantCcaPacket::newpkt(_flow, *_route, _last_acked+1, dsn, mss(), _src._destination, _src._addr, _pathid); // TODO: should probably increment the path label after sending here too 
 
     p->set_ts(eventlist().now());
@@ -460,6 +490,7 @@ ConstantCcaSubflowSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1 // the fact that with NACKs this broke concerns me - are we getting worse performance? I thought this was necessary since otherwise you won't timeout if you were first in fast retransmit, right? Let's test
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -476,24 +507,25 @@ ConstantCcaSubflowSrc::retransmit_packet(uint64_t seqno) {
     //     _nack_backoff = _pacing_delay;
     // }
     if (!_pacer.allow_send()) {
-        _pending_retransmit.insert(seqno);
+        _pending_retransmit.insert((seqno - 1) / mss());
         return;
     }
     _repeated_nack_rtxs++;
-    ConstantCcaPacket::seq_t dsn = _dsn_map[seqno];
+    ConstantCcaPacket::seq_t dsn = _dsn_map.get((seqno - 1) / mss());
     ConstantCcaPacket* p = ConstantCcaPacket::newpkt(_flow, *_route, seqno, dsn, mss(), _src._destination, _src._addr, _pathid);
 
     p->set_ts(eventlist().now());
     p->sendOn();
 
     _packets_sent++;
-    _pending_retransmit.erase(seqno);
+    _pending_retransmit.erase((seqno - 1) / mss());
     _nack_rtxs++;
     _pacer.just_sent();
     // _pending_retransmit = 0; // maybe this should be a list?
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -515,7 +547,6 @@ ConstantCcaSubflowSrc::receivePacket(Packet& pkt)
     ConstantCcaAck *p = (ConstantCcaAck*)(&pkt);
     ConstantCcaAck::seq_t ackno = p->ackno();
     ConstantCcaAck::seq_t ds_ackno = p->ds_ackno();
-    // _acks_received.push_back(ackno);
 
     if (p->is_nack()) {
         // cout << nodename() << " received NACK " << ackno << endl;
@@ -557,14 +588,8 @@ ConstantCcaSubflowSrc::receivePacket(Packet& pkt)
 
     if (_src.plb()) {
         simtime_picosec now = eventlist().now();
-        _ecn_marks.emplace_back(pkt.flags() & ECN_CE);
-        if (_ecn_marks.size() > 10) {
-            _ecn_marks.pop_front();
-        }
-        int total_marks = 0;
-        for (auto& m : _ecn_marks) {
-            total_marks += m;
-        }
+        _ecn_marks = ((_ecn_marks << 1) | ((pkt.flags() & ECN_CE) ? 1 : 0)) & 0x3ff;
+        int total_marks = __builtin_popcount(_ecn_marks);
         if (total_marks < _plb_threshold_ecn) {
             // not enough marks to be a problem
             _last_good_path = now;
@@ -596,6 +621,14 @@ ConstantCcaSubflowSrc::receivePacket(Packet& pkt)
     handle_ack(ackno);
 }
 
+simtime_picosec
+ConstantCcaSubflowSrc::rtx_timer_due() const {
+    // rtx_timer_hook does nothing until we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void
 ConstantCcaSubflowSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     //cout << timeAsUs(eventlist().now()) << " " << nodename() << " rtx_timer_hook" << endl;
@@ -640,6 +673,7 @@ ConstantCcaSubflowSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec perio
         //if (_rto > timeFromMs(1000))
         //  _rto = timeFromMs(1000);
         _RFC2988_RTO_timeout = now + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -651,10 +685,10 @@ void ConstantCcaSubflowSrc::doNextEvent() {
     }
     if(_src._highest_dsn_ack >= _src._flow_size) {
         _RFC2988_RTO_timeout = timeInf;
+        rtx_timer_update();
         return;
     }
     if(_rtx_timeout_pending) {
-        // _rto_times.push_back(eventlist().now());
         _rtx_timeout_pending = false;
 
         _in_fast_recovery = false;
@@ -677,17 +711,70 @@ void ConstantCcaSubflowSrc::doNextEvent() {
     }
 }
 
+void
+ConstantCcaSubflowSrc::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ConstantCcaSubflowSrc));
+    checkpoint_random(archive);
+    archive.check(_mss, "MSS");
+    archive.io(_maxcwnd);
+    archive.io(_highest_sent);
+    archive.io(_packets_sent);
+    archive.io(_highest_sent_abs);
+    archive.io(_established);
+    archive.io(_rtt);
+    archive.io(_rto);
+    archive.io(_min_rto);
+    archive.io(_mdev);
+    archive.io(_min_rtt);
+    archive.io(_max_rtt);
+    archive.io(_inflate);
+    archive.io(_recoverq);
+    archive.io(_in_fast_recovery);
+    _dsn_map.checkpoint(archive);
+    archive.io(_min_cwnd);
+    archive.io(_max_cwnd);
+    archive.io(_const_cwnd);
+    archive.io(_prev_cwnd);
+    archive.io(_last_acked);
+    archive.io(_dupacks);
+    archive.io(_retransmit_cnt);
+    archive.io(_rtx_reset_threshold);
+    archive.io(_pacing_delay);
+    archive.io(_last_good_path);
+    archive.io(_ecn_marks);
+    archive.io(_plb_threshold_ecn);
+    archive.io(_path_qualities);
+    archive.io(_path_skipped);
+    archive.io(_drops);
+    archive.io(_RFC2988_RTO_timeout);
+    archive.io(_rtx_timeout_pending);
+    archive.io(_rto_count);
+    archive.io(_total_dupacks);
+    archive.io(_pathid);
+    archive.io(_path_index);
+    archive.route(_route);
+    _pending_retransmit.checkpoint(archive);
+    archive.io(deferred_retransmit);
+    archive.io(_repeated_nack_rtxs);
+    archive.io(_nack_backoff);
+    archive.io(_deferred_send);
+    archive.io(_plb_interval);
+    archive.io(_nack_rtxs);
+    checkpoint_rtx_timer(archive);
+}
+
 void 
 ConstantCcaSubflowSrc::connect(ConstantCcaSink& sink, const Route& routeout, const Route& routein, ConstBaseScheduler* scheduler) {
     _subflow_sink = sink.connect(_src, *this, routein);
-    Route* new_route = routeout.clone(); // make a copy, as we may be switching routes and don't want to append the sink more than once
-    new_route->push_back(_subflow_sink);
-    _route = new_route;
+    Route new_route(routeout); // make a copy, as we may be switching routes and don't want to append the sink more than once
+    new_route.push_back(_subflow_sink);
+    _route = RouteStore::current().intern(new_route);
     _flow.set_id(get_id()); // identify the packet flow with the source that generated it
     cout << "connect, flow id is now " << _flow.get_id() << endl;
     // cout << "connect, flow id (flow_id()) is now " << _flow.flow_id() << endl;
     assert(scheduler);
-    scheduler->add_src(_flow.flow_id(), this);
+    if (!scheduler->has_src(_flow.flow_id())) // a recycled subflow is still there
+        scheduler->add_src(_flow.flow_id(), this);
 }
 
 void
@@ -711,38 +798,53 @@ ConstantCcaSubflowSrc::move_path_flow_label() {
 void
 ConstantCcaSubflowSrc::move_path(bool permit_cycles) {
     cout << timeAsUs(eventlist().now()) << " " << nodename() << " td move_path\n";
-    if (_src._paths.size() == 0) {
+    if (_src.no_of_paths() == 0) {
         cout << nodename() << " cant move_path\n";
         return;
     }
     _path_index++;
     if (!permit_cycles) {
         // if we've moved paths so often we've run out of paths, I want to know
-        assert(_path_index < _src._paths.size()); 
-    } else if (_path_index >= _src._paths.size()) {
-        _path_index = _path_index % _src._paths.size();
+        assert(_path_index < _src.no_of_paths()); 
+    } else if (_path_index >= _src.no_of_paths()) {
+        _path_index = _path_index % _src.no_of_paths();
     }
-    Route* new_route = _src._paths[_path_index]->clone();
-    new_route->push_back(_subflow_sink);
-    _route = new_route;
+    Route new_route(*_src.path(_path_index));
+    new_route.push_back(_subflow_sink);
+    _route = RouteStore::current().intern(new_route);
 }
 
 void
 ConstantCcaSubflowSrc::reroute(const Route &routeout) {
-    Route* new_route = routeout.clone();
-    new_route->push_back(_subflow_sink);
-    _route = new_route;
+    Route new_route(routeout);
+    new_route.push_back(_subflow_sink);
+    _route = RouteStore::current().intern(new_route);
 }
 
 ////////////////////////////////////////////////////////////////
 //  CONSTANT CCA SRC
 ////////////////////////////////////////////////////////////////
 
-ConstantCcaSrc::ConstantCcaSrc(ConstantCcaRtxTimerScanner& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger)
+ConstantCcaSrc::ConstantCcaSrc(RtxTimerWheel& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger)
     : EventSource(eventlist,"constcca"),  _traffic_logger(pkt_logger), _rtx_timer_scanner(&rtx_scanner)
 {
     _mss = Packet::data_packet_size();
     _scheduler = NULL;
+    _end_trigger = NULL;
+    _addr = addr;
+    _pacing_delay = pacing_delay;
+    reset();
+}
+
+void
+ConstantCcaSrc::reset() {
+    for (size_t i = 0; i < _subs.size(); i++) {
+        // quiet, with no timers, until connect() picks it up again
+        _subs[i]->reset(_subs[i]->pacing_delay());
+    }
+    _idle_subs.insert(_idle_subs.end(), _subs.rbegin(), _subs.rend());
+    _subs.clear();
+    _sink = NULL;
     _flow_size = ((uint64_t)1)<<63;
     _stop_time = 0;
     _stopped = false;
@@ -756,9 +858,10 @@ ConstantCcaSrc::ConstantCcaSrc(ConstantCcaRtxTimerScanner& rtx_scanner, EventLis
     _fr_disabled = false;
     _adaptive = false;
     _ev_count = 32;
-
-    _addr = addr;
-    _pacing_delay = pacing_delay;
+    _dupack_threshold = 3;
+    _paths.clear();
+    _path_source = NULL;
+    _path_dest = 0;
 }
 
 void 
@@ -769,6 +872,15 @@ ConstantCcaSrc::connect(ConstantCcaSink& sink, simtime_picosec starttime, uint32
     // new_route->push_back(_sink);
     _scheduler = dynamic_cast<ConstBaseScheduler*>(routeout.at(0));
     for (uint32_t i = 0; i < no_of_subflows; i++) {
+        if (!_idle_subs.empty()) {
+            // already registered with the scheduler and timer wheel
+            ConstantCcaSubflowSrc* subflow = _idle_subs.back();
+            _idle_subs.pop_back();
+            subflow->reset(_pacing_delay * no_of_subflows);
+            _subs.push_back(subflow);
+            subflow->connect(sink, routeout, routein, _scheduler);
+            continue;
+        }
         ConstantCcaSubflowSrc* subflow = new ConstantCcaSubflowSrc(*this, _traffic_logger, _subs.size(), _pacing_delay * no_of_subflows);
         _subs.push_back(subflow);
         // assert(_paths.size() > 0);
@@ -779,13 +891,49 @@ ConstantCcaSrc::connect(ConstantCcaSink& sink, simtime_picosec starttime, uint32
         // const Route* routeback = _paths[i%_paths.size()]->reverse();
         // assert(routeback);
         subflow->connect(sink, routeout, routein, _scheduler);
-        _rtx_timer_scanner->registerSubflow(subflow);
+        _rtx_timer_scanner->registerSrc(*subflow);
     }
     _start_time = starttime;
     eventlist().sourceIsPending(*this,starttime);
     // cout << "starttime " << timeAsUs(starttime) << endl;
 }
 
+void
+ConstantCcaSrc::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ConstantCcaSrc));
+    if (_end_trigger)
+        archive.fail("can't save a flow's end trigger");
+    checkpoint_random(archive);
+    archive.check(_addr, "source address");
+    archive.check(_destination, "destination");
+    archive.check(_mss, "MSS");
+    archive.check(_subs.size(), "subflows");
+    archive.check(_idle_subs.size(), "idle subflows");
+    archive.check(_path_source != NULL, "path source");
+    archive.check(_path_dest, "path destination");
+    archive.ref(_scheduler);
+    archive.io(_plb);
+    archive.io(_plb_threshold_ecn);
+    archive.io(_spraying);
+    archive.io(_adaptive);
+    archive.io(_ev_count);
+    archive.io(_highest_dsn_sent);
+    archive.io(_flow_size);
+    archive.io(_stop_time);
+    archive.io(_stopped);
+    archive.io(_completion_time);
+    archive.io(_start_time);
+    archive.io(_highest_dsn_ack);
+    archive.io(_pacing_delay);
+    archive.io(_fr_disabled);
+    archive.io(_dupack_threshold);
+    uint64_t paths = _paths.size();
+    archive.io(paths);
+    _paths.resize(paths);
+    for (size_t i = 0; i < paths; i++)
+        archive.route(_paths[i]);
+}
+
 void ConstantCcaSrc::update_dsn_ack(ConstantCcaAck::seq_t ds_ackno) {
     //cout << "Flow " << _name << " dsn ack " << ds_ackno << endl;
     _highest_dsn_ack = max(_highest_dsn_ack, ds_ackno);
@@ -794,7 +942,9 @@ void ConstantCcaSrc::update_dsn_ack(ConstantCcaAck::seq_t ds_ackno) {
         for (size_t i = 0; i < _subs.size(); i++) {
             _subs[i]->_pacer.cancel();
         }
-        cout << "Flow " << _name << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ds_ackno << endl;
+        cout << "Flow " << str() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ds_ackno << endl;
+        if (_end_trigger)
+            _end_trigger->activate();
     }
 }
 
@@ -827,17 +977,18 @@ ConstantCcaSrc::set_paths(vector<const Route*>* rt_list){
     size_t no_of_paths = rt_list->size();
     _paths.resize(no_of_paths);
     for (size_t i=0; i < no_of_paths; i++){
-        Route* rt_tmp = new Route(*(rt_list->at(i)));
+        Route rt_tmp(*(rt_list->at(i)));
         if (!_scheduler) {
-            _scheduler = dynamic_cast<ConstBaseScheduler*>(rt_tmp->at(0));
+            _scheduler = dynamic_cast<ConstBaseScheduler*>(rt_tmp.at(0));
             assert(_scheduler);
         } else {
             // sanity check all paths share the same scheduler.  If we ever want to use multiple NICs, this will need fixing
-            assert(_scheduler == dynamic_cast<ConstBaseScheduler*>(rt_tmp->at(0)));
+            assert(_scheduler == dynamic_cast<ConstBaseScheduler*>(rt_tmp.at(0)));
         }
-        rt_tmp->set_path_id(i, rt_list->size());
-        _paths[i] = rt_tmp;
+        rt_tmp.set_path_id(i, rt_list->size());
+        _paths[i] = RouteStore::current().intern(rt_tmp);
     }
+    _path_source = NULL;
     // permute_paths();
     for (size_t i = 0; i < _subs.size(); i++) {
         _subs[i]->_path_index = 0;
@@ -845,6 +996,42 @@ ConstantCcaSrc::set_paths(vector<const Route*>* rt_list){
     }
 }
 
+void
+ConstantCcaSrc::set_paths(PathSource& paths, uint32_t destination) {
+    _paths.clear();
+    _path_source = &paths;
+    _path_dest = destination;
+    for (size_t i = 0; i < _subs.size(); i++) {
+        _subs[i]->_path_index = 0;
+        _subs[i]->reroute(*path(i));
+    }
+}
+
+size_t
+ConstantCcaSrc::no_of_paths() {
+    if (_path_source)
+        return _path_source->no_of_paths(_addr, _path_dest);
+    return _paths.size();
+}
+
+const Route*
+ConstantCcaSrc::path(size_t i) {
+    if (!_path_source)
+        return _paths[i];
+    // the same route set_paths(vector) would have made
+    const Route* found = _path_source->get_path(_addr, _path_dest, i);
+    Route rt(*found);
+    _path_source->put_path(found);
+    if (!_scheduler) {
+        _scheduler = dynamic_cast<ConstBaseScheduler*>(rt.at(0));
+        assert(_scheduler);
+    } else {
+        assert(_scheduler == dynamic_cast<ConstBaseScheduler*>(rt.at(0)));
+    }
+    rt.set_path_id(i, no_of_paths());
+    return RouteStore::current().intern(rt);
+}
+
 void
 ConstantCcaSrc::permute_paths() {
     // Fisher-Yates shuffle
@@ -925,14 +1112,41 @@ ConstantCcaSink::ConstantCcaSink()
     : DataReceiver("ConstantCcaSink"), _cumulative_data_ack(0), _buffer_logger(NULL)
 {
     _src = NULL;
+    _subs_connected = 0;
     _nodename = "constantccasink";
 }
 
+void
+ConstantCcaSink::reset() {
+    _cumulative_data_ack = 0;
+    _dsn_received.clear();
+    _src = NULL;
+    for (size_t i = 0; i < _subs.size(); i++) {
+        _subs[i]->reset();
+    }
+    _subs_connected = 0;
+}
+
+void
+ConstantCcaSink::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ConstantCcaSink));
+    archive.check(_subs.size(), "subflow sinks");
+    archive.check(_subs_connected, "subflow sinks connected");
+    archive.io(_cumulative_data_ack);
+    _dsn_received.checkpoint(archive);
+}
+
 ConstantCcaSubflowSink*
 ConstantCcaSink::connect(ConstantCcaSrc& src, ConstantCcaSubflowSrc& subflow_src, const Route& route_back) {
     _src = &src;
-    ConstantCcaSubflowSink* subflow_sink = new ConstantCcaSubflowSink(*this);
-    _subs.push_back(subflow_sink);
+    ConstantCcaSubflowSink* subflow_sink;
+    if (_subs_connected < _subs.size()) {
+        subflow_sink = _subs[_subs_connected];
+    } else {
+        subflow_sink = new ConstantCcaSubflowSink(*this);
+        _subs.push_back(subflow_sink);
+    }
+    _subs_connected++;
     subflow_sink->connect(subflow_src, route_back);
     return subflow_sink;
 }
@@ -945,15 +1159,12 @@ ConstantCcaSink::receivePacket(Packet& pkt) {
     //cout << "ConstantCcaSink received dsn " << dsn << endl;
     if (dsn == _cumulative_data_ack+1) {
         _cumulative_data_ack = dsn + size - 1;
-        while (!_dsn_received.empty() && (*(_dsn_received.begin()) == _cumulative_data_ack+1) ) {
-            _dsn_received.erase(_dsn_received.begin());
-            _cumulative_data_ack+= size;
-        }
+        _cumulative_data_ack += _dsn_received.consume(_cumulative_data_ack / size) * size;
     } else if (dsn < _cumulative_data_ack+1) {
         // cout << "Dup DSN received!\n";
     } else {
         // hole in sequence space
-        _dsn_received.insert(dsn);
+        _dsn_received.insert((dsn - 1) / size);
     }
 }
 
@@ -991,21 +1202,38 @@ ConstantCcaSink::nacks_sent() {
 ConstantCcaSubflowSink::ConstantCcaSubflowSink(ConstantCcaSink& sink) 
     : DataReceiver("ConstantCcaSubflowSink"), _sink(sink)
 {
+    reset();
+    _nodename = "constantccasubflowsink";
+}
+
+void
+ConstantCcaSubflowSink::reset() {
     _cumulative_ack = 0;
     _packets = 0;
     _spurious_retransmits = 0;
     _drops = 0;
     _nacks_sent = 0;
+    _received.clear();
     _subflow_src = NULL;
-    _nodename = "constantccasubflowsink";
+}
+
+void
+ConstantCcaSubflowSink::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ConstantCcaSubflowSink));
+    archive.io(_cumulative_ack);
+    archive.io(_packets);
+    archive.io(_spurious_retransmits);
+    archive.io(_drops);
+    archive.io(_nacks_sent);
+    _received.checkpoint(archive);
 }
 
 void
 ConstantCcaSubflowSink::connect(ConstantCcaSubflowSrc& src, const Route& route) {
     _subflow_src = &src;
-    Route *rt = route.clone();
-    rt->push_back(&src);
-    _route = rt;
+    Route rt(route);
+    rt.push_back(&src);
+    _route = RouteStore::current().intern(rt);
     _cumulative_ack = 0;
     _spurious_retransmits = 0;
 }
@@ -1033,10 +1261,7 @@ ConstantCcaSubflowSink::receivePacket(Packet& pkt) {
     if (seqno == _cumulative_ack+1) { // it's the next expected seq no
         _cumulative_ack = seqno + size - 1;
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (*(_received.begin()) == _cumulative_ack+1) ) {
-            _received.erase(_received.begin());
-            _cumulative_ack += size;
-        }
+        _cumulative_ack += _received.consume(_cumulative_ack / size) * size;
     } else if (seqno < _cumulative_ack+1) {
         // it is before the next expected sequence - must be a spurious retransmit.
         // We want to see if this happens - it generally shouldn't
@@ -1044,7 +1269,7 @@ ConstantCcaSubflowSink::receivePacket(Packet& pkt) {
         _spurious_retransmits++;
     } else {
         // it's not the next expected sequence number
-        _received.insert(seqno);
+        _received.insert((seqno - 1) / size);
     }
 
     _sink.receivePacket(pkt);
@@ -1075,27 +1300,3 @@ ConstantCcaSubflowSink::send_nack(simtime_picosec ts, uint32_t ack_dst, uint32_t
     nack->sendOn();
     _nacks_sent++;
 }
-
-////////////////////////////////////////////////////////////////
-//  RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-ConstantCcaRtxTimerScanner::ConstantCcaRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod){
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-ConstantCcaRtxTimerScanner::registerSubflow(ConstantCcaSubflowSrc* subflow_src) {
-    _srcs.push_back(subflow_src);
-}
-
-
-void ConstantCcaRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    for (auto it = _srcs.begin(); it != _srcs.end(); it++) {
-        ConstantCcaSubflowSrc* src = *it;
-        src->rtx_timer_hook(now, _scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
@@ -13,9 +13,14 @@
 #include "network.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "seq_bitmap.h"
+#include "seq_ring.h"
+#include "rtx_timer.h"
 #include "constant_cca_packet.h"
 #include "constant_cca_scheduler.h"
+#include "trigger.h"
 #include "ecn.h"
+#include "memory_account.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
 
@@ -25,7 +30,6 @@ class ConstantCcaSrc;
 class ConstantCcaSink;
 class ConstantCcaSubflowSrc;
 class ConstantCcaSubflowSink;
-class ConstantCcaRtxTimerScanner;
 class ConstBaseScheduler;
 
 class ConstantCcaPacer : public EventSource {
@@ -34,26 +38,42 @@ public:
     bool is_pending() const {return _interpacket_delay > 0;}  // are we pacing?
     void schedule_send(simtime_picosec delay);  // schedule a paced packet "delay" picoseconds after the last packet was sent
     void cancel();     // cancel pacing
+    void reset(simtime_picosec interpacket_delay); // as if just constructed
     void just_sent();  // called when we've just sent a packet, even if it wasn't paced
     void doNextEvent();
     bool allow_send();
+    virtual void checkpoint(CheckpointArchive& archive);
 private:
     ConstantCcaSubflowSrc* _src;
     simtime_picosec _interpacket_delay; // the interpacket delay, or zero if we're not pacing
     simtime_picosec _last_send;  // when the last packet was sent (always set, even when we're not pacing)
     simtime_picosec _next_send;  // when the next scheduled packet should be sent
+    EventList::Handle _next_send_handle; // the event for _next_send, so cancel() is cheap
 };
 
 class ConstantCcaSrc : public EventSource {
     friend class ConstantCcaSink;
-    friend class ConstantCcaRtxTimerScanner;
 public:
-    ConstantCcaSrc(ConstantCcaRtxTimerScanner& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger);
+    MEMORY_ACCOUNTED(TRANSPORT)
+    ConstantCcaSrc(RtxTimerWheel& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger);
     virtual void connect(ConstantCcaSink& sink, simtime_picosec startTime, uint32_t no_of_subflows, uint32_t destination, const Route& routeout, const Route& routein); 
     void startflow();
 
+    // Forget the last connection, so this src can be connected again,
+    // to any destination, instead of making a new one.  Its subflows
+    // are reused by the next connect(), keeping their flow ids and so
+    // their place in the scheduler and timer wheel, and its end trigger
+    // stays set.  Packets of the old connection still in the network
+    // will confuse the new one, so leave it long enough for them to
+    // drain first.
+    void reset();
+
+    // activated whenever a flow completes
+    void set_end_trigger(Trigger& trigger) {_end_trigger = &trigger;}
+
     void doNextEvent();
     void update_dsn_ack(ConstantCcaAck::seq_t ds_ackno);
+    virtual void checkpoint(CheckpointArchive& archive);
     // virtual void receivePacket(Packet& pkt);
 
     void set_flowsize(uint64_t flow_size_in_bytes) {
@@ -85,6 +105,8 @@ public:
     // add paths for PLB
     void enable_plb() {_plb = true;}
     void set_paths(vector<const Route*>* rt);
+    // look paths up when they're needed instead of keeping them all
+    void set_paths(PathSource& paths, uint32_t destination);
     void permute_paths();
     bool _plb;
     inline bool plb() const {return _plb;}
@@ -115,8 +137,13 @@ public:
     uint16_t _mss;
     inline uint16_t mss() const {return _mss;}
 
-    // paths for PLB or MPSwift
+    // paths for PLB or MPSwift: _paths, or _path_source's paths to
+    // _path_dest if there is one
     vector<const Route*> _paths;
+    PathSource* _path_source;
+    uint32_t _path_dest;
+    size_t no_of_paths();
+    const Route* path(size_t i);
 
     ConstantCcaSink* _sink;
     uint32_t _destination;
@@ -142,21 +169,26 @@ private:
     // Housekeeping
     TrafficLogger* _traffic_logger;
     ConstBaseScheduler* _scheduler;
-    ConstantCcaRtxTimerScanner* _rtx_timer_scanner;
+    RtxTimerWheel* _rtx_timer_scanner;
+    Trigger* _end_trigger;
 
     // Mechanism
     void clear_timer(uint64_t start,uint64_t end);
 
     // list of subflows
     vector<ConstantCcaSubflowSrc*> _subs;
+    // subflows of an earlier connection, last first, for connect() to reuse
+    vector<ConstantCcaSubflowSrc*> _idle_subs;
 };
 
 
 
-class ConstantCcaSubflowSrc : public EventSource, public PacketSink, public ConstScheduledSrc {
+class ConstantCcaSubflowSrc : public EventSource, public PacketSink, public ConstScheduledSrc, public RtxTimerClient {
     friend class ConstantCcaSrc;
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     ConstantCcaSubflowSrc(ConstantCcaSrc& src, TrafficLogger* pktlogger, int subflow_id, simtime_picosec pacing_delay);
+    void reset(simtime_picosec pacing_delay); // connection state, as if just constructed
     virtual const string& nodename() { return _nodename; }
     virtual void receivePacket(Packet& pkt);
     void update_rtt(simtime_picosec delay);
@@ -167,8 +199,11 @@ public:
     void reroute(const Route &route);
     void doNextEvent();
     void rtx_timer_hook(simtime_picosec now, simtime_picosec period);
+    simtime_picosec rtx_timer_due() const;
+    virtual void checkpoint(CheckpointArchive& archive);
     inline simtime_picosec pacing_delay() const {return _pacing_delay;}
     PacketFlow& flow() {return _flow;}
+    EventSource& pacer() {return _pacer;}
 
     void set_pacing_delay(simtime_picosec delay) { _pacing_delay = delay; }
 
@@ -209,7 +244,7 @@ protected:
     uint64_t _recoverq;
     bool _in_fast_recovery;
 
-    map <ConstantCcaPacket::seq_t, ConstantCcaPacket::seq_t> _dsn_map;  // map of subflow seqno to data seqno
+    SeqRing<ConstantCcaPacket::seq_t> _dsn_map;  // data seqno by subflow packet, (seqno-1)/mss; 0 if none yet
 
     uint32_t _min_cwnd;
     uint32_t _max_cwnd;
@@ -225,7 +260,7 @@ protected:
 
     // PLB stuff
     simtime_picosec _last_good_path;
-    std::deque<bool> _ecn_marks;
+    uint16_t _ecn_marks; // of the last 10 acks, newest in bit 0
     int _plb_threshold_ecn;
 
     // Adaptive spraying stuff
@@ -247,7 +282,7 @@ protected:
     const Route* _route;
 
     // Account for NACK-based retransmissions when pacing 
-    std::set<uint64_t> _pending_retransmit;
+    SeqBitmap _pending_retransmit; // by packet, (seqno-1)/mss
     bool deferred_retransmit;
 
     uint32_t _repeated_nack_rtxs;
@@ -263,9 +298,7 @@ private:
     simtime_picosec _plb_interval;
     string _nodename;
 
-    std::vector<uint32_t> _acks_received;
     uint32_t _nack_rtxs;
-    std::vector<simtime_picosec> _rto_times;
 };
 
 
@@ -277,7 +310,10 @@ class ConstantCcaSubflowSink : public PacketSink, public DataReceiver {
     friend class ConstantCcaSrc;
     friend class ConstantCcaSink;
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     ConstantCcaSubflowSink(ConstantCcaSink& sink);
+    void reset();
+    virtual void checkpoint(CheckpointArchive& archive);
 
     void receivePacket(Packet& pkt);
     ConstantCcaAck::seq_t _cumulative_ack; // seqno of the last byte in the packet we have
@@ -293,7 +329,7 @@ public:
     uint32_t _nacks_sent;
     uint32_t nacks_sent() { return _nacks_sent; }
 
-    set<ConstantCcaAck::seq_t> _received; 
+    SeqBitmap _received; // by packet, (seqno-1)/mss, past _cumulative_ack
     virtual const string& nodename() { return _nodename; }
 
 
@@ -319,14 +355,18 @@ class ConstantCcaSink : public PacketSink, public DataReceiver {
     friend class ConstantCcaSrc;
     friend class ConstantCcaSubflowSrc;
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     ConstantCcaSink();
+    // forget the last connection, keeping the subflow sinks for the next
+    void reset();
+    virtual void checkpoint(CheckpointArchive& archive);
 
     void receivePacket(Packet& pkt);
     ConstantCcaAck::seq_t _cumulative_data_ack; // seqno of the last DSN byte in the packet we have
                                           // cumulatively acked
     virtual const string& nodename() { return _nodename; }
 
-    set <ConstantCcaPacket::seq_t> _dsn_received; // use a map because multipath packets will arrive out of order
+    SeqBitmap _dsn_received; // by packet, (dsn-1)/mss: multipath packets will arrive out of order
 
     ConstantCcaSrc* _src;
     uint64_t cumulative_ack() { return _cumulative_data_ack;};
@@ -340,16 +380,7 @@ private:
     ConstantCcaSubflowSink* connect(ConstantCcaSrc& src, ConstantCcaSubflowSrc& subflow_src, const Route& route);
     string _nodename;
     ReorderBufferLogger* _buffer_logger;
-};
-
-class ConstantCcaRtxTimerScanner : public EventSource {
-public:
-    ConstantCcaRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerSubflow(ConstantCcaSubflowSrc* subflow_src);
-private:
-    simtime_picosec _scanPeriod;
-    std::vector<ConstantCcaSubflowSrc*> _srcs;
+    uint32_t _subs_connected; // _subs past these are left from an earlier connection
 };
 
 #endif
@@ -14,6 +14,7 @@ ConstantErasureCcaPacer::ConstantErasureCcaPacer(ConstantErasureCcaSrc& src, Eve
     : EventSource(event_list,"constant_cca_pacer"), _src(&src), _interpacket_delay(interpacket_delay) {
     _last_send = 0;
     _next_send = 0;
+    _next_send_handle = eventlist().nullHandle();
 }
 
 void
@@ -40,7 +41,7 @@ ConstantErasureCcaPacer::schedule_send(simtime_picosec delay) {
     }
     // cout << "Setting next send to " << timeAsUs(new_next_send) << endl;
     _next_send = new_next_send;
-    eventlist().sourceIsPending(*this, _next_send);
+    _next_send_handle = eventlist().sourceIsPendingGetHandle(*this, _next_send);
 }
 
 bool 
@@ -57,7 +58,7 @@ void
 ConstantErasureCcaPacer::cancel() {
     _interpacket_delay = 0;
     _next_send = 0;
-    eventlist().cancelPendingSource(*this);
+    eventlist().cancelPendingSourceByHandle(*this, _next_send_handle);
 }
 
 // called when we're in window-mode to update the send time so it's always correct if we
@@ -270,9 +271,9 @@ void
 ConstantErasureCcaSrc::connect(ConstantErasureCcaSink& sink, simtime_picosec startTime, uint32_t destination, const Route& routeout, const Route& routein) {
     _sink = &sink;
     _destination = destination;
-    Route* new_route = routeout.clone(); // make a copy, as we may be switching routes and don't want to append the sink more than once
-    new_route->push_back(_sink);
-    _route = new_route;
+    Route new_route(routeout); // make a copy, as we may be switching routes and don't want to append the sink more than once
+    new_route.push_back(_sink);
+    _route = RouteStore::current().intern(new_route);
     _flow.set_id(get_id()); // identify the packet flow with the source that generated it
     cout << "connect, flow id is now " << _flow.get_id() << endl;
     // cout << "connect, flow id (flow_id()) is now " << _flow.flow_id() << endl;
@@ -328,16 +329,16 @@ ConstantErasureCcaSrc::move_path(bool permit_cycles) {
     } else if (_path_index >= _paths.size()) {
         _path_index = _path_index % _paths.size();
     }
-    Route* new_route = _paths[_path_index]->clone();
-    new_route->push_back(_sink);
-    _route = new_route;
+    Route new_route(*_paths[_path_index]);
+    new_route.push_back(_sink);
+    _route = RouteStore::current().intern(new_route);
 }
 
 void
 ConstantErasureCcaSrc::reroute(const Route &routeout) {
-    Route* new_route = routeout.clone();
-    new_route->push_back(_sink);
-    _route = new_route;
+    Route new_route(routeout);
+    new_route.push_back(_sink);
+    _route = RouteStore::current().intern(new_route);
 }
 
 int
@@ -367,16 +368,16 @@ ConstantErasureCcaSrc::set_paths(vector<const Route*>* rt_list){
     size_t no_of_paths = rt_list->size();
     _paths.resize(no_of_paths);
     for (size_t i=0; i < no_of_paths; i++){
-        Route* rt_tmp = new Route(*(rt_list->at(i)));
+        Route rt_tmp(*(rt_list->at(i)));
         if (!_scheduler) {
-            _scheduler = dynamic_cast<ConstBaseScheduler*>(rt_tmp->at(0));
+            _scheduler = dynamic_cast<ConstBaseScheduler*>(rt_tmp.at(0));
             assert(_scheduler);
         } else {
             // sanity check all paths share the same scheduler.  If we ever want to use multiple NICs, this will need fixing
-            assert(_scheduler == dynamic_cast<ConstBaseScheduler*>(rt_tmp->at(0)));
+            assert(_scheduler == dynamic_cast<ConstBaseScheduler*>(rt_tmp.at(0)));
         }
-        rt_tmp->set_path_id(i, rt_list->size());
-        _paths[i] = rt_tmp;
+        rt_tmp.set_path_id(i, rt_list->size());
+        _paths[i] = RouteStore::current().intern(rt_tmp);
     }
     permute_paths();
     _path_index = 0;
@@ -421,9 +422,9 @@ ConstantErasureCcaSink::ConstantErasureCcaSink()
 void
 ConstantErasureCcaSink::connect(ConstantErasureCcaSrc& src, const Route& route) {
     _src = &src;
-    Route *rt = route.clone();
-    rt->push_back(&src);
-    _route = rt;
+    Route rt(route);
+    rt.push_back(&src);
+    _route = RouteStore::current().intern(rt);
 }
 
 void
@@ -37,6 +37,7 @@ private:
     simtime_picosec _interpacket_delay; // the interpacket delay, or zero if we're not pacing
     simtime_picosec _last_send;  // when the last packet was sent (always set, even when we're not pacing)
     simtime_picosec _next_send;  // when the next scheduled packet should be sent
+    EventList::Handle _next_send_handle; // the event for _next_send, so cancel() is cheap
 };
 
 
@@ -12,6 +12,7 @@ ConstantCcaOPacer::ConstantCcaOPacer(ConstantCcaOSrc& src, EventList& event_list
     : EventSource(event_list,"constant_cca_pacer"), _src(&src), _interpacket_delay(interpacket_delay) {
     _last_send = eventlist().now();
     _next_send = 0;
+    _next_send_handle = eventlist().nullHandle();
 }
 
 void
@@ -38,7 +39,7 @@ ConstantCcaOPacer::schedule_send(simtime_picosec delay) {
     }
     // cout << "Setting next send to " << timeAsUs(new_next_send) << endl;
     _next_send = new_next_send;
-    eventlist().sourceIsPending(*this, _next_send);
+    _next_send_handle = eventlist().sourceIsPendingGetHandle(*this, _next_send);
 }
 
 bool 
@@ -55,7 +56,7 @@ void
 ConstantCcaOPacer::cancel() {
     _interpacket_delay = 0;
     _next_send = 0;
-    eventlist().cancelPendingSource(*this);
+    eventlist().cancelPendingSourceByHandle(*this, _next_send_handle);
 }
 
 // called when we're in window-mode to update the send time so it's always correct if we
@@ -92,7 +93,7 @@ ConstantCcaOPacer::doNextEvent() {
 //  CONSTANT CCA SRC
 ////////////////////////////////////////////////////////////////
 
-ConstantCcaOSrc::ConstantCcaOSrc(ConstantCcaORtxTimerScanner& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger)
+ConstantCcaOSrc::ConstantCcaOSrc(RtxTimerWheel& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger)
     : EventSource(eventlist, "constant_cca_src"), _pacer(*this, eventlist, pacing_delay), _flow(pkt_logger)
 {
     _addr = addr;
@@ -149,7 +150,7 @@ ConstantCcaOSrc::ConstantCcaOSrc(ConstantCcaORtxTimerScanner& rtx_scanner, Event
     _spraying = false;
 
     _rtx_timer_scanner = &rtx_scanner;
-    _rtx_timer_scanner->addSrc(this);
+    _rtx_timer_scanner->registerSrc(*this);
 
     _nodename = "constcca_src_" + std::to_string(get_id());
 
@@ -217,12 +218,14 @@ ConstantCcaOSrc::handle_ack(ConstantCcaAck::seq_t ackno) {
     simtime_picosec now = eventlist().now();
     if (ackno > _last_acked) { // a brand new ack
         _RFC2988_RTO_timeout = now + _rto;// RFC 2988 5.3
+        rtx_timer_update();
     
         if (ackno >= _highest_sent) {
             
             _highest_sent = ackno;
             //cout << timeAsUs(now) << " " << nodename() << " highest_sent now  " << _highest_sent << endl;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
+            rtx_timer_update();
         }
 
         if (!_in_fast_recovery) {
@@ -315,7 +318,7 @@ ConstantCcaOSrc::send_packets() {
     if (_last_acked >= _flow_size && _completion_time == 0){ // should this be in receive packet instead?
         _completion_time = eventlist().now();
         // _pacer.cancel();
-        cout << "Flow " << _name << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << _last_acked<< endl;
+        cout << "Flow " << str() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << _last_acked<< endl;
     }
 
     // if (deferred_retransmit) { // should also check pacer? How else could this be called?
@@ -351,6 +354,7 @@ ConstantCcaOSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return sent_count;
@@ -408,6 +412,7 @@ ConstantCcaOSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
             //cout << timeAsUs(eventlist().now()) << " " << nodename() << " RTO at " << timeAsUs(_RFC2988_RTO_timeout) << "us" << endl;
         }
     }
@@ -493,6 +498,7 @@ ConstantCcaOSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1 // the fact that with NACKs this broke concerns me - are we getting worse performance? I thought this was necessary since otherwise you won't timeout if you were first in fast retransmit, right? Let's test
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -526,6 +532,7 @@ ConstantCcaOSrc::retransmit_packet(uint64_t seqno) {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -618,6 +625,14 @@ ConstantCcaOSrc::receivePacket(Packet& pkt)
     handle_ack(ackno);
 }
 
+simtime_picosec
+ConstantCcaOSrc::rtx_timer_due() const {
+    // rtx_timer_hook does nothing until we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void
 ConstantCcaOSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     //cout << timeAsUs(eventlist().now()) << " " << nodename() << " rtx_timer_hook" << endl;
@@ -662,6 +677,7 @@ ConstantCcaOSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
         //if (_rto > timeFromMs(1000))
         //  _rto = timeFromMs(1000);
         _RFC2988_RTO_timeout = now + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -673,6 +689,7 @@ void ConstantCcaOSrc::doNextEvent() {
     }
     if(_last_acked >= _flow_size) {
         _RFC2988_RTO_timeout = timeInf;
+        rtx_timer_update();
         return;
     }
     if(_rtx_timeout_pending) {
@@ -922,21 +939,3 @@ ConstantCcaOSink::cumulative_ack() {
 uint32_t ConstantCcaOSink::spurious_retransmits() {
     return _spurious_retransmits;
 }
-
-////////////////////////////////////////////////////////////////
-//  RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-ConstantCcaORtxTimerScanner::ConstantCcaORtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod){
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void ConstantCcaORtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    for (auto it = _srcs.begin(); it != _srcs.end(); it++) {
-        ConstantCcaOSrc* src = *it;
-        src->rtx_timer_hook(now, _scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
\ No newline at end of file
@@ -13,6 +13,7 @@
 #include "network.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "rtx_timer.h"
 #include "constant_cca_packet.h"
 #include "constant_cca_scheduler.h"
 #include "ecn.h"
@@ -23,7 +24,6 @@
 
 class ConstantCcaOSrc;
 class ConstantCcaOSink;
-class ConstantCcaORtxTimerScanner;
 class ConstBaseScheduler;
 
 class ConstantCcaOPacer : public EventSource {
@@ -40,14 +40,14 @@ private:
     simtime_picosec _interpacket_delay; // the interpacket delay, or zero if we're not pacing
     simtime_picosec _last_send;  // when the last packet was sent (always set, even when we're not pacing)
     simtime_picosec _next_send;  // when the next scheduled packet should be sent
+    EventList::Handle _next_send_handle; // the event for _next_send, so cancel() is cheap
 };
 
 
-class ConstantCcaOSrc : public EventSource, public PacketSink, public ConstScheduledSrc {
+class ConstantCcaOSrc : public EventSource, public PacketSink, public ConstScheduledSrc, public RtxTimerClient {
     friend class ConstantCcaOSink;
-    friend class ConstantCcaORtxTimerScanner;
 public:
-    ConstantCcaOSrc(ConstantCcaORtxTimerScanner& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger);
+    ConstantCcaOSrc(RtxTimerWheel& rtx_scanner, EventList &eventlist, uint32_t addr, simtime_picosec pacing_delay, TrafficLogger* pkt_logger);
     virtual const string& nodename() { return _nodename; }
     virtual void receivePacket(Packet& pkt);
     void update_rtt(simtime_picosec delay);
@@ -58,6 +58,7 @@ public:
     void reroute(const Route &route);
     void doNextEvent();
     void rtx_timer_hook(simtime_picosec now, simtime_picosec period);
+    simtime_picosec rtx_timer_due() const;
     inline simtime_picosec pacing_delay() const {return _pacing_delay;}
     PacketFlow& flow() {return _flow;}
 
@@ -204,7 +205,7 @@ private:
 
     // Housekeeping
     ConstBaseScheduler* _scheduler;
-    ConstantCcaORtxTimerScanner* _rtx_timer_scanner;
+    RtxTimerWheel* _rtx_timer_scanner;
 
     // Mechanism
     void clear_timer(uint64_t start,uint64_t end);
@@ -256,14 +257,4 @@ private:
     void send_nack(simtime_picosec ts, uint32_t ack_dst, uint32_t ack_src, uint32_t pathid, uint64_t seqno);
 };
 
-class ConstantCcaORtxTimerScanner : public EventSource {
-public:
-    ConstantCcaORtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void addSrc(ConstantCcaOSrc* src) { _srcs.push_back(src); }
-private:
-    simtime_picosec _scanPeriod;
-    std::vector<ConstantCcaOSrc*> _srcs;
-};
-
 #endif
\ No newline at end of file
@@ -1,4 +1,24 @@
 #include "constant_cca_packet.h"
+#include "checkpoint.h"
 
 PacketDB<ConstantCcaPacket> ConstantCcaPacket::_packetdb;
 PacketDB<ConstantCcaAck> ConstantCcaAck::_packetdb;
+
+void
+ConstantCcaPacket::checkpoint(CheckpointArchive& archive) {
+    Packet::checkpoint(archive);
+    archive.io(_seqno);
+    archive.io(_dsn);
+    archive.io(_ts);
+    archive.io(_syn);
+}
+
+void
+ConstantCcaAck::checkpoint(CheckpointArchive& archive) {
+    Packet::checkpoint(archive);
+    archive.io(_seqno);
+    archive.io(_ackno);
+    archive.io(_ds_ackno);
+    archive.io(_ts_echo);
+    archive.io(_is_nack);
+}
@@ -46,12 +46,13 @@ public:
     inline void set_ts(simtime_picosec ts) {_ts = ts;}
     virtual PktPriority priority() const {return Packet::PRIO_LO;}  // change this if you want to use swift with priority queues
     inline bool is_header() const {return _is_header;}
+    virtual void checkpoint(CheckpointArchive& archive);
 
 protected:
     seq_t _seqno;
     seq_t _dsn;
-    bool _syn;
     simtime_picosec _ts;
+    bool _syn;
     static PacketDB<ConstantCcaPacket> _packetdb;
 };
 
@@ -102,6 +103,7 @@ public:
     inline simtime_picosec ts_echo() const {return _ts_echo;}
     inline bool is_nack() const {return _is_nack;}
     virtual PktPriority priority() const {return Packet::PRIO_HI;}
+    virtual void checkpoint(CheckpointArchive& archive);
 
     virtual ~ConstantCcaAck(){}
     const static int ACKSIZE=40;
@@ -2,6 +2,7 @@
 #include <math.h>
 #include "constant_cca_scheduler.h"
 #include "constant_cca_packet.h"
+#include "checkpoint.h"
 
 
 // We have one Swift Scheduler per sending host.  Multiple Swift flows
@@ -92,6 +93,31 @@ ConstBaseScheduler::completeService()
 }
 
 
+void
+ConstBaseScheduler::checkpoint_counts(CheckpointArchive& archive) {
+    checkpoint_base(archive);
+    archive.check(_srcs.size(), "the scheduler's sources");
+    archive.io(_pkt_count);
+    uint64_t n = _queue_counts.size();
+    archive.io(n);
+    if (archive.saving()) {
+        for (map<flowid_t, int32_t>::iterator i = _queue_counts.begin(); i != _queue_counts.end(); i++) {
+            flowid_t flow_id = i->first;
+            archive.io(flow_id);
+            archive.io(i->second);
+        }
+        return;
+    }
+    _queue_counts.clear();
+    for (uint64_t i = 0; i < n; i++) {
+        flowid_t flow_id;
+        int32_t count;
+        archive.io(flow_id);
+        archive.io(count);
+        _queue_counts[flow_id] = count;
+    }
+}
+
 /************************************************************************/
 /* FiFo Scheduler                                                       */
 /************************************************************************/
@@ -203,3 +229,34 @@ ConstFairScheduler::create_queue(const Packet& pkt) {
 }
 
 
+
+void
+ConstFairScheduler::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ConstFairScheduler));
+    checkpoint_counts(archive);
+    // every flow's queue, even the empty ones, as they set the round robin
+    uint64_t n = _queue_map.size();
+    archive.io(n);
+    if (archive.restoring()) {
+        for (map<flowid_t, list<Packet*>*>::iterator i = _queue_map.begin(); i != _queue_map.end(); i++)
+            delete i->second;
+        _queue_map.clear();
+    }
+    map<flowid_t, list<Packet*>*>::iterator q = _queue_map.begin();
+    for (uint64_t i = 0; i < n; i++) {
+        flowid_t flow_id = archive.saving() ? q->first : 0;
+        archive.io(flow_id);
+        if (archive.restoring())
+            q = _queue_map.insert(make_pair(flow_id, new list<Packet*>)).first;
+        archive.packets(*q->second);
+        q++;
+    }
+    archive.packet(_next_packet);
+
+    bool at_end = (_current_queue == _queue_map.end());
+    flowid_t current = at_end ? 0 : _current_queue->first;
+    archive.io(at_end);
+    archive.io(current);
+    if (archive.restoring())
+        _current_queue = at_end ? _queue_map.end() : _queue_map.find(current);
+}
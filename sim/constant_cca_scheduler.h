@@ -40,9 +40,13 @@ class ConstBaseScheduler : public BaseQueue {
         return (simtime_picosec)(pkt->size() * _ps_per_byte); 
     }
     void add_src(int32_t flowid, ConstScheduledSrc* src);
+    bool has_src(int32_t flowid) const {return _srcs.find(flowid) != _srcs.end();}
     int src_queuesize(int32_t flowid) {return _queue_counts[flowid];}
     map <flowid_t, int32_t> _queue_counts; 
  protected:
+    // save or restore the packet counts, for checkpoint()
+    void checkpoint_counts(CheckpointArchive& archive);
+
     uint32_t _pkt_count;
      // map from flow id to packet count
     map <flowid_t, ConstScheduledSrc*> _srcs; // map from flow id to SubflowSrc for callbacks
@@ -65,6 +69,7 @@ class ConstFairScheduler : public ConstBaseScheduler{
     virtual void enqueue(Packet& pkt);
     virtual Packet* next_packet();
     virtual Packet* dequeue();
+    virtual void checkpoint(CheckpointArchive& archive);
  protected:
     map<flowid_t, list<Packet*>*> _queue_map;  // map flow id to pull queue
     Packet *_next_packet; // when we start dequeuing a packet, it must
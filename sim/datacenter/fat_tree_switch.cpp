@@ -5,8 +5,10 @@
 #include "callback_pipe.h"
 #include "queue_lossless.h"
 #include "queue_lossless_output.h"
+#include "checkpoint.h"
+#include <algorithm>
 
-unordered_map<BaseQueue*,uint32_t> FatTreeSwitch::_port_flow_counts;
+thread_local unordered_map<BaseQueue*,uint32_t> FatTreeSwitch::_port_flow_counts;
 
 FatTreeSwitch::FatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec delay, FatTreeTopology* ft): Switch(eventlist, s) {
     _id = id;
@@ -58,11 +60,15 @@ void FatTreeSwitch::receivePacket(Packet& pkt){
 };
 
 void FatTreeSwitch::addHostPort(int addr, int flowid, PacketSink* transport){
-    Route* rt = new Route();
-    rt->push_back(_ft->queues_nlp_ns[_ft->HOST_POD_SWITCH(addr)][addr][0]);
-    rt->push_back(_ft->pipes_nlp_ns[_ft->HOST_POD_SWITCH(addr)][addr][0]);
-    rt->push_back(transport);
-    _fib->addHostRoute(addr,rt,flowid);
+    Route rt;
+    rt.push_back(_ft->queues_nlp_ns[_ft->HOST_POD_SWITCH(addr)][addr][0]);
+    rt.push_back(_ft->pipes_nlp_ns[_ft->HOST_POD_SWITCH(addr)][addr][0]);
+    rt.push_back(transport);
+    _fib->addHostRoute(addr,RouteStore::current().intern(rt),flowid);
+}
+
+void FatTreeSwitch::removeHostPort(int addr, int flowid){
+    _fib->removeHostRoute(addr,flowid);
 }
 
 uint32_t mhash(uint32_t x) {
@@ -80,7 +86,7 @@ uint32_t FatTreeSwitch::adaptive_route_p2c(vector<FibEntry*>* ecmp_set, int8_t (
     do {
         start = random()%ecmp_set->size();
 
-        Route * r= (*ecmp_set)[start]->getEgressPort();
+        const Route * r= (*ecmp_set)[start]->getEgressPort();
         assert(r && r->size()>1);
         BaseQueue* q = (BaseQueue*)(r->at(0));
         assert(q);
@@ -177,10 +183,10 @@ uint32_t FatTreeSwitch::replace_worst_choice(vector<FibEntry*>* ecmp_set, int8_t
 
 
 int8_t FatTreeSwitch::compare_pause(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     LosslessOutputQueue* q1 = dynamic_cast<LosslessOutputQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     LosslessOutputQueue* q2 = dynamic_cast<LosslessOutputQueue*>(r2->at(0));
 
@@ -193,10 +199,10 @@ int8_t FatTreeSwitch::compare_pause(FibEntry* left, FibEntry* right){
 }
 
 int8_t FatTreeSwitch::compare_flow_count(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = (BaseQueue*)(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = (BaseQueue*)(r2->at(0));
 
@@ -217,10 +223,10 @@ int8_t FatTreeSwitch::compare_flow_count(FibEntry* left, FibEntry* right){
 }
 
 int8_t FatTreeSwitch::compare_queuesize(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = dynamic_cast<BaseQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = dynamic_cast<BaseQueue*>(r2->at(0));
 
@@ -233,10 +239,10 @@ int8_t FatTreeSwitch::compare_queuesize(FibEntry* left, FibEntry* right){
 }
 
 int8_t FatTreeSwitch::compare_bandwidth(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = dynamic_cast<BaseQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = dynamic_cast<BaseQueue*>(r2->at(0));
 
@@ -310,15 +316,100 @@ void FatTreeSwitch::permute_paths(vector<FibEntry *>* uproutes) {
     }
 }
 
-FatTreeSwitch::routing_strategy FatTreeSwitch::_strategy = FatTreeSwitch::NIX;
-uint16_t FatTreeSwitch::_ar_fraction = 0;
-uint16_t FatTreeSwitch::_ar_sticky = FatTreeSwitch::PER_PACKET;
-simtime_picosec FatTreeSwitch::_sticky_delta = timeFromUs((uint32_t)10);
-double FatTreeSwitch::_ecn_threshold_fraction = 0.5;
-double FatTreeSwitch::_speculative_threshold_fraction = 0.2;
-int8_t (*FatTreeSwitch::fn)(FibEntry*,FibEntry*)= &FatTreeSwitch::compare_queuesize;
+void FatTreeSwitch::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(FatTreeSwitch));
+    if (fn == compare_flow_count) {
+        // the flow counts are per thread, not per switch
+        archive.fail("can't save adaptive routing by flow count");
+    }
+    checkpoint_random(archive);
+    archive.check(_id, "switch ID");
+    archive.check(_type, "switch type");
+    archive.io(_crt_route);
+    archive.io(_hash_salt);
+    archive.io(_last_choice);
+    _fib->checkpoint(archive);
+
+    // the destination whose routes _uproutes are, and everyone going up shares
+    int64_t up = -1;
+    if (archive.saving() && _uproutes) {
+        for (uint32_t d = 0; d < _ft->no_of_nodes() && up < 0; d++) {
+            if (_fib->getRoutes(d) == _uproutes)
+                up = d;
+        }
+        if (up < 0)
+            archive.fail("switch " + _name + " has up routes that aren't in its FIB");
+    }
+    archive.io(up);
+    if (archive.restoring())
+        _uproutes = up < 0 ? NULL : _fib->getRoutes(up);
+
+    struct Flowlet {
+        uint32_t flow_id;
+        uint32_t egress;
+        simtime_picosec last;
+    };
+    vector<Flowlet> flowlets;
+    unordered_map<uint32_t,FlowletInfo*>::iterator f;
+    for (f = _flowlet_maps.begin(); f != _flowlet_maps.end(); f++) {
+        if (archive.saving())
+            flowlets.push_back(Flowlet{f->first, f->second->_egress, f->second->_last});
+        else
+            delete f->second;
+    }
+    sort(flowlets.begin(), flowlets.end(),
+         [](const Flowlet& a, const Flowlet& b) {return a.flow_id < b.flow_id;});
+    archive.io(flowlets);
+    if (archive.restoring()) {
+        _flowlet_maps.clear();
+        for (size_t i = 0; i < flowlets.size(); i++)
+            _flowlet_maps[flowlets[i].flow_id] = new FlowletInfo(flowlets[i].egress, flowlets[i].last);
+    }
+
+    // the packets between ingress and egress
+    vector<Packet*> crossing;
+    unordered_map<Packet*,bool>::iterator p;
+    for (p = _packets.begin(); p != _packets.end(); p++)
+        crossing.push_back(p->first);
+    uint64_t n = crossing.size();
+    archive.io(n);
+    crossing.resize(n);
+    for (size_t i = 0; i < n; i++)
+        archive.packet(crossing[i]);
+    if (archive.restoring()) {
+        _packets.clear();
+        for (size_t i = 0; i < n; i++)
+            _packets[crossing[i]] = true;
+    }
+}
+
+thread_local FatTreeSwitch::routing_strategy FatTreeSwitch::_strategy = FatTreeSwitch::NIX;
+thread_local uint16_t FatTreeSwitch::_ar_fraction = 0;
+thread_local uint16_t FatTreeSwitch::_ar_sticky = FatTreeSwitch::PER_PACKET;
+thread_local simtime_picosec FatTreeSwitch::_sticky_delta = timeFromUs((uint32_t)10);
+thread_local double FatTreeSwitch::_ecn_threshold_fraction = 0.5;
+thread_local double FatTreeSwitch::_speculative_threshold_fraction = 0.2;
+thread_local int8_t (*FatTreeSwitch::fn)(FibEntry*,FibEntry*)= &FatTreeSwitch::compare_queuesize;
+
+std::function<void()> FatTreeSwitch::thread_settings() {
+    routing_strategy strategy = _strategy;
+    uint16_t ar_fraction = _ar_fraction, ar_sticky = _ar_sticky;
+    simtime_picosec sticky_delta = _sticky_delta;
+    double ecn_threshold_fraction = _ecn_threshold_fraction;
+    double speculative_threshold_fraction = _speculative_threshold_fraction;
+    int8_t (*cmp)(FibEntry*,FibEntry*) = fn;
+    return [=]() {
+        _strategy = strategy;
+        _ar_fraction = ar_fraction;
+        _ar_sticky = ar_sticky;
+        _sticky_delta = sticky_delta;
+        _ecn_threshold_fraction = ecn_threshold_fraction;
+        _speculative_threshold_fraction = speculative_threshold_fraction;
+        fn = cmp;
+    };
+}
 
-Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
+const Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
     vector<FibEntry*> * available_hops = _fib->getRoutes(pkt.dst());
     
     if (available_hops){
@@ -424,13 +515,13 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
 
                 for (uint32_t k=agg_min; k<=agg_max;k++){
                     for (uint32_t b = 0; b < _ft->bundlesize(AGG_TIER); b++) {
-                        Route * r = new Route();
-                        r->push_back(_ft->queues_nlp_nup[_id][k][b]);
-                        assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                        Route r;
+                        r.push_back(_ft->queues_nlp_nup[_id][k][b]);
+                        assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
-                        r->push_back(_ft->pipes_nlp_nup[_id][k][b]);
-                        r->push_back(_ft->queues_nlp_nup[_id][k][b]->getRemoteEndpoint());
-                        _fib->addRoute(pkt.dst(),r,1,UP);
+                        r.push_back(_ft->pipes_nlp_nup[_id][k][b]);
+                        r.push_back(_ft->queues_nlp_nup[_id][k][b]->getRemoteEndpoint());
+                        _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1,UP);
                     }
 
                     /*
@@ -448,14 +539,14 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
             //target NLP id is 2 * pkt.dst()/K
             uint32_t target_tor = _ft->HOST_POD_SWITCH(pkt.dst());
             for (uint32_t b = 0; b < _ft->bundlesize(AGG_TIER); b++) {
-                Route * r = new Route();
-                r->push_back(_ft->queues_nup_nlp[_id][target_tor][b]);
-                assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                Route r;
+                r.push_back(_ft->queues_nup_nlp[_id][target_tor][b]);
+                assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
-                r->push_back(_ft->pipes_nup_nlp[_id][target_tor][b]);          
-                r->push_back(_ft->queues_nup_nlp[_id][target_tor][b]->getRemoteEndpoint());
+                r.push_back(_ft->pipes_nup_nlp[_id][target_tor][b]);          
+                r.push_back(_ft->queues_nup_nlp[_id][target_tor][b]->getRemoteEndpoint());
 
-                _fib->addRoute(pkt.dst(),r,1, DOWN);
+                _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1, DOWN);
             }
         } else {
             //go up!
@@ -467,19 +558,19 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
                 for (uint32_t l = 0; l <  uplink_bundles ; l++) {
                     uint32_t core = l * _ft->agg_switches_per_pod() + podpos;
                     for (uint32_t b = 0; b < _ft->bundlesize(CORE_TIER); b++) {
-                        Route *r = new Route();
-                        r->push_back(_ft->queues_nup_nc[_id][core][b]);
-                        assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                        Route r;
+                        r.push_back(_ft->queues_nup_nc[_id][core][b]);
+                        assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
-                        r->push_back(_ft->pipes_nup_nc[_id][core][b]);
-                        r->push_back(_ft->queues_nup_nc[_id][core][b]->getRemoteEndpoint());
+                        r.push_back(_ft->pipes_nup_nc[_id][core][b]);
+                        r.push_back(_ft->queues_nup_nc[_id][core][b]->getRemoteEndpoint());
 
                         /*
                           FatTreeSwitch* next = (FatTreeSwitch*)_ft->queues_nup_nc[_id][k]->getRemoteEndpoint();
                           assert (next->getType()==CORE && next->getID() == k);
                         */
                     
-                        _fib->addRoute(pkt.dst(),r,1,UP);
+                        _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1,UP);
 
                         //cout << "AGG switch " << _id << " adding route to " << pkt.dst() << " via CORE " << k << " bundle_id " << b << endl;
                     }
@@ -491,18 +582,18 @@ Route* FatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
     } else if (_type == CORE) {
         uint32_t nup = _ft->MIN_POD_AGG_SWITCH(_ft->HOST_POD(pkt.dst())) + (_id % _ft->agg_switches_per_pod());
         for (uint32_t b = 0; b < _ft->bundlesize(CORE_TIER); b++) {
-            Route *r = new Route();
+            Route r;
             // cout << "CORE switch " << _id << " adding route to " << pkt.dst() << " via AGG " << nup << endl;
 
             assert (_ft->queues_nc_nup[_id][nup][b]);
-            r->push_back(_ft->queues_nc_nup[_id][nup][b]);
-            assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+            r.push_back(_ft->queues_nc_nup[_id][nup][b]);
+            assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
             assert (_ft->pipes_nc_nup[_id][nup][b]);
-            r->push_back(_ft->pipes_nc_nup[_id][nup][b]);
+            r.push_back(_ft->pipes_nc_nup[_id][nup][b]);
 
-            r->push_back(_ft->queues_nc_nup[_id][nup][b]->getRemoteEndpoint());
-            _fib->addRoute(pkt.dst(),r,1,DOWN);
+            r.push_back(_ft->queues_nc_nup[_id][nup][b]->getRemoteEndpoint());
+            _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1,DOWN);
         }
     }
     else {
@@ -5,6 +5,7 @@
 #include "switch.h"
 #include "callback_pipe.h"
 #include <unordered_map>
+#include <functional>
 
 class FatTreeTopology;
 
@@ -98,8 +99,9 @@ public:
     FatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec switch_delay, FatTreeTopology* ft);
   
     virtual void receivePacket(Packet& pkt);
-    virtual Route* getNextHop(Packet& pkt, BaseQueue* ingress_port);
+    virtual const Route* getNextHop(Packet& pkt, BaseQueue* ingress_port);
     virtual uint32_t getType() {return _type;}
+    Pipe* pipe() const {return _pipe;} // models the switch latency
 
     uint32_t adaptive_route(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*));
     uint32_t replace_worst_choice(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*),uint32_t my_choice);
@@ -114,22 +116,26 @@ public:
     static int8_t compare_pb(FibEntry* l, FibEntry* r);//compare pause, bandwidth
     static int8_t compare_qb(FibEntry* l, FibEntry* r);//compare pause, bandwidth
 
-    static int8_t (*fn)(FibEntry*,FibEntry*);
+    static thread_local int8_t (*fn)(FibEntry*,FibEntry*);
 
     virtual void addHostPort(int addr, int flowid, PacketSink* transport);
+    virtual void removeHostPort(int addr, int flowid);
 
     virtual void permute_paths(vector<FibEntry*>* uproutes);
+    virtual void checkpoint(CheckpointArchive& archive);
 
     static void set_strategy(routing_strategy s) { assert (_strategy==NIX); _strategy = s; }
     static void set_ar_fraction(uint16_t f) { assert(f>=1);_ar_fraction = f;} 
     static void set_ar_sticky(uint16_t v) { _ar_sticky = v;} 
-
-    static routing_strategy _strategy;
-    static uint16_t _ar_fraction;
-    static uint16_t _ar_sticky;
-    static simtime_picosec _sticky_delta;
-    static double _ecn_threshold_fraction;
-    static double _speculative_threshold_fraction;
+    // copies the settings above for another thread; see FatTreeTopology::thread_settings()
+    static std::function<void()> thread_settings();
+
+    static thread_local routing_strategy _strategy;
+    static thread_local uint16_t _ar_fraction;
+    static thread_local uint16_t _ar_sticky;
+    static thread_local simtime_picosec _sticky_delta;
+    static thread_local double _ecn_threshold_fraction;
+    static thread_local double _speculative_threshold_fraction;
 private:
     switch_type _type;
     Pipe* _pipe;
@@ -140,7 +146,7 @@ private:
 
     unordered_map<uint32_t,FlowletInfo*> _flowlet_maps;
 
-    static unordered_map<BaseQueue*,uint32_t> _port_flow_counts;
+    static thread_local unordered_map<BaseQueue*,uint32_t> _port_flow_counts;
 
     uint32_t _crt_route;
     uint32_t _hash_salt;
@@ -23,17 +23,18 @@
 extern void tokenize(string const &str, const char delim, vector<string> &out);
 
 // default to 3-tier topology.  Change this with set_tiers() before calling the constructor.
-uint32_t FatTreeTopology::_tiers = 3;
-simtime_picosec FatTreeTopology::_link_latencies[] = {0,0,0};
-simtime_picosec FatTreeTopology::_switch_latencies[] = {0,0,0};
-uint32_t FatTreeTopology::_hosts_per_pod = 0;
-uint32_t FatTreeTopology::_radix_up[] = {0,0};
-uint32_t FatTreeTopology::_radix_down[] = {0,0,0};
-mem_b FatTreeTopology::_queue_up[] = {0,0};
-mem_b FatTreeTopology::_queue_down[] = {0,0,0};
-uint32_t FatTreeTopology::_bundlesize[] = {1,1,1};
-uint32_t FatTreeTopology::_oversub[] = {1,1,1};
-linkspeed_bps FatTreeTopology::_downlink_speeds[] = {0,0,0};
+thread_local uint32_t FatTreeTopology::_tiers = 3;
+thread_local simtime_picosec FatTreeTopology::_link_latencies[] = {0,0,0};
+thread_local simtime_picosec FatTreeTopology::_switch_latencies[] = {0,0,0};
+thread_local uint32_t FatTreeTopology::_hosts_per_pod = 0;
+thread_local uint32_t FatTreeTopology::_radix_up[] = {0,0};
+thread_local uint32_t FatTreeTopology::_radix_down[] = {0,0,0};
+thread_local mem_b FatTreeTopology::_queue_up[] = {0,0};
+thread_local mem_b FatTreeTopology::_queue_down[] = {0,0,0};
+thread_local uint32_t FatTreeTopology::_bundlesize[] = {1,1,1};
+thread_local uint32_t FatTreeTopology::_oversub[] = {1,1,1};
+thread_local linkspeed_bps FatTreeTopology::_downlink_speeds[] = {0,0,0};
+thread_local PdesEngine* FatTreeTopology::_pdes_engine = NULL;
 
 void
 FatTreeTopology::set_tier_parameters(int tier, int radix_up, int radix_down, mem_b queue_up, mem_b queue_down, int bundlesize, linkspeed_bps linkspeed, int oversub) {
@@ -256,6 +257,8 @@ FatTreeTopology::FatTreeTopology(uint32_t no_of_nodes, linkspeed_bps linkspeed,
     _qt = q;
     _sender_qt = snd;
     failed_links = 0;
+    flaky_links = 0;
+    _rts = false;
     if ((latency != 0 || switch_latency != 0) && _link_latencies[TOR_TIER] != 0) {
         cerr << "Don't set latencies using both the constructor and set_latencies - use only one of the two\n";
         exit(1);
@@ -641,51 +644,51 @@ void FatTreeTopology::alloc_vectors() {
     queues_ns_nlp.resize(NSRV, vector< vector<BaseQueue*> >(NTOR, vector<BaseQueue*>(_bundlesize[TOR_TIER])));
 }
 
-BaseQueue* FatTreeTopology::alloc_src_queue(QueueLogger* queueLogger){
+BaseQueue* FatTreeTopology::alloc_src_queue(QueueLogger* queueLogger, EventList& eventlist){
     linkspeed_bps linkspeed = _downlink_speeds[TOR_TIER]; // linkspeeds are symmetric
     switch (_sender_qt) {
     case SWIFT_SCHEDULER:
-        return new FairScheduler(linkspeed, *_eventlist, queueLogger);
+        return new FairScheduler(linkspeed, eventlist, queueLogger);
     case CONST_SCHEDULER:
-        return new ConstFairScheduler(linkspeed, *_eventlist, queueLogger);
+        return new ConstFairScheduler(linkspeed, eventlist, queueLogger);
     case PRIORITY:
         return new PriorityQueue(linkspeed,
-                                 memFromPkt(FEEDER_BUFFER), *_eventlist, queueLogger);
+                                 memFromPkt(FEEDER_BUFFER), eventlist, queueLogger);
     case FAIR_PRIO:
         return new FairPriorityQueue(linkspeed,
-                                     memFromPkt(FEEDER_BUFFER), *_eventlist, queueLogger);
+                                     memFromPkt(FEEDER_BUFFER), eventlist, queueLogger);
     default:
         abort();
     }
 }
 
 BaseQueue* FatTreeTopology::alloc_queue(QueueLogger* queueLogger, mem_b queuesize,
-                                        link_direction dir, int switch_tier, bool tor = false){
+                                        link_direction dir, int switch_tier, bool tor, EventList& eventlist){
     if (dir == UPLINK) {
         switch_tier++; // _downlink_speeds is set for the downlinks, so uplinks need to use the tier above's linkspeed
     }
-    return alloc_queue(queueLogger, _downlink_speeds[switch_tier], queuesize, dir, switch_tier, tor);
+    return alloc_queue(queueLogger, _downlink_speeds[switch_tier], queuesize, dir, switch_tier, tor, eventlist);
 }
 
 BaseQueue*
 FatTreeTopology::alloc_queue(QueueLogger* queueLogger, linkspeed_bps speed, mem_b queuesize,
-                             link_direction dir, int switch_tier, bool tor){
+                             link_direction dir, int switch_tier, bool tor, EventList& eventlist){
     switch (_qt) {
     case RANDOM:
-        return new RandomQueue(speed, queuesize, *_eventlist, queueLogger, memFromPkt(RANDOM_BUFFER));
+        return new RandomQueue(speed, queuesize, eventlist, queueLogger, memFromPkt(RANDOM_BUFFER));
     case COMPOSITE:
     {
-        CompositeQueue* q = new CompositeQueue(speed, queuesize, *_eventlist, queueLogger);
+        CompositeQueue* q = new CompositeQueue(speed, queuesize, eventlist, queueLogger);
         q->setRTS(_rts);
         return q;
     }
     case CTRL_PRIO:
-        return new CtrlPrioQueue(speed, queuesize, *_eventlist, queueLogger);
+        return new CtrlPrioQueue(speed, queuesize, eventlist, queueLogger);
     case AEOLUS:
-        return new AeolusQueue(speed, queuesize, FatTreeSwitch::_speculative_threshold_fraction * queuesize,  *_eventlist, queueLogger);
+        return new AeolusQueue(speed, queuesize, FatTreeSwitch::_speculative_threshold_fraction * queuesize,  eventlist, queueLogger);
     case AEOLUS_ECN:
         {
-            AeolusQueue* q = new AeolusQueue(speed, queuesize, FatTreeSwitch::_speculative_threshold_fraction * queuesize ,  *_eventlist, queueLogger);
+            AeolusQueue* q = new AeolusQueue(speed, queuesize, FatTreeSwitch::_speculative_threshold_fraction * queuesize ,  eventlist, queueLogger);
             if (!tor || dir == UPLINK) {
                 // don't use ECN on ToR downlinks
                 q->set_ecn_threshold(FatTreeSwitch::_ecn_threshold_fraction * queuesize);
@@ -693,45 +696,45 @@ FatTreeTopology::alloc_queue(QueueLogger* queueLogger, linkspeed_bps speed, mem_
             return q;
         }
     case ECN:
-        return new ECNQueue(speed, queuesize, *_eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
+        return new ECNQueue(speed, queuesize, eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
     case ECN_PRIO:
         return new ECNPrioQueue(speed, queuesize, queuesize,
                                 FatTreeSwitch::_ecn_threshold_fraction * queuesize,
                                 FatTreeSwitch::_ecn_threshold_fraction * queuesize,
-                                *_eventlist, queueLogger);
+                                eventlist, queueLogger);
     case LOSSLESS:
-        return new LosslessQueue(speed, queuesize, *_eventlist, queueLogger, NULL);
+        return new LosslessQueue(speed, queuesize, eventlist, queueLogger, NULL);
     case LOSSLESS_INPUT:
-        return new LosslessOutputQueue(speed, queuesize, *_eventlist, queueLogger);
+        return new LosslessOutputQueue(speed, queuesize, eventlist, queueLogger);
     case LOSSLESS_INPUT_ECN: 
-        return new LosslessOutputQueue(speed, queuesize*10, *_eventlist, queueLogger,1,FatTreeSwitch::_ecn_threshold_fraction * queuesize);
+        return new LosslessOutputQueue(speed, queuesize*10, eventlist, queueLogger,1,FatTreeSwitch::_ecn_threshold_fraction * queuesize);
     case COMPOSITE_ECN:
         if (tor && dir == DOWNLINK) {
-            CompositeQueue* q = new CompositeQueue(speed, queuesize, *_eventlist, queueLogger);
+            CompositeQueue* q = new CompositeQueue(speed, queuesize, eventlist, queueLogger);
             q->setRTS(_rts);
             return q;
         } else {
-            return new ECNQueue(speed, queuesize, *_eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
+            return new ECNQueue(speed, queuesize, eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
             // return new ECNQueue(speed, memFromPkt(2*SWITCH_BUFFER), *_eventlist, queueLogger, memFromPkt(15));
         }
     case COMPOSITE_ECN_DEF:
         if (tor && dir == DOWNLINK) {
-            CompositeQueue* q = new CompositeQueue(speed, queuesize, *_eventlist, queueLogger);
+            CompositeQueue* q = new CompositeQueue(speed, queuesize, eventlist, queueLogger);
             q->setRTS(_rts);
             return q;
         } else {
             // return new ECNQueue(speed, queuesize, *_eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
-            return new ECNQueue(speed, memFromPkt(2*SWITCH_BUFFER), *_eventlist, queueLogger, memFromPkt(15));
+            return new ECNQueue(speed, memFromPkt(2*SWITCH_BUFFER), eventlist, queueLogger, memFromPkt(15));
         }
     case ECN_BIG:
         if (tor && dir == DOWNLINK) {
-            return new ECNQueue(speed, queuesize, *_eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
+            return new ECNQueue(speed, queuesize, eventlist, queueLogger, FatTreeSwitch::_ecn_threshold_fraction * queuesize);
         } else {
-            return new ECNQueue(speed, memFromPkt(2*SWITCH_BUFFER), *_eventlist, queueLogger, memFromPkt(15));
+            return new ECNQueue(speed, memFromPkt(2*SWITCH_BUFFER), eventlist, queueLogger, memFromPkt(15));
         }
     case COMPOSITE_ECN_LB:
         {
-            CompositeQueue* q = new CompositeQueue(speed, queuesize, *_eventlist, queueLogger);
+            CompositeQueue* q = new CompositeQueue(speed, queuesize, eventlist, queueLogger);
             if (!tor || dir == UPLINK) {
                 // don't use ECN on ToR downlinks
                 q->set_ecn_threshold(FatTreeSwitch::_ecn_threshold_fraction * queuesize);
@@ -746,6 +749,12 @@ FatTreeTopology::alloc_queue(QueueLogger* queueLogger, linkspeed_bps speed, mem_
 
 void FatTreeTopology::init_network(){
     QueueLogger* queueLogger;
+    _pdes = _pdes_engine;
+    if (_pdes && (_qt == LOSSLESS || _qt == LOSSLESS_INPUT || _qt == LOSSLESS_INPUT_ECN)) {
+        // pause frames go straight from switch to switch, not through a pipe
+        cerr << "Lossless queues can't be split across LPs" << endl;
+        exit(1);
+    }
     if (_tiers == 3) {
         for (uint32_t j=0;j<NCORE;j++) {
             for (uint32_t k=0;k<NAGG;k++) {
@@ -786,19 +795,21 @@ void FatTreeTopology::init_network(){
     // changed to always create switches
     for (uint32_t j=0;j<NTOR;j++){
         simtime_picosec switch_latency = (_switch_latencies[TOR_TIER] > 0) ? _switch_latencies[TOR_TIER] : _switch_latency;
-        switches_lp[j] = new FatTreeSwitch(*_eventlist, "Switch_LowerPod_"+ntoa(j),FatTreeSwitch::TOR,j,switch_latency,this);
+        switches_lp[j] = new FatTreeSwitch(lp_eventlist(tor_lp(j)), "Switch_LowerPod_"+ntoa(j),FatTreeSwitch::TOR,j,switch_latency,this);
     }
     for (uint32_t j=0;j<NAGG;j++){
         simtime_picosec switch_latency = (_switch_latencies[AGG_TIER] > 0) ? _switch_latencies[AGG_TIER] : _switch_latency;
-        switches_up[j] = new FatTreeSwitch(*_eventlist, "Switch_UpperPod_"+ntoa(j), FatTreeSwitch::AGG,j,switch_latency,this);
+        switches_up[j] = new FatTreeSwitch(lp_eventlist(agg_lp(j)), "Switch_UpperPod_"+ntoa(j), FatTreeSwitch::AGG,j,switch_latency,this);
     }
     for (uint32_t j=0;j<NCORE;j++){
         simtime_picosec switch_latency = (_switch_latencies[CORE_TIER] > 0) ? _switch_latencies[CORE_TIER] : _switch_latency;
-        switches_c[j] = new FatTreeSwitch(*_eventlist, "Switch_Core_"+ntoa(j), FatTreeSwitch::CORE,j,switch_latency,this);
+        switches_c[j] = new FatTreeSwitch(lp_eventlist(core_lp(j)), "Switch_Core_"+ntoa(j), FatTreeSwitch::CORE,j,switch_latency,this);
     }
       
     // links from lower layer pod switch to server
     for (uint32_t tor = 0; tor < NTOR; tor++) {
+        // hosts are on their ToR's LP
+        EventList& eventlist = lp_eventlist(tor_lp(tor));
         uint32_t link_bundles = _radix_down[TOR_TIER]/_bundlesize[TOR_TIER];
         for (uint32_t l = 0; l < link_bundles; l++) {
             uint32_t srv = tor * link_bundles + l;
@@ -810,11 +821,11 @@ void FatTreeTopology::init_network(){
                     queueLogger = NULL;
                 }
             
-                queues_nlp_ns[tor][srv][b] = alloc_queue(queueLogger, _queue_down[TOR_TIER], DOWNLINK, TOR_TIER, true);
+                queues_nlp_ns[tor][srv][b] = alloc_queue(queueLogger, _queue_down[TOR_TIER], DOWNLINK, TOR_TIER, true, eventlist);
                 queues_nlp_ns[tor][srv][b]->setName("LS" + ntoa(tor) + "->DST" +ntoa(srv) + "(" + ntoa(b) + ")");
                 //if (logfile) logfile->writeName(*(queues_nlp_ns[tor][srv]));
                 simtime_picosec hop_latency = (_hop_latency == 0) ? _link_latencies[TOR_TIER] : _hop_latency;
-                pipes_nlp_ns[tor][srv][b] = new Pipe(hop_latency, *_eventlist);
+                pipes_nlp_ns[tor][srv][b] = new Pipe(hop_latency, eventlist);
                 pipes_nlp_ns[tor][srv][b]->setName("Pipe-LS" + ntoa(tor)  + "->DST" + ntoa(srv) + "(" + ntoa(b) + ")");
                 //if (logfile) logfile->writeName(*(pipes_nlp_ns[tor][srv]));
             
@@ -824,7 +835,7 @@ void FatTreeTopology::init_network(){
                 } else {
                     queueLogger = NULL;
                 }
-                queues_ns_nlp[srv][tor][b] = alloc_src_queue(queueLogger);   
+                queues_ns_nlp[srv][tor][b] = alloc_src_queue(queueLogger, eventlist);   
                 queues_ns_nlp[srv][tor][b]->setName("SRC" + ntoa(srv) + "->LS" +ntoa(tor) + "(" + ntoa(b) + ")");
                 //cout << queues_ns_nlp[srv][tor][b]->str() << endl;
                 //if (logfile) logfile->writeName(*(queues_ns_nlp[srv][tor]));
@@ -838,7 +849,7 @@ void FatTreeTopology::init_network(){
                     new LosslessInputQueue(*_eventlist, queues_ns_nlp[srv][tor][b], switches_lp[tor], _hop_latency);
                 }
         
-                pipes_ns_nlp[srv][tor][b] = new Pipe(hop_latency, *_eventlist);
+                pipes_ns_nlp[srv][tor][b] = new Pipe(hop_latency, eventlist);
                 pipes_ns_nlp[srv][tor][b]->setName("Pipe-SRC" + ntoa(srv) + "->LS" + ntoa(tor) + "(" + ntoa(b) + ")");
                 //if (logfile) logfile->writeName(*(pipes_ns_nlp[srv][tor]));
             
@@ -865,6 +876,7 @@ void FatTreeTopology::init_network(){
             agg_max = NAGG-1;
         }
         for (uint32_t agg=agg_min; agg<=agg_max; agg++){
+            uint32_t tlp = tor_lp(tor), alp = agg_lp(agg);
             for (uint32_t b = 0; b < _bundlesize[AGG_TIER]; b++) {
                 // Downlink
                 if (_logger_factory) {
@@ -872,12 +884,12 @@ void FatTreeTopology::init_network(){
                 } else {
                     queueLogger = NULL;
                 }
-                queues_nup_nlp[agg][tor][b] = alloc_queue(queueLogger, _queue_down[AGG_TIER], DOWNLINK, AGG_TIER);
+                queues_nup_nlp[agg][tor][b] = alloc_queue(queueLogger, _queue_down[AGG_TIER], DOWNLINK, AGG_TIER, false, lp_eventlist(alp));
                 queues_nup_nlp[agg][tor][b]->setName("US" + ntoa(agg) + "->LS_" + ntoa(tor) + "(" + ntoa(b) + ")");
                 //if (logfile) logfile->writeName(*(queues_nup_nlp[agg][tor]));
             
                 simtime_picosec hop_latency = (_hop_latency == 0) ? _link_latencies[AGG_TIER] : _hop_latency;
-                pipes_nup_nlp[agg][tor][b] = new Pipe(hop_latency, *_eventlist);
+                pipes_nup_nlp[agg][tor][b] = new_pipe(hop_latency, alp, tlp);
                 pipes_nup_nlp[agg][tor][b]->setName("Pipe-US" + ntoa(agg) + "->LS" + ntoa(tor) + "(" + ntoa(b) + ")");
                 //if (logfile) logfile->writeName(*(pipes_nup_nlp[agg][tor]));
             
@@ -887,7 +899,7 @@ void FatTreeTopology::init_network(){
                 } else {
                     queueLogger = NULL;
                 }
-                queues_nlp_nup[tor][agg][b] = alloc_queue(queueLogger, _queue_up[TOR_TIER], UPLINK, TOR_TIER, true);
+                queues_nlp_nup[tor][agg][b] = alloc_queue(queueLogger, _queue_up[TOR_TIER], UPLINK, TOR_TIER, true, lp_eventlist(tlp));
                 queues_nlp_nup[tor][agg][b]->setName("LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
                 //cout << queues_nlp_nup[tor][agg][b]->str() << endl;
                 //if (logfile) logfile->writeName(*(queues_nlp_nup[tor][agg]));
@@ -906,7 +918,7 @@ void FatTreeTopology::init_network(){
                     new LosslessInputQueue(*_eventlist, queues_nup_nlp[agg][tor][b],switches_lp[tor],_hop_latency);
                 }
         
-                pipes_nlp_nup[tor][agg][b] = new Pipe(hop_latency, *_eventlist);
+                pipes_nlp_nup[tor][agg][b] = new_pipe(hop_latency, tlp, alp);
                 pipes_nlp_nup[tor][agg][b]->setName("Pipe-LS" + ntoa(tor) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
                 //if (logfile) logfile->writeName(*(pipes_nlp_nup[tor][agg]));
         
@@ -932,6 +944,7 @@ void FatTreeTopology::init_network(){
             for (uint32_t l = 0; l < _radix_up[AGG_TIER]/_bundlesize[CORE_TIER]; l++) {
                 uint32_t core = podpos +  _agg_switches_per_pod * l;
                 assert(core < NCORE);
+                uint32_t alp = agg_lp(agg), clp = core_lp(core);
                 for (uint32_t b = 0; b < _bundlesize[CORE_TIER]; b++) {
                 
                     // Downlink
@@ -941,13 +954,13 @@ void FatTreeTopology::init_network(){
                         queueLogger = NULL;
                     }
                     assert(queues_nup_nc[agg][core][b] == NULL);
-                    queues_nup_nc[agg][core][b] = alloc_queue(queueLogger, _queue_up[AGG_TIER], UPLINK, AGG_TIER);
+                    queues_nup_nc[agg][core][b] = alloc_queue(queueLogger, _queue_up[AGG_TIER], UPLINK, AGG_TIER, false, lp_eventlist(alp));
                     queues_nup_nc[agg][core][b]->setName("US" + ntoa(agg) + "->CS" + ntoa(core) + "(" + ntoa(b) + ")");
                     //cout << queues_nup_nc[agg][core][b]->str() << endl;
                     //if (logfile) logfile->writeName(*(queues_nup_nc[agg][core]));
         
                     simtime_picosec hop_latency = (_hop_latency == 0) ? _link_latencies[CORE_TIER] : _hop_latency;
-                    pipes_nup_nc[agg][core][b] = new Pipe(hop_latency, *_eventlist);
+                    pipes_nup_nc[agg][core][b] = new_pipe(hop_latency, alp, clp);
                     pipes_nup_nc[agg][core][b]->setName("Pipe-US" + ntoa(agg) + "->CS" + ntoa(core) + "(" + ntoa(b) + ")");
                     //if (logfile) logfile->writeName(*(pipes_nup_nc[agg][core]));
         
@@ -960,15 +973,15 @@ void FatTreeTopology::init_network(){
         
                     if ((l+agg*_agg_switches_per_pod)<failed_links){
                         queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _downlink_speeds[CORE_TIER]*fail_bw_pct, _queue_down[CORE_TIER],
-                                                               DOWNLINK, CORE_TIER, false);
+                                                               DOWNLINK, CORE_TIER, false, lp_eventlist(clp));
                         cout << "Adding link failure for agg_sw " << ntoa(agg) << " l " << ntoa(l) << " b " << ntoa(b) << endl;
                     } else if ((l+agg*_agg_switches_per_pod)<flaky_links) {
                         BaseQueue* q = alloc_queue(queueLogger, _downlink_speeds[CORE_TIER], _queue_down[CORE_TIER],
-                                                               DOWNLINK, CORE_TIER, false);
+                                                               DOWNLINK, CORE_TIER, false, lp_eventlist(clp));
                         queues_nc_nup[core][agg][b] = q;
                         q->setBurstyLossParameters(_link_loss_burst_interarrival_time, _link_loss_burst_duration);
                     } else {
-                        queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _queue_down[CORE_TIER], DOWNLINK, CORE_TIER);
+                        queues_nc_nup[core][agg][b] = alloc_queue(queueLogger, _queue_down[CORE_TIER], DOWNLINK, CORE_TIER, false, lp_eventlist(clp));
                     }
         
                     queues_nc_nup[core][agg][b]->setName("CS" + ntoa(core) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
@@ -989,7 +1002,7 @@ void FatTreeTopology::init_network(){
                     }
                     //if (logfile) logfile->writeName(*(queues_nc_nup[core][agg]));
             
-                    pipes_nc_nup[core][agg][b] = new Pipe(hop_latency, *_eventlist);
+                    pipes_nc_nup[core][agg][b] = new_pipe(hop_latency, clp, alp);
                     pipes_nc_nup[core][agg][b]->setName("Pipe-CS" + ntoa(core) + "->US" + ntoa(agg) + "(" + ntoa(b) + ")");
                     //if (logfile) logfile->writeName(*(pipes_nc_nup[core][agg]));
             
@@ -1055,9 +1068,41 @@ void FatTreeTopology::add_host_port(uint32_t hostnum, flowid_t flow_id, PacketSi
     switches_lp[HOST_POD_SWITCH(hostnum)]->addHostPort(hostnum,flow_id,host);
 }
 
+void FatTreeTopology::remove_host_port(uint32_t hostnum, flowid_t flow_id) {
+    assert(switches_lp[HOST_POD_SWITCH(hostnum)]);
+    switches_lp[HOST_POD_SWITCH(hostnum)]->removeHostPort(hostnum,flow_id);
+}
+
+uint32_t FatTreeTopology::no_of_paths(uint32_t src, uint32_t dest){
+    if (HOST_POD_SWITCH(src)==HOST_POD_SWITCH(dest))
+        return 1;
+
+    uint32_t pod = HOST_POD(src);
+    uint32_t aggs = MAX_POD_AGG_SWITCH(pod) - MIN_POD_AGG_SWITCH(pod) + 1;
+    uint32_t b1 = _bundlesize[AGG_TIER];
+    if (HOST_POD(src)==HOST_POD(dest))
+        return aggs * b1 * b1;
+
+    assert(_tiers == 3);
+    uint32_t b2 = _bundlesize[CORE_TIER];
+    return aggs * (_radix_up[AGG_TIER]/_bundlesize[CORE_TIER]) * b1 * b1 * b2 * b2;
+}
+
 vector<const Route*>* FatTreeTopology::get_bidir_paths(uint32_t src, uint32_t dest, bool reverse){
     vector<const Route*>* paths = new vector<const Route*>();
+    uint32_t n = no_of_paths(src, dest);
+    paths->reserve(n);
+    for (uint32_t k = 0; k < n; k++)
+        paths->push_back(get_path(src, dest, k, reverse));
+    // cout << "pathcount " << paths->size() << endl;
+    return paths;
+}
 
+// Path k between src and dest is worked out from k alone: the link in
+// the downgoing bundle varies fastest, then the link in the upgoing one,
+// then the core switch and finally the agg switch we go up to.
+Route* FatTreeTopology::get_path(uint32_t src, uint32_t dest, uint32_t k, bool reverse){
+    assert(k < no_of_paths(src, dest));
     route_t *routeout, *routeback;
   
     //QueueLoggerSimple *simplequeuelogger = new QueueLoggerSimple();
@@ -1097,11 +1142,8 @@ vector<const Route*>* FatTreeTopology::get_bidir_paths(uint32_t src, uint32_t de
         }
 
         //print_route(*routeout);
-        paths->push_back(routeout);
-
         check_non_null(routeout);
-        //cout << "pathcount " << paths->size() << endl;
-        return paths;
+        return routeout;
     }
     else if (HOST_POD(src)==HOST_POD(dest)){
         //don't go up the hierarchy, stay in the pod only.
@@ -1113,190 +1155,181 @@ vector<const Route*>* FatTreeTopology::get_bidir_paths(uint32_t src, uint32_t de
             assert(MIN_POD_AGG_SWITCH(pod) == 0);
             assert(MAX_POD_AGG_SWITCH(pod) == NAGG - 1);
         }
-        for (uint32_t upper = MIN_POD_AGG_SWITCH(pod);upper <= MAX_POD_AGG_SWITCH(pod); upper++){
-            for (uint32_t b_up = 0; b_up < _bundlesize[AGG_TIER]; b_up++) {
-                for (uint32_t b_down = 0; b_down < _bundlesize[AGG_TIER]; b_down++) {
-                    // b_up is link number in upgoing bundle, b_down is link number in downgoing bundle
-                    // note: no bundling supported between host and tor - just use link number 0
-                
-                    //upper is nup
-      
-                    routeout = new Route();
-      
-                    routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
-                    routeout->push_back(pipes_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
+        // b_up is link number in upgoing bundle, b_down is link number in downgoing bundle
+        // note: no bundling supported between host and tor - just use link number 0
+        uint32_t b_down = k % _bundlesize[AGG_TIER];
+        k /= _bundlesize[AGG_TIER];
+        uint32_t b_up = k % _bundlesize[AGG_TIER];
+        k /= _bundlesize[AGG_TIER];
+        //upper is nup
+        uint32_t upper = MIN_POD_AGG_SWITCH(pod) + k;
 
-                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                        routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
+        routeout = new Route();
 
-                    routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b_up]);
-                    routeout->push_back(pipes_nlp_nup[HOST_POD_SWITCH(src)][upper][b_up]);
+        routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
+        routeout->push_back(pipes_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
 
-                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                        routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b_up]->getRemoteEndpoint());
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
 
-                    routeout->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(dest)][b_down]);
-                    routeout->push_back(pipes_nup_nlp[upper][HOST_POD_SWITCH(dest)][b_down]);
+        routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b_up]);
+        routeout->push_back(pipes_nlp_nup[HOST_POD_SWITCH(src)][upper][b_up]);
 
-                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                        routeout->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(dest)][b_down]->getRemoteEndpoint());
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b_up]->getRemoteEndpoint());
 
-                    routeout->push_back(queues_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
-                    routeout->push_back(pipes_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
+        routeout->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(dest)][b_down]);
+        routeout->push_back(pipes_nup_nlp[upper][HOST_POD_SWITCH(dest)][b_down]);
 
-                    if (reverse) {
-                        // reverse path for RTS packets
-                        routeback = new Route();
-      
-                        routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
-                        routeback->push_back(pipes_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(dest)][b_down]->getRemoteEndpoint());
 
-                        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                            routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
+        routeout->push_back(queues_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
+        routeout->push_back(pipes_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
 
-                        routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper][b_down]);
-                        routeback->push_back(pipes_nlp_nup[HOST_POD_SWITCH(dest)][upper][b_down]);
+        if (reverse) {
+            // reverse path for RTS packets
+            routeback = new Route();
 
-                        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                            routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper][b_down]->getRemoteEndpoint());
+            routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
+            routeback->push_back(pipes_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
 
-                        routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b_up]);
-                        routeback->push_back(pipes_nup_nlp[upper][HOST_POD_SWITCH(src)][b_up]);
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
 
-                        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                            routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b_up]->getRemoteEndpoint());
-      
-                        routeback->push_back(queues_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
-                        routeback->push_back(pipes_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
+            routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper][b_down]);
+            routeback->push_back(pipes_nlp_nup[HOST_POD_SWITCH(dest)][upper][b_down]);
 
-                        routeout->set_reverse(routeback);
-                        routeback->set_reverse(routeout);
-                    }
-      
-                    //print_route(*routeout);
-                    paths->push_back(routeout);
-                    check_non_null(routeout);
-                }
-            }
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper][b_down]->getRemoteEndpoint());
+
+            routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b_up]);
+            routeback->push_back(pipes_nup_nlp[upper][HOST_POD_SWITCH(src)][b_up]);
+
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b_up]->getRemoteEndpoint());
+
+            routeback->push_back(queues_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
+            routeback->push_back(pipes_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
+
+            routeout->set_reverse(routeback);
+            routeback->set_reverse(routeout);
         }
-        // cout << "pathcount " << paths->size() << endl;
-        return paths;
+
+        //print_route(*routeout);
+        check_non_null(routeout);
+        return routeout;
     } else {
         assert(_tiers == 3);
         uint32_t pod = HOST_POD(src);
 
-        for (uint32_t upper = MIN_POD_AGG_SWITCH(pod); upper <= MAX_POD_AGG_SWITCH(pod); upper++) {
-            uint32_t podpos = upper % _agg_switches_per_pod;
+        // b1_up is link number in upgoing bundle from tor to agg, b1_down is link number in downgoing bundle
+        // b2_up is link number in upgoing bundle from agg to core, b2_down is link number in downgoing bundle
+        // note: no bundling supported between host and tor - just use link number 0
+        uint32_t b2_down = k % _bundlesize[CORE_TIER];
+        k /= _bundlesize[CORE_TIER];
+        uint32_t b2_up = k % _bundlesize[CORE_TIER];
+        k /= _bundlesize[CORE_TIER];
+        uint32_t b1_down = k % _bundlesize[AGG_TIER];
+        k /= _bundlesize[AGG_TIER];
+        uint32_t b1_up = k % _bundlesize[AGG_TIER];
+        k /= _bundlesize[AGG_TIER];
+        uint32_t uplink_bundles = _radix_up[AGG_TIER]/_bundlesize[CORE_TIER];
+        uint32_t l = k % uplink_bundles;
+        k /= uplink_bundles;
+        //upper is nup
+        uint32_t upper = MIN_POD_AGG_SWITCH(pod) + k;
+        uint32_t podpos = upper % _agg_switches_per_pod;
+        uint32_t core = podpos +  _agg_switches_per_pod * l;
 
-            for (uint32_t l = 0; l < _radix_up[AGG_TIER]/_bundlesize[CORE_TIER]; l++) {
-                uint32_t core = podpos +  _agg_switches_per_pod * l;
+        routeout = new Route();
+        //routeout->push_back(pqueue);
 
-                for (uint32_t b1_up = 0; b1_up < _bundlesize[AGG_TIER]; b1_up++) {
-                    for (uint32_t b1_down = 0; b1_down < _bundlesize[AGG_TIER]; b1_down++) {
-                        // b1_up is link number in upgoing bundle from tor to agg, b1_down is link number in downgoing bundle
+        routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
+        routeout->push_back(pipes_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
 
-                        for (uint32_t b2_up = 0; b2_up < _bundlesize[CORE_TIER]; b2_up++) {
-                            for (uint32_t b2_down = 0; b2_down < _bundlesize[CORE_TIER]; b2_down++) {
-                                // b2_up is link number in upgoing bundle from agg to core, b2_down is link number in downgoing bundle
-                                // note: no bundling supported between host and tor - just use link number 0
-                                //upper is nup
-        
-                                routeout = new Route();
-                                //routeout->push_back(pqueue);
-        
-                                routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
-                                routeout->push_back(pipes_ns_nlp[src][HOST_POD_SWITCH(src)][0]);
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
 
-                                if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                    routeout->push_back(queues_ns_nlp[src][HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
-        
-                                routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b1_up]);
-                                routeout->push_back(pipes_nlp_nup[HOST_POD_SWITCH(src)][upper][b1_up]);
+        routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b1_up]);
+        routeout->push_back(pipes_nlp_nup[HOST_POD_SWITCH(src)][upper][b1_up]);
 
-                                if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                    routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b1_up]->getRemoteEndpoint());
-        
-                                routeout->push_back(queues_nup_nc[upper][core][b2_up]);
-                                routeout->push_back(pipes_nup_nc[upper][core][b2_up]);
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_nlp_nup[HOST_POD_SWITCH(src)][upper][b1_up]->getRemoteEndpoint());
 
-                                if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                    routeout->push_back(queues_nup_nc[upper][core][b2_up]->getRemoteEndpoint());
-        
-                                //now take the only link down to the destination server!
-        
-                                uint32_t upper2 = MIN_POD_AGG_SWITCH(HOST_POD(dest)) + core % _agg_switches_per_pod;
-                                //printf("K %d HOST_POD(%d) %d core %d upper2 %d\n",K,dest,HOST_POD(dest),core, upper2);
-        
-                                routeout->push_back(queues_nc_nup[core][upper2][b2_down]);
-                                routeout->push_back(pipes_nc_nup[core][upper2][b2_down]);
+        routeout->push_back(queues_nup_nc[upper][core][b2_up]);
+        routeout->push_back(pipes_nup_nc[upper][core][b2_up]);
 
-                                if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                    routeout->push_back(queues_nc_nup[core][upper2][b2_down]->getRemoteEndpoint());        
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_nup_nc[upper][core][b2_up]->getRemoteEndpoint());
 
-                                routeout->push_back(queues_nup_nlp[upper2][HOST_POD_SWITCH(dest)][b1_down]);
-                                routeout->push_back(pipes_nup_nlp[upper2][HOST_POD_SWITCH(dest)][b1_down]);
+        //now take the only link down to the destination server!
 
-                                if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                    routeout->push_back(queues_nup_nlp[upper2][HOST_POD_SWITCH(dest)][b1_down]->getRemoteEndpoint());
-        
-                                routeout->push_back(queues_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
-                                routeout->push_back(pipes_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
+        uint32_t upper2 = MIN_POD_AGG_SWITCH(HOST_POD(dest)) + core % _agg_switches_per_pod;
+        //printf("K %d HOST_POD(%d) %d core %d upper2 %d\n",K,dest,HOST_POD(dest),core, upper2);
 
-                                if (reverse) {
-                                    // reverse path for RTS packets
-                                    routeback = new Route();
-        
-                                    routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
-                                    routeback->push_back(pipes_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
+        routeout->push_back(queues_nc_nup[core][upper2][b2_down]);
+        routeout->push_back(pipes_nc_nup[core][upper2][b2_down]);
 
-                                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                        routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
-        
-                                    routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper2][b1_down]);
-                                    routeback->push_back(pipes_nlp_nup[HOST_POD_SWITCH(dest)][upper2][b1_down]);
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_nc_nup[core][upper2][b2_down]->getRemoteEndpoint());        
 
-                                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                        routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper2][b1_down]->getRemoteEndpoint());
-        
-                                    routeback->push_back(queues_nup_nc[upper2][core][b2_down]);
-                                    routeback->push_back(pipes_nup_nc[upper2][core][b2_down]);
+        routeout->push_back(queues_nup_nlp[upper2][HOST_POD_SWITCH(dest)][b1_down]);
+        routeout->push_back(pipes_nup_nlp[upper2][HOST_POD_SWITCH(dest)][b1_down]);
 
-                                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                        routeback->push_back(queues_nup_nc[upper2][core][b2_down]->getRemoteEndpoint());
-        
-                                    //now take the only link back down to the src server!
-        
-                                    routeback->push_back(queues_nc_nup[core][upper][b2_up]);
-                                    routeback->push_back(pipes_nc_nup[core][upper][b2_up]);
+        if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+            routeout->push_back(queues_nup_nlp[upper2][HOST_POD_SWITCH(dest)][b1_down]->getRemoteEndpoint());
 
-                                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                        routeback->push_back(queues_nc_nup[core][upper][b2_up]->getRemoteEndpoint());
-        
-                                    routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b1_up]);
-                                    routeback->push_back(pipes_nup_nlp[upper][HOST_POD_SWITCH(src)][b1_up]);
+        routeout->push_back(queues_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
+        routeout->push_back(pipes_nlp_ns[HOST_POD_SWITCH(dest)][dest][0]);
 
-                                    if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
-                                        routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b1_up]->getRemoteEndpoint());
-        
-                                    routeback->push_back(queues_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
-                                    routeback->push_back(pipes_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
+        if (reverse) {
+            // reverse path for RTS packets
+            routeback = new Route();
 
+            routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
+            routeback->push_back(pipes_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]);
 
-                                    routeout->set_reverse(routeback);
-                                    routeback->set_reverse(routeout);
-                                }
-        
-                                //print_route(*routeout);
-                                paths->push_back(routeout);
-                                check_non_null(routeout);
-                            }
-                        }
-                    }
-                }
-            }
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_ns_nlp[dest][HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
+
+            routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper2][b1_down]);
+            routeback->push_back(pipes_nlp_nup[HOST_POD_SWITCH(dest)][upper2][b1_down]);
+
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_nlp_nup[HOST_POD_SWITCH(dest)][upper2][b1_down]->getRemoteEndpoint());
+
+            routeback->push_back(queues_nup_nc[upper2][core][b2_down]);
+            routeback->push_back(pipes_nup_nc[upper2][core][b2_down]);
+
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_nup_nc[upper2][core][b2_down]->getRemoteEndpoint());
+
+            //now take the only link back down to the src server!
+
+            routeback->push_back(queues_nc_nup[core][upper][b2_up]);
+            routeback->push_back(pipes_nc_nup[core][upper][b2_up]);
+
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_nc_nup[core][upper][b2_up]->getRemoteEndpoint());
+
+            routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b1_up]);
+            routeback->push_back(pipes_nup_nlp[upper][HOST_POD_SWITCH(src)][b1_up]);
+
+            if (_qt==LOSSLESS_INPUT || _qt==LOSSLESS_INPUT_ECN)
+                routeback->push_back(queues_nup_nlp[upper][HOST_POD_SWITCH(src)][b1_up]->getRemoteEndpoint());
+
+            routeback->push_back(queues_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
+            routeback->push_back(pipes_nlp_ns[HOST_POD_SWITCH(src)][src][0]);
+
+
+            routeout->set_reverse(routeback);
+            routeback->set_reverse(routeout);
         }
-        // cout << "pathcount " << paths->size() << endl;
-        return paths;
+
+        //print_route(*routeout);
+        check_non_null(routeout);
+        return routeout;
     }
 }
 
@@ -1408,4 +1441,78 @@ void FatTreeTopology::add_switch_loggers(Logfile& log, simtime_picosec sample_pe
              ; i++) {
         switches_c[i]->add_logger(log, sample_period);
     }
-}
\ No newline at end of file
+}
+uint32_t FatTreeTopology::tor_lp(uint32_t tor) {
+    if (!_pdes)
+        return 0;
+    uint32_t pod = (_tiers == 3) ? tor / _tor_switches_per_pod : tor;
+    return pod % _pdes->lps();
+}
+
+uint32_t FatTreeTopology::agg_lp(uint32_t agg) {
+    if (!_pdes)
+        return 0;
+    if (_tiers == 3)
+        return AGG_SWITCH_POD_ID(agg) % _pdes->lps();
+    // in a leaf-spine the aggs are the spines, shared by every ToR
+    return agg % _pdes->lps();
+}
+
+uint32_t FatTreeTopology::core_lp(uint32_t core) {
+    return _pdes ? core % _pdes->lps() : 0;
+}
+
+uint32_t FatTreeTopology::host_lp(uint32_t host) {
+    return tor_lp(HOST_POD_SWITCH(host));
+}
+
+EventList& FatTreeTopology::lp_eventlist(uint32_t lp) {
+    return _pdes ? _pdes->eventlist(lp) : *_eventlist;
+}
+
+Pipe* FatTreeTopology::new_pipe(simtime_picosec delay, uint32_t from, uint32_t to) {
+    if (from == to)
+        return new Pipe(delay, lp_eventlist(to));
+    if (delay == 0) {
+        // the lookahead would be zero, and no LP could run ahead of any other
+        cerr << "Links between LPs need a latency" << endl;
+        exit(1);
+    }
+    return _pdes->new_link(delay, from, to);
+}
+
+std::function<void()> FatTreeTopology::thread_settings() {
+    struct Settings {
+        uint32_t tiers, hosts_per_pod;
+        simtime_picosec link_latencies[3], switch_latencies[3];
+        uint32_t bundlesize[3], oversub[3], radix_down[3], radix_up[2];
+        linkspeed_bps downlink_speeds[3];
+        mem_b queue_down[3], queue_up[2];
+    } s;
+    s.tiers = _tiers;
+    s.hosts_per_pod = _hosts_per_pod;
+    copy(_link_latencies, _link_latencies + 3, s.link_latencies);
+    copy(_switch_latencies, _switch_latencies + 3, s.switch_latencies);
+    copy(_bundlesize, _bundlesize + 3, s.bundlesize);
+    copy(_oversub, _oversub + 3, s.oversub);
+    copy(_radix_down, _radix_down + 3, s.radix_down);
+    copy(_radix_up, _radix_up + 2, s.radix_up);
+    copy(_downlink_speeds, _downlink_speeds + 3, s.downlink_speeds);
+    copy(_queue_down, _queue_down + 3, s.queue_down);
+    copy(_queue_up, _queue_up + 2, s.queue_up);
+    std::function<void()> switch_settings = FatTreeSwitch::thread_settings();
+    return [s, switch_settings]() {
+        _tiers = s.tiers;
+        _hosts_per_pod = s.hosts_per_pod;
+        copy(s.link_latencies, s.link_latencies + 3, _link_latencies);
+        copy(s.switch_latencies, s.switch_latencies + 3, _switch_latencies);
+        copy(s.bundlesize, s.bundlesize + 3, _bundlesize);
+        copy(s.oversub, s.oversub + 3, _oversub);
+        copy(s.radix_down, s.radix_down + 3, _radix_down);
+        copy(s.radix_up, s.radix_up + 2, _radix_up);
+        copy(s.downlink_speeds, s.downlink_speeds + 3, _downlink_speeds);
+        copy(s.queue_down, s.queue_down + 3, _queue_down);
+        copy(s.queue_up, s.queue_up + 2, _queue_up);
+        switch_settings();
+    };
+}
@@ -12,7 +12,9 @@
 #include "logfile.h"
 #include "eventlist.h"
 #include "switch.h"
+#include "pdes.h"
 #include <ostream>
+#include <functional>
 
 //#define N K*K*K/4
 
@@ -81,13 +83,18 @@ public:
 
     void init_network();
     virtual vector<const Route*>* get_bidir_paths(uint32_t src, uint32_t dest, bool reverse);
+    virtual uint32_t no_of_paths(uint32_t src, uint32_t dest);
+    virtual Route* get_path(uint32_t src, uint32_t dest, uint32_t k, bool reverse);
     Route* get_tor_route(uint32_t hostnum);
     void add_host_port(uint32_t hostnum, flowid_t flow_id, PacketSink* host);
+    // for a transport that's finished with hostnum, eg to be reused
+    void remove_host_port(uint32_t hostnum, flowid_t flow_id);
 
-    BaseQueue* alloc_src_queue(QueueLogger* q);
-    BaseQueue* alloc_queue(QueueLogger* q, mem_b queuesize, link_direction dir, int switch_tier, bool tor);
+    BaseQueue* alloc_src_queue(QueueLogger* q, EventList& eventlist);
+    BaseQueue* alloc_queue(QueueLogger* q, mem_b queuesize, link_direction dir, int switch_tier, bool tor,
+                           EventList& eventlist);
     BaseQueue* alloc_queue(QueueLogger* q, uint64_t speed, mem_b queuesize,
-                           link_direction dir,  int switch_tier, bool tor);
+                           link_direction dir,  int switch_tier, bool tor, EventList& eventlist);
     static void set_tiers(uint32_t tiers) {_tiers = tiers;}
     static uint32_t get_tiers() {return _tiers;}
     static void set_latencies(simtime_picosec src_lp, simtime_picosec lp_up, simtime_picosec up_cs,
@@ -102,6 +109,14 @@ public:
     static void set_podsize(int hosts_per_pod) {
         _hosts_per_pod = hosts_per_pod;
     }
+    // Build the network split across pdes's LPs: each pod (each ToR in
+    // a leaf-spine) with its hosts on one LP, and the core switches
+    // (spines) dealt out across them.  NULL, the default, builds it all
+    // on the one event list.
+    static void set_pdes_engine(PdesEngine* pdes) {_pdes_engine = pdes;}
+    // The settings above, and FatTreeSwitch's, as they are on this
+    // thread, for PdesEngine::set_thread_init() to copy to the LPs'.
+    static std::function<void()> thread_settings();
 
     void count_queue(Queue*);
     void print_path(std::ofstream& paths,uint32_t src,const Route* route);
@@ -123,6 +138,10 @@ public:
     // add loggers to record total queue size at switches
     virtual void add_switch_loggers(Logfile& log, simtime_picosec sample_period); 
 
+    // the LP a host is on, for its transport endpoints; 0 unless
+    // built for a PdesEngine
+    uint32_t host_lp(uint32_t host);
+
     uint32_t HOST_POD_SWITCH(uint32_t src){
         return src/_radix_down[TOR_TIER];
     }
@@ -190,15 +209,21 @@ private:
     void set_params(uint32_t no_of_nodes);
     void set_custom_params(uint32_t no_of_nodes);
     void alloc_vectors();
+    uint32_t tor_lp(uint32_t tor);
+    uint32_t agg_lp(uint32_t agg);
+    uint32_t core_lp(uint32_t core);
+    EventList& lp_eventlist(uint32_t lp);
+    // a PdesLink if from and to are different LPs
+    Pipe* new_pipe(simtime_picosec delay, uint32_t from, uint32_t to);
     uint32_t NCORE, NAGG, NTOR, NSRV, NPOD;
     uint32_t _tor_switches_per_pod, _agg_switches_per_pod;
-    static uint32_t _tiers;
+    static thread_local uint32_t _tiers;
 
     // _link_latencies[0] is the ToR->host latency.
-    static simtime_picosec _link_latencies[3];
+    static thread_local simtime_picosec _link_latencies[3];
 
     // _switch_latencies[0] is the ToR switch latency.
-    static simtime_picosec _switch_latencies[3];
+    static thread_local simtime_picosec _switch_latencies[3];
 
     // How many uplinks to bundle from each node in a tier to the same
     // node in the tier below.  Eg bundlesize[2] = 2 means two
@@ -206,26 +231,29 @@ private:
     //
     // Note: we don't currently support bundling from the hosts to
     // ToRs because transport needs to know for that to work.
-    static uint32_t _bundlesize[3];
+    static thread_local uint32_t _bundlesize[3];
 
     // Linkspeed of each link in a switch tier to the tier below. ToRs are tier 0.
     // Eg. _downlink_speeds[0] = 400Gbps indicates 400Gbps links from hosts
     // to ToRs.
-    static linkspeed_bps _downlink_speeds[3];
+    static thread_local linkspeed_bps _downlink_speeds[3];
 
     // degree of oversubscription at tier.  Eg _oversub[TOR_TIER] = 3 implies 3x more bw to hosts than to agg switches.
-    static uint32_t _oversub[3];
+    static thread_local uint32_t _oversub[3];
 
     // switch radix used.  Eg _radix_down[0] = 32 indicates 32 downlinks from ToRs.  _radix_up[2] should be zero in a 3-tier topology.  
-    static uint32_t _radix_down[3];
-    static uint32_t _radix_up[2];
+    static thread_local uint32_t _radix_down[3];
+    static thread_local uint32_t _radix_up[2];
 
     // switch queue size used.  Eg _queue_down[0] = 32 indicates 32 downlinks from ToRs.  _queue_up[2] should be zero in a 3-tier topology.  
-    static mem_b _queue_down[3];
-    static mem_b _queue_up[2];
+    static thread_local mem_b _queue_down[3];
+    static thread_local mem_b _queue_up[2];
 
     // number of hosts in a pod.  
-    static uint32_t _hosts_per_pod; 
+    static thread_local uint32_t _hosts_per_pod; 
+
+    static thread_local PdesEngine* _pdes_engine;
+    PdesEngine* _pdes;
     
     uint32_t _no_of_nodes;
     simtime_picosec _hop_latency,_switch_latency;
@@ -0,0 +1,96 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef FLOW_RECYCLER_H
+#define FLOW_RECYCLER_H
+
+/*
+ * What a driver needs, besides the FlowPools, to run with -recycle:
+ * connections are set up as they become due, and finished flows give
+ * their srcs and sinks back to be reused.  Src is the transport's
+ * source, whatever it is called.
+ */
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "config.h"
+#include "eventlist.h"
+#include "trigger.h"
+#include "connection_matrix.h"
+
+// Sets up each connection when it's due to start rather than all of
+// them before the run, so they can use the srcs and sinks of flows that
+// have finished.
+class ConnectionLauncher : public EventSource {
+public:
+    ConnectionLauncher(EventList& eventlist, const vector<connection*>& conns, std::function<void(connection*)> start)
+        : EventSource(eventlist, "connection_launcher"), _conns(conns), _next(0), _start(start) {
+        std::stable_sort(_conns.begin(), _conns.end(),
+                         [](const connection* a, const connection* b) {return a->start < b->start;});
+        if (!_conns.empty())
+            eventlist.sourceIsPending(*this, _conns[0]->start);
+    }
+    void doNextEvent() {
+        while (_next < _conns.size() && _conns[_next]->start <= eventlist().now())
+            _start(_conns[_next++]);
+        if (_next < _conns.size())
+            eventlist().sourceIsPending(*this, _conns[_next]->start);
+    }
+private:
+    vector<connection*> _conns; // by start time
+    size_t _next;
+    std::function<void(connection*)> _start;
+};
+
+// Finished flows wait here before their src and sink are reset and
+// pooled, long enough for their packets still in the network to drain.
+// A src the transport says is still busy - with packets waiting in its
+// NIC, say - waits again.
+template<class Src>
+class FlowRecycler : public EventSource {
+public:
+    FlowRecycler(EventList& eventlist, simtime_picosec linger,
+                 std::function<bool(Src*)> busy, std::function<void(Src*)> recycle)
+        : EventSource(eventlist, "flow_recycler"), _linger(linger), _finished(0),
+          _busy(busy), _recycle(recycle) {}
+    void finished(Src* src) {
+        _finished++;
+        _lingering.push_back(make_pair(eventlist().now() + _linger, src));
+        if (_lingering.size() == 1)
+            eventlist().sourceIsPending(*this, _lingering.front().first);
+    }
+    void doNextEvent() {
+        while (!_lingering.empty() && _lingering.front().first <= eventlist().now()) {
+            Src* src = _lingering.front().second;
+            _lingering.pop_front();
+            if (_busy(src))
+                _lingering.push_back(make_pair(eventlist().now() + _linger, src));
+            else
+                _recycle(src);
+        }
+        if (!_lingering.empty())
+            eventlist().sourceIsPending(*this, _lingering.front().first);
+    }
+    uint64_t finished() const {return _finished;}
+private:
+    simtime_picosec _linger;
+    uint64_t _finished;
+    deque<pair<simtime_picosec, Src*> > _lingering; // by release time
+    std::function<bool(Src*)> _busy;
+    std::function<void(Src*)> _recycle;
+};
+
+// A src's end trigger, set once when it's made: it tells the recycler
+// each time the src finishes a flow.
+template<class Src>
+class FlowEndTrigger : public Trigger {
+public:
+    FlowEndTrigger(EventList& eventlist, triggerid_t id, FlowRecycler<Src>& recycler, Src& src)
+        : Trigger(eventlist, id), _recycler(recycler), _src(src) {}
+    virtual void activate() {_recycler.finished(&_src);}
+private:
+    FlowRecycler<Src>& _recycler;
+    Src& _src;
+};
+
+#endif
@@ -13,11 +13,17 @@
 #include "logfile.h"
 #include "loggers.h"
 #include "clock.h"
+#include "event_profiler.h"
+#include "checkpoint.h"
+#include "pdes.h"
 #include "constant_cca.h"
 #include "compositequeue.h"
 //#include "firstfit.h"
 #include "topology.h"
 #include "connection_matrix.h"
+#include "path_cache.h"
+#include "flow_pool.h"
+#include "flow_recycler.h"
 //#include "vl2_topology.h"
 
 #include "fat_tree_topology.h"
@@ -27,6 +33,7 @@
 //#include "star_topology.h"
 //#include "bcube_topology.h"
 #include <list>
+#include <map>
 
 // Simulation params
 
@@ -53,6 +60,97 @@ enum HostLBStrategy {NOLB = 0, SPRAY = 1, PLB = 2, SPRAY_ADAPTIVE = 3};
 EventList eventlist;
 
 
+// point a forked branch's flow log and stdout at files of its own
+void open_branch_output(std::ofstream& flowlog, const string& flowfile) {
+    flowlog.close();
+    flowlog.open(flowfile.c_str());
+    if (!flowlog || !freopen((flowfile + ".out").c_str(), "w", stdout)) {
+        cerr << "Can't open output files " << flowfile << endl;
+        exit(1);
+    }
+}
+
+// The arguments a -save run records for -restore to build the same
+// network with: all but -save, plus the seed, which may have come from
+// the clock.
+vector<string> saved_args(int argc, char** argv, unsigned seed) {
+    vector<string> args;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-save")) {
+            i++;
+            continue;
+        }
+        args.push_back(argv[i]);
+    }
+    args.push_back("-seed");
+    args.push_back(ntoa(seed));
+    return args;
+}
+
+// What a -variant branch changes at the checkpoint; anything it doesn't
+// mention stays as the warm-up had it.
+struct BranchVariant {
+    BranchVariant() : rate_coef(0), dupack_thresh(0), disable_fr(false), endtime(0) {}
+    string options;
+    double rate_coef;         // 0: unchanged
+    int dupack_thresh;        // 0: unchanged
+    bool disable_fr;
+    simtime_picosec endtime;  // 0: unchanged
+};
+
+bool parse_variant(const string& options, BranchVariant& v) {
+    v.options = options;
+    istringstream in(options);
+    string opt;
+    while (in >> opt) {
+        if (opt == "-ratecoef") {
+            if (!(in >> v.rate_coef) || v.rate_coef <= 0)
+                return false;
+        } else if (opt == "-dup") {
+            if (!(in >> v.dupack_thresh) || v.dupack_thresh <= 0)
+                return false;
+        } else if (opt == "-nofr") {
+            v.disable_fr = true;
+        } else if (opt == "-end") {
+            double us;
+            if (!(in >> us) || us <= 0)
+                return false;
+            v.endtime = timeFromUs(us);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Change the running senders to match the variant.  rate_coef is the
+// one the warm-up ran with.
+void apply_variant(const BranchVariant& v, list<ConstantCcaSrc*>& srcs, double rate_coef) {
+    list<ConstantCcaSrc*>::iterator src_i;
+    for (src_i = srcs.begin(); src_i != srcs.end(); src_i++) {
+        ConstantCcaSrc* src = *src_i;
+        if (v.rate_coef > 0) {
+            // the pacers pick the new delay up at their next send
+            simtime_picosec delay = src->_pacing_delay * rate_coef / v.rate_coef;
+            src->set_pacing_delay(delay);
+            for (size_t s = 0; s < src->subflows().size(); s++)
+                src->subflows()[s]->set_pacing_delay(delay * src->subflows().size());
+        }
+        if (v.dupack_thresh)
+            src->set_dupack_thresh(v.dupack_thresh);
+        if (v.disable_fr)
+            src->disable_fast_recovery();
+    }
+}
+
+const char* FLOWLOG_HEADER = "Flow ID,Drops,Spurious Retransmits,Completion Time,RTOs,ReceivedBytes,NACKs,DupACKs,PacketsSent";
+
+void log_flow(std::ofstream& flowlog, ConstantCcaSrc* src) {
+    ConstantCcaSink* sink = src->_sink;
+    simtime_picosec time = src->_completion_time > 0 ? src->_completion_time - src->_start_time: 0;
+    flowlog << src->_addr << "-" << src->_destination << "," << src->drops() << "," << sink->spurious_retransmits() << "," << time << "," << src->rtos() << "," << sink->cumulative_ack() << "," << sink->nacks_sent() << "," << src->total_dupacks() << "," << src->packets_sent() <<  endl;
+}
+
 void exit_error(char* progr) {
     cout << "Usage " << progr << " [UNCOUPLED(DEFAULT)|COUPLED_INC|FULLY_COUPLED|COUPLED_EPSILON] [epsilon][COUPLED_SCALABLE_TCP" << endl;
     exit(1);
@@ -70,6 +168,7 @@ int main(int argc, char **argv) {
     simtime_picosec tput_sample_time = timeFromUs((uint32_t)12);
     simtime_picosec endtime = timeFromMs(1.2);
     char* tm_file = NULL;
+    char* profile_file = NULL;
     char* topo_file = NULL;
     NetRouteStrategy route_strategy = SOURCE_ROUTE;
     HostLBStrategy host_lb = NOLB;
@@ -83,6 +182,56 @@ int main(int argc, char **argv) {
     simtime_picosec latency = 0;
     bool disable_fr = false;
     int dupack_thresh = 3;
+    uint32_t pdes_lps = 0;
+    bool pdes_sequential = false;
+    unsigned seed = time(NULL);
+    simtime_picosec checkpoint_time = 0;
+    uint32_t branches = 0;
+    vector<BranchVariant> variants;
+    uint32_t replicas = 0;
+    bool batch_dispatch = false;
+    bool compact_routes = false;
+    uint32_t path_cache_size = 0;
+    bool recycle = false;
+    simtime_picosec recycle_linger = 0;
+    char* save_file = NULL;
+    char* restore_file = NULL;
+    CheckpointArchive* archive = NULL;
+
+    // -restore carries on from a file a -save run wrote, with that run's
+    // arguments; only the output files and a -variant can be changed.
+    vector<string> args(argv, argv + argc);
+    for (int a = 1; a + 1 < argc; a++) {
+        if (!strcmp(argv[a], "-restore"))
+            restore_file = argv[a+1];
+    }
+    if (restore_file) {
+        archive = new CheckpointArchive(restore_file, false);
+        vector<string> saved;
+        archive->io(saved);
+        args.resize(1);
+        args.insert(args.end(), saved.begin(), saved.end());
+        int variant_count = 0;
+        for (int a = 1; a < argc; a += 2) {
+            if (!strcmp(argv[a], "-restore"))
+                continue;
+            if (!strcmp(argv[a], "-variant"))
+                variant_count++;
+            else if (strcmp(argv[a], "-o") && strcmp(argv[a], "-of"))
+                variant_count = 2;
+            if (a + 1 == argc || variant_count > 1) {
+                cout << "-restore only takes -o, -of and one -variant with it" << endl;
+                exit(1);
+            }
+            args.push_back(argv[a]);
+            args.push_back(argv[a+1]);
+        }
+    }
+    vector<char*> arg_ptrs;
+    for (size_t a = 0; a < args.size(); a++)
+        arg_ptrs.push_back(&args[a][0]);
+    argc = arg_ptrs.size();
+    argv = arg_ptrs.data();
 
     int i = 1;
     filename << "None";
@@ -117,6 +266,10 @@ int main(int argc, char **argv) {
             // linkspeed specified is in Mbps
             linkspeed = speedFromMbps(atof(argv[i+1]));
             i++;
+        } else if (!strcmp(argv[i],"-profile")){
+            // time events by class, writing the table to this CSV file too
+            profile_file = argv[i+1];
+            i++;
         } else if (!strcmp(argv[i],"-end")){
             endtime = timeFromUs(atof(argv[i+1]));
             i++;
@@ -161,6 +314,60 @@ int main(int argc, char **argv) {
         } else if (!strcmp(argv[i],"-dup")){
             dupack_thresh = atoi(argv[i+1]);
             i++;
+        } else if (!strcmp(argv[i],"-pdes")){
+            // run the fat tree's pods on this many threads
+            pdes_lps = atoi(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-pdesseq")){
+            // run -pdes's LPs one at a time on this thread, to check a
+            // parallel run against
+            pdes_sequential = true;
+        } else if (!strcmp(argv[i],"-seed")){
+            seed = atoi(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-checkpoint")){
+            // simulate the warm-up once, then fork -branches copies here
+            // or -save it
+            checkpoint_time = timeFromUs(atof(argv[i+1]));
+            i++;
+        } else if (!strcmp(argv[i],"-save")){
+            // write the network at -checkpoint to this file, and carry on
+            save_file = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-branches")){
+            branches = atoi(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-variant")){
+            // a branch that changes these options at the checkpoint,
+            // e.g. "-ratecoef 0.9 -dup 5"; one branch per -variant
+            BranchVariant v;
+            if (!parse_variant(argv[i+1], v)) {
+                cout << "Bad -variant \"" << argv[i+1] << "\": it can set -ratecoef, -dup, -nofr and -end" << endl;
+                exit(1);
+            }
+            variants.push_back(v);
+            i++;
+        } else if (!strcmp(argv[i],"-replicas")){
+            // build the network once, then fork this many runs of it
+            replicas = atoi(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-batch")){
+            // run same-time events grouped by class, not FIFO
+            batch_dispatch = true;
+        } else if (!strcmp(argv[i],"-compactroutes")){
+            // store interned routes' hops as 32-bit sink indices
+            compact_routes = true;
+        } else if (!strcmp(argv[i],"-pathcache")){
+            // remember at most this many paths (0: all of them)
+            path_cache_size = atoi(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-recycle")){
+            // start connections when they're due, reusing the srcs and
+            // sinks of flows finished at least this many us ago - long
+            // enough for their last packets to have been delivered
+            recycle = true;
+            recycle_linger = timeFromUs(atof(argv[i+1]));
+            i++;
         } else if (!strcmp(argv[i],"-tsample")){
             tput_sample_time = timeFromUs((uint32_t)atoi(argv[i+1]));
             i++;            
@@ -208,11 +415,15 @@ int main(int argc, char **argv) {
         i++;
     }
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
+    RouteStore::current().set_compact(compact_routes);
     eventlist.setEndtime(endtime);
 
     queuesize = queuesize*Packet::data_packet_size();
-    srand(time(NULL));
-    srandom(time(NULL));
+    srand(seed);
+    srandom(seed);
+    cout << "random seed " << seed << endl;
       
     cout << "requested nodes " << no_of_nodes << endl;
     cout << "cwnd " << cwnd << endl;
@@ -221,6 +432,64 @@ int main(int argc, char **argv) {
     cout << "strategy " << route_strategy << endl;
     cout << "subflows " << no_of_subflows << endl;
 
+    if (!variants.empty()) {
+        if (branches > 0 && branches != variants.size()) {
+            cout << "-branches " << branches << " but " << variants.size() << " variants" << endl;
+            exit(1);
+        }
+        // a restored run applies its one variant itself
+        if (!restore_file)
+            branches = variants.size();
+        for (size_t v = 0; v < variants.size(); v++) {
+            // nothing was scheduled past the run's end time during the
+            // warm-up, so a branch can only end sooner
+            simtime_picosec end = variants[v].endtime;
+            if (end && (end <= checkpoint_time || (endtime > 0 && end > endtime))) {
+                cout << "Variant \"" << variants[v].options << "\" must end after the checkpoint and no later than -end" << endl;
+                exit(1);
+            }
+        }
+    }
+    if ((branches > 0 || save_file) && endtime > 0 && checkpoint_time >= endtime) {
+        cout << "Checkpoint must be before the end of the simulation" << endl;
+        exit(1);
+    }
+    if (branches > 0 && replicas > 0) {
+        cout << "Use either -branches or -replicas, not both" << endl;
+        exit(1);
+    }
+
+    if (recycle && (pdes_lps > 0 || branches > 0 || replicas > 0)) {
+        cout << "-recycle doesn't work with -pdes, -branches or -replicas" << endl;
+        exit(1);
+    }
+    if (pdes_lps > 0 && (branches > 0 || replicas > 0 || profile_file || batch_dispatch)) {
+        cout << "-pdes doesn't work with -branches, -replicas, -profile or -batch" << endl;
+        exit(1);
+    }
+    if (pdes_sequential && pdes_lps == 0) {
+        cout << "-pdesseq needs -pdes" << endl;
+        exit(1);
+    }
+    if (save_file && checkpoint_time == 0) {
+        cout << "-save needs -checkpoint" << endl;
+        exit(1);
+    }
+    if ((save_file || restore_file) && (branches > 0 || replicas > 0 || pdes_lps > 0 || recycle || profile_file || batch_dispatch)) {
+        cout << "-save and -restore don't work with -branches, -replicas, -pdes, -recycle, -profile or -batch" << endl;
+        exit(1);
+    }
+    if (save_file) {
+        archive = new CheckpointArchive(save_file, true);
+        vector<string> saved = saved_args(argc, argv, seed);
+        archive->io(saved);
+    }
+    if (archive) {
+        // The saving and restoring runs list their objects in the order
+        // they're built: the clock, which is already, then the rest.
+        SimContext::current().logged_manager().keep_idmap();
+    }
+
     if (host_lb == PLB && queue_type == COMPOSITE) {
         cout << "PLB and composite queueing not supported (for now)" << endl;
         exit(1);
@@ -248,16 +517,36 @@ int main(int argc, char **argv) {
     ConstantCcaSrc* sender;
     ConstantCcaSink* sink;
 
-    Route* routeout, *routein;
+    const Route* routeout, *routein;
 
-    ConstantCcaRtxTimerScanner rtxScanner(timeFromUs(0.01), eventlist);
+    RtxTimerWheel rtxScanner(timeFromUs(0.01), eventlist);
    
 #ifdef FAT_TREE
+    // Each pod's switches, hosts and flows get an event list of their
+    // own, with the same random seed as ours.
+    PdesEngine* pdes = NULL;
+    vector<RtxTimerWheel*> lp_scanners;
+    if (pdes_lps > 0) {
+        pdes = new PdesEngine(pdes_lps);
+        pdes->setEndtime(endtime);
+        pdes->set_sequential(pdes_sequential);
+        // Built in the LPs' own contexts, so they don't take IDs the
+        // rest of the network would have had without -pdes.
+        SimContext& context = SimContext::current();
+        for (uint32_t lp = 0; lp < pdes_lps; lp++) {
+            pdes->context(lp).bind();
+            lp_scanners.push_back(new RtxTimerWheel(timeFromUs(0.01), pdes->eventlist(lp)));
+        }
+        context.bind();
+    }
+    FatTreeTopology::set_pdes_engine(pdes);
     FatTreeTopology* top = new FatTreeTopology(no_of_nodes, linkspeed, queuesize, 
                                                NULL, &eventlist, NULL, queue_type, CONST_SCHEDULER, link_failures, failure_pct, rts, latency, flaky_links, timeFromUs(100.0), timeFromUs(10.0));
     // if (flaky_links > 0) {
     //     top->set_flaky_links(flaky_links, timeFromUs(100.0), timeFromUs(10.0)); // todo: parameterize this
     // }
+    if (pdes)
+        pdes->set_thread_init(FatTreeTopology::thread_settings());
 #endif
 
 #ifdef OV_FAT_TREE
@@ -291,16 +580,13 @@ int main(int argc, char **argv) {
     no_of_nodes = top->no_of_nodes();
     cout << "actual nodes " << no_of_nodes << endl;
 
-    vector<const Route*>*** net_paths;
-    net_paths = new vector<const Route*>**[no_of_nodes];
+    // paths are only built when a connection needs them
+    PathCache net_paths(*top, true, path_cache_size);
 
     int* is_dest = new int[no_of_nodes];
     
     for (uint32_t i=0; i<no_of_nodes; i++){
         is_dest[i] = 0;
-        net_paths[i] = new vector<const Route*>*[no_of_nodes];
-        for (uint32_t j = 0; j<no_of_nodes; j++)
-            net_paths[i][j] = NULL;
     }
 
     // Permutation connections
@@ -335,8 +621,41 @@ int main(int argc, char **argv) {
     all_conns = conns->getAllConnections();
     uint32_t connCount = all_conns->size();
 
-    for (uint32_t c = 0; c < all_conns->size(); c++){
-        connection* crt = all_conns->at(c);
+    // With -recycle, srcs are pooled by host and sinks by destination.
+    // The flows started and not yet recycled are logged at the end.
+    FlowPool<ConstantCcaSrc> src_pool;
+    FlowPool<ConstantCcaSink> sink_pool;
+    map<id_t, ConstantCcaSrc*> live;
+    FlowRecycler<ConstantCcaSrc>* recycler = NULL;
+    if (recycle) {
+        flowlog << FLOWLOG_HEADER << endl;
+        // a src with packets still waiting in its NIC's scheduler isn't done
+        auto queued = [](ConstantCcaSrc* sender) {
+            for (size_t s = 0; s < sender->subflows().size(); s++) {
+                if (sender->queuesize(sender->subflows()[s]->flow().flow_id()) > 0)
+                    return true;
+            }
+            return false;
+        };
+        recycler = new FlowRecycler<ConstantCcaSrc>(eventlist, recycle_linger, queued, [&](ConstantCcaSrc* sender) {
+            ConstantCcaSink* sink = sender->_sink;
+            log_flow(flowlog, sender);
+            if (route_strategy != SOURCE_ROUTE) {
+                for (size_t s = 0; s < sender->subflows().size(); s++) {
+                    flowid_t flow_id = sender->subflows()[s]->flow().flow_id();
+                    top->remove_host_port(sender->_addr, flow_id);
+                    top->remove_host_port(sender->_destination, flow_id);
+                }
+            }
+            live.erase(sender->get_id());
+            src_pool.release(sender->_addr, sender);
+            sink_pool.release(sender->_destination, sink);
+            sender->reset();
+            sink->reset();
+        });
+    }
+
+    auto start_connection = [&](connection* crt) {
         uint32_t src = crt->src;
         uint32_t dest = crt->dst;
         if (src == dest) {
@@ -345,17 +664,12 @@ int main(int argc, char **argv) {
         }
         
         connID++;
-        if (!net_paths[src][dest]) {
-            vector<const Route*>* paths = top->get_paths(src,dest);
-            net_paths[src][dest] = paths;
-            for (uint32_t p = 0; p < paths->size(); p++) {
-                routes.push_back((*paths)[p]);
-            }
-        }
-        if (!net_paths[dest][src]) {
-            vector<const Route*>* paths = top->get_paths(dest,src);
-            net_paths[dest][src] = paths;
+        uint32_t no_of_paths = net_paths.no_of_paths(src, dest);
+#if PRINT_PATHS
+        for (uint32_t p = 0; p < no_of_paths; p++) {
+            routes.push_back(net_paths.get_path(src, dest, p));
         }
+#endif
         // TODO: set the number of subflows here (if -subflows == 0) such that the rate  is low enough for a certain dupack threshold
         if (no_of_subflows == 0) {
             int num_queues = 4;
@@ -373,7 +687,18 @@ int main(int argc, char **argv) {
 
         double rate = (linkspeed / ((double)all_conns->size() / no_of_nodes)) / (packet_size * 8); // assumes all nodes have the same number of connections
         simtime_picosec interpacket_delay = timeFromSec(1. / (rate * rate_coef)); //+ rand() % (2*(no_of_nodes-1)); // just to keep them not perfectly in sync
-        sender = new ConstantCcaSrc(rtxScanner, eventlist, src, interpacket_delay, NULL);  
+        sender = recycle ? src_pool.acquire(src) : NULL;
+        if (!sender) {
+#ifdef FAT_TREE
+            if (pdes) {
+                uint32_t lp = top->host_lp(src);
+                sender = new ConstantCcaSrc(*lp_scanners[lp], pdes->eventlist(lp), src, interpacket_delay, NULL);
+            } else
+#endif
+            sender = new ConstantCcaSrc(rtxScanner, eventlist, src, interpacket_delay, NULL);  
+            if (recycle)
+                sender->set_end_trigger(*new FlowEndTrigger<ConstantCcaSrc>(eventlist, connID, *recycler, *sender));
+        }
 
         if (disable_fr) {
             sender->disable_fast_recovery(); // no fast recovery when we have packet trimming
@@ -401,13 +726,19 @@ int main(int argc, char **argv) {
             // }
             sender->set_dupack_thresh(dupack_thresh);
         }
-        srcs.push_back(sender);
-        sink = new ConstantCcaSink();
-        sinks.push_back(sink);
+        sink = recycle ? sink_pool.acquire(dest) : NULL;
+        if (!sink)
+            sink = new ConstantCcaSink();
+        if (recycle) {
+            live[sender->get_id()] = sender;
+        } else {
+            srcs.push_back(sender);
+            sinks.push_back(sink);
+        }
 
-        sender->setName("constcca_" + ntoa(src) + "_" + ntoa(dest));
+        sender->setIdName("constcca", src, dest);
 
-        sink->setName("constcca_sink_" + ntoa(src) + "_" + ntoa(dest));
+        sink->setIdName("constcca_sink", src, dest);
 
           
         if (route_strategy != SOURCE_ROUTE) {
@@ -417,24 +748,24 @@ int main(int argc, char **argv) {
             uint32_t choice = 0;
           
 #ifdef FAT_TREE
-            choice = rand()%net_paths[src][dest]->size();
+            choice = rand()%no_of_paths;
 #endif
           
 #ifdef OV_FAT_TREE
-            choice = rand()%net_paths[src][dest]->size();
+            choice = rand()%no_of_paths;
 #endif
           
 #ifdef MH_FAT_TREE
-            int use_all = it_sub==net_paths[src][dest]->size();
+            int use_all = it_sub==no_of_paths;
 
             if (use_all)
                 choice = inter;
             else
-                choice = rand()%net_paths[src][dest]->size();
+                choice = rand()%no_of_paths;
 #endif
           
 #ifdef VL2
-            choice = rand()%net_paths[src][dest]->size();
+            choice = rand()%no_of_paths;
 #endif
           
 #ifdef STAR
@@ -447,45 +778,54 @@ int main(int argc, char **argv) {
             int min = -1, max = -1,minDist = 1000,maxDist = 0;
             if (subflow_count==1){
                 //find shortest and longest path 
-                for (uint32_t dd=0;dd<net_paths[src][dest]->size();dd++){
-                    if (net_paths[src][dest]->at(dd)->size()<minDist){
-                        minDist = net_paths[src][dest]->at(dd)->size();
+                for (uint32_t dd=0;dd<no_of_paths;dd++){
+                    const Route* path = net_paths.get_path(src,dest,dd);
+                    if (path->size()<minDist){
+                        minDist = path->size();
                         min = dd;
                     }
-                    if (net_paths[src][dest]->at(dd)->size()>maxDist){
-                        maxDist = net_paths[src][dest]->at(dd)->size();
+                    if (path->size()>maxDist){
+                        maxDist = path->size();
                         max = dd;
                     }
+                    net_paths.put_path(path);
                 }
                 choice = min;
             } 
             else
-                choice = rand()%net_paths[src][dest]->size();
+                choice = rand()%no_of_paths;
 #endif
-            if (choice>=net_paths[src][dest]->size()){
-                printf("Weird path choice %d out of %lu\n",choice,net_paths[src][dest]->size());
+            if (choice>=no_of_paths){
+                printf("Weird path choice %d out of %u\n",choice,no_of_paths);
                 exit(1);
             }
           
 #if PRINT_PATHS
-            for (uint32_t ll=0;ll<net_paths[src][dest]->size();ll++){
+            for (uint32_t ll=0;ll<no_of_paths;ll++){
                 paths << "Route from "<< ntoa(src) << " to " << ntoa(dest) << "  (" << ll << ") -> " ;
-                print_path(paths,net_paths[src][dest]->at(ll));
+                const Route* path = net_paths.get_path(src,dest,ll);
+                print_path(paths,path);
+                net_paths.put_path(path);
             }
 #endif
           
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            routeout = net_paths.get_path(src, dest, choice);
             //routeout->push_back(swiftSnk);
             
-            routein = new Route(*top->get_paths(dest,src)->at(choice));
+            routein = net_paths.get_path(dest, src, choice);
             //routein->push_back(swiftSrc);
         }
 
         // simtime_picosec offset = (interpacket_delay/connCount) * (connID-1);
         // simtime_picosec offset = (interpacket_delay/connCount) * (rand()%(connCount-1));
         // simtime_picosec starttime = crt->start + offset;
-        sender->set_paths(net_paths[src][dest]);
-        sender->connect(*sink, (uint32_t)crt->start + rand()%(interpacket_delay), no_of_subflows, dest, *routeout, *routein);
+        sender->set_paths(net_paths, dest);
+        sender->connect(*sink, crt->start + rand()%(interpacket_delay), no_of_subflows, dest, *routeout, *routein);
+        if (route_strategy == SOURCE_ROUTE) {
+            // the subflows have copies of their own
+            net_paths.put_path(routeout);
+            net_paths.put_path(routein);
+        }
         sender->set_cwnd(cwnd*Packet::data_packet_size());
         // sender->set_paths(net_paths[src][dest]);
 
@@ -498,21 +838,197 @@ int main(int argc, char **argv) {
                 cout << "Added subflow " << sub->flow().flow_id() << " from " << src << " to " << dest << endl;
             }
         }
+    };
+
+    ConnectionLauncher* launcher = NULL;
+    if (recycle) {
+        launcher = new ConnectionLauncher(eventlist, *all_conns, start_connection);
+    } else {
+        for (uint32_t c = 0; c < all_conns->size(); c++)
+            start_connection(all_conns->at(c));
     }
     //    ShortFlows* sf = new ShortFlows(2560, eventlist, net_paths,conns,lg, &swiftRtxScanner);
 
-    cout << "Loaded " << connID << " connections in total\n";
+    if (launcher)
+        cout << "Starting " << connCount << " connections as they're due\n";
+    else
+        cout << "Loaded " << connID << " connections in total\n";
+
+    EventProfiler* profiler = NULL;
+    if (profile_file) {
+        profiler = new EventProfiler();
+        eventlist.setProfiler(profiler);
+    }
+    eventlist.setBatchDispatch(batch_dispatch);
+
+    if (replicas > 0) {
+        // Each replica shares the topology, routes and connections built
+        // above, copy-on-write, and runs with its own random numbers from
+        // here on.  Choices setup made with rand() - the source-routed
+        // paths and start time jitter - are the same in every replica.
+        Brancher setup;
+        cout << "Setup done: starting " << replicas << " replicas" << endl;
+        uint32_t replica = setup.branch(replicas);
+        if (replica == Brancher::PARENT) {
+            // gather the replicas' flow logs into ours
+            for (uint32_t r = 0; r < replicas; r++) {
+                stringstream name;
+                name << flowfilename.str() << ".replica" << r;
+                std::ifstream in(name.str().c_str());
+                if (!in) {
+                    cout << "No flow log from replica " << r << endl;
+                    continue;
+                }
+                string line;
+                bool header = true;
+                while (getline(in, line)) {
+                    if (header && r > 0) {
+                        header = false;
+                        continue;
+                    }
+                    flowlog << (header ? "Replica" : ntoa(r)) << "," << line << endl;
+                    header = false;
+                }
+                in.close();
+                remove(name.str().c_str());
+            }
+            flowlog.close();
+            cout << "Flow logs of " << replicas << " replicas written to " << flowfilename.str() << endl;
+            return setup.failures() ? 1 : 0;
+        }
+        srand(seed + replica + 1);
+        srandom(seed + replica + 1);
+        flowfilename << ".replica" << replica;
+        open_branch_output(flowlog, flowfilename.str());
+    }
+
+    Checkpoint* warm = NULL;
+    if (branches > 0 || archive)
+        warm = new Checkpoint(eventlist, checkpoint_time);
+
+    simtime_picosec checkpoint = timeFromUs(100.0);
+    vector<Logged*> objects;
+    if (archive) {
+        objects.push_back(&c);
+        objects.insert(objects.end(), SimContext::current().logged_manager().idmap().begin(), SimContext::current().logged_manager().idmap().end());
+    }
+    if (restore_file) {
+        archive->checkpoint(eventlist, objects);
+        delete archive;
+        archive = NULL;
+        warm = NULL;
+        cout << "Restored " << restore_file << " at " << timeAsUs(eventlist.now()) << "us" << endl;
+        // print the time where the saved run would have next
+        while (checkpoint < eventlist.now())
+            checkpoint += timeFromUs(100.0);
+        if (!variants.empty()) {
+            // the same run as branch 0 of the one forked with this -variant
+            srand(seed + 1);
+            srandom(seed + 1);
+            const BranchVariant& v = variants[0];
+            cout << "Variant: " << v.options << endl;
+            apply_variant(v, srcs, rate_coef);
+            if (v.endtime) {
+                endtime = v.endtime;
+                eventlist.setEndtime(endtime);
+            }
+        }
+    }
 
     // GO!
     cout << "Starting simulation" << endl;
-    simtime_picosec checkpoint = timeFromUs(100.0);
+#ifdef FAT_TREE
+    if (pdes) {
+        // Our own event list still has the clock on it, so run that in
+        // step with the LPs, checking in after the first event past
+        // each checkpoint just as the loop below does.  The flows'
+        // timers are all on the LPs' wheels.
+        eventlist.cancelPendingSource(rtxScanner);
+        while (true) {
+            simtime_picosec local, lp, now;
+            bool has_local = eventlist.nextEventTime(local);
+            bool has_lp = pdes->next_time(lp);
+            if (!has_local && !has_lp)
+                break;
+            if (has_local && (!has_lp || local <= lp)) {
+                eventlist.doNextEvent();
+                now = local;
+            } else if (lp > checkpoint) {
+                pdes->run_until(lp + 1);
+                now = lp;
+            } else {
+                pdes->run_until(has_local ? min(checkpoint + 1, local) : checkpoint + 1);
+                continue;
+            }
+            if (endtime > 0 && now >= endtime)
+                break;
+            if (now <= checkpoint)
+                continue;
+            cout << "Simulation time " << timeAsUs(now) << endl;
+            checkpoint += timeFromUs(100.0);
+            if (endtime == 0) {
+                bool all_done = true;
+                list <ConstantCcaSrc*>::iterator src_i;
+                for (src_i = srcs.begin(); src_i != srcs.end(); src_i++) {
+                    if ((*src_i)->highest_dsn_ack() < (*src_i)->_flow_size) {
+                        all_done = false;
+                        break;
+                    }
+                }
+                if (all_done) {
+                    cout << "All flows completed" << endl;
+                    break;
+                }
+            }
+        }
+    }
+    while (!pdes && eventlist.doNextEvent()) {
+#else
     while (eventlist.doNextEvent()) {
+#endif
+        if (warm && warm->reached() && archive) {
+            archive->checkpoint(eventlist, objects);
+            delete archive;
+            archive = NULL;
+            warm = NULL;
+            cout << "Saved " << save_file << " at " << timeAsUs(eventlist.now()) << "us" << endl;
+        }
+        if (warm && warm->reached()) {
+            uint32_t branch = warm->branch(branches);
+            if (branch == Brancher::PARENT) {
+                flowlog.close();
+                remove(flowfilename.str().c_str());
+                cout << "Branch flow logs are in " << flowfilename.str() << ".branch*" << endl;
+                return warm->failures() ? 1 : 0;
+            }
+            // each branch has its own random numbers, flow log and output
+            srand(seed + branch + 1);
+            srandom(seed + branch + 1);
+            flowfilename << ".branch" << branch;
+            open_branch_output(flowlog, flowfilename.str());
+            if (!variants.empty()) {
+                const BranchVariant& v = variants[branch];
+                cout << "Branch " << branch << " variant: " << v.options << endl;
+                apply_variant(v, srcs, rate_coef);
+                if (v.endtime) {
+                    endtime = v.endtime;
+                    eventlist.setEndtime(endtime);
+                }
+            }
+            warm = NULL;
+        }
+        if (endtime > 0 && eventlist.now() >= endtime) {
+            // only after a variant shortened the run: events were
+            // scheduled past the new end during the warm-up
+            break;
+        }
         if (eventlist.now() > checkpoint) {
             cout << "Simulation time " << timeAsUs(eventlist.now()) << endl;
             checkpoint += timeFromUs(100.0);
             if (endtime == 0) {
-                // Iterate through sources to see if they have completed the flows
-                bool all_done = true;
+                // Iterate through sources to see if they have completed the flows,
+                // or with -recycle count them as they finish
+                bool all_done = !recycle || recycler->finished() == connCount;
                 list <ConstantCcaSrc*>::iterator src_i;
                 for (src_i = srcs.begin(); src_i != srcs.end(); src_i++) {
                     if ((*src_i)->highest_dsn_ack() < (*src_i)->_flow_size) {
@@ -529,6 +1045,19 @@ int main(int argc, char **argv) {
     }
 
     cout << "Done" << endl;
+    net_paths.report(cout);
+    RouteStore::current().report(cout);
+    MemoryAccount::current().report(cout);
+    if (profiler) {
+        eventlist.setProfiler(NULL);
+        profiler->report(cout, profile_file);
+    }
+    if (batch_dispatch)
+        eventlist.reportBatching(cout);
+#ifdef FAT_TREE
+    if (pdes)
+        pdes->report(cout);
+#endif
 
 #if PRINT_PATHS
     list <const Route*>::iterator rt_i;
@@ -576,11 +1105,18 @@ int main(int argc, char **argv) {
     // for (src_i = swift_srcs.begin(); src_i != swift_srcs.end(); src_i++) {
     //     cout << "Src, sent: " << (*src_i)->_highest_dsn_sent << "[rtx: " << (*src_i)->_subs[0]. << "] nacks: " << (*src_i)->_nacks_received << " pulls: " << (*src_i)->_pulls_received << " paths: " << (*src_i)->_paths.size() << endl;
     // }
-    flowlog << "Flow ID,Drops,Spurious Retransmits,Completion Time,RTOs,ReceivedBytes,NACKs,DupACKs,PacketsSent" << endl;
+    if (recycle) {
+        // the rest were logged as they were recycled
+        map<id_t, ConstantCcaSrc*>::iterator live_i;
+        for (live_i = live.begin(); live_i != live.end(); live_i++)
+            log_flow(flowlog, live_i->second);
+        src_pool.report(cout, "ConstantCca srcs");
+        sink_pool.report(cout, "ConstantCca sinks");
+    } else {
+        flowlog << FLOWLOG_HEADER << endl;
+    }
     for (src_i = srcs.begin(); src_i != srcs.end(); src_i++) {
-        ConstantCcaSink* sink = (*src_i)->_sink;
-        simtime_picosec time = (*src_i)->_completion_time > 0 ? (*src_i)->_completion_time - (*src_i)->_start_time: 0;
-        flowlog << (*src_i)->_addr << "-" << (*src_i)->_destination << "," << (*src_i)->drops() << "," << sink->spurious_retransmits() << "," << time << "," << (*src_i)->rtos() << "," << sink->cumulative_ack() << "," << sink->nacks_sent() << "," << (*src_i)->total_dupacks() << "," << (*src_i)->packets_sent() <<  endl;
+        log_flow(flowlog, *src_i);
     }
     flowlog.close();
     list <ConstantCcaSink*>::iterator sink_i;
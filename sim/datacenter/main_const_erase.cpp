@@ -197,6 +197,8 @@ int main(int argc, char **argv) {
         i++;
     }
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
     eventlist.setEndtime(endtime);
 
     queuesize = queuesize*Packet::data_packet_size();
@@ -232,7 +234,7 @@ int main(int argc, char **argv) {
     ConstantErasureCcaSrc* sender;
     ConstantErasureCcaSink* sink;
 
-    Route* routeout, *routein;
+    const Route* routeout, *routein;
 
 #ifdef FAT_TREE
     FatTreeTopology* top = new FatTreeTopology(no_of_nodes, linkspeed, queuesize, 
@@ -361,9 +363,9 @@ int main(int argc, char **argv) {
         sink = new ConstantErasureCcaSink();
         sinks.push_back(sink);
 
-        sender->setName("constcca_" + ntoa(src) + "_" + ntoa(dest));
+        sender->setIdName("constcca", src, dest);
 
-        sink->setName("constcca_sink_" + ntoa(src) + "_" + ntoa(dest));
+        sink->setIdName("constcca_sink", src, dest);
 
           
         if (route_strategy != SOURCE_ROUTE) {
@@ -434,10 +436,10 @@ int main(int argc, char **argv) {
             }
 #endif
           
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            routeout = RouteStore::current().intern(*(net_paths[src][dest]->at(choice)));
             //routeout->push_back(swiftSnk);
             
-            routein = new Route(*top->get_paths(dest,src)->at(choice));
+            routein = RouteStore::current().intern(*top->get_paths(dest,src)->at(choice));
             //routein->push_back(swiftSrc);
         }
 
@@ -194,6 +194,7 @@ int main(int argc, char **argv) {
         i++;
     }
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
     eventlist.setEndtime(endtime);
 
     queuesize = queuesize*Packet::data_packet_size();
@@ -230,7 +231,7 @@ int main(int argc, char **argv) {
 
     Route* routeout, *routein;
 
-    ConstantCcaORtxTimerScanner rtxScanner(timeFromUs(0.01), eventlist);
+    RtxTimerWheel rtxScanner(timeFromUs(0.01), eventlist);
    
 #ifdef FAT_TREE
     FatTreeTopology* top = new FatTreeTopology(no_of_nodes, linkspeed, queuesize, 
@@ -369,9 +370,9 @@ int main(int argc, char **argv) {
         sink = new ConstantCcaOSink();
         sinks.push_back(sink);
 
-        sender->setName("constcca_" + ntoa(src) + "_" + ntoa(dest));
+        sender->setIdName("constcca", src, dest);
 
-        sink->setName("constcca_sink_" + ntoa(src) + "_" + ntoa(dest));
+        sink->setIdName("constcca_sink", src, dest);
 
           
         if (route_strategy != SOURCE_ROUTE) {
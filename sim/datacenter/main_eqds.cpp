@@ -11,6 +11,7 @@
 #include "logfile.h"
 #include "eqds_logger.h"
 #include "clock.h"
+#include "event_profiler.h"
 #include "eqds.h"
 #include "compositequeue.h"
 #include "topology.h"
@@ -18,6 +19,8 @@
 
 #include "fat_tree_topology.h"
 #include "fat_tree_switch.h"
+#include "flow_pool.h"
+#include "flow_recycler.h"
 
 #include <list>
 
@@ -60,12 +63,15 @@ int main(int argc, char **argv) {
     bool log_traffic = false;
     bool log_switches = false;
     bool log_queue_usage = false;
+    bool log_memory = false;
     double ecn_thresh = 0.5; // default marking threshold for ECN load balancing
 
     RouteStrategy route_strategy = NOT_SET;
     
     int seed = 13;
     int path_burst = 1;
+    bool recycle = false;
+    simtime_picosec recycle_linger = 0;
     int i = 1;
 
     bool oversubscribed_congestion_control = false;
@@ -80,7 +86,9 @@ int main(int argc, char **argv) {
     FatTreeSwitch::sticky_choices ar_sticky = FatTreeSwitch::PER_PACKET;
 
     char* tm_file = NULL;
+    char* profile_file = NULL;
     char* topo_file = NULL;
+    simtime_picosec pkt_trim = 0;
 
     while (i<argc) {
         if (!strcmp(argv[i],"-o")) {
@@ -95,6 +103,14 @@ int main(int argc, char **argv) {
             no_of_conns = atoi(argv[i+1]);
             cout << "no_of_conns "<<no_of_conns << endl;
             i++;
+        } else if (!strcmp(argv[i],"-profile")) {
+            // time events by class, writing the table to this CSV file too
+            profile_file = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-pkttrim")) {
+            // every this many us, free packet slabs nothing is using
+            pkt_trim = timeFromUs(atof(argv[i+1]));
+            i++;
         } else if (!strcmp(argv[i],"-end")) {
             end_time = atoi(argv[i+1]);
             cout << "endtime(us) "<< end_time << endl;
@@ -166,6 +182,9 @@ int main(int argc, char **argv) {
             } else if (!strcmp(argv[i+1], "queue_usage")) {
                 cout << "logging queue usage\n";
                 log_queue_usage = true;
+            } else if (!strcmp(argv[i+1], "memory")) {
+                cout << "logging memory by subsystem\n";
+                log_memory = true;
             } else {
                 exit_error(argv[0]);
             }
@@ -216,6 +235,13 @@ int main(int argc, char **argv) {
             path_burst = atoi(argv[i+1]);
             cout << "path burst " << path_burst << endl;
             i++;
+        } else if (!strcmp(argv[i],"-recycle")){
+            // start connections when they're due, reusing the srcs and
+            // sinks of flows finished at least this many us ago - long
+            // enough for their last packets to have been delivered
+            recycle = true;
+            recycle_linger = timeFromUs(atof(argv[i+1]));
+            i++;
         } else if (!strcmp(argv[i],"-hop_latency")){
             hop_latency = timeFromUs(atof(argv[i+1]));
             cout << "Hop latency set to " << timeAsUs(hop_latency) << endl;
@@ -322,6 +348,8 @@ int main(int argc, char **argv) {
     srandom(seed);
     cout << "Parsed args\n";
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
 
     if (route_strategy==NOT_SET){
         route_strategy = ECMP_FIB;
@@ -397,6 +425,12 @@ int main(int argc, char **argv) {
         event_logger = new FlowEventLoggerSimple();
         logfile.addLogger(*event_logger);
     }
+    MemoryLoggerSampling* memory_logger = NULL;
+    if (log_memory) {
+        memory_logger = new MemoryLoggerSampling(logtime, eventlist);
+        memory_logger->monitorMemoryAccount();
+        logfile.addLogger(*memory_logger);
+    }
 
     //EqdsSrc::setMinRTO(50000); //increase RTO to avoid spurious retransmits
     EqdsSrc::_path_entropy_size = path_entropy_size;
@@ -485,27 +519,90 @@ int main(int argc, char **argv) {
 
     map <flowid_t, TriggerTarget*> flowmap;
 
-    for (size_t c = 0; c < all_conns->size(); c++){
-        connection* crt = all_conns->at(c);
+    if (recycle) {
+        for (size_t c = 0; c < all_conns->size(); c++) {
+            connection* crt = all_conns->at(c);
+            if (crt->trigger || crt->send_done_trigger || crt->recv_done_trigger) {
+                cout << "-recycle doesn't work with triggers in the connection matrix" << endl;
+                exit(1);
+            }
+        }
+    }
+
+    // With -recycle, srcs are pooled by host and sinks by destination.
+    // Their packet counts are added up as they're recycled, and those
+    // still live at the end are counted then.  EqdsSrc keeps its sink
+    // and hosts to itself, so live flows remember them here.
+    struct LiveFlow {EqdsSink* sink; uint32_t src, dest;};
+    FlowPool<EqdsSrc> src_pool;
+    FlowPool<EqdsSink> sink_pool;
+    map<EqdsSrc*, LiveFlow> live;
+    vector<Route*> tor_routes(no_of_nodes, NULL); // each host's, shared by its flows
+    int new_pkts = 0, rtx_pkts = 0, bounce_pkts = 0, rts_pkts = 0;
+    FlowRecycler<EqdsSrc>* recycler = NULL;
+    if (recycle) {
+        // A finished src may still have packets waiting for its NIC.  Its
+        // sink may still be pulling, too - speculative credit can leave
+        // it owed more than the flow needed - so stop that and give the
+        // last pulls another linger to arrive.
+        auto busy = [&](EqdsSrc* sender) {
+            EqdsSink* sink = live[sender].sink;
+            if (sink->pullsQueued()) {
+                sink->stopPulls();
+                return true;
+            }
+            return sender->waitingForNIC();
+        };
+        recycler = new FlowRecycler<EqdsSrc>(eventlist, recycle_linger, busy, [&](EqdsSrc* sender) {
+            LiveFlow flow = live[sender];
+            top->remove_host_port(flow.src, flow.sink->flowId());
+            top->remove_host_port(flow.dest, sender->flowId());
+            new_pkts += sender->_new_packets_sent;
+            rtx_pkts += sender->_rtx_packets_sent;
+            rts_pkts += sender->_rts_packets_sent;
+            bounce_pkts += sender->_bounces_received;
+            live.erase(sender);
+            src_pool.release(flow.src, sender);
+            sink_pool.release(flow.dest, flow.sink);
+            sender->reset();
+            flow.sink->reset();
+        });
+    }
+
+    auto start_connection = [&](connection* crt) {
         int src = crt->src;
         int dest = crt->dst;
         //cout << "Connection " << crt->src << "->" <<crt->dst << " starting at " << crt->start << " size " << crt->size << endl;
 
-        eqds_src = new EqdsSrc(traffic_logger, eventlist, *nics.at(src));
+        eqds_src = recycle ? src_pool.acquire(src) : NULL;
+        if (!eqds_src) {
+            eqds_src = new EqdsSrc(traffic_logger, eventlist, *nics.at(src));
+            if (recycle) {
+                eqds_src->setEndTrigger(*new FlowEndTrigger<EqdsSrc>(eventlist, 0, *recycler, *eqds_src));
+            }
+            if (log_flow_events) {
+                eqds_src->logFlowEvents(*event_logger);
+            }
+        }
         eqds_src->setCwnd(cwnd*Packet::data_packet_size());
-        eqds_srcs.push_back(eqds_src);
-        eqds_src->setDst(dest);
-
-        if (log_flow_events) {
-            eqds_src->logFlowEvents(*event_logger);
+        if (!recycle) {
+            eqds_srcs.push_back(eqds_src);
         }
+        eqds_src->setDst(dest);
         
-        eqds_snk = new EqdsSink(NULL,pacers[dest],*nics.at(dest));
-        eqds_src->setName("Eqds_" + ntoa(src) + "_" + ntoa(dest));
+        eqds_snk = recycle ? sink_pool.acquire(dest) : NULL;
+        bool new_sink = !eqds_snk;
+        if (new_sink) {
+            eqds_snk = new EqdsSink(NULL,pacers[dest],*nics.at(dest));
+        }
+        if (recycle) {
+            live[eqds_src] = {eqds_snk, (uint32_t)src, (uint32_t)dest};
+        }
+        eqds_src->setIdName("Eqds", src, dest);
         logfile.writeName(*eqds_src);
         eqds_snk->setSrc(src);
                         
-        eqds_snk->setName("Eqds_sink_" + ntoa(src) + "_" + ntoa(dest));
+        eqds_snk->setIdName("Eqds_sink", src, dest);
         logfile.writeName(*eqds_snk);
 
         if (crt->flowid) {
@@ -543,15 +640,20 @@ int main(int argc, char **argv) {
         case ECMP_FIB_ECN:
         case REACTIVE_ECN:
             {
-                Route* srctotor = new Route();
-                srctotor->push_back(top->queues_ns_nlp[src][top->HOST_POD_SWITCH(src)][0]);
-                srctotor->push_back(top->pipes_ns_nlp[src][top->HOST_POD_SWITCH(src)][0]);
-                srctotor->push_back(top->queues_ns_nlp[src][top->HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
-
-                Route* dsttotor = new Route();
-                dsttotor->push_back(top->queues_ns_nlp[dest][top->HOST_POD_SWITCH(dest)][0]);
-                dsttotor->push_back(top->pipes_ns_nlp[dest][top->HOST_POD_SWITCH(dest)][0]);
-                dsttotor->push_back(top->queues_ns_nlp[dest][top->HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
+                Route* srctotor;
+                Route* dsttotor;
+                if (recycle) {
+                    // recycled flows would pile up routes otherwise
+                    if (!tor_routes[src])
+                        tor_routes[src] = top->get_tor_route(src);
+                    if (!tor_routes[dest])
+                        tor_routes[dest] = top->get_tor_route(dest);
+                    srctotor = tor_routes[src];
+                    dsttotor = tor_routes[dest];
+                } else {
+                    srctotor = top->get_tor_route(src);
+                    dsttotor = top->get_tor_route(dest);
+                }
 
 
                 eqds_src->connect(*srctotor, *dsttotor, *eqds_snk, crt->start);
@@ -572,9 +674,17 @@ int main(int argc, char **argv) {
         // set up the triggers
         // xxx
 
-        if (log_sink) {
+        if (log_sink && new_sink) {
             sink_logger->monitorSink(eqds_snk);
         }
+    };
+
+    if (recycle) {
+        new ConnectionLauncher(eventlist, *all_conns, start_connection);
+        cout << "Starting " << all_conns->size() << " connections as they're due\n";
+    } else {
+        for (size_t c = 0; c < all_conns->size(); c++)
+            start_connection(all_conns->at(c));
     }
 
     Logged::dump_idmap();
@@ -585,13 +695,36 @@ int main(int argc, char **argv) {
     //logfile.write("# corelinkrate = " + ntoa(HOST_NIC*CORE_TO_HOST) + " pkt/sec");
     //logfile.write("# buffer = " + ntoa((double) (queues_na_ni[0][1]->_maxsize) / ((double) pktsize)) + " pkt");
     
+    EventProfiler* profiler = NULL;
+    if (profile_file) {
+        profiler = new EventProfiler();
+        eventlist.setProfiler(profiler);
+    }
+
     // GO!
     cout << "Starting simulation" << endl;
+    simtime_picosec next_trim = pkt_trim;
     while (eventlist.doNextEvent()) {
+        if (pkt_trim && eventlist.now() >= next_trim) {
+            PacketArena::current().trim();
+            next_trim = eventlist.now() + pkt_trim;
+        }
     }
 
     cout << "Done" << endl;
-    int new_pkts = 0, rtx_pkts = 0, bounce_pkts = 0, rts_pkts = 0;
+    PacketArena::current().report(cout);
+    MemoryAccount::current().report(cout);
+    if (profiler) {
+        eventlist.setProfiler(NULL);
+        profiler->report(cout, profile_file);
+    }
+    if (recycle) {
+        map<EqdsSrc*, LiveFlow>::iterator live_i;
+        for (live_i = live.begin(); live_i != live.end(); live_i++)
+            eqds_srcs.push_back(live_i->first);
+        src_pool.report(cout, "EQDS srcs");
+        sink_pool.report(cout, "EQDS sinks");
+    }
     for (size_t ix = 0; ix < eqds_srcs.size(); ix++) {
         new_pkts += eqds_srcs[ix]->_new_packets_sent;
         rtx_pkts += eqds_srcs[ix]->_rtx_packets_sent;
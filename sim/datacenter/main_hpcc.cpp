@@ -22,6 +22,7 @@
 #include "connection_matrix.h"
 #include "fat_tree_topology.h"
 #include "fat_tree_switch.h"
+#include "path_cache.h"
 
 #include <list>
 
@@ -281,6 +282,7 @@ int main(int argc, char **argv) {
 
     cout << "Parsed args\n";
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
 
     FatTreeSwitch::_ar_sticky = FatTreeSwitch::PER_FLOWLET;
     FatTreeSwitch::_sticky_delta = timeFromUs(ar_sticky_delta);
@@ -372,23 +374,9 @@ int main(int argc, char **argv) {
         top->add_switch_loggers(logfile, timeFromUs(20.0));
     }
 
-    vector<const Route*>*** net_paths;
-    net_paths = new vector<const Route*>**[no_of_nodes];
-
-    int **path_refcounts;
-    path_refcounts = new int*[no_of_nodes];
-
-    int* is_dest = new int[no_of_nodes];
-    
-    for (size_t s = 0; s < no_of_nodes; s++) {
-        is_dest[s] = 0;
-        net_paths[s] = new vector<const Route*>*[no_of_nodes];
-        path_refcounts[s] = new int[no_of_nodes];
-        for (size_t d = 0; d < no_of_nodes; d++) {
-            net_paths[s][d] = NULL;
-            path_refcounts[s][d] = 0;
-        }
-    }
+    // Paths are built as connections ask for them.  Each connection
+    // copies the one it uses, so the cache need only hold a few.
+    PathCache net_paths(*top, false, 1024);
     
     ConnectionMatrix* conns = new ConnectionMatrix(no_of_nodes);
 
@@ -416,28 +404,6 @@ int main(int argc, char **argv) {
     all_conns = conns->getAllConnections();
     vector <HPCCSrc*> hpcc_srcs;
 
-    for (size_t c = 0; c < all_conns->size(); c++){
-        connection* crt = all_conns->at(c);
-        int src = crt->src;
-        int dest = crt->dst;
-        path_refcounts[src][dest]++;
-        path_refcounts[dest][src]++;
-                        
-        if (!net_paths[src][dest]&&route_strategy!=ECMP_FIB) {
-            vector<const Route*>* paths = top->get_bidir_paths(src,dest,false);
-            net_paths[src][dest] = paths;
-            /*
-              for (unsigned int i = 0; i < paths->size(); i++) {
-              routes.push_back((*paths)[i]);
-              }
-            */
-        }
-        if (!net_paths[dest][src]&&route_strategy!=ECMP_FIB) {
-            vector<const Route*>* paths = top->get_bidir_paths(dest,src,false);
-            net_paths[dest][src] = paths;
-        }
-    }
-
     map <flowid_t, TriggerTarget*> flowmap;
 
     for (size_t c = 0; c < all_conns->size(); c++){
@@ -472,13 +438,13 @@ int main(int argc, char **argv) {
 
         hpccSnk = new HPCCSink();
                         
-        hpccSrc->setName("HPCC_" + ntoa(src) + "_" + ntoa(dest));
+        hpccSrc->setIdName("HPCC", src, dest);
 
         logfile.writeName(*hpccSrc);
 
         hpccSnk->set_src(src);
                         
-        hpccSnk->setName("HPCC_sink_" + ntoa(src) + "_" + ntoa(dest));
+        hpccSnk->setIdName("HPCC_sink", src, dest);
         logfile.writeName(*hpccSnk);
                         
         ((HostQueue*)top->queues_ns_nlp[src][top->HOST_POD_SWITCH(src)][0])->addHostSender(hpccSrc);
@@ -509,47 +475,24 @@ int main(int argc, char **argv) {
             top->switches_lp[top->HOST_POD_SWITCH(src)]->addHostPort(src,hpccSrc->flow_id(),hpccSrc);
             top->switches_lp[top->HOST_POD_SWITCH(dest)]->addHostPort(dest,hpccSrc->flow_id(),hpccSnk);
         } else {
-            int choice = rand()%net_paths[src][dest]->size();
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            int choice = rand()%net_paths.no_of_paths(src, dest);
+            const Route* path = net_paths.get_path(src, dest, choice);
+            routeout = new Route(*path);
+            net_paths.put_path(path);
             routeout->add_endpoints(hpccSrc, hpccSnk);
                                 
-            routein = new Route(*top->get_bidir_paths(dest,src,false)->at(choice));
+            path = net_paths.get_path(dest, src, choice);
+            routein = new Route(*path);
+            net_paths.put_path(path);
             routein->add_endpoints(hpccSnk, hpccSrc);
             hpccSrc->connect(routeout, routein, *hpccSnk, timeFromUs((uint32_t)rand()%20));
         }
 
-        path_refcounts[src][dest]--;
-        path_refcounts[dest][src]--;
-
-        // free up the routes if no other connection needs them 
-        if (path_refcounts[src][dest] == 0 && net_paths[src][dest]) {
-            vector<const Route*>::iterator i;
-            for (i = net_paths[src][dest]->begin(); i != net_paths[src][dest]->end(); i++) {
-                if ((*i)->reverse())
-                    delete (*i)->reverse();
-                delete *i;
-            }
-            delete net_paths[src][dest];
-        }
-        if (path_refcounts[dest][src] == 0 && net_paths[dest][src]) {
-            vector<const Route*>::iterator i;
-            for (i = net_paths[dest][src]->begin(); i != net_paths[dest][src]->end(); i++) {
-                if ((*i)->reverse())
-                    delete (*i)->reverse();
-                delete *i;
-            }
-            delete net_paths[dest][src];
-        }
-
         if (log_sink) {
             sinkLogger.monitorSink(hpccSnk);
         }
     }
 
-    for (size_t ix = 0; ix < no_of_nodes; ix++) {
-        delete path_refcounts[ix];
-    }
-
     Logged::dump_idmap();
     // Record the setup
     int pktsize = Packet::data_packet_size();
@@ -64,6 +64,7 @@ int main(int argc, char **argv) {
     int k = 3;
     int flaky_links = 0;
     simtime_picosec latency = 0;
+    bool parallel = false;
     
     // Multi-DC specific parameters
     uint32_t num_datacenters = 2;
@@ -97,6 +98,9 @@ int main(int argc, char **argv) {
             num_datacenters = atoi(argv[i+1]);
             nodes_per_dc = no_of_nodes / num_datacenters;
             i++;
+        } else if (!strcmp(argv[i],"-parallel")){
+            // one thread per datacenter
+            parallel = true;
         } else if (!strcmp(argv[i],"-wan_speed")){
             wan_speed = speedFromGbps(atof(argv[i+1]));
             i++;
@@ -200,6 +204,8 @@ int main(int argc, char **argv) {
     }
     
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
     eventlist.setEndtime(endtime);
 
     // Initialize WAN queue size after packet size is set
@@ -208,6 +214,13 @@ int main(int argc, char **argv) {
     queuesize = queuesize*Packet::data_packet_size();
     srand(time(NULL));
     srandom(time(NULL));
+
+    // seeded from the main random numbers, so after srand()
+    PdesEngine* pdes = NULL;
+    if (parallel) {
+        pdes = new PdesEngine(num_datacenters);
+        pdes->setEndtime(endtime);
+    }
       
     cout << "Multi-DC Configuration:" << endl;
     cout << "  Number of datacenters: " << num_datacenters << endl;
@@ -243,12 +256,12 @@ int main(int argc, char **argv) {
     ConstantErasureCcaSrc* sender;
     ConstantErasureCcaSink* sink;
 
-    Route* routeout, *routein;
+    const Route* routeout, *routein;
 
     // Create multi-datacenter topology
     MultiDatacenterTopology* top = new MultiDatacenterTopology(
         num_datacenters, nodes_per_dc, linkspeed, wan_speed,
-        queuesize, wan_queue_size, wan_delay, NULL, &eventlist, queue_type);
+        queuesize, wan_queue_size, wan_delay, NULL, &eventlist, queue_type, pdes);
    
     no_of_nodes = top->no_of_nodes();
     cout << "actual nodes " << no_of_nodes << endl;
@@ -367,7 +380,7 @@ int main(int argc, char **argv) {
         }
         
         simtime_picosec interpacket_delay = timeFromSec(1. / (base_rate * rate_coef));
-        sender = new ConstantErasureCcaSrc(eventlist, src, interpacket_delay, NULL);  
+        sender = new ConstantErasureCcaSrc(top->dc_eventlist(top->get_dc_id(src)), src, interpacket_delay, NULL);  
                         
         if (crt->size>0){
             sender->set_flowsize(crt->size, k);
@@ -387,9 +400,9 @@ int main(int argc, char **argv) {
         sink = new ConstantErasureCcaSink();
         sinks.push_back(sink);
 
-        sender->setName("constcca_" + ntoa(src) + "_" + ntoa(dest));
+        sender->setIdName("constcca", src, dest);
 
-        sink->setName("constcca_sink_" + ntoa(src) + "_" + ntoa(dest));
+        sink->setIdName("constcca_sink", src, dest);
 
         // TODO:
         // Need to to connect each sink to ToR
@@ -410,7 +423,7 @@ int main(int argc, char **argv) {
                 exit(1);
             }
             
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            routeout = RouteStore::current().intern(*(net_paths[src][dest]->at(choice)));
             
             // Also check the reverse path
             vector<const Route*>* reverse_paths = top->get_bidir_paths(dest,src,false);
@@ -418,7 +431,7 @@ int main(int argc, char **argv) {
                 cout << "No valid reverse path found from " << dest << " to " << src << endl;
                 continue; // Skip this connection
             }
-            routein = new Route(*(reverse_paths->at(choice)));
+            routein = RouteStore::current().intern(*(reverse_paths->at(choice)));
 
             
         } else {
@@ -445,7 +458,7 @@ int main(int argc, char **argv) {
           
             // cout << "Creating forward route from " << src << " to " << dest << endl;
             // cout << "Route has " << net_paths[src][dest]->at(choice)->size() << " elements" << endl;
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            routeout = RouteStore::current().intern(*(net_paths[src][dest]->at(choice)));
             // cout << "Forward route created with " << routeout->size() << " hops" << endl;
             // if (routeout->size() > 0) {
             //     cout << "First element type: " << typeid(*routeout->at(0)).name() << endl;
@@ -458,7 +471,7 @@ int main(int argc, char **argv) {
                 continue; // Skip this connection
             }
             // cout << "Creating reverse route from " << dest << " to " << src << endl;
-            routein = new Route(*(reverse_paths->at(choice)));
+            routein = RouteStore::current().intern(*(reverse_paths->at(choice)));
 
         }
 
@@ -512,9 +525,10 @@ int main(int argc, char **argv) {
     // GO!
     cout << "Starting simulation" << endl;
     simtime_picosec checkpoint = timeFromUs(100.0);
-    while (eventlist.doNextEvent()) {
-        if (eventlist.now() > checkpoint) {
-            cout << "Simulation time " << timeAsUs(eventlist.now()) << endl;
+    while (pdes ? pdes->run_window() : eventlist.doNextEvent()) {
+        simtime_picosec now = pdes ? pdes->now() : eventlist.now();
+        if (now > checkpoint) {
+            cout << "Simulation time " << timeAsUs(now) << endl;
             checkpoint += timeFromUs(100.0);
             if (endtime == 0) {
                 // Iterate through sinks to see if they have completed the flows
@@ -535,6 +549,10 @@ int main(int argc, char **argv) {
     }
 
     cout << "Done" << endl;
+    if (pdes) {
+        pdes->report(cout);
+        delete pdes;
+    }
 
     flowlog << "Flow ID,Src->Dest,Completion Time,ReceivedBytes,PacketsSent,InterDC" << endl;
     list <ConstantErasureCcaSrc*>::iterator src_i;
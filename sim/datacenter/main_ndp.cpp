@@ -14,6 +14,7 @@
 #include "logfile.h"
 #include "loggers.h"
 #include "clock.h"
+#include "event_profiler.h"
 #include "ndp.h"
 #include "compositequeue.h"
 #include "firstfit.h"
@@ -23,6 +24,9 @@
 
 #include "fat_tree_topology.h"
 #include "fat_tree_switch.h"
+#include "path_cache.h"
+#include "flow_pool.h"
+#include "flow_recycler.h"
 
 #include <list>
 
@@ -78,6 +82,11 @@ int main(int argc, char **argv) {
     linkspeed_bps linkspeed = speedFromMbps((double)HOST_NIC);
     int packet_size = 9000;
     uint32_t path_entropy_size = 10000000;
+    // The sources and sinks copy their paths as they're set up, so the
+    // cache need only hold a few pairs' worth.
+    uint32_t path_cache_size = 1024;
+    bool recycle = false;
+    simtime_picosec recycle_linger = 0;
     uint32_t no_of_conns = 0, cwnd = 15, no_of_nodes = DEFAULT_NODES;
     uint32_t tiers = 3; // we support 2 and 3 tier fattrees
     double logtime = 0.25; // ms;
@@ -93,6 +102,7 @@ int main(int argc, char **argv) {
     bool log_traffic = false;
     bool log_switches = false;
     bool log_queue_usage = false;
+    bool log_memory = false;
     double ecn_thresh = 0.5; // default marking threshold for ECN load balancing
     RouteStrategy route_strategy = NOT_SET;
     int seed = 13;
@@ -111,7 +121,9 @@ int main(int argc, char **argv) {
     uint64_t high_pfc = 15, low_pfc = 12;
 
     char* tm_file = NULL;
+    char* profile_file = NULL;
     char* topo_file = NULL;
+    simtime_picosec pkt_trim = 0;
 
     while (i<argc) {
         if (!strcmp(argv[i],"-o")) {
@@ -124,6 +136,14 @@ int main(int argc, char **argv) {
             no_of_conns = atoi(argv[i+1]);
             cout << "no_of_conns "<<no_of_conns << endl;
             i++;
+        } else if (!strcmp(argv[i],"-profile")) {
+            // time events by class, writing the table to this CSV file too
+            profile_file = argv[i+1];
+            i++;
+        } else if (!strcmp(argv[i],"-pkttrim")) {
+            // every this many us, free packet slabs nothing is using
+            pkt_trim = timeFromUs(atof(argv[i+1]));
+            i++;
         } else if (!strcmp(argv[i],"-end")) {
             end_time = atoi(argv[i+1]);
             cout << "endtime(us) "<< end_time << endl;
@@ -196,6 +216,9 @@ int main(int argc, char **argv) {
             } else if (!strcmp(argv[i+1], "queue_usage")) {
                 cout << "logging queue usage\n";
                 log_queue_usage = true;
+            } else if (!strcmp(argv[i+1], "memory")) {
+                cout << "logging memory by subsystem\n";
+                log_memory = true;
             } else {
                 exit_error(argv[0]);
             }
@@ -238,6 +261,17 @@ int main(int argc, char **argv) {
             path_entropy_size = atoi(argv[i+1]);
             cout << "no of paths " << path_entropy_size << endl;
             i++;
+        } else if (!strcmp(argv[i],"-pathcache")){
+            // remember at most this many paths (0: all of them)
+            path_cache_size = atoi(argv[i+1]);
+            i++;
+        } else if (!strcmp(argv[i],"-recycle")){
+            // start connections when they're due, reusing the srcs and
+            // sinks of flows finished at least this many us ago - long
+            // enough for their last packets to have been delivered
+            recycle = true;
+            recycle_linger = timeFromUs(atof(argv[i+1]));
+            i++;
         } else if (!strcmp(argv[i],"-path_burst")){
             path_burst = atoi(argv[i+1]);
             cout << "path burst " << path_burst << endl;
@@ -364,6 +398,8 @@ int main(int argc, char **argv) {
     srandom(seed);
     cout << "Parsed args\n";
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
 
     NdpSink::_oversubscribed_congestion_control = oversubscribed_congestion_control;
 
@@ -430,6 +466,12 @@ int main(int argc, char **argv) {
     if (log_traffic) {
         logfile.addLogger(traffic_logger);
     }
+    MemoryLoggerSampling* memory_logger = NULL;
+    if (log_memory) {
+        memory_logger = new MemoryLoggerSampling(timeFromMs(logtime), eventlist);
+        memory_logger->monitorMemoryAccount();
+        logfile.addLogger(*memory_logger);
+    }
 
 #if PRINT_PATHS
     filename << ".paths";
@@ -452,7 +494,7 @@ int main(int argc, char **argv) {
     Route* routeout, *routein;
 
     // scanner interval must be less than min RTO
-    NdpRtxTimerScanner ndpRtxScanner(timeFromUs((uint32_t)9), eventlist);
+    RtxTimerWheel ndpRtxScanner(timeFromUs((uint32_t)9), eventlist);
    
     QueueLoggerFactory *qlf = 0;
     if (log_tor_downqueue || log_tor_upqueue) {
@@ -501,23 +543,8 @@ int main(int argc, char **argv) {
         top->add_switch_loggers(logfile, timeFromUs(20.0));
     }
 
-    vector<const Route*>*** net_paths;
-    net_paths = new vector<const Route*>**[no_of_nodes];
-
-    int **path_refcounts;
-    path_refcounts = new int*[no_of_nodes];
-
-    int* is_dest = new int[no_of_nodes];
-    
-    for (size_t s = 0; s < no_of_nodes; s++) {
-        is_dest[s] = 0;
-        net_paths[s] = new vector<const Route*>*[no_of_nodes];
-        path_refcounts[s] = new int[no_of_nodes];
-        for (size_t d = 0; d < no_of_nodes; d++) {
-            net_paths[s][d] = NULL;
-            path_refcounts[s][d] = 0;
-        }
-    }
+    // paths are built as connections ask for them
+    PathCache net_paths(*top, false, path_cache_size);
     
     ConnectionMatrix* conns = new ConnectionMatrix(no_of_nodes);
 
@@ -558,50 +585,72 @@ int main(int argc, char **argv) {
     vector<connection*>* all_conns = conns->getAllConnections();
     vector <NdpSrc*> ndp_srcs;
 
-    for (size_t c = 0; c < all_conns->size(); c++){
-        connection* crt = all_conns->at(c);
-        int src = crt->src;
-        int dest = crt->dst;
-        path_refcounts[src][dest]++;
-        path_refcounts[dest][src]++;
-                        
-        if (!net_paths[src][dest]
-            && route_strategy!=ECMP_FIB
-            && route_strategy!=ECMP_FIB_ECN
-            && route_strategy!=REACTIVE_ECN ) {
-            vector<const Route*>* paths = top->get_bidir_paths(src,dest,false);
-            net_paths[src][dest] = paths;
-            /*
-            for (unsigned int i = 0; i < paths->size(); i++) {
-              routes.push_back((*paths)[i]);
-            }
-            */
+    map <flowid_t, TriggerTarget*> flowmap;
+
+    if (recycle) {
+        if (route_strategy == SINGLE_PATH) {
+            cout << "-recycle doesn't work with -strat single" << endl;
+            exit(1);
         }
-        if (!net_paths[dest][src]
-            && route_strategy!=ECMP_FIB
-            && route_strategy!=ECMP_FIB_ECN
-            && route_strategy!=REACTIVE_ECN ) {
-            vector<const Route*>* paths = top->get_bidir_paths(dest,src,false);
-            net_paths[dest][src] = paths;
-            /*
-            for (unsigned int i = 0; i < paths->size(); i++) {
-              routes.push_back((*paths)[i]);
+        for (size_t c = 0; c < all_conns->size(); c++) {
+            connection* crt = all_conns->at(c);
+            if (crt->trigger || crt->send_done_trigger || crt->recv_done_trigger) {
+                cout << "-recycle doesn't work with triggers in the connection matrix" << endl;
+                exit(1);
             }
-            */
         }
     }
 
-    map <flowid_t, TriggerTarget*> flowmap;
+    // With -recycle, srcs are pooled by host and sinks by destination.
+    // Their packet counts are added up as they're recycled, and those
+    // still live at the end are counted then.
+    FlowPool<NdpSrc> src_pool;
+    FlowPool<NdpSink> sink_pool;
+    map<id_t, NdpSrc*> live;
+    vector<Route*> tor_routes(no_of_nodes, NULL); // each host's, shared by its flows
+    int new_pkts = 0, rtx_pkts = 0, bounce_pkts = 0;
+    FlowRecycler<NdpSrc>* recycler = NULL;
+    if (recycle) {
+        // NDP srcs have no NIC queue of their own to wait for
+        recycler = new FlowRecycler<NdpSrc>(eventlist, recycle_linger, [](NdpSrc* sender) {return false;},
+                                            [&](NdpSrc* sender) {
+            NdpSink* sink = sender->_sink;
+            uint32_t src = sink->_srcaddr;
+            uint32_t dest = sender->_dstaddr;
+            if (route_strategy == ECMP_FIB || route_strategy == ECMP_FIB_ECN || route_strategy == REACTIVE_ECN) {
+                top->remove_host_port(src, sender->flow_id());
+                top->remove_host_port(dest, sender->flow_id());
+            }
+            new_pkts += sender->_new_packets_sent;
+            rtx_pkts += sender->_rtx_packets_sent;
+            bounce_pkts += sender->_bounces_received;
+            live.erase(sender->get_id());
+            src_pool.release(src, sender);
+            sink_pool.release(dest, sink);
+            sender->reset();
+            sink->reset();
+        });
+    }
 
-    for (size_t c = 0; c < all_conns->size(); c++){
-        connection* crt = all_conns->at(c);
+    auto start_connection = [&](connection* crt) {
         int src = crt->src;
         int dest = crt->dst;
         //cout << "Connection " << crt->src << "->" <<crt->dst << " starting at " << crt->start << " size " << crt->size << endl;
 
-        ndpSrc = new NdpSrc(NULL, NULL, eventlist,rts);
+        ndpSrc = recycle ? src_pool.acquire(src) : NULL;
+        if (!ndpSrc) {
+            ndpSrc = new NdpSrc(NULL, NULL, eventlist,rts);
+            if (recycle) {
+                ndpSrc->set_end_trigger(*new FlowEndTrigger<NdpSrc>(eventlist, 0, *recycler, *ndpSrc));
+            }
+            ndpRtxScanner.registerSrc(*ndpSrc);
+        }
         ndpSrc->setCwnd(cwnd*Packet::data_packet_size());
-        ndp_srcs.push_back(ndpSrc);
+        if (recycle) {
+            live[ndpSrc->get_id()] = ndpSrc;
+        } else {
+            ndp_srcs.push_back(ndpSrc);
+        }
         ndpSrc->set_dst(dest);
         ndpSrc->set_path_burst(path_burst);
         if (crt->flowid) {
@@ -623,16 +672,20 @@ int main(int argc, char **argv) {
             ndpSrc->set_end_trigger(*trig);
         }
 
-        ndpSnk = new NdpSink(pacers[dest]);
+        ndpSnk = recycle ? sink_pool.acquire(dest) : NULL;
+        bool new_sink = !ndpSnk;
+        if (new_sink) {
+            ndpSnk = new NdpSink(pacers[dest]);
+        }
                         
-        ndpSrc->setName("ndp_" + ntoa(src) + "_" + ntoa(dest));
+        ndpSrc->setIdName("ndp", src, dest);
 
         //cout << "ndp_" + ntoa(src) + "_" + ntoa(dest) << endl;
         logfile.writeName(*ndpSrc);
 
         ndpSnk->set_src(src);
                         
-        ndpSnk->setName("ndp_sink_" + ntoa(src) + "_" + ntoa(dest));
+        ndpSnk->setIdName("ndp_sink", src, dest);
         logfile.writeName(*ndpSnk);
         if (crt->recv_done_trigger) {
             Trigger* trig = conns->getTrigger(crt->recv_done_trigger, eventlist);
@@ -640,8 +693,6 @@ int main(int argc, char **argv) {
         }
 
         ndpSnk->set_priority(crt->priority);
-                        
-        ndpRtxScanner.registerNdp(*ndpSrc);
 
         switch (route_strategy) {
         case SCATTER_PERMUTE:
@@ -649,23 +700,27 @@ int main(int argc, char **argv) {
         case SCATTER_ECMP:
         case PULL_BASED:
             ndpSrc->connect(NULL, NULL, *ndpSnk, crt->start);
-            ndpSrc->set_paths(net_paths[src][dest]);
-            ndpSnk->set_paths(net_paths[dest][src]);
+            ndpSrc->set_paths(net_paths, src, dest);
+            ndpSnk->set_paths(net_paths, dest, src);
             break;
         case ECMP_FIB:
         case ECMP_FIB_ECN:
         case REACTIVE_ECN:
             {
-                Route* srctotor = new Route();
-                srctotor->push_back(top->queues_ns_nlp[src][top->HOST_POD_SWITCH(src)][0]);
-                srctotor->push_back(top->pipes_ns_nlp[src][top->HOST_POD_SWITCH(src)][0]);
-                srctotor->push_back(top->queues_ns_nlp[src][top->HOST_POD_SWITCH(src)][0]->getRemoteEndpoint());
-
-                Route* dsttotor = new Route();
-                dsttotor->push_back(top->queues_ns_nlp[dest][top->HOST_POD_SWITCH(dest)][0]);
-                dsttotor->push_back(top->pipes_ns_nlp[dest][top->HOST_POD_SWITCH(dest)][0]);
-                dsttotor->push_back(top->queues_ns_nlp[dest][top->HOST_POD_SWITCH(dest)][0]->getRemoteEndpoint());
-
+                Route* srctotor;
+                Route* dsttotor;
+                if (recycle) {
+                    // recycled flows would pile up routes otherwise
+                    if (!tor_routes[src])
+                        tor_routes[src] = top->get_tor_route(src);
+                    if (!tor_routes[dest])
+                        tor_routes[dest] = top->get_tor_route(dest);
+                    srctotor = tor_routes[src];
+                    dsttotor = tor_routes[dest];
+                } else {
+                    srctotor = top->get_tor_route(src);
+                    dsttotor = top->get_tor_route(dest);
+                }
 
                 ndpSrc->connect(srctotor, dsttotor, *ndpSnk, crt->start);
                 ndpSrc->set_paths(path_entropy_size);
@@ -681,11 +736,15 @@ int main(int argc, char **argv) {
         case SINGLE_PATH:
             {
                 assert(route_strategy==SINGLE_PATH);
-                int choice = rand()%net_paths[src][dest]->size();
-                routeout = new Route(*(net_paths[src][dest]->at(choice)));
+                int choice = rand()%net_paths.no_of_paths(src, dest);
+                const Route* path = net_paths.get_path(src, dest, choice);
+                routeout = new Route(*path);
+                net_paths.put_path(path);
                 routeout->add_endpoints(ndpSrc, ndpSnk);
                                 
-                routein = new Route(*top->get_bidir_paths(dest,src,false)->at(choice));
+                path = net_paths.get_path(dest, src, choice);
+                routein = new Route(*path);
+                net_paths.put_path(path);
                 routein->add_endpoints(ndpSnk, ndpSrc);
                 ndpSrc->connect(routeout, routein, *ndpSnk, crt->start);
                 break;
@@ -694,40 +753,20 @@ int main(int argc, char **argv) {
             abort();
         }
 
-        path_refcounts[src][dest]--;
-        path_refcounts[dest][src]--;
-
-
         // set up the triggers
         // xxx
 
-        // free up the routes if no other connection needs them 
-        if (path_refcounts[src][dest] == 0 && net_paths[src][dest]) {
-            vector<const Route*>::iterator i;
-            for (i = net_paths[src][dest]->begin(); i != net_paths[src][dest]->end(); i++) {
-                if ((*i)->reverse())
-                    delete (*i)->reverse();
-                delete *i;
-            }
-            delete net_paths[src][dest];
-        }
-        if (path_refcounts[dest][src] == 0 && net_paths[dest][src]) {
-            vector<const Route*>::iterator i;
-            for (i = net_paths[dest][src]->begin(); i != net_paths[dest][src]->end(); i++) {
-                if ((*i)->reverse())
-                    delete (*i)->reverse();
-                delete *i;
-            }
-            delete net_paths[dest][src];
-        }
-
-        if (log_sink) {
+        if (log_sink && new_sink) {
             sinkLogger.monitorSink(ndpSnk);
         }
-    }
+    };
 
-    for (size_t ix = 0; ix < no_of_nodes; ix++) {
-        delete path_refcounts[ix];
+    if (recycle) {
+        new ConnectionLauncher(eventlist, *all_conns, start_connection);
+        cout << "Starting " << all_conns->size() << " connections as they're due\n";
+    } else {
+        for (size_t c = 0; c < all_conns->size(); c++)
+            start_connection(all_conns->at(c));
     }
 
     Logged::dump_idmap();
@@ -740,13 +779,36 @@ int main(int argc, char **argv) {
     double rtt = timeAsSec(timeFromUs(RTT));
     logfile.write("# rtt =" + ntoa(rtt));
     
+    EventProfiler* profiler = NULL;
+    if (profile_file) {
+        profiler = new EventProfiler();
+        eventlist.setProfiler(profiler);
+    }
+
     // GO!
     cout << "Starting simulation" << endl;
+    simtime_picosec next_trim = pkt_trim;
     while (eventlist.doNextEvent()) {
+        if (pkt_trim && eventlist.now() >= next_trim) {
+            PacketArena::current().trim();
+            next_trim = eventlist.now() + pkt_trim;
+        }
     }
 
     cout << "Done" << endl;
-    int new_pkts = 0, rtx_pkts = 0, bounce_pkts = 0;
+    PacketArena::current().report(cout);
+    MemoryAccount::current().report(cout);
+    if (profiler) {
+        eventlist.setProfiler(NULL);
+        profiler->report(cout, profile_file);
+    }
+    if (recycle) {
+        map<id_t, NdpSrc*>::iterator live_i;
+        for (live_i = live.begin(); live_i != live.end(); live_i++)
+            ndp_srcs.push_back(live_i->second);
+        src_pool.report(cout, "NDP srcs");
+        sink_pool.report(cout, "NDP sinks");
+    }
     for (size_t ix = 0; ix < ndp_srcs.size(); ix++) {
         new_pkts += ndp_srcs[ix]->_new_packets_sent;
         rtx_pkts += ndp_srcs[ix]->_rtx_packets_sent;
@@ -23,6 +23,7 @@
 
 #include "fat_tree_topology.h"
 #include "fat_tree_switch.h"
+#include "path_cache.h"
 
 #include <list>
 
@@ -297,6 +298,7 @@ int main(int argc, char **argv) {
 
     cout << "Parsed args\n";
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
 
     FatTreeSwitch::_ar_sticky = FatTreeSwitch::PER_FLOWLET;
     FatTreeSwitch::_sticky_delta = timeFromUs(ar_sticky_delta);
@@ -396,23 +398,9 @@ int main(int argc, char **argv) {
         top->add_switch_loggers(logfile, timeFromUs(20.0));
     }
 
-    vector<const Route*>*** net_paths;
-    net_paths = new vector<const Route*>**[no_of_nodes];
-
-    int **path_refcounts;
-    path_refcounts = new int*[no_of_nodes];
-
-    int* is_dest = new int[no_of_nodes];
-    
-    for (size_t s = 0; s < no_of_nodes; s++) {
-        is_dest[s] = 0;
-        net_paths[s] = new vector<const Route*>*[no_of_nodes];
-        path_refcounts[s] = new int[no_of_nodes];
-        for (size_t d = 0; d < no_of_nodes; d++) {
-            net_paths[s][d] = NULL;
-            path_refcounts[s][d] = 0;
-        }
-    }
+    // Paths are built as connections ask for them.  Each connection
+    // copies the one it uses, so the cache need only hold a few.
+    PathCache net_paths(*top, false, 1024);
     
     ConnectionMatrix* conns = new ConnectionMatrix(no_of_nodes);
 
@@ -440,28 +428,6 @@ int main(int argc, char **argv) {
     all_conns = conns->getAllConnections();
     vector <RoceSrc*> roce_srcs;
 
-    for (size_t c = 0; c < all_conns->size(); c++){
-        connection* crt = all_conns->at(c);
-        int src = crt->src;
-        int dest = crt->dst;
-        path_refcounts[src][dest]++;
-        path_refcounts[dest][src]++;
-                        
-        if (!net_paths[src][dest]&&route_strategy!=ECMP_FIB) {
-            vector<const Route*>* paths = top->get_bidir_paths(src,dest,false);
-            net_paths[src][dest] = paths;
-            /*
-              for (unsigned int i = 0; i < paths->size(); i++) {
-              routes.push_back((*paths)[i]);
-              }
-            */
-        }
-        if (!net_paths[dest][src]&&route_strategy!=ECMP_FIB) {
-            vector<const Route*>* paths = top->get_bidir_paths(dest,src,false);
-            net_paths[dest][src] = paths;
-        }
-    }
-
     map <flowid_t, TriggerTarget*> flowmap;
 
     for (size_t c = 0; c < all_conns->size(); c++){
@@ -496,13 +462,13 @@ int main(int argc, char **argv) {
 
         roceSnk = new RoceSink();
                         
-        roceSrc->setName("Roce_" + ntoa(src) + "_" + ntoa(dest));
+        roceSrc->setIdName("Roce", src, dest);
 
         logfile.writeName(*roceSrc);
 
         roceSnk->set_src(src);
                         
-        roceSnk->setName("Roce_sink_" + ntoa(src) + "_" + ntoa(dest));
+        roceSnk->setIdName("Roce_sink", src, dest);
         logfile.writeName(*roceSnk);
                         
         ((HostQueue*)top->queues_ns_nlp[src][top->HOST_POD_SWITCH(src)][0])->addHostSender(roceSrc);
@@ -534,47 +500,24 @@ int main(int argc, char **argv) {
             top->switches_lp[top->HOST_POD_SWITCH(src)]->addHostPort(src,roceSrc->flow_id(),roceSrc);
             top->switches_lp[top->HOST_POD_SWITCH(dest)]->addHostPort(dest,roceSrc->flow_id(),roceSnk);
         } else {
-            int choice = rand()%net_paths[src][dest]->size();
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            int choice = rand()%net_paths.no_of_paths(src, dest);
+            const Route* path = net_paths.get_path(src, dest, choice);
+            routeout = new Route(*path);
+            net_paths.put_path(path);
             routeout->add_endpoints(roceSrc, roceSnk);
                                 
-            routein = new Route(*top->get_bidir_paths(dest,src,false)->at(choice));
+            path = net_paths.get_path(dest, src, choice);
+            routein = new Route(*path);
+            net_paths.put_path(path);
             routein->add_endpoints(roceSnk, roceSrc);
             roceSrc->connect(routeout, routein, *roceSnk, timeFromUs((uint32_t)rand()%20));
         }
 
-        path_refcounts[src][dest]--;
-        path_refcounts[dest][src]--;
-
-        // free up the routes if no other connection needs them 
-        if (path_refcounts[src][dest] == 0 && net_paths[src][dest]) {
-            vector<const Route*>::iterator i;
-            for (i = net_paths[src][dest]->begin(); i != net_paths[src][dest]->end(); i++) {
-                if ((*i)->reverse())
-                    delete (*i)->reverse();
-                delete *i;
-            }
-            delete net_paths[src][dest];
-        }
-        if (path_refcounts[dest][src] == 0 && net_paths[dest][src]) {
-            vector<const Route*>::iterator i;
-            for (i = net_paths[dest][src]->begin(); i != net_paths[dest][src]->end(); i++) {
-                if ((*i)->reverse())
-                    delete (*i)->reverse();
-                delete *i;
-            }
-            delete net_paths[dest][src];
-        }
-
         if (log_sink) {
             sinkLogger.monitorSink(roceSnk);
         }
     }
 
-    for (size_t ix = 0; ix < no_of_nodes; ix++) {
-        delete path_refcounts[ix];
-    }
-
     Logged::dump_idmap();
     // Record the setup
     int pktsize = Packet::data_packet_size();
@@ -196,6 +196,8 @@ int main(int argc, char **argv) {
         i++;
     }
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
     eventlist.setEndtime(endtime);
 
     queuesize = queuesize*Packet::data_packet_size();
@@ -365,9 +367,9 @@ int main(int argc, char **argv) {
         sink->set_src(src);
         sinks.push_back(sink);
 
-        sender->setName("Roce_" + ntoa(src) + "_" + ntoa(dest));
+        sender->setIdName("Roce", src, dest);
 
-        sink->setName("Roce_sink_" + ntoa(src) + "_" + ntoa(dest));
+        sink->setIdName("Roce_sink", src, dest);
 
           
         if (route_strategy != SOURCE_ROUTE) {
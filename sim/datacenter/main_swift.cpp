@@ -22,6 +22,7 @@
 //#include "vl2_topology.h"
 
 #include "fat_tree_topology.h"
+#include "path_cache.h"
 //#include "generic_topology.h"
 //#include "oversubscribed_fat_tree_topology.h"
 //#include "multihomed_fat_tree_topology.h"
@@ -69,6 +70,9 @@ int main(int argc, char **argv) {
     stringstream flowfilename(ios_base::out);
     uint32_t packet_size = 4000;
     uint32_t no_of_subflows = 1;
+    // The sources copy their paths as they're set up, so the cache need
+    // only hold a few pairs' worth.
+    uint32_t path_cache_size = 1024;
     simtime_picosec tput_sample_time = timeFromUs((uint32_t)12);
     simtime_picosec endtime = timeFromMs(1.2);
     char* tm_file = NULL;
@@ -122,6 +126,10 @@ int main(int argc, char **argv) {
         } else if (!strcmp(argv[i],"-subflows")){
             no_of_subflows = atoi(argv[i+1]);
             i++;
+        } else if (!strcmp(argv[i],"-pathcache")){
+            // remember at most this many paths (0: all of them)
+            path_cache_size = atoi(argv[i+1]);
+            i++;
         } else if (!strcmp(argv[i],"-fails")){
             link_failures = atoi(argv[i+1]);
             i++;
@@ -163,6 +171,8 @@ int main(int argc, char **argv) {
         i++;
     }
     Packet::set_packet_size(packet_size);
+    print_packet_sizes(cout);
+    print_queue_sizes(cout);
     eventlist.setEndtime(endtime);
 
     queuesize = queuesize*Packet::data_packet_size();
@@ -219,7 +229,7 @@ int main(int argc, char **argv) {
 
     Route* routeout, *routein;
 
-    SwiftRtxTimerScanner swiftRtxScanner(timeFromUs(0.01), eventlist);
+    RtxTimerWheel swiftRtxScanner(timeFromUs(0.01), eventlist);
    
 #ifdef FAT_TREE
     /*
@@ -261,17 +271,8 @@ int main(int argc, char **argv) {
     no_of_nodes = top->no_of_nodes();
     cout << "actual nodes " << no_of_nodes << endl;
 
-    vector<const Route*>*** net_paths;
-    net_paths = new vector<const Route*>**[no_of_nodes];
-
-    int* is_dest = new int[no_of_nodes];
-    
-    for (uint32_t i=0; i<no_of_nodes; i++){
-        is_dest[i] = 0;
-        net_paths[i] = new vector<const Route*>*[no_of_nodes];
-        for (uint32_t j = 0; j<no_of_nodes; j++)
-            net_paths[i][j] = NULL;
-    }
+    // paths are built as connections ask for them
+    PathCache net_paths(*top, true, path_cache_size);
 
     // Permutation connections
     ConnectionMatrix* conns = new ConnectionMatrix(no_of_nodes);
@@ -310,17 +311,13 @@ int main(int argc, char **argv) {
         uint32_t dest = crt->dst;
         
         connID++;
-        if (!net_paths[src][dest]) {
-            vector<const Route*>* paths = top->get_paths(src,dest);
-            net_paths[src][dest] = paths;
-            for (uint32_t p = 0; p < paths->size(); p++) {
-                routes.push_back((*paths)[p]);
-            }
-        }
-        if (!net_paths[dest][src]) {
-            vector<const Route*>* paths = top->get_paths(dest,src);
-            net_paths[dest][src] = paths;
+        uint32_t no_of_paths = net_paths.no_of_paths(src, dest);
+#if PRINT_PATHS
+        for (uint32_t p = 0; p < no_of_paths; p++) {
+            // never handed back, so they last until they're printed
+            routes.push_back(net_paths.get_path(src, dest, p));
         }
+#endif
 
         swiftSrc = new SwiftSrc(swiftRtxScanner, NULL, NULL, eventlist, src);  // TODO: add trigger support (difference between CCA erasure)
         swiftSrc->set_cwnd(cwnd*Packet::data_packet_size());
@@ -341,14 +338,14 @@ int main(int argc, char **argv) {
         //logfile.addLogger(*buf_logger);
         //swiftSnk->add_buffer_logger(buf_logger);
 
-        swiftSrc->setName("swift_" + ntoa(src) + "_" + ntoa(dest));
+        swiftSrc->setIdName("swift", src, dest);
 
         
 
         if (no_of_subflows>1)
-            swiftSnk->setName("mpswift_sink_" + ntoa(src) + "_" + ntoa(dest));
+            swiftSnk->setIdName("mpswift_sink", src, dest);
         else
-            swiftSnk->setName("swift_sink_" + ntoa(src) + "_" + ntoa(dest));
+            swiftSnk->setIdName("swift_sink", src, dest);
 
         if (lg != NULL) {
             lg->writeName(*swiftSrc);
@@ -363,24 +360,24 @@ int main(int argc, char **argv) {
             uint32_t choice = 0;
           
 #ifdef FAT_TREE
-            choice = rand()%net_paths[src][dest]->size();
+            choice = rand()%no_of_paths;
 #endif
           
 #ifdef OV_FAT_TREE
-            choice = rand()%net_paths[src][dest]->size();
+            choice = rand()%no_of_paths;
 #endif
           
 #ifdef MH_FAT_TREE
-            int use_all = it_sub==net_paths[src][dest]->size();
+            int use_all = it_sub==no_of_paths;
 
             if (use_all)
                 choice = inter;
             else
-                choice = rand()%net_paths[src][dest]->size();
+                choice = rand()%no_of_paths;
 #endif
           
 #ifdef VL2
-            choice = rand()%net_paths[src][dest]->size();
+            choice = rand()%no_of_paths;
 #endif
           
 #ifdef STAR
@@ -393,44 +390,52 @@ int main(int argc, char **argv) {
             int min = -1, max = -1,minDist = 1000,maxDist = 0;
             if (subflow_count==1){
                 //find shortest and longest path 
-                for (uint32_t dd=0;dd<net_paths[src][dest]->size();dd++){
-                    if (net_paths[src][dest]->at(dd)->size()<minDist){
-                        minDist = net_paths[src][dest]->at(dd)->size();
+                for (uint32_t dd=0;dd<no_of_paths;dd++){
+                    const Route* path = net_paths.get_path(src,dest,dd);
+                    if (path->size()<minDist){
+                        minDist = path->size();
                         min = dd;
                     }
-                    if (net_paths[src][dest]->at(dd)->size()>maxDist){
-                        maxDist = net_paths[src][dest]->at(dd)->size();
+                    if (path->size()>maxDist){
+                        maxDist = path->size();
                         max = dd;
                     }
+                    net_paths.put_path(path);
                 }
                 choice = min;
             } 
             else
-                choice = rand()%net_paths[src][dest]->size();
+                choice = rand()%no_of_paths;
 #endif
-            if (choice>=net_paths[src][dest]->size()){
-                printf("Weird path choice %d out of %lu\n",choice,net_paths[src][dest]->size());
+            if (choice>=no_of_paths){
+                printf("Weird path choice %d out of %u\n",choice,no_of_paths);
                 exit(1);
             }
           
 #if PRINT_PATHS
-            for (uint32_t ll=0;ll<net_paths[src][dest]->size();ll++){
+            for (uint32_t ll=0;ll<no_of_paths;ll++){
                 paths << "Route from "<< ntoa(src) << " to " << ntoa(dest) << "  (" << ll << ") -> " ;
-                print_path(paths,net_paths[src][dest]->at(ll));
+                const Route* path = net_paths.get_path(src,dest,ll);
+                print_path(paths,path);
+                net_paths.put_path(path);
             }
 #endif
           
-            routeout = new Route(*(net_paths[src][dest]->at(choice)));
+            const Route* path = net_paths.get_path(src, dest, choice);
+            routeout = new Route(*path);
+            net_paths.put_path(path);
             //routeout->push_back(swiftSnk);
             
-            routein = new Route(*top->get_paths(dest,src)->at(choice));
+            path = net_paths.get_path(dest, src, choice);
+            routein = new Route(*path);
+            net_paths.put_path(path);
             //routein->push_back(swiftSrc);
         }
 
         if (no_of_subflows == 1) {
             swiftSrc->connect(*routeout, *routein, *swiftSnk, (uint32_t)crt->start, dest);
         }
-        swiftSrc->set_paths(net_paths[src][dest]);
+        swiftSrc->set_paths(net_paths, dest);
         if (no_of_subflows > 1) {
             // could probably use this for single-path case too, but historic reasons
             cout << "will start subflow " << c << " at " << crt->start << endl;
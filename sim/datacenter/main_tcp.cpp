@@ -68,6 +68,7 @@ void print_path(std::ofstream &paths,const Route* rt){
 
 int main(int argc, char **argv) {
     eventlist.setEndtime(timeFromSec(4));
+    print_packet_sizes(cout);
     Clock c(timeFromSec(50 / 100.), eventlist);
     linkspeed_bps linkspeed = speedFromMbps((double)HOST_NIC);
     int algo = COUPLED_EPSILON;
@@ -162,7 +163,7 @@ int main(int argc, char **argv) {
     Route* routeout, *routein;
     double extrastarttime;
 
-    TcpRtxTimerScanner tcpRtxScanner(timeFromMs(10), eventlist);
+    RtxTimerWheel tcpRtxScanner(timeFromMs(10), eventlist);
    
     MultipathTcpSrc* mtcp;
     
@@ -328,7 +329,7 @@ int main(int argc, char **argv) {
                         tcpSnk->setName("mtcp_sink_" + ntoa(src) + "_" + ntoa(inter) + "_" + ntoa(dest)+ "("+ntoa(connection)+")");
                         logfile.writeName(*tcpSnk);
               
-                        tcpRtxScanner.registerTcp(*tcpSrc);
+                        tcpRtxScanner.registerSrc(*tcpSrc);
 
                         /*int found;
                           do {
@@ -9,11 +9,15 @@ MultiDatacenterTopology::MultiDatacenterTopology(uint32_t num_datacenters, uint3
                                                  linkspeed_bps intra_dc_speed, linkspeed_bps wan_speed,
                                                  mem_b intra_dc_queue_size, mem_b wan_queue_size,
                                                  simtime_picosec wan_delay, QueueLoggerFactory* logger_factory,
-                                                 EventList* eventlist, queue_type qt)
+                                                 EventList* eventlist, queue_type qt, PdesEngine* pdes)
     : _num_datacenters(num_datacenters), _nodes_per_dc(nodes_per_dc), _total_nodes(num_datacenters * nodes_per_dc),
       _intra_dc_speed(intra_dc_speed), _wan_speed(wan_speed), _intra_dc_queue_size(intra_dc_queue_size),
       _wan_queue_size(wan_queue_size), _wan_delay(wan_delay), _queue_type(qt),
-      _logger_factory(logger_factory), _eventlist(eventlist) {
+      _logger_factory(logger_factory), _eventlist(eventlist), _pdes(pdes) {
+    if (_pdes && _pdes->lps() != _num_datacenters) {
+        std::cerr << "Parallel run needs one LP per datacenter, not " << _pdes->lps() << std::endl;
+        abort();
+    }
     
     std::cout << "Creating Multi-Datacenter Topology with " << num_datacenters 
               << " datacenters, " << nodes_per_dc << " nodes per DC" << std::endl;
@@ -53,7 +57,7 @@ void MultiDatacenterTopology::init_datacenters() {
         // Create individual fat tree topology for this datacenter
         std::cout << "  Creating MultiFatTreeTopology for DC " << dc_id << "..." << std::endl;
         _datacenters[dc_id] = new MultiFatTreeTopology(_nodes_per_dc, _intra_dc_speed, _intra_dc_queue_size,
-                                                  _logger_factory, _eventlist, nullptr, _queue_type, 
+                                                  _logger_factory, &dc_eventlist(dc_id), nullptr, _queue_type, 
                                                   0, 0, CONST_SCHEDULER);
         std::cout << "  MultiFatTreeTopology created for DC " << dc_id << std::endl;
         
@@ -72,7 +76,7 @@ void MultiDatacenterTopology::init_datacenters() {
         // Pass the FatTree topology to the WAN switch so it can route to local hosts
         // DEBUG: Verify we're passing the correct FatTree topology
         std::cout << "  Creating WAN switch " << dc_id << " with FatTree topology for DC " << dc_id << std::endl;
-        _wan_switches[dc_id] = new MultiFatTreeSwitch(*_eventlist, ss.str(), MultiFatTreeSwitch::WAN, dc_id, 
+        _wan_switches[dc_id] = new MultiFatTreeSwitch(dc_eventlist(dc_id), ss.str(), MultiFatTreeSwitch::WAN, dc_id, 
                                                       timeFromUs((uint32_t)1), _datacenters[dc_id]);
         
         // Configure WAN switch for multi-DC
@@ -117,12 +121,15 @@ void MultiDatacenterTopology::init_wan_connections() {
                 // Create WAN connection from src_dc to dest_dc
                 std::stringstream ss;
                 ss << "WAN_Pipe_DC" << src_dc << "_to_DC" << dest_dc;
-                _wan_pipes[src_dc][dest_dc] = new Pipe(_wan_delay, *_eventlist);
+                if (_pdes)
+                    _wan_pipes[src_dc][dest_dc] = _pdes->new_link(_wan_delay, src_dc, dest_dc);
+                else
+                    _wan_pipes[src_dc][dest_dc] = new Pipe(_wan_delay, *_eventlist);
                 _wan_pipes[src_dc][dest_dc]->setName(ss.str());
                 
                 ss.str("");
                 ss << "WAN_Queue_DC" << src_dc << "_to_DC" << dest_dc;
-                _wan_queues[src_dc][dest_dc] = new RandomQueue(_wan_speed, _wan_queue_size, *_eventlist, nullptr, _wan_queue_size);
+                _wan_queues[src_dc][dest_dc] = new RandomQueue(_wan_speed, _wan_queue_size, dc_eventlist(src_dc), nullptr, _wan_queue_size);
                 _wan_queues[src_dc][dest_dc]->setName(ss.str());
                 
                 std::cout << "Created WAN connection from DC " << src_dc << " to DC " << dest_dc << std::endl;
@@ -307,7 +314,7 @@ Route* MultiDatacenterTopology::get_wan_route(uint32_t src_dc, uint32_t dest_dc,
     Route* complete_route = new Route();
     
     // Add a scheduler at the beginning (required by ConstantErasureCcaSrc::connect)
-    ConstFairScheduler* scheduler = new ConstFairScheduler(_wan_speed, *_eventlist, nullptr);
+    ConstFairScheduler* scheduler = new ConstFairScheduler(_wan_speed, dc_eventlist(src_dc), nullptr);
     complete_route->push_back(scheduler);
     
     // Add WAN connection - only for inter-DC traffic
@@ -342,6 +349,10 @@ bool MultiDatacenterTopology::is_inter_dc_flow(uint32_t src, uint32_t dest) cons
     return get_dc_id(src) != get_dc_id(dest);
 }
 
+EventList& MultiDatacenterTopology::dc_eventlist(uint32_t dc_id) const {
+    return _pdes ? _pdes->eventlist(dc_id) : *_eventlist;
+}
+
 MultiFatTreeTopology* MultiDatacenterTopology::get_datacenter(uint32_t dc_id) const {
     if (dc_id < _datacenters.size()) {
         return _datacenters[dc_id];
@@ -369,13 +380,13 @@ void MultiDatacenterTopology::create_core_wan_connections(uint32_t dc_id) {
         // Queue* core_to_wan_queue = new RandomQueue(_intra_dc_speed, _intra_dc_queue_size, 
         //                                            *_eventlist, nullptr, _intra_dc_queue_size);
         Queue* core_to_wan_queue = new RandomQueue(_wan_speed, _wan_queue_size, 
-                                                   *_eventlist, nullptr, _wan_queue_size);
+                                                   dc_eventlist(dc_id), nullptr, _wan_queue_size);
         core_to_wan_queue->setName(ss.str());
         
         // Create pipe from CORE switch to WAN switch
         ss.str("");
         ss << "CORE" << core_id << "_to_WAN_Pipe_DC" << dc_id;
-        Pipe* core_to_wan_pipe = new Pipe(timeFromUs((uint32_t)1), *_eventlist);
+        Pipe* core_to_wan_pipe = new Pipe(timeFromUs((uint32_t)1), dc_eventlist(dc_id));
         core_to_wan_pipe->setName(ss.str());
         
         // Connect the queue to the pipe
@@ -391,13 +402,13 @@ void MultiDatacenterTopology::create_core_wan_connections(uint32_t dc_id) {
         // Queue* wan_to_core_queue = new RandomQueue(_intra_dc_speed, _intra_dc_queue_size, 
         //                                            *_eventlist, nullptr, _intra_dc_queue_size);
         Queue* wan_to_core_queue = new RandomQueue(_wan_speed, _wan_queue_size, 
-                                                   *_eventlist, nullptr, _wan_queue_size);
+                                                   dc_eventlist(dc_id), nullptr, _wan_queue_size);
         wan_to_core_queue->setName(ss.str());
         
         // Create pipe from WAN switch to CORE switch
         ss.str("");
         ss << "WAN_to_CORE" << core_id << "_Pipe_DC" << dc_id;
-        Pipe* wan_to_core_pipe = new Pipe(timeFromUs((uint32_t)1), *_eventlist);
+        Pipe* wan_to_core_pipe = new Pipe(timeFromUs((uint32_t)1), dc_eventlist(dc_id));
         wan_to_core_pipe->setName(ss.str());
         
         // Connect the queue to the pipe
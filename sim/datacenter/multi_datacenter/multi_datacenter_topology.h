@@ -6,6 +6,7 @@
 #include "queue.h"
 #include "pipe.h"
 #include "route.h"
+#include "pdes.h"
 #include <vector>
 #include <map>
 
@@ -15,7 +16,7 @@ public:
                            linkspeed_bps intra_dc_speed, linkspeed_bps wan_speed,
                            mem_b intra_dc_queue_size, mem_b wan_queue_size,
                            simtime_picosec wan_delay, QueueLoggerFactory* logger_factory,
-                           EventList* eventlist, queue_type qt);
+                           EventList* eventlist, queue_type qt, PdesEngine* pdes = NULL);
     
     virtual ~MultiDatacenterTopology();
     
@@ -33,6 +34,9 @@ public:
     // Get individual datacenter topologies
     MultiFatTreeTopology* get_datacenter(uint32_t dc_id) const;
     
+    // the event list DC dc_id's network and hosts run on
+    EventList& dc_eventlist(uint32_t dc_id) const;
+
     // WAN routing methods
     Route* get_wan_route(uint32_t src_dc, uint32_t dest_dc, uint32_t src_host, uint32_t dest_host);
     
@@ -55,6 +59,9 @@ private:
     queue_type _queue_type;
     QueueLoggerFactory* _logger_factory;
     EventList* _eventlist;
+    // when set, each datacenter is one of its LPs, and the WAN pipes
+    // are PdesLinks between them
+    PdesEngine* _pdes;
     
     // Individual datacenter topologies
     std::vector<MultiFatTreeTopology*> _datacenters;
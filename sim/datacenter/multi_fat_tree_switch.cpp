@@ -8,7 +8,7 @@
 #include "queue_lossless_output.h"
 #include "constant_cca_packet.h"
 
-unordered_map<BaseQueue*,uint32_t> MultiFatTreeSwitch::_port_flow_counts;
+thread_local unordered_map<BaseQueue*,uint32_t> MultiFatTreeSwitch::_port_flow_counts;
 
 MultiFatTreeSwitch::MultiFatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec delay, MultiFatTreeTopology* ft): Switch(eventlist, s) {
     _id = id;
@@ -77,15 +77,15 @@ void MultiFatTreeSwitch::addHostPort(int addr, int flowid, PacketSink* transport
         return;
     }
     
-    Route* rt = new Route();
+    Route rt;
     // Convert global host ID to local host ID for accessing topology arrays
     uint32_t local_addr = _ft->adjusted_host(addr);
     // Use local host ID to calculate switch ID for array access
     uint32_t switch_id = _ft->HOST_POD_SWITCH(local_addr);
-    rt->push_back(_ft->queues_nlp_ns[switch_id][local_addr][0]);
-    rt->push_back(_ft->pipes_nlp_ns[switch_id][local_addr][0]);
-    rt->push_back(transport);
-    _fib->addHostRoute(addr,rt,flowid);
+    rt.push_back(_ft->queues_nlp_ns[switch_id][local_addr][0]);
+    rt.push_back(_ft->pipes_nlp_ns[switch_id][local_addr][0]);
+    rt.push_back(transport);
+    _fib->addHostRoute(addr,RouteStore::current().intern(rt),flowid);
 }
 
 static uint32_t mhash(uint32_t x) {
@@ -103,7 +103,7 @@ uint32_t MultiFatTreeSwitch::adaptive_route_p2c(vector<FibEntry*>* ecmp_set, int
     do {
         start = random()%ecmp_set->size();
 
-        Route * r= (*ecmp_set)[start]->getEgressPort();
+        const Route * r= (*ecmp_set)[start]->getEgressPort();
         assert(r && r->size()>1);
         BaseQueue* q = (BaseQueue*)(r->at(0));
         assert(q);
@@ -200,10 +200,10 @@ uint32_t MultiFatTreeSwitch::replace_worst_choice(vector<FibEntry*>* ecmp_set, i
 
 
 int8_t MultiFatTreeSwitch::compare_pause(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     LosslessOutputQueue* q1 = dynamic_cast<LosslessOutputQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     LosslessOutputQueue* q2 = dynamic_cast<LosslessOutputQueue*>(r2->at(0));
 
@@ -216,10 +216,10 @@ int8_t MultiFatTreeSwitch::compare_pause(FibEntry* left, FibEntry* right){
 }
 
 int8_t MultiFatTreeSwitch::compare_flow_count(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = (BaseQueue*)(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = (BaseQueue*)(r2->at(0));
 
@@ -240,10 +240,10 @@ int8_t MultiFatTreeSwitch::compare_flow_count(FibEntry* left, FibEntry* right){
 }
 
 int8_t MultiFatTreeSwitch::compare_queuesize(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = dynamic_cast<BaseQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = dynamic_cast<BaseQueue*>(r2->at(0));
 
@@ -256,10 +256,10 @@ int8_t MultiFatTreeSwitch::compare_queuesize(FibEntry* left, FibEntry* right){
 }
 
 int8_t MultiFatTreeSwitch::compare_bandwidth(FibEntry* left, FibEntry* right){
-    Route * r1= left->getEgressPort();
+    const Route * r1= left->getEgressPort();
     assert(r1 && r1->size()>1);
     BaseQueue* q1 = dynamic_cast<BaseQueue*>(r1->at(0));
-    Route * r2= right->getEgressPort();
+    const Route * r2= right->getEgressPort();
     assert(r2 && r2->size()>1);
     BaseQueue* q2 = dynamic_cast<BaseQueue*>(r2->at(0));
 
@@ -341,7 +341,7 @@ double MultiFatTreeSwitch::_ecn_threshold_fraction = 0.5;
 double MultiFatTreeSwitch::_speculative_threshold_fraction = 0.2;
 int8_t (*MultiFatTreeSwitch::fn)(FibEntry*,FibEntry*)= &MultiFatTreeSwitch::compare_queuesize;
 
-Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
+const Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
 
     // Need to account for local vs global host IDs
 
@@ -550,13 +550,13 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
 
                     for (uint32_t k=agg_min; k<=agg_max;k++){
                         for (uint32_t b = 0; b < _ft->bundlesize(AGG_TIER); b++) {
-                            Route * r = new Route();
-                            r->push_back(_ft->queues_nlp_nup[_id][k][b]);
-                            assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                            Route r;
+                            r.push_back(_ft->queues_nlp_nup[_id][k][b]);
+                            assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
-                            r->push_back(_ft->pipes_nlp_nup[_id][k][b]);
-                            r->push_back(_ft->queues_nlp_nup[_id][k][b]->getRemoteEndpoint());
-                            _fib->addRoute(pkt.dst(),r,1,UP);
+                            r.push_back(_ft->pipes_nlp_nup[_id][k][b]);
+                            r.push_back(_ft->queues_nlp_nup[_id][k][b]->getRemoteEndpoint());
+                            _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1,UP);
                         }
                     }
                     _uproutes = _fib->getRoutes(pkt.dst());
@@ -580,14 +580,14 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
             //target NLP id is 2 * pkt.dst()/K
             uint32_t target_tor = _ft->HOST_POD_SWITCH(adjusted_dst);
             for (uint32_t b = 0; b < _ft->bundlesize(AGG_TIER); b++) {
-                Route * r = new Route();
-                r->push_back(_ft->queues_nup_nlp[_id][target_tor][b]);
-                assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                Route r;
+                r.push_back(_ft->queues_nup_nlp[_id][target_tor][b]);
+                assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
-                r->push_back(_ft->pipes_nup_nlp[_id][target_tor][b]);          
-                r->push_back(_ft->queues_nup_nlp[_id][target_tor][b]->getRemoteEndpoint());
+                r.push_back(_ft->pipes_nup_nlp[_id][target_tor][b]);          
+                r.push_back(_ft->queues_nup_nlp[_id][target_tor][b]->getRemoteEndpoint());
 
-                _fib->addRoute(pkt.dst(),r,1, DOWN);
+                _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1, DOWN);
             }
         } else {
             // cerr << "  AGG switch " << _id << " routing up to different pod" << endl;
@@ -604,14 +604,14 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
                     for (uint32_t l = 0; l <  uplink_bundles ; l++) {
                         uint32_t core = l * _ft->agg_switches_per_pod() + podpos;
                         for (uint32_t b = 0; b < _ft->bundlesize(CORE_TIER); b++) {
-                            Route *r = new Route();
-                            r->push_back(_ft->queues_nup_nc[_id][core][b]);
-                            assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                            Route r;
+                            r.push_back(_ft->queues_nup_nc[_id][core][b]);
+                            assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
-                            r->push_back(_ft->pipes_nup_nc[_id][core][b]);
-                            r->push_back(_ft->queues_nup_nc[_id][core][b]->getRemoteEndpoint());
+                            r.push_back(_ft->pipes_nup_nc[_id][core][b]);
+                            r.push_back(_ft->queues_nup_nc[_id][core][b]->getRemoteEndpoint());
 
-                            _fib->addRoute(pkt.dst(),r,1,UP);
+                            _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1,UP);
                         }
                     }
                     permute_paths(_fib->getRoutes(pkt.dst()));
@@ -643,7 +643,7 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
             
             // Create route to WAN switch through physical connections
             // We need to find the actual queue and pipe to the WAN switch
-            Route* r = new Route();
+            Route r;
             
             // Find the queue from this CORE switch to the WAN switch
             // The queue should be in the CORE switch's ports
@@ -654,9 +654,9 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
                     // Check if this queue leads to the WAN switch
                     Pipe* pipe = dynamic_cast<Pipe*>(q->getRemoteEndpoint());
                     if (pipe && pipe->getRemoteEndpoint() == _ft->get_wan_switch()) {
-                        r->push_back(q);
-                        r->push_back(pipe);
-                        r->push_back(_ft->get_wan_switch());
+                        r.push_back(q);
+                        r.push_back(pipe);
+                        r.push_back(_ft->get_wan_switch());
                         found_wan_connection = true;
                         break;
                     }
@@ -665,11 +665,10 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
             
             if (!found_wan_connection) {
                 cerr << "  ERROR: CORE switch " << _id << " has no physical connection to WAN switch" << endl;
-                delete r;
                 return nullptr;
             }
             
-            _fib->addRoute(pkt.dst(), r, 1, UP);
+            _fib->addRoute(pkt.dst(),RouteStore::current().intern(r), 1, UP);
             
             // cerr << "  Created route to WAN switch for host " << pkt.dst() << endl;
         } else {
@@ -678,18 +677,18 @@ Route* MultiFatTreeSwitch::getNextHop(Packet& pkt, BaseQueue* ingress_port){
             uint32_t adjusted_dst = _ft->adjusted_host(pkt.dst());
             uint32_t nup = _ft->MIN_POD_AGG_SWITCH(_ft->HOST_POD(adjusted_dst)) + (_id % _ft->agg_switches_per_pod());
             for (uint32_t b = 0; b < _ft->bundlesize(CORE_TIER); b++) {
-                Route *r = new Route();
+                Route r;
                 // cout << "CORE switch " << _id << " adding route to " << pkt.dst() << " via AGG " << nup << endl;
 
                 assert (_ft->queues_nc_nup[_id][nup][b]);
-                r->push_back(_ft->queues_nc_nup[_id][nup][b]);
-                assert(((BaseQueue*)r->at(0))->getSwitch() == this);
+                r.push_back(_ft->queues_nc_nup[_id][nup][b]);
+                assert(((BaseQueue*)r.at(0))->getSwitch() == this);
 
                 assert (_ft->pipes_nc_nup[_id][nup][b]);
-                r->push_back(_ft->pipes_nc_nup[_id][nup][b]);
+                r.push_back(_ft->pipes_nc_nup[_id][nup][b]);
 
-                r->push_back(_ft->queues_nc_nup[_id][nup][b]->getRemoteEndpoint());
-                _fib->addRoute(pkt.dst(),r,1,DOWN);
+                r.push_back(_ft->queues_nc_nup[_id][nup][b]->getRemoteEndpoint());
+                _fib->addRoute(pkt.dst(),RouteStore::current().intern(r),1,DOWN);
             }
         }
     }
@@ -723,7 +722,7 @@ bool MultiFatTreeSwitch::is_inter_dc_traffic(uint32_t dest_host) const {
 }
 
 // Public method to add routes to FIB (for WAN switches)
-void MultiFatTreeSwitch::add_wan_route(uint32_t dest_host, Route* route) {
+void MultiFatTreeSwitch::add_wan_route(uint32_t dest_host, const Route* route) {
     if (_type != WAN) {
         cerr << "Warning: Attempting to add WAN route to non-WAN switch" << endl;
         return;
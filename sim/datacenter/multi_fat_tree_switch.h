@@ -77,7 +77,7 @@ public:
     MultiFatTreeSwitch(EventList& eventlist, string s, switch_type t, uint32_t id,simtime_picosec switch_delay, MultiFatTreeTopology* ft);
   
     virtual void receivePacket(Packet& pkt);
-    virtual Route* getNextHop(Packet& pkt, BaseQueue* ingress_port);
+    virtual const Route* getNextHop(Packet& pkt, BaseQueue* ingress_port);
     virtual uint32_t getType() {return _type;}
 
     uint32_t adaptive_route(vector<FibEntry*>* ecmp_set, int8_t (*cmp)(FibEntry*,FibEntry*));
@@ -115,7 +115,7 @@ public:
     bool is_inter_dc_traffic(uint32_t dest_host) const;
     
     // Public method to add routes to FIB (for WAN switches)
-    void add_wan_route(uint32_t dest_host, Route* route);
+    void add_wan_route(uint32_t dest_host, const Route* route);
 
     static routing_strategy _strategy;
     static uint16_t _ar_fraction;
@@ -138,7 +138,9 @@ private:
 
     unordered_map<uint32_t,FlowletInfo*> _flowlet_maps;
 
-    static unordered_map<BaseQueue*,uint32_t> _port_flow_counts;
+    // one per thread: when PdesEngine runs the datacenters in parallel,
+    // each counts flows on its own ports
+    static thread_local unordered_map<BaseQueue*,uint32_t> _port_flow_counts;
 
     uint32_t _crt_route;
     uint32_t _hash_salt;
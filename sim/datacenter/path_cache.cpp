@@ -0,0 +1,91 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "path_cache.h"
+#include <iostream>
+
+PathCache::PathCache(Topology& topology, bool reverse, size_t max_entries)
+    : _topology(topology), _reverse(reverse), _max_entries(max_entries),
+      _hits(0), _built(0), _evicted(0), _freed(0)
+{
+}
+
+PathCache::~PathCache() {
+    unordered_map<const Route*, Entry*>::iterator i;
+    for (i = _held.begin(); i != _held.end(); i++) {
+        delete i->second->path;
+        delete i->second;
+    }
+}
+
+uint32_t
+PathCache::no_of_paths(uint32_t src, uint32_t dest) {
+    return _topology.no_of_paths(src, dest);
+}
+
+const Route*
+PathCache::get_path(uint32_t src, uint32_t dest, uint32_t k) {
+    std::lock_guard<std::mutex> guard(_lock);
+    Key key = {src, dest, k};
+    unordered_map<Key, Entry*, KeyHash>::iterator i = _paths.find(key);
+    if (i != _paths.end()) {
+        _hits++;
+        i->second->refs++;
+        return i->second->path;
+    }
+
+    Route* path = _topology.get_path(src, dest, k, _reverse);
+    Route* back = const_cast<Route*>(path->reverse());
+    if (back) {
+        // the interned reverse can't point back at a path that will be
+        // freed
+        back->set_reverse(NULL);
+        // set_reverse() wants a Route*, but nothing changes a route
+        // through its reverse() once it's interned
+        path->set_reverse(const_cast<Route*>(RouteStore::current().intern(*back)));
+        delete back;
+    }
+    _built++;
+
+    if (_max_entries) {
+        if (_paths.size() >= _max_entries) {
+            unordered_map<Key, Entry*, KeyHash>::iterator oldest = _paths.find(_age.front());
+            Entry* evicted = oldest->second;
+            _paths.erase(oldest);
+            _age.pop_front();
+            _evicted++;
+            release(evicted);
+        }
+        _age.push_back(key);
+    }
+    Entry* entry = new Entry();
+    entry->path = path;
+    entry->refs = 2; // the cache's and the caller's
+    _paths[key] = entry;
+    _held[path] = entry;
+    return path;
+}
+
+void
+PathCache::put_path(const Route* path) {
+    std::lock_guard<std::mutex> guard(_lock);
+    unordered_map<const Route*, Entry*>::iterator i = _held.find(path);
+    assert(i != _held.end());
+    release(i->second);
+}
+
+void
+PathCache::release(Entry* entry) {
+    assert(entry->refs > 0);
+    if (--entry->refs > 0)
+        return;
+    _held.erase(entry->path);
+    delete entry->path;
+    delete entry;
+    _freed++;
+}
+
+void
+PathCache::report(ostream& out) {
+    out << "Paths: " << _built << " built, " << _hits << " cache hits, "
+        << _evicted << " evicted, " << _freed << " freed, " << _paths.size() << " cached, "
+        << _held.size() << " held" << endl;
+}
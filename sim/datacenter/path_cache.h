@@ -0,0 +1,84 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+/*
+ * Paths between hosts, built when they're first asked for.
+ *
+ * The drivers used to keep every path between every pair of hosts in
+ * an N x N matrix of path vectors, filled in for each connection.  At
+ * 16k hosts the matrix of pointers alone is 2GB, and a fat tree with
+ * bundles has hundreds of paths per pair.  A PathCache instead asks
+ * the topology for path k between src and dest when someone needs it
+ * (see Topology::get_path), interns it in the RouteStore and remembers
+ * it, so memory grows with the paths flows actually use.
+ *
+ * The cache owns the paths it builds, and with max_entries set it
+ * holds at most that many: past it, it drops the oldest.  A path is
+ * counted while it's cached and while someone who asked for it hasn't
+ * handed it back (see PathSource::put_path), and freed once neither
+ * holds, so what the cache keeps stays bounded however many pairs of
+ * hosts are used over a run.  The reverse of a path isn't freed with
+ * it: packets carry their route's reverse to bounce back along, long
+ * after their sender has moved on, so reverses are interned in the
+ * RouteStore, where they're shared by every path with the same hops.
+ *
+ * Transports' move_path asks for paths while they run, which under
+ * PdesEngine is on several LPs' threads at once, so get_path takes a
+ * lock.
+ */
+
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include "config.h"
+#include "route.h"
+#include "topology.h"
+
+class PathCache : public PathSource {
+public:
+    // max_entries 0 means no bound
+    PathCache(Topology& topology, bool reverse, size_t max_entries = 0);
+    virtual ~PathCache();
+
+    virtual uint32_t no_of_paths(uint32_t src, uint32_t dest);
+    virtual const Route* get_path(uint32_t src, uint32_t dest, uint32_t k);
+    virtual void put_path(const Route* path);
+
+    void report(ostream& out);
+
+private:
+    struct Key {
+        uint32_t src, dest, k;
+        bool operator==(const Key& other) const {
+            return src == other.src && dest == other.dest && k == other.k;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return ((size_t)key.src * 0x9e3779b1 + key.dest) * 0x9e3779b1 + key.k;
+        }
+    };
+    struct Entry {
+        Route* path;
+        uint32_t refs; // one for the cache, while it's cached, and one per get_path
+    };
+
+    void release(Entry* entry);
+
+    Topology& _topology;
+    bool _reverse;
+    size_t _max_entries;
+    unordered_map<Key, Entry*, KeyHash> _paths;
+    unordered_map<const Route*, Entry*> _held; // every path not yet freed
+    deque<Key> _age; // oldest first, when bounded
+    std::mutex _lock;
+
+    uint64_t _hits;
+    uint64_t _built;
+    uint64_t _evicted;
+    uint64_t _freed;
+};
+
+#endif
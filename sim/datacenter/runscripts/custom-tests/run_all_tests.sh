@@ -50,6 +50,13 @@ bash test_reliability_failures.sh
 echo "Reliability and failure tests completed at $(date)"
 echo ""
 
+# Test 6: Parallel runs
+echo "=== TEST 6: Parallel Runs ==="
+echo "Checking parallel fat tree runs against sequential ones..."
+bash test_pdes.sh
+echo "Parallel run tests completed at $(date)"
+echo ""
+
 # Generate test summary
 echo "=== TEST SUMMARY ==="
 echo "All tests completed at $(date)"
@@ -0,0 +1,76 @@
+#!/bin/bash
+
+# Parallel (PDES) Tests
+# Runs pod-partitioned fat trees on threads, and on one thread with
+# -pdesseq, and checks that they print and log exactly what a plain run
+# of the same network does, with the same seed
+
+echo "=== PDES Test Suite ==="
+echo "Starting at $(date)"
+
+# run from sim/datacenter, wherever we're called from
+cd "$(dirname "$0")/../.."
+
+RESULTS=../results/test-suite/pdes
+mkdir -p $RESULTS
+
+# Test parameters
+NODES=128
+SEED=17
+LPS=(2 4)
+HOST_LB_STRATEGIES=("none" "spray" "plb")
+
+failed=0
+for lps in "${LPS[@]}"
+do
+    for host_lb in "${HOST_LB_STRATEGIES[@]}"
+    do
+        echo "Testing $lps LPs, host load balancing: $host_lb"
+        hostlb=""
+        if [ "$host_lb" != "none" ]; then
+            hostlb="-hostlb $host_lb"
+        fi
+        for mode in plain seq par
+        do
+            pdes="-pdes $lps"
+            if [ "$mode" = "plain" ]; then
+                pdes=""
+            elif [ "$mode" = "seq" ]; then
+                pdes="$pdes -pdesseq"
+            fi
+            name=$RESULTS/pdes-${lps}lp-${host_lb}-${mode}
+            # The engine's report, the flow log's name and the memory
+            # and route reports at the end, which are per event list,
+            # differ by design
+            ./htsim_constcca \
+                -end 1000 \
+                -tm ./connection_matrices/perm_128n_128c_2MB.cm \
+                -nodes $NODES \
+                -strat ecmp \
+                $hostlb \
+                -seed $SEED \
+                $pdes \
+                -of $name.csv | grep -v -e '^PDES' -e '^Logging flows' | sed '/^Routes:/,$d' > $name.out
+            if [ ${PIPESTATUS[0]} -ne 0 ]; then
+                echo "  $mode run failed"
+                failed=1
+            fi
+        done
+        plain=$RESULTS/pdes-${lps}lp-${host_lb}-plain
+        for mode in seq par
+        do
+            name=$RESULTS/pdes-${lps}lp-${host_lb}-${mode}
+            if cmp -s $plain.out $name.out && cmp -s $plain.csv $name.csv; then
+                echo "  PDES test passed ($mode)"
+            else
+                echo "  PDES test failed: $mode run differs from plain"
+                failed=1
+            fi
+        done
+    done
+done
+
+echo "PDES tests completed at $(date)"
+if [ $failed -ne 0 ]; then
+    exit 1
+fi
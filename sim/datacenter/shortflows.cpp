@@ -5,7 +5,7 @@ string ntoa(double n);
 string itoa(uint64_t n);
 
 ShortFlows::ShortFlows(double lambda, EventList& eventlist, vector<const Route*>*** n,
-                       ConnectionMatrix* conns,Logfile* logfile,TcpRtxTimerScanner * rtx)
+                       ConnectionMatrix* conns,Logfile* logfile,RtxTimerWheel * rtx)
   : EventSource(eventlist,"ShortFlows")
 {
   eventlist.sourceIsPendingRel(*this, timeFromMs(1000));
@@ -22,7 +22,7 @@ ShortFlow* ShortFlows::createConnection(int src, int dst, simtime_picosec startt
     f->src = new TcpSrcTransfer(NULL,NULL,eventlist(),70000,net_paths[src][dst]);
     f->snk = new TcpSinkTransfer();
 
-    int pos = connections[src][dst].size();
+    int pos = connections(src, dst).size();
 
     f->src->setName("sf_" + ntoa(src) + "_" + ntoa(dst)+"("+ntoa(pos)+")");
     logfile->writeName(*(f->src));
@@ -30,7 +30,7 @@ ShortFlow* ShortFlows::createConnection(int src, int dst, simtime_picosec startt
     f->snk->setName("sf_sink_" + ntoa(src) + "_" + ntoa(dst)+ "("+ntoa(pos)+")");
     logfile->writeName(*(f->snk));
     
-    tcpRtxScanner->registerTcp(*(f->src));
+    tcpRtxScanner->registerSrc(*(f->src));
 
     int choice = rand()%net_paths[src][dst]->size();
 
@@ -59,15 +59,15 @@ void ShortFlows::run(){
   connection* c = _traffic_matrix->at(pos);
   
   ShortFlow* f = NULL;
-  for (unsigned int i=0;i<connections[c->src][c->dst].size();i++){
-    f = connections[c->src][c->dst][i];
+  for (unsigned int i=0;i<connections(c->src, c->dst).size();i++){
+    f = connections(c->src, c->dst)[i];
     if (!f->src->_is_active)
       break;
   }
 
   if (!f||f->src->_is_active){
     f = createConnection(c->src,c->dst,eventlist().now());
-    connections[c->src][c->dst].push_back(f);
+    connections(c->src, c->dst).push_back(f);
   }
   else {
     f->src->reset(70000, true);
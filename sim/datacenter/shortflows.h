@@ -10,6 +10,7 @@
 #include "tcp_transfer.h"
 #include <list>
 #include <map>
+#include <unordered_map>
 #include "connection_matrix.h"
 
 struct ShortFlow{
@@ -20,7 +21,7 @@ struct ShortFlow{
 class ShortFlows: public EventSource{
 public:
     ShortFlows(double l, EventList& eventlist, vector<const Route*>*** np, ConnectionMatrix* c,
-               Logfile* logfile,TcpRtxTimerScanner* r);
+               Logfile* logfile,RtxTimerWheel* r);
     void doNextEvent();
 
     void run();
@@ -29,7 +30,12 @@ public:
     ShortFlow* createConnection(int src, int dst, simtime_picosec starttime);
     vector<const Route*>*** net_paths;
 private:
-    vector<ShortFlow*> connections[1024][1024];
+    // flows made so far between each pair of hosts, to reuse once
+    // they're inactive; only pairs that have had a flow have an entry
+    vector<ShortFlow*>& connections(int src, int dst) {
+        return _connections[((uint64_t)src << 32) | (uint32_t)dst];
+    }
+    unordered_map<uint64_t, vector<ShortFlow*> > _connections;
     vector<connection*>* _traffic_matrix;
     Logfile* logfile;
 
@@ -39,7 +45,7 @@ private:
     //log finish time when it's done
   
     double _lambda;  
-    TcpRtxTimerScanner* tcpRtxScanner;
+    RtxTimerWheel* tcpRtxScanner;
 };
 
 #endif
@@ -3,7 +3,7 @@
 #include "fat_tree_topology.h"
 
 SubflowControl::SubflowControl(simtime_picosec scanPeriod, Logfile* lg, SinkLoggerSampling* sl,
-                               EventList& eventlist, TcpRtxTimerScanner* rtx,  
+                               EventList& eventlist, RtxTimerWheel* rtx,  
                                vector<const Route*>*** n, std::ofstream* p, int ms) 
   : EventSource(eventlist,"SubflowControl"), _scanPeriod(scanPeriod)
 {
@@ -72,7 +72,7 @@ void SubflowControl::run(){
       tcpSnk->setName("mtcp_sink_" + ntoa(f->src) + "_" + ntoa(f->subflows->size()) + "_" + ntoa(f->dest));
       logfile->writeName(*tcpSnk);
       
-      _rtx->registerTcp(*tcpSrc);
+      _rtx->registerSrc(*tcpSrc);
       
       int found;
       int choice;
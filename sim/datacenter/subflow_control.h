@@ -32,7 +32,7 @@ struct multipath_flow_entry {
 class SubflowControl: public EventSource{
  public:
   SubflowControl(simtime_picosec scanPeriod, Logfile* lg, SinkLoggerSampling* sl,
-                 EventList& eventlist, TcpRtxTimerScanner* rtx, vector<const Route*>*** np, 
+                 EventList& eventlist, RtxTimerWheel* rtx, vector<const Route*>*** np, 
                  std::ofstream* p,int max_subflows);
   void doNextEvent();
 
@@ -51,7 +51,7 @@ class SubflowControl: public EventSource{
   simtime_picosec _scanPeriod;  
   int threshold;
   int _max_subflows;
-  TcpRtxTimerScanner* _rtx;
+  RtxTimerWheel* _rtx;
   SinkLoggerSampling* sinkLogger;
   Logfile * logfile;
 };
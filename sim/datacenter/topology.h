@@ -10,6 +10,22 @@ public:
         return get_bidir_paths(src, dest, true);
     }
     virtual vector<const Route*>* get_bidir_paths(uint32_t src, uint32_t dest, bool reverse)=0;
+    // How many paths get_bidir_paths() returns, and path k of them
+    // built on its own, for whoever only needs a few.  The caller owns
+    // the path, and its reverse.  Topologies that can work out a path
+    // from k override these; the defaults build all the paths.
+    virtual uint32_t no_of_paths(uint32_t src, uint32_t dest) {
+        vector<const Route*>* paths = get_bidir_paths(src, dest, false);
+        uint32_t n = paths->size();
+        delete_paths(paths, 0, n);
+        return n;
+    }
+    virtual Route* get_path(uint32_t src, uint32_t dest, uint32_t k, bool reverse) {
+        vector<const Route*>* paths = get_bidir_paths(src, dest, reverse);
+        Route* path = const_cast<Route*>(paths->at(k));
+        delete_paths(paths, k, k + 1);
+        return path;
+    }
     virtual vector<uint32_t>* get_neighbours(uint32_t src) = 0;  
     virtual uint32_t no_of_nodes() const {
         abort();
@@ -19,6 +35,18 @@ public:
     virtual void add_switch_loggers(Logfile& log, simtime_picosec sample_period) {
         abort();
     }
+
+private:
+    // delete paths and every route in it except [keep, keep_end)
+    static void delete_paths(vector<const Route*>* paths, size_t keep, size_t keep_end) {
+        for (size_t i = 0; i < paths->size(); i++) {
+            if (i >= keep && i < keep_end)
+                continue;
+            delete (*paths)[i]->reverse();
+            delete (*paths)[i];
+        }
+        delete paths;
+    }
 };
 
 #endif
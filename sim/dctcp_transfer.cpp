@@ -49,9 +49,11 @@ void DCTCPSrcTransfer::reset(uint64_t bb, int shouldRestart){
   _recoverq = 0;
   _in_fast_recovery = false;
   _established = false;
+  update_mptcp_window();
   
   _rtx_timeout_pending = false;
   _RFC2988_RTO_timeout = timeInf;
+  rtx_timer_update();
   
   //_bytes_to_send = bb;
 
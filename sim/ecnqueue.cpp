@@ -3,6 +3,7 @@
 #include <math.h>
 #include "ecn.h"
 #include "queue_lossless.h"
+#include "checkpoint.h"
 #include <iostream>
 
 ECNQueue::ECNQueue(linkspeed_bps bitrate, mem_b maxsize, 
@@ -111,3 +112,12 @@ ECNQueue::completeService()
         beginService();
     }
 }
+
+void
+ECNQueue::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(ECNQueue));
+    checkpoint_base(archive);
+    checkpoint_fifo(archive);
+    archive.check(_K, "ECN threshold");
+    archive.io(_state_send);
+}
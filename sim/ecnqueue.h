@@ -18,6 +18,7 @@ public:
              QueueLogger* logger, mem_b drop);
     void receivePacket(Packet & pkt);
     void completeService();
+    virtual void checkpoint(CheckpointArchive& archive);
 private:
     mem_b _K;
     int _state_send;
@@ -269,6 +269,9 @@ EqdsSrc::EqdsSrc(TrafficLogger *trafficLogger, EventList &eventList, EqdsNIC &ni
     _credit_pull = 0;
     _credit_spec = _maxwnd;
     _in_flight = 0;
+    _in_flight_pkts = 0;
+    _oldest_sent = 0;
+    _newest_sent = 0;
     _highest_sent = 0;
     _send_blocked_on_nic = false;
     _no_of_paths = _path_entropy_size;
@@ -306,7 +309,7 @@ void EqdsSrc::connect(Route &routeout, Route &routeback, EqdsSink &sink, simtime
     _route = &routeout;
     _sink = &sink;
     //_flow.set_id(get_id());  // identify the packet flow with the EQDS source that generated it
-    _flow._name = _name;
+    _flow.copyName(*this);
    
     _sink->connect(this, &routeback);
 
@@ -391,20 +394,19 @@ void EqdsSrc::receivePacket(Packet &pkt) {
 }
 
 void EqdsSrc::handleAckno(EqdsDataPacket::seq_t ackno) {
-    auto i = _tx_bitmap.find(ackno);
-    if (i == _tx_bitmap.end())
+    if (!_tx_records.get(ackno).in_flight)
         return;
-    //mem_b pkt_size = i->second.pkt_size;
-    simtime_picosec send_time = i->second.send_time;
+    sendRecord& record = _tx_records[ackno];
+    simtime_picosec send_time = record.send_time;
 
     //computeRTO(send_time);
 
-    mem_b pkt_size = i->second.pkt_size;
+    mem_b pkt_size = record.pkt_size;
     _in_flight -= pkt_size;
     assert(_in_flight >= 0);
     if (_debug_src) cout << _nodename << " handleAck " << ackno << " flow " << _flow.str() << endl;
-    _tx_bitmap.erase(i);
-    _send_times.erase(send_time);
+    unlinkSendRecord(ackno);
+    record.pkt_size = 0;
 
     if (send_time == _rto_send_time) {
         recalculateRTO();
@@ -412,39 +414,32 @@ void EqdsSrc::handleAckno(EqdsDataPacket::seq_t ackno) {
 }
 
 void EqdsSrc::handleCumulativeAck(EqdsDataPacket::seq_t cum_ack) {
-    // free up anything cumulatively acked
-    while (!_rtx_queue.empty()) {
-        auto seqno = _rtx_queue.begin()->first;
-
-        if (seqno < cum_ack) {
-            _rtx_queue.erase(_rtx_queue.begin());
-        }
-        else break;
+    // cumulative ack is next expected packet, not yet received
+    if (cum_ack <= _tx_records.base()) {
+        // nothing new acked
+        return;
     }
+    // free up anything cumulatively acked
+    _rtx_queue.discard(cum_ack);
 
-    auto i = _tx_bitmap.begin();
-    while (i != _tx_bitmap.end()) {
-        auto seqno = i->first;
-        // cumulative ack is next expected packet, not yet received
-        if (seqno >= cum_ack) {
-            // nothing else acked
-            break;
-        }
-        mem_b pkt_size = i->second.pkt_size;
-        simtime_picosec send_time = i->second.send_time;
+    for (auto seqno = _tx_records.base(); seqno < cum_ack && _in_flight_pkts > 0; seqno++) {
+        sendRecord& record = _tx_records[seqno];
+        if (!record.in_flight)
+            continue;
+        mem_b pkt_size = record.pkt_size;
+        simtime_picosec send_time = record.send_time;
 
         //computeRTO(send_time);
 
         _in_flight -= pkt_size;
         assert(_in_flight >= 0);
         if (_debug_src) cout << _nodename << " handleCumAck " << seqno << " flow " << _flow.str() << endl;
-        _tx_bitmap.erase(i);
-        i = _tx_bitmap.begin();
-        _send_times.erase(send_time);
+        unlinkSendRecord(seqno);
         if (send_time == _rto_send_time) {
             recalculateRTO();
         }
     }
+    _tx_records.advance(cum_ack);
 }
 
 void EqdsSrc::handlePull(EqdsBasePacket::pull_quanta pullno) {
@@ -465,7 +460,7 @@ bool EqdsSrc::checkFinished(EqdsDataPacket::seq_t cum_ack) {
         cout << _nodename << " checkFinished " << " cum_acc " << cum_ack << " mss " << _mss << " RTS sent " << _rts_packets_sent << " total bytes " << (cum_ack - _rts_packets_sent) * _mss << " flow_size " << _flow_size << " done_sending " << _done_sending << endl;
 
     if ((((mem_b)cum_ack -_rts_packets_sent) * _mss) >= _flow_size) {
-        cout << "Flow " << _name << " flowId " << flowId() << " " << _nodename << " finished at " << timeAsUs(eventlist().now()) << " total packets " << cum_ack << " RTS " << _rts_packets_sent << " total bytes " << ((mem_b)cum_ack - _rts_packets_sent) * _mss << endl;
+        cout << "Flow " << str() << " flowId " << flowId() << " " << _nodename << " finished at " << timeAsUs(eventlist().now()) << " total packets " << cum_ack << " RTS " << _rts_packets_sent << " total bytes " << ((mem_b)cum_ack - _rts_packets_sent) * _mss << endl;
         _state = IDLE;
         if (_end_trigger) {
             _end_trigger->activate();
@@ -531,8 +526,7 @@ void EqdsSrc::processNack(const EqdsNackPacket& pkt) {
     //bool ecn_echo = pkt.ecn_echo();
 
     // move the packet to the RTX queue
-    auto i = _tx_bitmap.find(nacked_seqno);
-    if (i == _tx_bitmap.end()) {
+    if (!_tx_records.get(nacked_seqno).in_flight) {
         if (_debug_src) 
             cout << "Didn't find NACKed packet in _active_packets flow " << _flow.str() << endl;
 
@@ -544,26 +538,25 @@ void EqdsSrc::processNack(const EqdsNackPacket& pkt) {
         // this can happen when the NACK arrives later than a cumulative ACK covering the NACKed packet.
         //return;
     }
-    mem_b pkt_size = i->second.pkt_size;
+    sendRecord& record = _tx_records[nacked_seqno];
+    mem_b pkt_size = record.pkt_size;
     
     assert(pkt_size >= _hdr_size); // check we're not seeing NACKed RTS packets.
     if (pkt_size == _hdr_size){
         _stats.rts_nacks ++;
     } 
     
-    auto seqno = i->first;
-    simtime_picosec send_time = i->second.send_time;
+    auto seqno = nacked_seqno;
+    simtime_picosec send_time = record.send_time;
 
     //computeDynamicRTO(send_time);
 
     if (_debug_src) cout << _nodename << " erasing send record, seqno: " << seqno << " flow " << _flow.str() << endl;
-    _tx_bitmap.erase(i);
-    assert(_tx_bitmap.find(seqno) == _tx_bitmap.end()); // xxx remove when working
+    unlinkSendRecord(seqno);
 
     _in_flight -= pkt_size;
     assert(_in_flight >= 0);
     
-    _send_times.erase(send_time);
     queueForRtx(seqno, pkt_size);
 
     if (send_time == _rto_send_time) {
@@ -595,7 +588,7 @@ void EqdsSrc::doNextEvent() {
 
 	    rtxTimerExpired();
     } else {
-        if (_debug_src) cout << "Starting flow " << _name << endl;                                                                                           
+        if (_debug_src) cout << "Starting flow " << str() << endl;                                                                                           
         startFlow();
     }
 }
@@ -607,7 +600,7 @@ void EqdsSrc::setFlowsize(uint64_t flow_size_in_bytes) {
 void EqdsSrc::startFlow() {
     _cwnd = _maxwnd;
     _credit_spec = _maxwnd;
-    if (_debug_src) cout << "startflow " <<  _flow._name <<  " CWND " << _cwnd << " at " << timeAsUs(eventlist().now()) << " flow " << _flow.str() << endl;
+    if (_debug_src) cout << "startflow " <<  _flow.str() <<  " CWND " << _cwnd << " at " << timeAsUs(eventlist().now()) << " flow " << _flow.str() << endl;
     if (_flow_logger) {
         _flow_logger->logEvent(_flow, *this, FlowEventLogger::START, _flow_size, 0);
     }
@@ -718,7 +711,7 @@ void EqdsSrc::sendIfPermitted() {
         }
         pkt_size = payload_size + _hdr_size;
     } else {
-        pkt_size = _rtx_queue.begin()->second;
+        pkt_size = rtxPktSize();
     }
 
 #ifdef USE_CWND
@@ -890,8 +883,8 @@ mem_b EqdsSrc::sendNewPacket() {
 
 mem_b EqdsSrc::sendRtxPacket() {
     assert(!_rtx_queue.empty());
-    auto seq_no = _rtx_queue.begin()->first;
-    mem_b full_pkt_size = _rtx_queue.begin()->second;
+    auto seq_no = _rtx_queue.first();
+    mem_b full_pkt_size = _tx_records.get(seq_no).pkt_size;
     bool speculative = false;
     bool can_send = spendCredit(full_pkt_size, speculative);
     assert(!speculative); // I don't think this can happen, but remove this assert if we decide it can
@@ -900,7 +893,7 @@ mem_b EqdsSrc::sendRtxPacket() {
         return 0;
     }
     
-    _rtx_queue.erase(_rtx_queue.begin());
+    _rtx_queue.erase(seq_no);
     _in_flight += full_pkt_size;
     auto *p = EqdsDataPacket::newpkt(_flow, *_route, seq_no, full_pkt_size,
                                      EqdsDataPacket::DATA_RTX, _pull_target, /*unordered=*/true, _dstaddr);
@@ -945,14 +938,41 @@ void EqdsSrc::sendRTS() {
 void EqdsSrc::createSendRecord(EqdsBasePacket::seq_t seqno, mem_b full_pkt_size) {
     //assert(full_pkt_size > 64);
     if (_debug_src) cout << _nodename << " createSendRecord seqno: " << seqno << " size " << full_pkt_size << endl;
-    assert(_tx_bitmap.find(seqno) == _tx_bitmap.end());
-    _tx_bitmap.emplace(seqno, sendRecord(full_pkt_size, eventlist().now()));
-    _send_times.emplace(eventlist().now(), seqno);
+    sendRecord& record = _tx_records[seqno];
+    assert(!record.in_flight);
+    record.pkt_size = full_pkt_size;
+    record.send_time = eventlist().now();
+    record.in_flight = true;
+    // sent now, so it's the newest
+    record.older = _newest_sent;
+    if (_in_flight_pkts == 0)
+        _oldest_sent = seqno;
+    else
+        _tx_records[_newest_sent].newer = seqno;
+    _newest_sent = seqno;
+    _in_flight_pkts++;
+}
+
+void EqdsSrc::unlinkSendRecord(EqdsBasePacket::seq_t seqno) {
+    // the record stays, with its size, for queueForRtx
+    sendRecord& record = _tx_records[seqno];
+    assert(record.in_flight);
+    if (seqno == _oldest_sent)
+        _oldest_sent = record.newer;
+    else
+        _tx_records[record.older].newer = record.newer;
+    if (seqno == _newest_sent)
+        _newest_sent = record.older;
+    else
+        _tx_records[record.newer].older = record.older;
+    record.in_flight = false;
+    _in_flight_pkts--;
 }
 
 void EqdsSrc::queueForRtx(EqdsBasePacket::seq_t seqno, mem_b pkt_size) {
-    assert(_rtx_queue.find(seqno) == _rtx_queue.end());
-    _rtx_queue.emplace(seqno, pkt_size);
+    assert(!_rtx_queue.contains(seqno));
+    _tx_records[seqno].pkt_size = pkt_size;
+    _rtx_queue.insert(seqno);
     sendIfPermitted();
 }
 
@@ -985,7 +1005,7 @@ void EqdsSrc::timeToSend() {
         full_pkt_size = payload_size + _hdr_size;
     } else {
         // we want to retransmit
-        full_pkt_size = _rtx_queue.begin()->second;
+        full_pkt_size = rtxPktSize();
     }
 #ifdef USE_CWND
     if (_cwnd < full_pkt_size) {
@@ -1047,11 +1067,11 @@ void EqdsSrc::recalculateRTO() {
     // we're no longer waiting for the packet we set the timer for -
     // figure out what the timer should be now.
     cancelRTO();
-    if (_send_times.empty()) {
+    if (_in_flight_pkts == 0) {
         // nothing left that we're waiting for
         return;
     }
-    auto earliest_send_time = _send_times.begin()->first;
+    auto earliest_send_time = _tx_records.get(_oldest_sent).send_time;
     startRTO(earliest_send_time);
 }
 
@@ -1059,19 +1079,14 @@ void EqdsSrc::rtxTimerExpired() {
     assert(eventlist().now() == _rtx_timeout);
     clearRTO();
 
-    auto first_entry = _send_times.begin();
-    assert(first_entry != _send_times.end());
-    auto seqno = first_entry->second;
-
-    auto send_record = _tx_bitmap.find(seqno);
-    assert(send_record != _tx_bitmap.end());
-    mem_b pkt_size = send_record->second.pkt_size;
+    assert(_in_flight_pkts > 0);
+    auto seqno = _oldest_sent;
+    mem_b pkt_size = _tx_records.get(seqno).pkt_size;
 
     //update flightsize?
 
-    _send_times.erase(first_entry);
     if (_debug_src) cout << _nodename << " rtx timer expired for " << seqno << " flow " << _flow.str() << endl;
-    _tx_bitmap.erase(send_record);
+    unlinkSendRecord(seqno);
     recalculateRTO();
 
     if (!_rtx_queue.empty()) {
@@ -1134,6 +1149,52 @@ void EqdsSrc::setEndTrigger(Trigger& end_trigger) {
     _end_trigger = &end_trigger;
 };
 
+void EqdsSrc::reset() {
+    // the flow is done, so nothing is in flight or waiting to be resent
+    cancelRTO();
+    _tx_records.clear();
+    _rtx_queue.clear();
+    _oldest_sent = 0;
+    _newest_sent = 0;
+    _in_flight_pkts = 0;
+    _rtt = _min_rto;
+    _mdev = 0;
+    _rto = _min_rto;
+
+    _cwnd = _maxwnd;
+    _flow_size = 0;
+    _done_sending = false;
+    _backlog = 0;
+    _unsent = 0;
+    _pull_target = 0;
+    _pull = 0;
+    _state = INITIALIZE_CREDIT;
+    _speculating = false;
+    _credit_pull = 0;
+    _credit_spec = _maxwnd;
+    _in_flight = 0;
+    _highest_sent = 0;
+    _send_blocked_on_nic = false;
+    // the next flow gets entropy of its own, as a new src would
+    _path_random = rand() % 0xffff;
+    _path_xor = rand() % _no_of_paths;
+    _current_ev_index = 0;
+    _last_rts = 0;
+    for (uint32_t i = 0; i < _no_of_paths; i++) {
+        _ev_skip_bitmap[i] = 0;
+    }
+
+    _new_packets_sent = 0;
+    _rtx_packets_sent = 0;
+    _rts_packets_sent = 0;
+    _bounces_received = 0;
+    _stats = {0,0,0,0,0};
+
+    _sink = NULL;
+    _dstaddr = UINT32_MAX;
+    _route = NULL;
+}
+
 ////////////////////////////////////////////////////////////////                                                                   
 //  EQDS SINK                                                                                                                       
 ////////////////////////////////////////////////////////////////   
@@ -1151,7 +1212,6 @@ EqdsSink::EqdsSink(TrafficLogger *trafficLogger, EqdsPullPacer* pullPacer, EqdsN
     _received_bytes(0),
     _accepted_bytes(0),
     _end_trigger(NULL),
-    _epsn_rx_bitmap(0),
     _out_of_order_count(0),
     _ack_request(false)
 {
@@ -1173,7 +1233,6 @@ EqdsSink::EqdsSink(TrafficLogger* trafficLogger, linkspeed_bps linkSpeed, double
     _received_bytes(0),
     _accepted_bytes(0),
     _end_trigger(NULL),
-    _epsn_rx_bitmap(0),
     _out_of_order_count(0),
     _ack_request(false)
 {
@@ -1262,11 +1321,10 @@ void EqdsSink::processData(const EqdsDataPacket& pkt){
     if (_src->debug()) cout << _nodename << " src " << _src->nodename() << " >>    cumulative ack was: " << _expected_epsn << " flow " << _src->flow()->str() << endl;
 
     if (pkt.epsn() == _expected_epsn) {
-        while (_epsn_rx_bitmap[++_expected_epsn]){
-            //clean OOO state, this will wrap at some point.
-            _epsn_rx_bitmap[_expected_epsn] = 0;
-            _out_of_order_count--;
-        }
+        //clean OOO state, this will wrap at some point.
+        unsigned run = _epsn_rx_bitmap.consume(++_expected_epsn);
+        _expected_epsn += run;
+        _out_of_order_count -= run;
         if (_src->debug()) cout << " EqdsSink "<< _nodename << " src " << _src->nodename() << " >>    cumulative ack now: " << _expected_epsn << " ooo count " << _out_of_order_count << " flow " << _src->flow()->str()  << endl;
 
         if (_out_of_order_count==0 && _ack_request){
@@ -1275,7 +1333,7 @@ void EqdsSink::processData(const EqdsDataPacket& pkt){
         }
     }
     else {
-        _epsn_rx_bitmap[pkt.epsn()] = 1;
+        _epsn_rx_bitmap.set(pkt.epsn());
         _out_of_order_count ++;
         _stats.out_of_order++;
     }
@@ -1379,11 +1437,10 @@ void EqdsSink::processRts(const EqdsRtsPacket& pkt){
     _received_bytes += pkt.size() - EqdsAckPacket::ACKSIZE;
 
     if (pkt.epsn() == _expected_epsn) {
-        while (_epsn_rx_bitmap[++_expected_epsn]){
-            //clean OOO state, this will wrap at some point.
-            _epsn_rx_bitmap[_expected_epsn] = 0;
-            _out_of_order_count--;
-        }
+        //clean OOO state, this will wrap at some point.
+        unsigned run = _epsn_rx_bitmap.consume(++_expected_epsn);
+        _expected_epsn += run;
+        _out_of_order_count -= run;
         if (_src->debug())
             cout << " EqdsSink "<< _nodename << " src " << _src->nodename() << " >>    cumulative ack now: " << _expected_epsn << " ooo count " << _out_of_order_count << " flow " << _src->flow()->str()  << endl;
 
@@ -1392,7 +1449,7 @@ void EqdsSink::processRts(const EqdsRtsPacket& pkt){
         }
     }
     else {
-        _epsn_rx_bitmap[pkt.epsn()] = 1;
+        _epsn_rx_bitmap.set(pkt.epsn());
         _out_of_order_count ++;
         _stats.out_of_order++;
     }
@@ -1471,46 +1528,19 @@ EqdsBasePacket::seq_t EqdsSink::sackBitmapBase(EqdsBasePacket::seq_t epsn){
     return  max((int64_t)epsn - 63,(int64_t)(_expected_epsn+1));
 }
 
-EqdsBasePacket::seq_t EqdsSink::sackBitmapBaseIdeal(){
-    uint8_t lowest_value = UINT8_MAX;
-    EqdsBasePacket::seq_t lowest_position;
-
-    //find the lowest non-zero value in the sack bitmap; that is the candidate for the base, since it is the oldest packet that we are yet to sack.
-    //on sack bitmap construction that covers a given seqno, the value is incremented. 
-    for (EqdsBasePacket::seq_t crt = _expected_epsn; crt <= _high_epsn; crt++)
-        if (_epsn_rx_bitmap[crt] && _epsn_rx_bitmap[crt]<lowest_value){
-            lowest_value = _epsn_rx_bitmap[crt];
-            lowest_position = crt;
-        }
-    
-    if (lowest_position + 64 > _high_epsn)
-        lowest_position = _high_epsn - 64;
-
-    if (lowest_position <= _expected_epsn)
-        lowest_position = _expected_epsn + 1;
-    
-    return lowest_position;
-}
-
 uint64_t EqdsSink::buildSackBitmap(EqdsBasePacket::seq_t ref_epsn){
     //take the next 64 entries from ref_epsn and create a SACK bitmap with them
     if (_src->debug())
         cout << " EqdsSink: building sack for ref_epsn " << ref_epsn << endl;
-    uint64_t bitmap = (uint64_t)(_epsn_rx_bitmap[ref_epsn]!=0) << 63;
+    uint64_t bitmap = _epsn_rx_bitmap.window(ref_epsn);
 
-    for (int i=1;i<64;i++){
-        bitmap = bitmap >> 1 | (uint64_t)(_epsn_rx_bitmap[ref_epsn+i]!=0) << 63;
-        if (_src->debug() && (_epsn_rx_bitmap[ref_epsn+i]!=0))
-            cout << "     Sack: " <<  ref_epsn+i << endl;
-
-        if (_epsn_rx_bitmap[ref_epsn+i]){
-            //remember that we sacked this packet
-            if (_epsn_rx_bitmap[ref_epsn+i]<UINT8_MAX)
-                _epsn_rx_bitmap[ref_epsn+i]++;
+    if (_src->debug()) {
+        for (int i=1;i<64;i++){
+            if ((bitmap >> i) & 1)
+                cout << "     Sack: " <<  ref_epsn+i << endl;
         }
-    }
-    if (_src->debug())
         cout << "       bitmap is: " << bitmap << endl;
+    }
     return bitmap;
 }
 
@@ -1530,19 +1560,43 @@ void EqdsSink::setEndTrigger(Trigger& end_trigger) {
     _end_trigger = &end_trigger;
 };
 
+void EqdsSink::reset() {
+    _src = NULL;
+    _route = NULL;
+    _expected_epsn = 0;
+    _high_epsn = 0;
+    _retx_backlog = 0;
+    _latest_pull = 0;
+    _highest_pull_target = 0;
+    _received_bytes = 0;
+    _accepted_bytes = 0;
+    _end_trigger = NULL;
+    _epsn_rx_bitmap.clear();
+    _out_of_order_count = 0;
+    _ack_request = false;
+    _in_pull = false;
+    _in_slow_pull = false;
+    _stats = {0,0,0,0,0};
+}
+
+bool EqdsSink::pullsQueued() {
+    return _pullPacer->isActive(this) || _pullPacer->isRetransmitting(this) || _pullPacer->isIdle(this);
+}
+
+void EqdsSink::stopPulls() {
+    _pullPacer->cancelPulls(this);
+    _in_pull = false;
+    _in_slow_pull = false;
+    _retx_backlog = 0;
+}
+
 static unsigned pktByteTimes(unsigned size) {
     // IPG (96 bit times) + preamble + SFD + ether header + FCS = 38B
     return max(size, 46u) + 38;
 }
 
 uint32_t EqdsSink::reorder_buffer_size() {
-    uint32_t count = 0;
-    // it's not very efficient to count each time, but if we only do
-    // this occasionally when the sink logger runs, it should be OK.
-    for (uint32_t i = 0; i < eqdsMaxInFlightPkts; i++) {
-        if (_epsn_rx_bitmap[i]) count++;
-    }
-    return count;
+    return _epsn_rx_bitmap.count();
 }
 
 ////////////////////////////////////////////////////////////////                                                                   
@@ -1644,6 +1698,13 @@ bool EqdsPullPacer::isIdle(EqdsSink* sink){
     return false;
 }
 
+void EqdsPullPacer::cancelPulls(EqdsSink* sink){
+    // if that empties the lists, doNextEvent will find nothing to do
+    _rtx_senders.remove(sink);
+    _active_senders.remove(sink);
+    _idle_senders.remove(sink);
+}
+
 
 void EqdsPullPacer::requestPull(EqdsSink *sink) {
     if (isActive(sink)){
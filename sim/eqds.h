@@ -10,6 +10,9 @@
 #include "trigger.h"
 #include "eqdspacket.h"
 #include "circular_buffer.h"
+#include "seq_ring.h"
+#include "seq_bitmap.h"
+#include "memory_account.h"
 
 
 #define timeInf 0
@@ -32,6 +35,68 @@ class ModularVector {
     T &operator [](unsigned idx) { return buf[idx & (Size - 1)]; }
 };
 
+// One bit per seqno, modulo Size like ModularVector.
+template <unsigned Size>
+class ModularBitmap {
+    // Size is a power of 2, and a whole number of words
+    static const unsigned Words = Size / 64;
+    uint64_t words[Words];
+
+ public:
+    ModularBitmap() {
+        for (unsigned i = 0; i < Words; i++) {
+            words[i] = 0;
+        }
+    }
+    bool operator [](uint64_t idx) const {
+        idx &= Size - 1;
+        return (words[idx >> 6] >> (idx & 63)) & 1;
+    }
+    void set(uint64_t idx) { idx &= Size - 1; words[idx >> 6] |= (uint64_t)1 << (idx & 63); }
+    void clear(uint64_t idx) { idx &= Size - 1; words[idx >> 6] &= ~((uint64_t)1 << (idx & 63)); }
+    void clear() {
+        for (unsigned i = 0; i < Words; i++) {
+            words[i] = 0;
+        }
+    }
+
+    // the 64 bits from idx on, idx in bit 0
+    uint64_t window(uint64_t idx) const {
+        idx &= Size - 1;
+        unsigned w = idx >> 6, shift = idx & 63;
+        if (shift == 0)
+            return words[w];
+        return (words[w] >> shift) | (words[(w + 1) & (Words - 1)] << (64 - shift));
+    }
+
+    // clear the run of set bits from idx on, and return how long it was
+    unsigned consume(uint64_t idx) {
+        unsigned run = 0;
+        while (run < Size) {
+            uint64_t i = (idx + run) & (Size - 1);
+            unsigned w = i >> 6, shift = i & 63;
+            uint64_t ones = ~(words[w] >> shift);
+            unsigned n = ones ? __builtin_ctzll(ones) : 64 - shift;
+            if (n == 64)
+                words[w] = 0;
+            else
+                words[w] &= ~((((uint64_t)1 << n) - 1) << shift);
+            run += n;
+            if (shift + n < 64)
+                break; // the run ended inside this word
+        }
+        return run;
+    }
+
+    unsigned count() const {
+        unsigned total = 0;
+        for (unsigned i = 0; i < Words; i++) {
+            total += __builtin_popcountll(words[i]);
+        }
+        return total;
+    }
+};
+
 static const unsigned eqdsMaxInFlightPkts = 1 << 12;
 class EqdsPullPacer;
 class EqdsSink;
@@ -70,6 +135,7 @@ private:
 
 class EqdsSrc : public EventSource, public PacketSink, public TriggerTarget {
  public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     struct Stats {
         uint64_t sent;
         uint64_t timeouts;
@@ -97,6 +163,12 @@ class EqdsSrc : public EventSource, public PacketSink, public TriggerTarget {
     // called from a trigger to start the flow.
     virtual void activate();
 
+    // once a flow is done, forget it so the src can be connected
+    // again.  It keeps its NIC, loggers, end trigger and flow id.
+    void reset();
+    // waiting for the NIC to let it send
+    bool waitingForNIC() const {return _send_blocked_on_nic;}
+
     static uint32_t _path_entropy_size; // now many paths do we include in our path set
     static int _global_node_count;
     static simtime_picosec _min_rto;
@@ -126,11 +198,12 @@ class EqdsSrc : public EventSource, public PacketSink, public TriggerTarget {
  private:
     EqdsNIC& _nic;
     struct sendRecord {
-        // need a constructor to be able to put this in a map
-        sendRecord(mem_b psize, simtime_picosec stime) :
-            pkt_size(psize), send_time(stime) {};
-        mem_b pkt_size;
+        sendRecord() : pkt_size(0), send_time(0), older(0), newer(0), in_flight(false) {};
+        mem_b pkt_size; // 0 if we know nothing of this seqno
         simtime_picosec send_time;
+        // neighbours in the order sent, while in flight
+        EqdsDataPacket::seq_t older, newer;
+        bool in_flight; // else it's waiting in _rtx_queue
     };
     EqdsLogger* _logger;
     TrafficLogger* _pktlogger;
@@ -140,11 +213,16 @@ class EqdsSrc : public EventSource, public PacketSink, public TriggerTarget {
     // TODO in-flight packet storage - acks and sacks clear it
     //list<EqdsDataPacket*> _activePackets;
 
-    // we need to access the in_flight packet list quickly by sequence number, or by send time.
-    map <EqdsDataPacket::seq_t, sendRecord> _tx_bitmap;
-    map <simtime_picosec, EqdsDataPacket::seq_t> _send_times;
-    
-    map <EqdsDataPacket::seq_t, mem_b> _rtx_queue;
+    // we need to access the in_flight packet list quickly by sequence
+    // number, or by send time.  Records are indexed by seqno, from the
+    // cumulative ack up, and those in flight are also linked oldest
+    // first, which is send time order as we only ever append.
+    SeqRing<sendRecord> _tx_records;
+    EqdsDataPacket::seq_t _oldest_sent, _newest_sent;
+    uint32_t _in_flight_pkts; // linked in that list
+
+    SeqBitmap _rtx_queue; // by seqno; the sizes are in _tx_records
+    mem_b rtxPktSize() const {return _tx_records.get(_rtx_queue.first()).pkt_size;}
     void startFlow();
     bool isSpeculative();
     uint16_t nextEntropy();
@@ -154,6 +232,7 @@ class EqdsSrc : public EventSource, public PacketSink, public TriggerTarget {
     mem_b sendRtxPacket();
     void sendRTS();
     void createSendRecord(EqdsDataPacket::seq_t seqno, mem_b pkt_size);
+    void unlinkSendRecord(EqdsDataPacket::seq_t seqno);
     void queueForRtx(EqdsBasePacket::seq_t seqno, mem_b pkt_size);
     void recalculateRTO();
     void startRTO(simtime_picosec send_time);
@@ -236,6 +315,7 @@ class EqdsSrc : public EventSource, public PacketSink, public TriggerTarget {
 
 class EqdsSink : public PacketSink, public DataReceiver {
  public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     struct Stats {
         uint64_t received;
         uint64_t bytes_received;
@@ -268,8 +348,14 @@ class EqdsSink : public PacketSink, public DataReceiver {
     uint16_t unackedPackets();
     void setEndTrigger(Trigger& trigger);
 
+    // the same as EqdsSrc::reset(), keeping the pull pacer and NIC
+    void reset();
+    // still queued in the pull pacer, so it will send more pulls
+    bool pullsQueued();
+    // the flow is done: take it out of the pull pacer
+    void stopPulls();
+
     EqdsBasePacket::seq_t sackBitmapBase(EqdsBasePacket::seq_t epsn);
-    EqdsBasePacket::seq_t sackBitmapBaseIdeal();
     uint64_t buildSackBitmap(EqdsBasePacket::seq_t ref_epsn);
     EqdsAckPacket* sack(uint16_t path_id, EqdsBasePacket::seq_t seqno, bool ce);
 
@@ -328,7 +414,7 @@ private:
     uint16_t _accepted_bytes;
 
     Trigger* _end_trigger;
-    ModularVector<uint8_t, eqdsMaxInFlightPkts> _epsn_rx_bitmap; // list of packets above a hole, that we've received
+    ModularBitmap<eqdsMaxInFlightPkts> _epsn_rx_bitmap; // list of packets above a hole, that we've received
     
     uint32_t _out_of_order_count;
     bool _ack_request;
@@ -356,6 +442,8 @@ class EqdsPullPacer : public EventSource {
     bool isActive(EqdsSink *sink);
     bool isRetransmitting(EqdsSink *sink);
     bool isIdle(EqdsSink *sink);
+    // stop pulling for sink altogether, whatever it is queued for
+    void cancelPulls(EqdsSink *sink);
 };
 
 #endif // EQDS_H
@@ -128,16 +128,16 @@ protected:
 
     pull_quanta _pull_target;  // in a real implemention we'd handle wrapping, but here just never wrap
 
+    //trim information, need to see if this stays here or goes to separate header.
+    int32_t _trim_hop;
+    packet_direction _trim_direction : 8;
+
+    PacketType _packet_type : 8;
+
     bool _ar;
     bool _unordered;
     bool _syn;
     bool _fin;
-
-    PacketType _packet_type;
-
-    //trim information, need to see if this stays here or goes to separate header.
-    int32_t _trim_hop;
-    packet_direction _trim_direction;
     static PacketDB<EqdsDataPacket> _packetdb;
 };
 
@@ -0,0 +1,117 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <typeinfo>
+#include <cxxabi.h>
+#include "event_profiler.h"
+
+EventProfiler::EventProfiler()
+{
+    _start = cycles();
+}
+
+EventProfiler::~EventProfiler() {
+    for (size_t i = 0; i < _all.size(); i++)
+        delete _all[i];
+}
+
+EventProfiler::Record&
+EventProfiler::new_record(EventSource& src) {
+    Record* r = new Record();
+    int status;
+    char* type = abi::__cxa_demangle(typeid(src).name(), NULL, NULL, &status);
+    r->type = (status == 0) ? type : typeid(src).name();
+    free(type);
+    // instances of a component differ only by numbers in their names
+    const string& name = src.str();
+    for (size_t i = 0; i < name.size(); i++) {
+        if (isdigit(name[i])) {
+            if (r->group.empty() || r->group.back() != '*')
+                r->group += '*';
+        } else {
+            r->group += name[i];
+        }
+    }
+    r->events = r->cycles = r->scheduled = r->cancelled = 0;
+    r->max_depth = 0;
+    _records[&src] = r;
+    _all.push_back(r);
+    return *r;
+}
+
+void
+EventProfiler::summarise(ostream& out, ostream* csv, const char* kind, bool by_type) {
+    map<string, Record> rows;
+    uint64_t total = 0;
+    for (size_t i = 0; i < _all.size(); i++) {
+        const Record& r = *_all[i];
+        string key = by_type ? r.type : r.type + " " + r.group;
+        map<string, Record>::iterator row = rows.find(key);
+        if (row == rows.end()) {
+            rows[key] = r;
+        } else {
+            row->second.events += r.events;
+            row->second.cycles += r.cycles;
+            row->second.scheduled += r.scheduled;
+            row->second.cancelled += r.cancelled;
+            row->second.max_depth = max(row->second.max_depth, r.max_depth);
+        }
+        total += r.cycles;
+    }
+
+    vector<const Record*> ranked;
+    for (map<string, Record>::iterator i = rows.begin(); i != rows.end(); i++)
+        ranked.push_back(&i->second);
+    sort(ranked.begin(), ranked.end(),
+         [](const Record* a, const Record* b) {return a->cycles > b->cycles;});
+
+    ios_base::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << endl << "Event profile by " << kind << endl;
+    out << setw(12) << "cycles" << setw(7) << "%" << setw(12) << "events" << setw(10) << "cyc/ev"
+        << setw(12) << "scheduled" << setw(12) << "cancelled" << setw(10) << "maxdepth" << "  " << kind << endl;
+    for (size_t i = 0; i < ranked.size(); i++) {
+        const Record& r = *ranked[i];
+        string name = by_type ? r.type : r.group + " (" + r.type + ")";
+        out << setw(12) << r.cycles
+            << setw(7) << fixed << setprecision(2) << (total ? 100.0 * r.cycles / total : 0.0)
+            << setw(12) << r.events
+            << setw(10) << setprecision(0) << (r.events ? (double)r.cycles / r.events : 0.0)
+            << setw(12) << r.scheduled << setw(12) << r.cancelled << setw(10) << r.max_depth
+            << "  " << name << endl;
+        if (csv) {
+            *csv << kind << ",\"" << r.type << "\",\"" << (by_type ? "" : r.group) << "\","
+                 << r.events << "," << r.cycles << "," << r.scheduled << "," << r.cancelled << ","
+                 << r.max_depth << endl;
+        }
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void
+EventProfiler::report(ostream& out, const char* csvfile) {
+    uint64_t elapsed = cycles() - _start;
+    uint64_t events = 0, cycles_in_events = 0;
+    for (size_t i = 0; i < _all.size(); i++) {
+        events += _all[i]->events;
+        cycles_in_events += _all[i]->cycles;
+    }
+    out << "Event profile: " << events << " events, " << cycles_in_events << " of "
+        << elapsed << " cycles in doNextEvent" << endl;
+
+    std::ofstream csv;
+    if (csvfile) {
+        csv.open(csvfile);
+        if (!csv) {
+            cout << "Can't open for writing event profile " << csvfile << endl;
+            exit(1);
+        }
+        csv << "kind,type,group,events,cycles,scheduled,cancelled,max_depth" << endl;
+    }
+    summarise(out, csvfile ? &csv : NULL, "type", true);
+    summarise(out, csvfile ? &csv : NULL, "group", false);
+}
@@ -0,0 +1,91 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+/*
+ * Where does the simulator's time go?
+ *
+ * With an EventProfiler attached (EventList::setProfiler), every
+ * event dispatched is timed with the CPU cycle counter, and every
+ * event scheduled or cancelled is counted, against the EventSource
+ * concerned.  report() then adds the sources up two ways - by class,
+ * and by name with the numbers blanked out ("LS*->US*(*)" covers all
+ * the ToR uplink queues) - and prints each ranked by cycles spent in
+ * doNextEvent().  It can also write the same rows to a CSV file.
+ *
+ * Max depth is the largest number of events pending in the event list
+ * when one of the source's events was dispatched.
+ *
+ * Profiling costs a hash lookup and two cycle counter reads per event,
+ * so the simulation runs slower, but its results don't change.
+ */
+
+#include <unordered_map>
+#include <vector>
+#include <ostream>
+#include "config.h"
+#include "eventlist.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+class EventProfiler {
+public:
+    EventProfiler();
+    ~EventProfiler();
+
+    inline void dispatch(EventSource& src, size_t depth) {
+        Record& r = record(src);
+        r.events++;
+        if (depth > r.max_depth)
+            r.max_depth = depth;
+        uint64_t start = cycles();
+        src.doNextEvent();
+        r.cycles += cycles() - start;
+    }
+    void scheduled(EventSource& src) {record(src).scheduled++;}
+    void cancelled(EventSource& src) {record(src).cancelled++;}
+
+    // print the ranked tables; write them to csvfile too unless it's NULL
+    void report(ostream& out, const char* csvfile = NULL);
+
+private:
+    struct Record {
+        string type;
+        string group;
+        uint64_t events;
+        uint64_t cycles;
+        uint64_t scheduled;
+        uint64_t cancelled;
+        size_t max_depth;
+    };
+
+    static inline uint64_t cycles() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        // no cycle counter we know how to read: count nanoseconds instead
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+    inline Record& record(EventSource& src) {
+        unordered_map<const EventSource*, Record*>::iterator i = _records.find(&src);
+        if (i != _records.end())
+            return *i->second;
+        return new_record(src);
+    }
+    Record& new_record(EventSource& src);
+    void summarise(ostream& out, ostream* csv, const char* kind, bool by_type);
+
+    // names are taken the first time a source is seen, so a source
+    // deleted before the report still counts
+    unordered_map<const EventSource*, Record*> _records;
+    vector<Record*> _all;
+    uint64_t _start;
+};
+
+#endif
@@ -2,40 +2,53 @@
 
 #include "eventlist.h"
 #include "trigger.h"
+#include "event_profiler.h"
+#include "checkpoint.h"
+#include <typeinfo>
 
-simtime_picosec EventList::_endtime = 0;
-simtime_picosec EventList::_lasteventtime = 0;
-EventList::pendingsources_t EventList::_pendingsources;
-vector <TriggerTarget*> EventList::_pending_triggers;
-int EventList::_instanceCount = 0;
-EventList* EventList::_theEventList = nullptr;
+#ifdef EVENTQUEUE_MULTIMAP
+class EventQueue : public MultimapEventQueue {};
+#else
+class EventQueue : public CalendarEventQueue {};
+#endif
 
 EventList::EventList()
+    : _context(SimContext::current()), _running(NULL), _endtime(0), _lasteventtime(0),
+      _pendingsources(new EventQueue()), _observer(NULL), _profiler(NULL),
+      _batch_dispatch(false), _batch_next(0), _events(0), _batched_events(0),
+      _batches(0), _largest_batch(0)
 {
-    if (EventList::_instanceCount != 0) 
+    if (_context._eventlist != nullptr) 
     {
-        std::cerr << "There should be only one instance of EventList. Abort." << std::endl;
+        std::cerr << "There should be only one instance of EventList per simulation. Abort." << std::endl;
         abort();
     }
 
-    EventList::_theEventList = this;
-    EventList::_instanceCount += 1;
+    _context._eventlist = this;
+}
+
+EventList::~EventList()
+{
+    if (_context._eventlist == this)
+        _context._eventlist = nullptr;
+    delete _pendingsources;
 }
 
 EventList& 
 EventList::getTheEventList()
 {
-    if (EventList::_theEventList == nullptr) 
+    SimContext& ctx = SimContext::current();
+    if (ctx.eventlist() == nullptr) 
     {
-        EventList::_theEventList = new EventList();
+        new EventList();
     }
-    return *EventList::_theEventList;
+    return *ctx.eventlist();
 }
 
 void
 EventList::setEndtime(simtime_picosec endtime)
 {
-    EventList::_endtime = endtime;
+    _endtime = endtime;
 }
 
 bool
@@ -50,36 +63,218 @@ EventList::doNextEvent()
         return true;
     }
     
-    if (_pendingsources.empty())
+    EventSource* nextsource;
+    if (_batch_dispatch) {
+        nextsource = nextBatched();
+        if (!nextsource)
+            return false;
+    } else {
+        if (_pendingsources->empty())
+            return false;
+
+        simtime_picosec nexteventtime;
+        nextsource = _pendingsources->pop(nexteventtime);
+        assert(nexteventtime >= _lasteventtime);
+        _lasteventtime = nexteventtime; // set this before calling doNextEvent, so that this::now() is accurate
+    }
+    if (_observer)
+        _observer->eventDispatched(*nextsource, _lasteventtime);
+    _running = nextsource;
+    _context.set_random_source(nextsource);
+    if (_profiler)
+        _profiler->dispatch(*nextsource, _pendingsources->size());
+    else
+        nextsource->doNextEvent();
+    _context.set_random_source(NULL);
+    _running = NULL;
+    return true;
+}
+
+
+bool
+EventList::doNextEventBefore(simtime_picosec limit) {
+    simtime_picosec when;
+    if (!nextEventTime(when) || when >= limit)
         return false;
-    
-    simtime_picosec nexteventtime = _pendingsources.begin()->first;
-    EventSource* nextsource = _pendingsources.begin()->second;
-    _pendingsources.erase(_pendingsources.begin());
-    assert(nexteventtime >= _lasteventtime);
-    _lasteventtime = nexteventtime; // set this before calling doNextEvent, so that this::now() is accurate
-    nextsource->doNextEvent();
+    return doNextEvent();
+}
+
+bool
+EventList::nextEventTime(simtime_picosec& when) {
+    while (_batch_next < _batch.size() && !_batch[_batch_next].src)
+        _batch_next++; // cancelled
+    if (!_pending_triggers.empty() || _batch_next < _batch.size()) {
+        // triggers and the rest of the current batch run now
+        when = now();
+        return true;
+    }
+    if (_pendingsources->empty())
+        return false;
+    when = _pendingsources->next_time();
     return true;
 }
 
+// Batch dispatch.  When many flows start or pace in lock-step, long
+// runs of events fall due at exactly the same time.  In batch mode the
+// whole run is taken from the queue at once and reordered so that all
+// the events of one class of source run together - all the pipes, then
+// all the queues, say - which keeps each class's code and data in
+// cache.  Classes go in the order their first event was scheduled, and
+// each class's events stay in the order they were scheduled, so the
+// order is still deterministic, but it isn't FIFO, and the results
+// differ from an unbatched run.
+//
+// Events scheduled for now while a batch runs go in the queue, and form
+// the next batch.  An event cancelled after its batch was formed is
+// marked dead in the batch and skipped.
+EventSource*
+EventList::nextBatched() {
+    while (_batch_next < _batch.size()) {
+        EventSource* src = _batch[_batch_next++].src;
+        if (src) {
+            _events++;
+            return src;
+        }
+    }
+    if (_pendingsources->empty())
+        return NULL;
+
+    _batch.clear();
+    _batch_next = 0;
+    BatchEntry e;
+    simtime_picosec when;
+    e.src = _pendingsources->pop(when, e.seq);
+    assert(when >= _lasteventtime);
+    _lasteventtime = when;
+    do {
+        _batch.push_back(e);
+        e.src = _pendingsources->pop_at(when, e.seq);
+    } while (e.src);
+    if (_batch.size() > 1) {
+        groupBatch();
+        _batched_events += _batch.size();
+        _batches++;
+        if (_batch.size() > _largest_batch)
+            _largest_batch = _batch.size();
+    }
+    _events++;
+    return _batch[_batch_next++].src;
+}
+
+void
+EventList::groupBatch() {
+    // a stable counting sort on the class of the source, classes
+    // numbered in order of appearance; there are only ever a few
+    vector<const type_info*> types;
+    vector<uint32_t>& group = _batch_group;
+    group.resize(_batch.size());
+    vector<size_t> count;
+    for (size_t i = 0; i < _batch.size(); i++) {
+        const type_info* t = &typeid(*_batch[i].src);
+        uint32_t g = 0;
+        while (g < types.size() && *types[g] != *t)
+            g++;
+        if (g == types.size()) {
+            types.push_back(t);
+            count.push_back(0);
+        }
+        group[i] = g;
+        count[g]++;
+    }
+    if (types.size() == 1)
+        return;
+    vector<size_t> start(types.size(), 0);
+    for (size_t g = 1; g < types.size(); g++)
+        start[g] = start[g-1] + count[g-1];
+    _batch_sorted.resize(_batch.size());
+    for (size_t i = 0; i < _batch.size(); i++)
+        _batch_sorted[start[group[i]]++] = _batch[i];
+    _batch.swap(_batch_sorted);
+}
+
+bool
+EventList::cancelBatched(EventSource& src, uint64_t seq) {
+    // seq 0 cancels src's first event in the batch
+    for (size_t i = _batch_next; i < _batch.size(); i++) {
+        if (_batch[i].src == &src && (seq == 0 || _batch[i].seq == seq)) {
+            _batch[i].src = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+EventList::eraseHandle(EventSource& src, const Handle& handle) {
+    if (_pendingsources->erase(handle))
+        return true;
+    // it may be in the batch being run
+    return _batch_next < _batch.size() && handle.when == _lasteventtime
+        && handle.seq != 0 && cancelBatched(src, handle.seq);
+}
+
+void
+EventList::reportBatching(ostream& out) const {
+    out << "Batch dispatch: " << _batched_events << " of " << _events << " events ("
+        << (_events ? 100.0 * _batched_events / _events : 0.0) << "%) ran in "
+        << _batches << " batches, the largest " << _largest_batch << " events" << endl;
+}
 
 void 
 EventList::sourceIsPending(EventSource &src, simtime_picosec when) 
 {
     assert(when>=now());
-    if (_endtime==0 || when<_endtime)
-        _pendingsources.insert(make_pair(when,&src));
+    assert(&src.eventlist() == this); // the queue keeps src's events in src
+    if (_endtime==0 || when<_endtime) {
+        _pendingsources->push(when, &src);
+        if (_profiler)
+            _profiler->scheduled(src);
+    }
 }
 
 EventList::Handle
 EventList::sourceIsPendingGetHandle(EventSource &src, simtime_picosec when) 
 {
     assert(when>=now());
+    assert(&src.eventlist() == this);
     if (_endtime==0 || when<_endtime) {
-        EventList::Handle handle =_pendingsources.insert(make_pair(when,&src));
+        EventList::Handle handle = _pendingsources->push(when, &src);
+        if (_profiler)
+            _profiler->scheduled(src);
         return handle;
     }
-    return _pendingsources.end();
+    return nullHandle();
+}
+
+void
+EventList::checkpoint(CheckpointArchive& archive) {
+    if (_running || !_pending_triggers.empty() || _batch_next < _batch.size())
+        archive.fail("the event list can only be checkpointed between events");
+    archive.check(_endtime, "end time");
+    archive.io(_lasteventtime);
+
+    vector<QueuedEvent> events;
+    if (archive.saving())
+        _pendingsources->events(events);
+    uint64_t count = events.size();
+    archive.io(count);
+    if (archive.restoring()) {
+        simtime_picosec when;
+        while (!_pendingsources->empty())
+            _pendingsources->pop(when);
+        events.resize(count);
+    }
+    for (size_t i = 0; i < count; i++) {
+        QueuedEvent& e = events[i];
+        archive.io(e.when);
+        archive.io(e.seq);
+        archive.ref(e.src);
+        if (archive.restoring()) {
+            // new sequence numbers, but in the same order: a source's
+            // order() is the same, and its events are pushed in turn
+            archive.requeued(e.seq, _pendingsources->push(e.when, e.src));
+        }
+    }
 }
 
 void
@@ -89,14 +284,11 @@ EventList::triggerIsPending(TriggerTarget &target) {
 
 void 
 EventList::cancelPendingSource(EventSource &src) {
-    pendingsources_t::iterator i = _pendingsources.begin();
-    while (i != _pendingsources.end()) {
-        if (i->second == &src) {
-            _pendingsources.erase(i);
-            return;
-        }
-        i++;
-    }
+    // anything left in the batch is due before whatever is queued
+    bool cancelled = (_batch_next < _batch.size() && cancelBatched(src, 0))
+        || _pendingsources->erase_source(&src);
+    if (cancelled && _profiler)
+        _profiler->cancelled(src);
 }
 
 void 
@@ -104,27 +296,24 @@ EventList::cancelPendingSourceByTime(EventSource &src, simtime_picosec when) {
     // fast cancellation of a timer - the timer MUST exist
     // this should normally be fast, except if we have a lot of events with exactly the same time value
 
-    auto range = _pendingsources.equal_range(when);
-
-    for (auto i = range.first; i != range.second; ++i) {
-        if (i->second == &src) {
-            _pendingsources.erase(i);
-            return;
-        }
-    }
-    abort();
+    if (!(_batch_next < _batch.size() && when == _lasteventtime && cancelBatched(src, 0))
+        && !_pendingsources->erase_source_at(&src, when))
+        abort();
+    if (_profiler)
+        _profiler->cancelled(src);
 }
 
 
-void EventList::cancelPendingSourceByHandle(EventSource &src, EventList::Handle handle) {
-    // If we're cancelling timers often, cancel them by handle.  But
-    // be careful - cancelling a handle that has already been
-    // cancelled or has already expired is undefined behaviour
-    assert(handle->second == &src);
-    assert(handle != _pendingsources.end());
-    assert(handle->first >= now());
-    
-    _pendingsources.erase(handle);
+bool
+EventList::cancelPendingSourceByHandle(EventSource &src, EventList::Handle handle) {
+    // If we're cancelling timers often, cancel them by handle.  Stale
+    // handles are harmless: the queue checks the event's sequence
+    // number, so it won't cancel whatever has reused the slot.
+    if (!eraseHandle(src, handle))
+        return false;
+    if (_profiler)
+        _profiler->cancelled(src);
+    return true;
 }
 
 void 
@@ -133,6 +322,47 @@ EventList::reschedulePendingSource(EventSource &src, simtime_picosec when) {
     sourceIsPending(src, when);
 }
 
+EventList::Handle
+EventList::reschedulePendingSourceByHandle(EventSource &src, EventList::Handle handle, simtime_picosec when) {
+    if (eraseHandle(src, handle) && _profiler)
+        _profiler->cancelled(src);
+    return sourceIsPendingGetHandle(src, when);
+}
+
+EventSource::EventSource(EventList& eventlist, const string& name)
+    : Logged(name), _eventlist(eventlist), _order(get_id() + 1), _random_epoch(0), _random_state(0)
+{
+    // order 1 is for the sources that run first
+    assert(get_id() > 0 && _order > get_id());
+}
+
 EventSource::EventSource(const string& name) : EventSource(EventList::getTheEventList(), name) 
 {
 }
+
+static inline uint64_t
+mix64(uint64_t z) {
+    // splitmix64's finaliser
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void
+EventSource::checkpoint_random(CheckpointArchive& archive) {
+    archive.check(_order, "event order");
+    archive.io(_random_epoch);
+    archive.io(_random_state);
+}
+
+uint32_t
+EventSource::random() {
+    SimContext& ctx = _eventlist.context();
+    if (_random_epoch != ctx.random_epoch()) {
+        _random_epoch = ctx.random_epoch();
+        _random_state = mix64(ctx.random_seed() ^ mix64(get_id()));
+    }
+    // splitmix64: a Weyl sequence through the finaliser
+    _random_state += 0x9e3779b97f4a7c15ULL;
+    return mix64(_random_state) >> 32;
+}
@@ -2,59 +2,140 @@
 #ifndef EVENTLIST_H
 #define EVENTLIST_H
 
-#include <map>
 #include <sys/time.h>
 #include "config.h"
 #include "loggertypes.h"
+#include "eventqueue.h"
+#include "simcontext.h"
 
 class EventList;
 class TriggerTarget;
+class EventProfiler;
 
 class EventSource : public Logged {
 public:
-    EventSource(EventList& eventlist, const string& name) : Logged(name), _eventlist(eventlist) {};
+    EventSource(EventList& eventlist, const string& name);
     EventSource(const string& name);
     virtual ~EventSource() {};
     virtual void doNextEvent() = 0;
     inline EventList& eventlist() const {return _eventlist;}
+    // Where our events go among everyone's due at the same time; see
+    // eventqueue.h.  Our ID plus one, unless we run first.
+    inline uint32_t order() const {return _order;}
+    // The next number from our own random stream, seeded from the
+    // context's seed and our ID the first time we draw, and again
+    // whenever srand() is called.  rand() uses this during our events.
+    uint32_t random();
 protected:
+    // save or restore our random stream, for subclasses' checkpoint()
+    void checkpoint_random(CheckpointArchive& archive);
+    // put our events ahead of every other source's due at the same
+    // time; for the timer wheels, which stand in for their clients
+    void runFirst() {_order = 1;}
     EventList& _eventlist;
+private:
+    friend class CalendarEventQueue;
+    SourceEvents _queued; // our events in _eventlist's queue
+    uint32_t _order;
+    uint32_t _random_epoch; // the context's epoch _random_state was seeded in
+    uint64_t _random_state;
+};
+
+// Sees every event EventList dispatches, just before it runs; see
+// EventList::setObserver.
+class EventObserver {
+public:
+    virtual ~EventObserver() {}
+    virtual void eventDispatched(EventSource& src, simtime_picosec when) = 0;
 };
 
+// One per simulation: each EventList belongs to the SimContext that
+// was current when it was created, and there can only be one in each.
 class EventList {
 public:
-    typedef multimap <simtime_picosec, EventSource*>::iterator Handle;
+    typedef EventHandle Handle;
     EventList();
-    static void setEndtime(simtime_picosec endtime); // end simulation at endtime (rather than forever)
-    static bool doNextEvent(); // returns true if it did anything, false if there's nothing to do
-    static void sourceIsPending(EventSource &src, simtime_picosec when);
-    static Handle sourceIsPendingGetHandle(EventSource &src, simtime_picosec when);
-    static void sourceIsPendingRel(EventSource &src, simtime_picosec timefromnow)
-    { sourceIsPending(src, EventList::now()+timefromnow); }
-    static void cancelPendingSource(EventSource &src);
+    ~EventList();
+    void setEndtime(simtime_picosec endtime); // end simulation at endtime (rather than forever)
+    bool doNextEvent(); // returns true if it did anything, false if there's nothing to do
+    // do the next event only if it's due before limit
+    bool doNextEventBefore(simtime_picosec limit);
+    // when the next event is due; false if there's nothing to do
+    bool nextEventTime(simtime_picosec& when);
+    void sourceIsPending(EventSource &src, simtime_picosec when);
+    Handle sourceIsPendingGetHandle(EventSource &src, simtime_picosec when);
+    void sourceIsPendingRel(EventSource &src, simtime_picosec timefromnow)
+    { sourceIsPending(src, now()+timefromnow); }
+    // cancel src's earliest pending event; O(1) with the calendar
+    // queue, O(log n) with the multimap
+    void cancelPendingSource(EventSource &src);
     // optimized cancel, if we know the expiry time
-    static void cancelPendingSourceByTime(EventSource &src, simtime_picosec when);   
-    // optimized cancel by handle - be careful to ensure handle is still valid
-    static void cancelPendingSourceByHandle(EventSource &src, Handle handle);       
-    static void reschedulePendingSource(EventSource &src, simtime_picosec when);
-    static void triggerIsPending(TriggerTarget &target);
-    static inline simtime_picosec now() {return EventList::_lasteventtime;}
-    static Handle nullHandle() {return _pendingsources.end();}
-
+    void cancelPendingSourceByTime(EventSource &src, simtime_picosec when);   
+    // O(1) cancel by handle.  Safe with a handle whose event has
+    // already fired or been cancelled: returns false and does nothing.
+    // This cancels the event the handle names, which is src's earliest
+    // only if it has just the one pending, as the pacers do.
+    bool cancelPendingSourceByHandle(EventSource &src, Handle handle);       
+    void reschedulePendingSource(EventSource &src, simtime_picosec when);
+    // cancel the event handle refers to, if still pending, and schedule
+    // src for when instead, returning the new handle
+    Handle reschedulePendingSourceByHandle(EventSource &src, Handle handle, simtime_picosec when);
+    void triggerIsPending(TriggerTarget &target);
+    inline simtime_picosec now() const {return _lasteventtime;}
+    // the source whose event is running, if any
+    EventSource* running() const {return _running;}
+    static Handle nullHandle() {return Handle{0, 0, 0};}
+    // at most one observer; NULL to remove it
+    void setObserver(EventObserver* observer) {_observer = observer;}
+    // time every event and count schedules and cancels; see event_profiler.h
+    void setProfiler(EventProfiler* profiler) {_profiler = profiler;}
+    // Take all the events due at the same time out of the queue at once
+    // and run them grouped by the class of their source, rather than in
+    // the order they were scheduled.  Off by default.  See doNextEvent().
+    void setBatchDispatch(bool batch) {_batch_dispatch = batch;}
+    // how much of the run batch dispatch grouped
+    void reportBatching(ostream& out) const;
+    SimContext& context() const {return _context;}
+    // Save or restore the time and the pending events.  A restore
+    // replaces whatever was pending with the saved events, in the
+    // same order; handles to them are restored with the archive's
+    // handle().  Only between events, with no batch under way.
+    void checkpoint(CheckpointArchive& archive);
 
+    // the current context's EventList, created if need be
     static EventList& getTheEventList();
     EventList(const EventList&)      = delete;  // disable Copy Constructor
     void operator=(const EventList&) = delete;  // disable Assign Constructor
 
 private:
-    static simtime_picosec _endtime;
-    static simtime_picosec _lasteventtime;
-    typedef multimap <simtime_picosec, EventSource*> pendingsources_t;
-    static pendingsources_t _pendingsources;
-    static vector <TriggerTarget*> _pending_triggers;
-
-    static int _instanceCount;
-    static EventList* _theEventList;
+    struct BatchEntry {
+        EventSource* src; // NULL once cancelled
+        uint64_t seq;
+    };
+    EventSource* nextBatched();
+    void groupBatch();
+    bool cancelBatched(EventSource& src, uint64_t seq);
+    bool eraseHandle(EventSource& src, const Handle& handle);
+
+    SimContext& _context;
+    EventSource* _running;
+    simtime_picosec _endtime;
+    simtime_picosec _lasteventtime;
+    // the priority queue backend is chosen at build time; see eventqueue.h
+    EventQueue* _pendingsources;
+    vector <TriggerTarget*> _pending_triggers;
+    EventObserver* _observer;
+    EventProfiler* _profiler;
+
+    bool _batch_dispatch;
+    vector<BatchEntry> _batch; // all due at _lasteventtime
+    size_t _batch_next;        // the next entry of _batch to run
+    vector<BatchEntry> _batch_sorted; // scratch space for groupBatch
+    vector<uint32_t> _batch_group;
+    uint64_t _events;          // these count only while batching
+    uint64_t _batched_events;  // events run in batches of two or more
+    uint64_t _batches;
+    size_t _largest_batch;
 };
 
 #endif
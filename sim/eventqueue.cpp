@@ -0,0 +1,411 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+
+#include <algorithm>
+#include "eventqueue.h"
+#include "eventlist.h"
+
+uint64_t
+eventqueue_seq(const EventSource* src, uint32_t pushes) {
+    return ((uint64_t)src->order() << 32) | pushes;
+}
+
+CalendarEventQueue::CalendarEventQueue()
+{
+    _free = NIL;
+    _shift = INITIAL_SHIFT;
+    _cur = 0;
+    _size = 0;
+    _dead = 0;
+    _pushes = 0;
+    _slow_ops = 0;
+    _buckets.assign(MIN_BUCKETS, Bucket{NIL, NIL});
+    _mask = MIN_BUCKETS - 1;
+}
+
+uint32_t
+CalendarEventQueue::alloc_node() {
+    if (_free == NIL) {
+        assert(_nodes.size() < NIL);
+        _nodes.push_back(Node());
+        return _nodes.size() - 1;
+    }
+    uint32_t n = _free;
+    _free = _nodes[n].next;
+    return n;
+}
+
+void
+CalendarEventQueue::link(uint32_t n) {
+    // insert n into its bucket's list, which is kept sorted by (time, seq)
+    Node& node = _nodes[n];
+    Bucket& b = bucket_of(node);
+    if (b.tail == NIL) {
+        node.prev = node.next = NIL;
+        b.head = b.tail = n;
+        return;
+    }
+    if (!before(node, _nodes[b.tail])) {
+        // the common case: later than everything already in the bucket
+        node.prev = b.tail;
+        node.next = NIL;
+        _nodes[b.tail].next = n;
+        b.tail = n;
+        return;
+    }
+    // walk from the head - far-future events collect at the tail
+    uint32_t m = b.head;
+    int walked = 0;
+    while (!before(node, _nodes[m])) {
+        m = _nodes[m].next;
+        walked++;
+    }
+    if (walked > 16)
+        _slow_ops++;
+    node.next = m;
+    node.prev = _nodes[m].prev;
+    if (node.prev == NIL)
+        b.head = n;
+    else
+        _nodes[node.prev].next = n;
+    _nodes[m].prev = n;
+}
+
+void
+CalendarEventQueue::unlink(uint32_t n) {
+    Node& node = _nodes[n];
+    Bucket& b = bucket_of(node);
+    if (node.prev == NIL)
+        b.head = node.next;
+    else
+        _nodes[node.prev].next = node.next;
+    if (node.next == NIL)
+        b.tail = node.prev;
+    else
+        _nodes[node.next].prev = node.prev;
+}
+
+void
+CalendarEventQueue::link_source(uint32_t n) {
+    // A source's events nearly always go in in time order, so this is
+    // an append; a source that schedules backwards walks its own list.
+    Node& node = _nodes[n];
+    SourceEvents& q = node.src->_queued;
+    uint32_t m = q.last;
+    while (m != NIL && before(node, _nodes[m]))
+        m = _nodes[m].src_prev;
+    // n goes after m
+    node.src_prev = m;
+    if (m == NIL) {
+        node.src_next = q.first;
+        q.first = n;
+    } else {
+        node.src_next = _nodes[m].src_next;
+        _nodes[m].src_next = n;
+    }
+    if (node.src_next == NIL)
+        q.last = n;
+    else
+        _nodes[node.src_next].src_prev = n;
+}
+
+void
+CalendarEventQueue::unlink_source(uint32_t n) {
+    Node& node = _nodes[n];
+    SourceEvents& q = node.src->_queued;
+    if (node.src_prev == NIL)
+        q.first = node.src_next;
+    else
+        _nodes[node.src_prev].src_next = node.src_next;
+    if (node.src_next == NIL)
+        q.last = node.src_prev;
+    else
+        _nodes[node.src_next].src_prev = node.src_prev;
+}
+
+void
+CalendarEventQueue::release(uint32_t n) {
+    // the node keeps its seq, so stale handles to it still don't match
+    _nodes[n].src = NULL;
+    _nodes[n].next = _free;
+    _free = n;
+}
+
+void
+CalendarEventQueue::remove(uint32_t n) {
+    unlink(n);
+    if (_nodes[n].src) {
+        unlink_source(n);
+        _size--;
+    } else {
+        _dead--;
+    }
+    release(n);
+    if (_buckets.size() > MIN_BUCKETS && _size < _buckets.size() / 2)
+        resize(_buckets.size() / 2);
+}
+
+EventHandle
+CalendarEventQueue::push(simtime_picosec when, EventSource* src) {
+    uint32_t n = alloc_node();
+    Node& node = _nodes[n];
+    node.when = when;
+    node.seq = eventqueue_seq(src, _pushes++);
+    node.src = src;
+    if ((when >> _shift) < _cur)
+        _cur = when >> _shift;
+    link(n);
+    link_source(n);
+    _size++;
+
+    EventHandle handle = {when, node.seq, n};
+    if (_size > 2 * _buckets.size()) {
+        resize(_buckets.size() * 2);
+    } else if (_slow_ops > 16 + _size / 2) {
+        // the bucket width no longer suits the event spacing
+        resize(_buckets.size());
+    }
+    return handle;
+}
+
+uint32_t
+CalendarEventQueue::find_min() {
+    // Scan forward one "year" from the current bucket.  Nothing is
+    // pending before bucket _cur, so the first bucket whose head falls
+    // within the bucket's current slice of time holds the minimum.
+    size_t nb = _buckets.size();
+    uint64_t vb = _cur;
+    for (size_t i = 0; i < nb; i++, vb++) {
+        uint32_t n = _buckets[vb & _mask].head;
+        if (n != NIL && (_nodes[n].when >> _shift) <= vb) {
+            _cur = vb;
+            return n;
+        }
+    }
+
+    // Everything is more than a year away: search the bucket heads directly.
+    _slow_ops++;
+    uint32_t best = NIL;
+    for (size_t b = 0; b < nb; b++) {
+        uint32_t n = _buckets[b].head;
+        if (n != NIL && (best == NIL || before(_nodes[n], _nodes[best])))
+            best = n;
+    }
+    assert(best != NIL);
+    _cur = _nodes[best].when >> _shift;
+    return best;
+}
+
+uint32_t
+CalendarEventQueue::first_live() {
+    assert(_size > 0);
+    uint32_t n = find_min();
+    while (_nodes[n].src == NULL) {
+        // a cancelled event: drop the tombstone and look again
+        remove(n);
+        n = find_min();
+    }
+    return n;
+}
+
+EventSource*
+CalendarEventQueue::pop(simtime_picosec& when, uint64_t& seq) {
+    uint32_t n = first_live();
+    when = _nodes[n].when;
+    seq = _nodes[n].seq;
+    EventSource* src = _nodes[n].src;
+    remove(n);
+    return src;
+}
+
+EventSource*
+CalendarEventQueue::pop_at(simtime_picosec when, uint64_t& seq) {
+    if (_size == 0)
+        return NULL;
+    uint32_t n = first_live();
+    if (_nodes[n].when != when)
+        return NULL;
+    seq = _nodes[n].seq;
+    EventSource* src = _nodes[n].src;
+    remove(n);
+    return src;
+}
+
+bool
+CalendarEventQueue::erase(const EventHandle& handle) {
+    if (handle.seq == 0 || handle.slot >= _nodes.size())
+        return false;
+    Node& node = _nodes[handle.slot];
+    if (node.seq != handle.seq || node.src == NULL)
+        return false; // already fired or cancelled
+    unlink_source(handle.slot);
+    node.src = NULL;
+    _size--;
+    _dead++;
+    if (_dead > 2 * _size + MIN_BUCKETS) {
+        // mostly tombstones: sweep them out rather than let them pile up
+        resize(_buckets.size());
+    }
+    return true;
+}
+
+bool
+CalendarEventQueue::erase_source(EventSource* src) {
+    uint32_t n = src->_queued.first;
+    if (n == NIL)
+        return false;
+    remove(n);
+    return true;
+}
+
+bool
+CalendarEventQueue::erase_source_at(EventSource* src, simtime_picosec when) {
+    for (uint32_t n = src->_queued.first; n != NIL && _nodes[n].when <= when; n = _nodes[n].src_next) {
+        if (_nodes[n].when == when) {
+            remove(n);
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+CalendarEventQueue::events(vector<QueuedEvent>& out) const {
+    out.clear();
+    out.reserve(_size);
+    for (size_t b = 0; b < _buckets.size(); b++) {
+        for (uint32_t n = _buckets[b].head; n != NIL; n = _nodes[n].next) {
+            const Node& node = _nodes[n];
+            if (node.src)
+                out.push_back(QueuedEvent{node.when, node.seq, node.src});
+        }
+    }
+    sort(out.begin(), out.end(), [](const QueuedEvent& a, const QueuedEvent& b) {
+        return a.when < b.when || (a.when == b.when && a.seq < b.seq);
+    });
+}
+
+void
+CalendarEventQueue::resize(size_t nbuckets) {
+    vector<uint32_t> pending;
+    pending.reserve(_size);
+    for (size_t b = 0; b < _buckets.size(); b++) {
+        uint32_t n = _buckets[b].head;
+        while (n != NIL) {
+            uint32_t next = _nodes[n].next;
+            if (_nodes[n].src)
+                pending.push_back(n);
+            else
+                release(n);
+            n = next;
+        }
+    }
+    _dead = 0;
+    sort(pending.begin(), pending.end(),
+         [this](uint32_t a, uint32_t b) {return before(_nodes[a], _nodes[b]);});
+
+    // Pick the bucket width as about three times the average spacing
+    // of the events at the head of the queue, ignoring outliers (Brown's
+    // heuristic).  Events at identical times share a bucket whatever
+    // the width, so only distinct times count.
+    size_t samples = min(pending.size(), (size_t)25);
+    simtime_picosec total = 0;
+    int gaps = 0;
+    for (size_t i = 1; i < samples; i++) {
+        simtime_picosec gap = _nodes[pending[i]].when - _nodes[pending[i-1]].when;
+        if (gap > 0) {
+            total += gap;
+            gaps++;
+        }
+    }
+    if (gaps > 0) {
+        simtime_picosec avg = total / gaps;
+        simtime_picosec trimmed = 0;
+        int kept = 0;
+        for (size_t i = 1; i < samples; i++) {
+            simtime_picosec gap = _nodes[pending[i]].when - _nodes[pending[i-1]].when;
+            if (gap > 0 && gap <= 2 * avg) {
+                trimmed += gap;
+                kept++;
+            }
+        }
+        simtime_picosec width = 3 * (kept > 0 ? trimmed / kept : avg);
+        _shift = 0;
+        while (_shift < 48 && ((simtime_picosec)1 << _shift) < width)
+            _shift++;
+    }
+
+    _buckets.assign(nbuckets, Bucket{NIL, NIL});
+    _mask = nbuckets - 1;
+    for (size_t i = 0; i < pending.size(); i++) {
+        // already in order, so this always appends
+        link(pending[i]);
+    }
+    if (!pending.empty())
+        _cur = _nodes[pending[0]].when >> _shift;
+    _slow_ops = 0;
+}
+
+EventHandle
+MultimapEventQueue::push(simtime_picosec when, EventSource* src) {
+    uint64_t seq = eventqueue_seq(src, _pushes++);
+    EventHandle handle = {when, seq, 0};
+    bool inserted = _pending.insert(make_pair(make_pair(when, seq), src)).second;
+    assert(inserted);
+    _by_source.insert(make_pair(src, make_pair(when, seq)));
+    return handle;
+}
+
+EventSource*
+MultimapEventQueue::pop(simtime_picosec& when, uint64_t& seq) {
+    pendingsources_t::iterator i = _pending.begin();
+    when = i->first.first;
+    seq = i->first.second;
+    EventSource* src = i->second;
+    _by_source.erase(make_pair(src, make_pair(when, seq)));
+    _pending.erase(i);
+    return src;
+}
+
+EventSource*
+MultimapEventQueue::pop_at(simtime_picosec when, uint64_t& seq) {
+    if (_pending.empty() || _pending.begin()->first.first != when)
+        return NULL;
+    return pop(when, seq);
+}
+
+bool
+MultimapEventQueue::erase(const EventHandle& handle) {
+    pendingsources_t::iterator i = _pending.find(make_pair(handle.when, handle.seq));
+    if (i == _pending.end())
+        return false;
+    _by_source.erase(make_pair(i->second, make_pair(handle.when, handle.seq)));
+    _pending.erase(i);
+    return true;
+}
+
+bool
+MultimapEventQueue::erase_source(EventSource* src) {
+    set<sourceevent_t>::iterator i = _by_source.lower_bound(make_pair(src, make_pair((simtime_picosec)0, (uint64_t)0)));
+    if (i == _by_source.end() || i->first != src)
+        return false;
+    _pending.erase(i->second);
+    _by_source.erase(i);
+    return true;
+}
+
+bool
+MultimapEventQueue::erase_source_at(EventSource* src, simtime_picosec when) {
+    set<sourceevent_t>::iterator i = _by_source.lower_bound(make_pair(src, make_pair(when, (uint64_t)0)));
+    if (i == _by_source.end() || i->first != src || i->second.first != when)
+        return false;
+    _pending.erase(i->second);
+    _by_source.erase(i);
+    return true;
+}
+
+void
+MultimapEventQueue::events(vector<QueuedEvent>& out) const {
+    out.clear();
+    for (pendingsources_t::const_iterator i = _pending.begin(); i != _pending.end(); i++)
+        out.push_back(QueuedEvent{i->first.first, i->first.second, i->second});
+}
@@ -0,0 +1,174 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef EVENTQUEUE_H
+#define EVENTQUEUE_H
+
+/*
+ * Priority queue backends holding EventList's pending sources.
+ *
+ * Events are ordered by (time, sequence number).  The top half of the
+ * sequence number is the source's order() - its ID, unless it runs
+ * first - and the bottom half a count of the events pushed, so events
+ * due at the same time fire in order of source, and a source's own in
+ * the order they were scheduled.  (Two events of one source at the
+ * same time do exactly the same thing, so if the count wraps and puts
+ * them the other way round, nothing changes.)  Source IDs don't depend
+ * on how the network is divided up, so when a network is split across
+ * several event lists (see pdes.h), each runs its events in the order
+ * the one list would have.  Both backends order events the same way,
+ * so results stay bit-identical whichever is used.
+ *
+ * CalendarEventQueue is the default.  It is a calendar queue (Brown,
+ * CACM 1988): a circular array of buckets, each covering a
+ * power-of-two slice of time and holding a sorted list.  The number
+ * of buckets and their width are recalibrated as the queue grows and
+ * shrinks, so insert and remove are O(1) on average and nodes are
+ * recycled rather than heap allocated per event.
+ *
+ * Cancelling by handle is O(1): the handle names the node and the
+ * sequence number of the event in it, so a handle whose event has
+ * fired or been cancelled (and whose node may since have been reused)
+ * simply no longer matches.  The node is left in its bucket as a
+ * tombstone and unlinked when the dequeue scan reaches it, or when
+ * the queue is next recalibrated.
+ *
+ * Cancelling a source's earliest event without a handle is O(1) too:
+ * each source's live events are also linked into a list of their own,
+ * in (time, sequence number) order, whose ends are kept in the source.
+ *
+ * MultimapEventQueue is the original red-black tree, kept so the
+ * calendar queue can be A/B validated.  Build libhtsim with
+ * "make EVENTQUEUE=multimap" to use it.
+ */
+
+#include <map>
+#include <set>
+#include <vector>
+#include "config.h"
+
+class EventSource;
+
+// Identifies one scheduled event.  Once the event has fired or been
+// cancelled the handle goes stale, and cancelling it does nothing.
+struct EventHandle {
+    simtime_picosec when;
+    uint64_t seq;  // seq 0 is the null handle; no source's order is 0
+    uint32_t slot; // CalendarEventQueue node holding the event
+    bool operator==(const EventHandle& h) const {return seq == h.seq;}
+    bool operator!=(const EventHandle& h) const {return !(*this == h);}
+};
+
+// The ends of a source's list of pending events in CalendarEventQueue,
+// kept in the source itself so finding them costs nothing.
+struct SourceEvents {
+    SourceEvents() : first(UINT32_MAX), last(UINT32_MAX) {}
+    uint32_t first, last; // nodes, earliest first
+};
+
+// A pending event, as events() lists them.
+struct QueuedEvent {
+    simtime_picosec when;
+    uint64_t seq;
+    EventSource* src;
+};
+
+class CalendarEventQueue {
+public:
+    CalendarEventQueue();
+    EventHandle push(simtime_picosec when, EventSource* src);
+    // remove the earliest event; the queue must not be empty
+    EventSource* pop(simtime_picosec& when) {uint64_t seq; return pop(when, seq);}
+    EventSource* pop(simtime_picosec& when, uint64_t& seq);
+    // remove the earliest event if it's due at when, else return NULL
+    EventSource* pop_at(simtime_picosec when, uint64_t& seq);
+    // the time of the earliest event; the queue must not be empty
+    simtime_picosec next_time() {return _nodes[first_live()].when;}
+    bool empty() const {return _size == 0;}
+    size_t size() const {return _size;}
+
+    // these return false if there was nothing to remove
+    bool erase(const EventHandle& handle); // O(1), leaves a tombstone
+    bool erase_source(EventSource* src); // earliest event for src, O(1)
+    bool erase_source_at(EventSource* src, simtime_picosec when);
+
+    // every pending event, earliest first; for checkpoints
+    void events(vector<QueuedEvent>& out) const;
+
+private:
+    static const uint32_t NIL = UINT32_MAX;
+    static const size_t MIN_BUCKETS = 16;
+    static const unsigned INITIAL_SHIFT = 20; // ~1us wide buckets until we've seen some events
+
+    struct Node {
+        simtime_picosec when;
+        uint64_t seq;
+        EventSource* src; // NULL when the node is a tombstone or on the free list
+        uint32_t prev, next;         // in the bucket
+        uint32_t src_prev, src_next; // among src's live events
+    };
+    struct Bucket {
+        uint32_t head, tail;
+    };
+
+    static inline bool before(const Node& a, const Node& b) {
+        return a.when < b.when || (a.when == b.when && a.seq < b.seq);
+    }
+    inline Bucket& bucket_of(const Node& n) {return _buckets[(n.when >> _shift) & _mask];}
+
+    uint32_t alloc_node();
+    void link(uint32_t n);
+    void unlink(uint32_t n);
+    void link_source(uint32_t n);
+    void unlink_source(uint32_t n);
+    void release(uint32_t n);
+    void remove(uint32_t n);
+    uint32_t find_min();
+    uint32_t first_live();
+    void resize(size_t nbuckets);
+
+    vector<Node> _nodes;
+    uint32_t _free;            // head of the free node list (linked through next)
+    vector<Bucket> _buckets;
+    uint64_t _mask;            // _buckets.size()-1; always a power of two
+    unsigned _shift;           // bucket width is 2^_shift picoseconds
+    uint64_t _cur;             // virtual bucket (when >> _shift) the dequeue scan starts from
+    size_t _size;              // live events, not counting tombstones
+    size_t _dead;              // tombstones still linked into buckets
+    uint32_t _pushes;          // the bottom half of the next sequence number
+    uint64_t _slow_ops;        // direct searches and long list walks since the last resize
+};
+
+class MultimapEventQueue {
+public:
+    MultimapEventQueue() : _pushes(0) {}
+    EventHandle push(simtime_picosec when, EventSource* src);
+    EventSource* pop(simtime_picosec& when) {uint64_t seq; return pop(when, seq);}
+    EventSource* pop(simtime_picosec& when, uint64_t& seq);
+    EventSource* pop_at(simtime_picosec when, uint64_t& seq);
+    simtime_picosec next_time() const {return _pending.begin()->first.first;}
+    bool empty() const {return _pending.empty();}
+    size_t size() const {return _pending.size();}
+
+    bool erase(const EventHandle& handle);
+    bool erase_source(EventSource* src); // earliest event for src, O(log n)
+    bool erase_source_at(EventSource* src, simtime_picosec when);
+
+    void events(vector<QueuedEvent>& out) const;
+
+private:
+    // keyed by (time, seq), as the calendar queue orders them
+    typedef map <pair<simtime_picosec, uint64_t>, EventSource*> pendingsources_t;
+    typedef pair<EventSource*, pair<simtime_picosec, uint64_t> > sourceevent_t;
+
+    pendingsources_t _pending;
+    set<sourceevent_t> _by_source; // the same events, by source
+    uint32_t _pushes;
+};
+
+// the sequence number of src's event, the pushes'th pushed
+uint64_t eventqueue_seq(const EventSource* src, uint32_t pushes);
+
+// The backend EventList uses; defined in eventlist.cpp according to
+// the EVENTQUEUE_MULTIMAP build flag.
+class EventQueue;
+
+#endif
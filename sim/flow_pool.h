@@ -0,0 +1,68 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef FLOW_POOL_H
+#define FLOW_POOL_H
+
+/*
+ * Finished transport endpoints, kept for the next flow on the same host.
+ *
+ * A driver that creates every connection of a long open-loop workload
+ * up front holds millions of sources and sinks, most of them finished
+ * or not started yet.  With a FlowPool it can create them as flows
+ * start and, once a flow is done, give its endpoints back to be
+ * reused, so memory grows with the flows active at once rather than
+ * with the whole workload.
+ *
+ * Endpoints are pooled per host because they stay bound to the host
+ * they were made for - its NIC scheduler, say, or its switch's host
+ * routes - so they can only be reused there.  The pool doesn't know
+ * how to reset or create them: acquire() returns NULL when there's
+ * none free and the caller makes a new one.
+ */
+
+#include <unordered_map>
+#include <vector>
+#include <ostream>
+#include "config.h"
+
+template<class T>
+class FlowPool {
+public:
+    FlowPool() : _created(0), _reused(0), _free(0) {}
+
+    // a finished endpoint for host, or NULL if the caller must make one
+    T* acquire(uint32_t host) {
+        typename unordered_map<uint32_t, vector<T*> >::iterator i = _pool.find(host);
+        if (i == _pool.end() || i->second.empty()) {
+            _created++;
+            return NULL;
+        }
+        T* endpoint = i->second.back();
+        i->second.pop_back();
+        _reused++;
+        _free--;
+        return endpoint;
+    }
+
+    // endpoint is done with, and must not be doing anything anymore
+    void release(uint32_t host, T* endpoint) {
+        _pool[host].push_back(endpoint);
+        _free++;
+    }
+
+    uint64_t created() const {return _created;}
+    uint64_t reused() const {return _reused;}
+    uint64_t available() const {return _free;}
+
+    void report(ostream& out, const char* what) const {
+        out << what << ": " << _created << " created, " << _reused << " reused, "
+            << _free << " free" << endl;
+    }
+
+private:
+    unordered_map<uint32_t, vector<T*> > _pool;
+    uint64_t _created;
+    uint64_t _reused;
+    uint64_t _free;
+};
+
+#endif
@@ -113,7 +113,7 @@ void HPCCSrc::log_me() {
 }
 
 void HPCCSrc::startflow(){
-    cout << "startflow " << _flow._name << " at " << timeAsUs(eventlist().now()) << endl;
+    cout << "startflow " << _flow.str() << " at " << timeAsUs(eventlist().now()) << endl;
     _flow_started = true;
     _highest_sent = 0;
     _last_acked = 0;
@@ -135,7 +135,7 @@ void HPCCSrc::connect(Route* routeout, Route* routeback, HPCCSink& sink, simtime
     
     _sink = &sink;
     _flow.set_id(get_id()); // identify the packet flow with the HPCC source that generated it
-    _flow._name = _name;
+    _flow.copyName(*this);
     _sink->connect(*this, routeback);
 
     if (starttime != TRIGGER_START) {
@@ -153,7 +153,7 @@ void HPCCSrc::processNack(const HPCCNack& nack){
     _last_acked = nack.ackno();
     _rtx_packets_sent += _highest_sent - _last_acked;
 
-    cout << "HPCC " << _name << " go back n from " <<  _highest_sent << " to " << _last_acked << " at " << timeAsUs(eventlist().now()) << " us" << endl;
+    cout << "HPCC " << str() << " go back n from " <<  _highest_sent << " to " << _last_acked << " at " << timeAsUs(eventlist().now()) << " us" << endl;
 
     if (_flow_size && _highest_sent>_flow_size && _last_acked < _flow_size){
         //restart the pacing of packets, this has stopped once we've passed the flow size but now a packet in the last window was lost.
@@ -208,7 +208,7 @@ void HPCCSrc::processAck(const HPCCAck& ack) {
     if (_logger) _logger->logHPCC(*this, HPCCLogger::HPCC_RCV);
 
     if (ackno >= _flow_size){
-        cout << "Flow " << _name << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ackno << endl;
+        cout << "Flow " << str() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ackno << endl;
         _done = true;
         if (_end_trigger) {
             _end_trigger->activate();
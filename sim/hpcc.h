@@ -50,7 +50,7 @@ public:
 
     // called from a trigger to start the flow.
     virtual void activate() {
-        cout << "Activate called " << _flow._name << endl;
+        cout << "Activate called " << _flow.str() << endl;
         startflow();
     }
 
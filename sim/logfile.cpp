@@ -1,6 +1,7 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-        
 #define _CRT_SECURE_NO_DEPRECATE  // For Visual Studio: this allows the unsafe operation fopen() without issuing a warning
 #include "logfile.h"
+#include "simcontext.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -32,6 +33,7 @@ Logfile::Logfile(const string& filename, EventList& eventlist)
         cerr << "Failed to open logfile " << _logfilename << endl;
         exit(1);
     }
+    SimContext::current().logged_manager().keep_idmap();
 }
 
 Logfile::~Logfile() {
@@ -2,32 +2,106 @@
 #include <iostream>
 #include <iomanip>
 #include "loggers.h"
+#include "memory_account.h"
+#include "checkpoint.h"
 
 
 // LoggedManager is a way to keep track of all the Logged instances
 // that have been created so we can dump a map of IDs to Names to help
 // interpret the IDs in the logfiles.
 
-LoggedManager::LoggedManager() {};
+LoggedManager::LoggedManager() : _keep_idmap(false) {};
 
 void LoggedManager::add_logged(Logged* logged) {
-    _idmap.push_back(logged);
+    if (_keep_idmap)
+        _idmap.push_back(logged);
 }
 
 void LoggedManager::dump_idmap() {
+    if (!_keep_idmap)
+        cerr << "dump_idmap: no logfile asked for the id map, it will be empty" << endl;
     std::ofstream fout("idmap.txt");
     for (size_t i = 0; i < _idmap.size(); i++) {
-        fout << _idmap[i]->get_id() << " " << _idmap[i]->_name << endl;
+        fout << _idmap[i]->get_id() << " " << _idmap[i]->str() << endl;
     }
     fout.close();
 }
 
-LoggedManager Logged::_logged_manager;
+size_t LoggedManager::bytes() const {
+    size_t total = _idmap.capacity() * sizeof(Logged*);
+    for (unordered_set<string>::const_iterator i = _names.begin(); i != _names.end(); i++)
+        total += sizeof(string) + i->capacity() + 1;
+    return total;
+}
+
+const string* LoggedManager::intern(const string& name) {
+    return &*_names.insert(name).first;
+}
+
+// IDs, names and the ID map are per simulation, kept in the SimContext.
+Logged::Logged(const string& name) {
+    SimContext& ctx = SimContext::current();
+    _name = ctx.logged_manager().intern(name);
+    _name_ids[0] = NO_NAME_ID;
+    _log_id = ctx.new_log_id();
+    ctx.logged_manager().add_logged(this);
+}
+
+void Logged::setName(const string& name) {
+    _name = SimContext::current().logged_manager().intern(name);
+    _name_ids[0] = NO_NAME_ID;
+}
+
+void Logged::setIdName(const char* type, uint32_t a, uint32_t b) {
+    assert(a != NO_NAME_ID);
+    _name = SimContext::current().logged_manager().intern(type);
+    _name_ids[0] = a;
+    _name_ids[1] = b;
+}
+
+void Logged::copyName(const Logged& other) {
+    _name = other._name;
+    _name_ids[0] = other._name_ids[0];
+    _name_ids[1] = other._name_ids[1];
+}
+
+void Logged::checkpoint(CheckpointArchive& archive) {
+    archive.unsupported(*this);
+}
+
+const string& Logged::str() {
+    if (_name_ids[0] != NO_NAME_ID) {
+        string name = *_name + "_" + to_string(_name_ids[0]);
+        if (_name_ids[1] != NO_NAME_ID)
+            name += "_" + to_string(_name_ids[1]);
+        // not setName(), which subclasses extend
+        _name = SimContext::current().logged_manager().intern(name);
+        _name_ids[0] = NO_NAME_ID;
+    }
+    return *_name;
+}
+
+void Logged::set_id(id_t id) {
+    assert(id < SimContext::current().next_log_id());
+    _log_id = id;
+}
+
+void Logged::dump_idmap() {
+    SimContext::current().logged_manager().dump_idmap();
+}
 
 string Logger::event_to_str(RawLogEvent& event) {
     return event.str();
 }
 
+void* Logger::operator new(size_t size) {
+    return MemoryAccount::allocate(MemoryAccount::LOGGERS, size);
+}
+
+void Logger::operator delete(void* p, size_t size) {
+    MemoryAccount::release(MemoryAccount::LOGGERS, p, size);
+}
+
 QueueLoggerFactory::QueueLoggerFactory(Logfile* lg, QueueLoggerType logtype, EventList& eventlist)
     :_logfile(lg), _logger_type(logtype), _eventlist(eventlist)
 {
@@ -1112,7 +1186,7 @@ vector<TcpSink*> _mtcp_sources;
 
 MemoryLoggerSampling::MemoryLoggerSampling(simtime_picosec period, 
                                            EventList& eventlist):
-    EventSource(eventlist,"MemorySampling"), _period(period)
+    EventSource(eventlist,"MemorySampling"), _memory_account(false), _period(period)
 {
     eventlist.sourceIsPendingRel(*this,0);
 }
@@ -1165,6 +1239,15 @@ void MemoryLoggerSampling::doNextEvent(){
                               _mtcp_sources[i]->_highest_sent - _mtcp_sources[i]->_last_acked);
     }
 #endif
+
+    if (_memory_account) {
+        MemoryAccount& account = MemoryAccount::current();
+        for (int c = 0; c < MemoryAccount::CATEGORIES; c++) {
+            MemoryAccount::Category category = (MemoryAccount::Category)c;
+            _logfile->writeRecord(Logger::MEMORY_ACCOUNT, c, 0,
+                                  account.objects(category), 0, account.bytes(category));
+        }
+    }
 }
 
 string MemoryLoggerSampling::event_to_str(RawLogEvent& event) {
@@ -1184,6 +1267,11 @@ string MemoryLoggerSampling::event_to_str(RawLogEvent& event) {
             break;
         }
         break;
+    case Logger::MEMORY_ACCOUNT:
+        ss << " Type MEMORY_ACCOUNT Category "
+           << MemoryAccount::name((MemoryAccount::Category)event._id)
+           << " Objects " << (int64_t)event._val1 << " Bytes " << (int64_t)event._val3;
+        break;
     default:
         ss << " Unknown event type " << event._type;
     }
@@ -263,8 +263,11 @@ class MemoryLoggerSampling : public Logger, public EventSource {
     void monitorTcpSource(TcpSrc* sink);
     void monitorMultipathTcpSink(MultipathTcpSink* sink);
     void monitorMultipathTcpSource(MultipathTcpSrc* sink);
+    // the MemoryAccount's breakdown, one record per category
+    void monitorMemoryAccount() {_memory_account = true;}
     static string event_to_str(RawLogEvent& event);
  private:
+    bool _memory_account;
     vector<TcpSink*> _tcp_sinks;
     vector<MultipathTcpSink*> _mtcp_sinks;
     vector<TcpSrc*> _tcp_sources;
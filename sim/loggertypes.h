@@ -2,6 +2,8 @@
 #ifndef LOGGERTYPES_H
 #define LOGGERTYPES_H
 #include <vector>
+#include <string>
+#include <unordered_set>
 
 class Packet;
 class PacketFlow;
@@ -21,33 +23,60 @@ class MultipathTcpSrc;
 class Logfile;
 class RawLogEvent;
 class Logged;
+class CheckpointArchive;
 
-// keep track of all logged items so we can do ID->Name mapping later
+// Keeps the names of logged items, and once a logfile asks for it,
+// track of the items themselves so we can do ID->Name mapping later.
 class LoggedManager {
 public:
     LoggedManager();
+    // Only items created after this are in the id map.  A Logfile
+    // calls it, so create the logfile before the network.
+    void keep_idmap() {_keep_idmap = true;}
     void add_logged(Logged* logged);
     void dump_idmap();
+    // the items in the id map, in the order they were created
+    const vector<Logged*>& idmap() const {return _idmap;}
+    // The one copy of name, which lives as long as the manager.
+    const string* intern(const string& name);
+    size_t names() const {return _names.size();}
+    // held by the names and the id map
+    size_t bytes() const;
 private:
+    bool _keep_idmap;
     vector<Logged*> _idmap;
+    unordered_set<string> _names;
 };
 
+// Names are only needed for logging and debug output, but there can be
+// hundreds of thousands of flows, sources and sinks.  So a Logged holds
+// a pointer to its name, interned in the LoggedManager, which the many
+// objects sharing a type name like "Queue" share.  A name that is just
+// a type and one or two numbers, like constcca_3_7, can be set with
+// setIdName() and isn't built until someone asks for it.
 class Logged {
  public:
     typedef uint32_t id_t;
-    Logged(const string& name) {_name=name; _log_id=LASTIDNUM; Logged::LASTIDNUM++; _logged_manager.add_logged(this);}
+    Logged(const string& name);
     virtual ~Logged() {}
-    virtual void setName(const string& name) { _name=name; }
-    virtual const string& str() { return _name; };
+    virtual void setName(const string& name);
+    // named type_a, or type_a_b
+    void setIdName(const char* type, uint32_t a, uint32_t b = NO_NAME_ID);
+    // the same name as other, built or not
+    void copyName(const Logged& other);
+    virtual const string& str();
     inline id_t get_id() const {return _log_id;}
     // usually things get their own IDs, but flows, for example, get associated with the sender ID
-    void set_id(id_t id) {assert(id < LASTIDNUM); _log_id = id;}
-    string _name;
-    static void dump_idmap() {_logged_manager.dump_idmap();}
+    void set_id(id_t id);
+    static void dump_idmap();
+    // Save or restore our state; see CheckpointArchive.  Only the
+    // classes a checkpoint can hold implement it.
+    virtual void checkpoint(CheckpointArchive& archive);
  private:
+    static const uint32_t NO_NAME_ID = UINT32_MAX;
+    const string* _name; // the type, while _name_ids[0] is set
+    uint32_t _name_ids[2];
     id_t _log_id;
-    static id_t LASTIDNUM;
-    static LoggedManager _logged_manager;
 };
 
 class Logger {
@@ -68,10 +97,14 @@ class Logger {
                      STRACK_SINK=32, STRACK_MEMORY=33,
                      EQDS_EVENT=38, EQDS_STATE=39, EQDS_RECORD=40,
                      EQDS_SINK = 41, EQDS_MEMORY = 42, EQDS_TRAFFIC = 43,
-                     FLOW_EVENT = 44 };
+                     FLOW_EVENT = 44, MEMORY_ACCOUNT = 45 };
     static string event_to_str(RawLogEvent& event);
     Logger() {};
     virtual ~Logger(){};
+    // loggers are counted in the MemoryAccount like MEMORY_ACCOUNTED
+    // classes, but out of line: it needs simcontext.h, which needs us
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
  protected:
     void setLogfile(Logfile& logfile) { _logfile=&logfile; }
     Logfile* _logfile;
@@ -0,0 +1,95 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "memory_account.h"
+#include "network.h"
+#include "route.h"
+#include "loggertypes.h"
+#include <iomanip>
+
+MemoryAccount::MemoryAccount() {
+    for (int c = 0; c < CATEGORIES; c++) {
+        _objects[c] = 0;
+        _bytes[c] = 0;
+        _peak[c] = 0;
+    }
+}
+
+void*
+MemoryAccount::allocate(Category category, size_t size) {
+    current().allocated(category, size);
+    return ::operator new(size);
+}
+
+void
+MemoryAccount::release(Category category, void* p, size_t size) {
+    current().freed(category, size);
+    ::operator delete(p);
+}
+
+const char*
+MemoryAccount::name(Category category) {
+    switch (category) {
+    case PACKETS: return "packets";
+    case ROUTES: return "routes";
+    case FIB: return "fib";
+    case QUEUES: return "queues";
+    case PIPES: return "pipes";
+    case SWITCHES: return "switches";
+    case TRANSPORT: return "transport";
+    case LOGGERS: return "loggers";
+    case NAMES: return "names";
+    default: return "unknown";
+    }
+}
+
+int64_t
+MemoryAccount::objects(Category category) const {
+    SimContext& context = SimContext::current();
+    switch (category) {
+    case PACKETS:
+        return PacketArena::current().packets();
+    case ROUTES:
+        return _objects[ROUTES] + RouteStore::current().routes();
+    case NAMES:
+        return context.logged_manager().names();
+    default:
+        return _objects[category];
+    }
+}
+
+int64_t
+MemoryAccount::bytes(Category category) const {
+    SimContext& context = SimContext::current();
+    switch (category) {
+    case PACKETS:
+        return PacketArena::current().bytes();
+    case ROUTES:
+        // interned routes live in the store's arena, not on the heap
+        return _bytes[ROUTES] + RouteStore::current().bytes();
+    case NAMES:
+        return context.logged_manager().bytes();
+    default:
+        return _bytes[category];
+    }
+}
+
+int64_t
+MemoryAccount::total_bytes() const {
+    int64_t total = 0;
+    for (int c = 0; c < CATEGORIES; c++)
+        total += bytes((Category)c);
+    return total;
+}
+
+void
+MemoryAccount::report(ostream& out) const {
+    out << "Memory by subsystem: " << total_bytes() / 1024 << " KB" << endl;
+    for (int c = 0; c < CATEGORIES; c++) {
+        Category category = (Category)c;
+        out << "  " << setw(10) << left << name(category) << right
+            << setw(10) << bytes(category) / 1024 << " KB in "
+            << objects(category) << " objects";
+        if (_peak[c] > _bytes[c])
+            out << ", peak " << (_peak[c] + bytes(category) - _bytes[c]) / 1024 << " KB";
+        out << endl;
+    }
+}
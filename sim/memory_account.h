@@ -0,0 +1,76 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef MEMORY_ACCOUNT_H
+#define MEMORY_ACCOUNT_H
+
+/*
+ * Where a simulation's memory goes.
+ *
+ * Packets, interned routes and Logged names are already kept in one
+ * place each - PacketArena, RouteStore and LoggedManager - and are
+ * asked how much they hold.  Everything else is counted as it's
+ * allocated: a class that says MEMORY_ACCOUNTED(category) in its
+ * public section gets an operator new and delete that count its
+ * objects, and the bytes of the most derived class, against the
+ * category in the current context's MemoryAccount.  Only the objects
+ * themselves are counted, not what they allocate in turn, such as the
+ * contents of their containers.
+ *
+ * report() prints the breakdown; MemoryLoggerSampling can write it to
+ * the logfile periodically (see monitorMemoryAccount()).
+ */
+
+#include <ostream>
+#include <new>
+#include "config.h"
+#include "simcontext.h"
+
+class MemoryAccount : public SimState {
+ public:
+    enum Category {PACKETS = 0, ROUTES = 1, FIB = 2, QUEUES = 3, PIPES = 4,
+                   SWITCHES = 5, TRANSPORT = 6, LOGGERS = 7, NAMES = 8,
+                   CATEGORIES = 9};
+
+    MemoryAccount();
+    static MemoryAccount& current() {return SimContext::current().state<MemoryAccount>();}
+    static const char* name(Category category);
+
+    void allocated(Category category, size_t bytes) {
+        _objects[category]++;
+        _bytes[category] += bytes;
+        if (_bytes[category] > _peak[category])
+            _peak[category] = _bytes[category];
+    }
+    void freed(Category category, size_t bytes) {
+        _objects[category]--;
+        _bytes[category] -= bytes;
+    }
+
+    // what MEMORY_ACCOUNTED's operator new and delete call; out of line
+    // so the compiler doesn't pair our delete with the global new
+    static void* allocate(Category category, size_t size);
+    static void release(Category category, void* p, size_t size);
+
+    // what's held now, counted or asked for
+    int64_t objects(Category category) const;
+    int64_t bytes(Category category) const;
+    int64_t total_bytes() const;
+
+    void report(ostream& out) const;
+
+ private:
+    // only what operator new and delete counted
+    int64_t _objects[CATEGORIES];
+    int64_t _bytes[CATEGORIES];
+    int64_t _peak[CATEGORIES];
+};
+
+#define MEMORY_ACCOUNTED(category)                                      \
+    static void* operator new(size_t size) {                            \
+        return MemoryAccount::allocate(MemoryAccount::category, size);  \
+    }                                                                   \
+    static void* operator new(size_t size, void* where) {return where;} \
+    static void operator delete(void* p, size_t size) {                 \
+        MemoryAccount::release(MemoryAccount::category, p, size);       \
+    }
+
+#endif
@@ -12,6 +12,7 @@
 #include "swiftpacket.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "reorder_buffer.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
 
@@ -173,8 +174,8 @@ class SwiftSink : public PacketSink, public DataReceiver {
     uint32_t get_id(){ return id;}
     virtual const string& nodename() { return _nodename; }
 
-    list<SwiftAck::seq_t> _received; /* list of packets above a hole, that 
-				      we've received */
+    ReorderBuffer<SwiftAck::seq_t> _received; /* packets above a hole, that
+						 we've received */
 
 
     uint64_t cumulative_ack() {
@@ -15,18 +15,13 @@ MultipathTcpSrc::MultipathTcpSrc(char cc_type,EventList& ev,MultipathTcpLogger*
     _cc_type = cc_type;
     a = A_SCALE;
     _sink = NULL;
+    _total_window = 0;
 
 #ifdef MODEL_RECEIVE_WINDOW
     _highest_sent = 0;
     _last_acked = 0;
 
     _receive_window = rwnd * 1000;
-
-    for (int i=0;i<100000;i++)
-        for (int j=0;j<4;j++)
-            _packets_mapped[i][j] = 0;
-    for (int j=0;j<4;j++)
-        _last_reduce[j] = 0;
 #endif
     eventlist().sourceIsPending(*this,timeFromSec(3));
     _nodename = "mtcpsrc";
@@ -36,6 +31,11 @@ void MultipathTcpSrc::addSubflow(TcpSrc* subflow){
     _subflows.push_back(subflow);
     subflow->_subflow_id = _subflows.size()-1;
     subflow->joinMultipathConnection(this);
+    subflow->update_mptcp_window();
+#ifdef MODEL_RECEIVE_WINDOW
+    _packets_mapped.resize(_subflows.size());
+    _last_reduce.push_back(0);
+#endif
 }
 
 void
@@ -52,6 +52,8 @@ MultipathTcpSrc::receivePacket(Packet& pkt) {
 
     //there is a chance that we can send packets on all subflows - we should try them out.
     _last_acked = seqno;
+    for (size_t j=0;j<_packets_mapped.size();j++)
+        _packets_mapped[j].discard(_last_acked/1000);
 
     if (_last_acked==_highest_sent){
         //create inactivity timers?
@@ -66,43 +68,37 @@ int MultipathTcpSrc::getDataSeq(uint64_t* seq, TcpSrc* subflow){
 
     if (_last_acked+_receive_window > _highest_sent){
         *seq = _highest_sent+1;
-        int pos = ((_highest_sent+1)/1000)%100000;
+        uint64_t pos = _highest_sent/1000;
 
         _highest_sent += 1000;
 
-        for (int j=0;j<4;j++)
-            _packets_mapped[pos][j] = 0;
-
-        _packets_mapped[pos][subflow->_subflow_id] = 1;
+        _packets_mapped[subflow->_subflow_id].insert(pos);
 
         return 1;
     } else {
         //receive window blocked
         uint64_t packet = _last_acked+1;
-        int pos = (packet/1000)%100000;
+        uint64_t pos = _last_acked/1000;
 
         //    cout << "BLK" << endl;
 
         //shall we stall the subflow at the trailling edge of the window?
 #ifdef STALL_SLOW_SUBFLOWS
         int slow_subflow_id = -1;
+        int subflows = _subflows.size();
 
-        for (int j=0;j<4;j++) {
-            if (_packets_mapped[pos][j]) {
+        for (int j=0;j<subflows;j++) {
+            if (_packets_mapped[j].contains(pos)) {
                 if (slow_subflow_id < 0)
                     slow_subflow_id = j;
                 else 
-                    slow_subflow_id = 4;
+                    slow_subflow_id = subflows; // more than one
             }
         }
 
-        if (slow_subflow_id>=0 && slow_subflow_id<4 && slow_subflow_id!=subflow->_subflow_id){
+        if (slow_subflow_id>=0 && slow_subflow_id<subflows && slow_subflow_id!=subflow->_subflow_id){
 
-            TcpSrc* src = NULL;
-            list<TcpSrc*>::iterator i = _subflows.begin();
-            std::advance(i, slow_subflow_id);
-      
-            src = *i;
+            TcpSrc* src = _subflows[slow_subflow_id];
       
             //stall
 
@@ -110,6 +106,7 @@ int MultipathTcpSrc::getDataSeq(uint64_t* seq, TcpSrc* subflow){
                 eventlist().now()-_last_reduce[slow_subflow_id] > src->_rtt){
                 src->_ssthresh = deflate_window(src->_cwnd,src->_mss);
                 src->_cwnd = src->_ssthresh;
+                src->update_mptcp_window();
         
                 _last_reduce[slow_subflow_id] = eventlist().now();
                 //        cout << "PEN"<<endl;
@@ -119,7 +116,7 @@ int MultipathTcpSrc::getDataSeq(uint64_t* seq, TcpSrc* subflow){
         //we should retransmit the oldest seqno which hasn't been sent on this subflow
 #ifdef REXMIT_ENABLED
         while (packet<_highest_sent) {
-            pos = (packet/1000)%100000;
+            pos = (packet-1)/1000;
       
             //if (subflow->_highest_data_seq<packet || !subflow->_sent_packets.has_data_seq(packet)){
 
@@ -129,10 +126,10 @@ int MultipathTcpSrc::getDataSeq(uint64_t* seq, TcpSrc* subflow){
     
                     src = *i;*/
       
-            if (!_packets_mapped[pos][subflow->_subflow_id]){
+            if (!_packets_mapped[subflow->_subflow_id].contains(pos)){
                 //                    && 4 * subflow->_rtt < src->_rtt){
                 *seq = packet;
-                _packets_mapped[pos][subflow->_subflow_id] = 1;
+                _packets_mapped[subflow->_subflow_id].insert(pos);
 
                 //        cout << "RX"<<endl;
                 return 1;
@@ -331,23 +328,9 @@ MultipathTcpSrc::deflate_window(uint32_t cwnd, uint32_t mss){
     }
 }
 
-uint32_t
-MultipathTcpSrc::compute_total_window(){
-    list<TcpSrc*>::iterator it;
-    uint32_t crt_wnd = 0;
-
-    //  printf ("Tot wnd ");
-    for (it = _subflows.begin();it!=_subflows.end();it++){
-        TcpSrc& crt = *(*it);
-        crt_wnd += crt._in_fast_recovery?crt._ssthresh:crt._cwnd;
-    }
-
-    return crt_wnd;
-}
-
 uint64_t
 MultipathTcpSrc::compute_total_bytes(){
-    list<TcpSrc*>::iterator it;
+    vector<TcpSrc*>::iterator it;
     uint64_t b = 0;
 
     for (it = _subflows.begin();it!=_subflows.end();it++){
@@ -414,18 +397,18 @@ uint32_t MultipathTcpSrc::compute_a_scaled(){
 
     uint32_t sum_denominator=0;
     uint64_t t = 0;
-    uint64_t cwndSum = 0;
+    uint64_t cwndSum = _total_window;
   
-    list<TcpSrc*>::iterator it;
+    // the rest depends on every subflow's current RTT
+    vector<TcpSrc*>::iterator it;
     for(it=_subflows.begin();it!=_subflows.end();++it) {
         TcpSrc& flow = *(*it);
-        uint32_t cwnd = flow._in_fast_recovery?flow._ssthresh:flow._cwnd;          
+        uint32_t cwnd = flow.effective_window();
         uint32_t rtt = timeAsUs(flow._rtt)/10;
         if(rtt==0) rtt=1;
     
         t = max(t,(uint64_t)cwnd * flow._mss * flow._mss / rtt / rtt);
         sum_denominator += cwnd * flow._mss / rtt;
-        cwndSum += cwnd;
     }
 
     uint32_t alpha = (uint32_t)( A_SCALE * (uint64_t)cwndSum * t / sum_denominator / sum_denominator);
@@ -449,7 +432,7 @@ double MultipathTcpSrc::compute_alfa(){
     else {
         double maxt = 0,sum_denominator = 0;
 
-        list<TcpSrc*>::iterator it;
+        vector<TcpSrc*>::iterator it;
         for(it=_subflows.begin();it!=_subflows.end();++it) {
             TcpSrc& flow = *(*it);
             uint32_t cwnd = flow._in_fast_recovery?flow._ssthresh:flow._cwnd;
@@ -544,7 +527,7 @@ MultipathTcpSrc::compute_a(){
 }
 
 void MultipathTcpSrc::doNextEvent(){
-    list<TcpSrc*>::iterator it;
+    vector<TcpSrc*>::iterator it;
     for(it=_subflows.begin();it!=_subflows.end();++it) {
         TcpSrc& flow = *(*it);
         flow.send_packets();
@@ -636,26 +619,10 @@ MultipathTcpSink::receivePacket(Packet& pkt) {
     if (seqno == _cumulative_ack+1) { // it's the next expected seq no
         _cumulative_ack = seqno + size - 1;
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (_received.front() == _cumulative_ack+1) ) {
-            _received.pop_front();
-            _cumulative_ack+= size;
-        }
+        _received.advance(_cumulative_ack, size);
     } else if (seqno < _cumulative_ack+1) { //must have been a bad retransmit
     } else { // it's not the next expected sequence number
-        if (_received.empty()) {
-            _received.push_front(seqno);
-        } else if (seqno > _received.back()) { // likely case
-            _received.push_back(seqno);
-        } else { // uncommon case - it fills a hole
-            list<uint64_t>::iterator i;
-            for (i = _received.begin(); i != _received.end(); i++) {
-                if (seqno == *i) break; // it's a bad retransmit
-                if (seqno < (*i)) {
-                    _received.insert(i, seqno);
-                    break;
-                }
-            }
-        }
+        _received.insert(seqno, size); // ignored if it's a bad retransmit
     }
 #endif
 }        
@@ -8,11 +8,15 @@
 
 #include <math.h>
 #include <list>
+#include <vector>
 #include "config.h"
 #include "network.h"
 #include "tcp.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "memory_account.h"
+#include "reorder_buffer.h"
+#include "seq_bitmap.h"
 
 #define USE_AVG_RTT 0
 #define UNCOUPLED 1
@@ -37,6 +41,7 @@ class MultipathTcpSink;
 
 class MultipathTcpSrc : public PacketSink, public EventSource {
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     MultipathTcpSrc(char cc_type,EventList & ev,MultipathTcpLogger* logger,int rwnd = 1000);
     void addSubflow(TcpSrc* tcp);
     void receivePacket(Packet& pkt);
@@ -56,7 +61,13 @@ public:
 
     uint32_t a;
     // Connectivity; list of subflows
-    list<TcpSrc*> _subflows; // list of active subflows for this connection
+    vector<TcpSrc*> _subflows; // active subflows for this connection, by _subflow_id
+
+    // a subflow's effective window has changed; keeps compute_total_window() current
+    void subflow_window_changed(uint32_t old_window, uint32_t new_window) {
+        _total_window += new_window;
+        _total_window -= old_window;
+    }
 
 
     void connect(MultipathTcpSink* sink) {
@@ -70,8 +81,10 @@ public:
     uint64_t _highest_sent;
     uint64_t _last_acked;
 
-    bool _packets_mapped[100000][4];
-    simtime_picosec _last_reduce[4];
+    // per subflow, the data packets sent on it that are still
+    // unacked, by (data seqno-1)/1000
+    vector<SeqBitmap> _packets_mapped;
+    vector<simtime_picosec> _last_reduce;
 
     //this maintains the total number of bytes allowed in flight past the data_ack
     //there is no need to have it signalled from the receiver if there is no flow control
@@ -79,9 +92,10 @@ public:
 #endif
 
     double _alfa;
-    uint32_t compute_total_window();
+    uint32_t compute_total_window() {return (uint32_t)_total_window;}
     MultipathTcpSink* _sink;
 private:
+    uint64_t _total_window; // sum of the subflows' effective windows
     MultipathTcpLogger* _logger;
 
     char _cc_type;
@@ -93,6 +107,7 @@ private:
 
 class MultipathTcpSink : public PacketSink , public EventSource {
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     MultipathTcpSink(EventList& ev);
     void addSubflow(TcpSink* tcp);
     void receivePacket(Packet& pkt);
@@ -106,7 +121,7 @@ public:
 
     void doNextEvent();
     virtual const string& nodename() { return _nodename; }
-    list<TcpAck::seq_t> _received; // list of packets above a hole, that we've received
+    ReorderBuffer<TcpAck::seq_t> _received; // packets above a hole, that we've received
 private:
 
     // Connectivity
@@ -268,7 +268,7 @@ void NdpSrc::connect(Route* routeout, Route* routeback, NdpSink& sink, simtime_p
     
     _sink = &sink;
     _flow.set_id(get_id()); // identify the packet flow with the NDP source that generated it
-    _flow._name = _name;
+    _flow.copyName(*this);
     _sink->connect(*this, routeback);
   
     eventlist().sourceIsPending(*this,starttime);
@@ -525,7 +525,7 @@ void NdpSrc::processAck(const NdpAck& ack) {
     assert(_flight_size>=0);
 
     if (cum_ackno >= _flow_size){
-      cout << "Flow " << _name << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << cum_ackno << endl;
+      cout << "Flow " << str() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << cum_ackno << endl;
       return;
     }
 
@@ -106,6 +106,7 @@ NdpSrc::NdpSrc(NdpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist
 
     // by default, end silently
     _end_trigger = 0;
+    _finished = false;
 
     // debugging hack
     _log_me = false;
@@ -129,6 +130,72 @@ void NdpSrc::set_end_trigger(Trigger& end_trigger) {
     _end_trigger = &end_trigger;
 }
 
+void NdpSrc::reset() {
+    // the flow is done, so nothing is in flight or waiting to be resent
+    _tx_records.clear();
+    _late_records.clear();
+    _sent_heap.clear();
+    _rtx_queue.clear();
+    _late_rtx_queue.clear();
+    _rtx_timeout_pending = false;
+    _rtx_timeout = timeInf;
+    rtx_timer_update();
+
+    _stop_time = 0;
+    _base_rtt = timeInf;
+    _acked_packets = 0;
+    _packets_sent = 0;
+    _new_packets_sent = 0;
+    _rtx_packets_sent = 0;
+    _acks_received = 0;
+    _nacks_received = 0;
+    _pulls_received = 0;
+    _implicit_pulls = 0;
+    _bounces_received = 0;
+    _flight_size = 0;
+    _first_window_count = 0;
+    _highest_sent = 0;
+    _last_acked = 0;
+    _dstaddr = UINT32_MAX;
+    _sink = 0;
+    _route = NULL;
+    _rtt = 0;
+    _rto = timeFromMs(20);
+    _cwnd = 15 * Packet::data_packet_size();
+    _mdev = 0;
+    _drops = 0;
+    _flow_size = ((uint64_t)1)<<63;
+    _last_pull = 0;
+    _max_pull = 0;
+    _pull_window = 0;
+    _finished = false;
+
+    // the paths were copied for this flow's sink
+    for (size_t i = 0; i < _original_paths.size(); i++) {
+        delete _original_paths[i];
+    }
+    _paths.clear();
+    _original_paths.clear();
+    _path_ids.clear();
+    _path_acks.clear();
+    _path_ecns.clear();
+    _path_nacks.clear();
+    _bad_path.clear();
+    _avoid_ratio.clear();
+    _avoid_score.clear();
+#ifdef DEBUG_PATH_STATS
+    _path_counts_new.clear();
+    _path_counts_rtx.clear();
+    _path_counts_rto.clear();
+#endif
+    _crt_path = 0;
+    _feedback_count = 0;
+    for(int i = 0; i < HIST_LEN; i++) {
+        _feedback_history[i] = UNKNOWN;
+    }
+    _log_me = false;
+}
+
 void NdpSrc::permute_paths() {
     int len = _paths.size();
     for (int i = 0; i < len; i++) {
@@ -199,7 +266,13 @@ void NdpSrc::set_paths(uint32_t no_of_paths){
 
 
 void NdpSrc::set_paths(vector<const Route*>* rt_list){
-    uint32_t no_of_paths = rt_list->size();
+    PathList paths(*rt_list);
+    set_paths(paths, 0, 0);
+}
+
+void NdpSrc::set_paths(PathSource& paths, uint32_t src, uint32_t dest){
+    uint32_t available = paths.no_of_paths(src, dest);
+    uint32_t no_of_paths = available;
     switch(_route_strategy) {
     case NOT_SET:
     case SINGLE_PATH:
@@ -228,8 +301,8 @@ void NdpSrc::set_paths(vector<const Route*>* rt_list){
         _path_counts_rto.resize(no_of_paths);
 #endif
 
-        // generate a randomize sequence of 0 .. size of rt_list - 1
-        vector <int> randseq(rt_list->size());
+        // generate a randomize sequence of 0 .. available - 1
+        vector <int> randseq(available);
         if (_route_strategy == SCATTER_ECMP) {
             // randsec may have duplicates, as with ECMP
             randomize_sequence(randseq);
@@ -242,10 +315,12 @@ void NdpSrc::set_paths(vector<const Route*>* rt_list){
             // we need to copy the route before adding endpoints, as
             // it may be used in the reverse direction too.
             // Pick a random route from the available ones
-            Route* tmp = new Route(*(rt_list->at(randseq[i])), *_sink);
+            const Route* path = paths.get_path(src, dest, randseq[i]);
+            Route* tmp = new Route(*path, *_sink);
+            paths.put_path(path);
             //Route* tmp = new Route(*(rt_list->at(i)));
             tmp->add_endpoints(this, _sink);
-            tmp->set_path_id(i, rt_list->size());
+            tmp->set_path_id(i, available);
             _paths[i] = tmp;
             _path_ids[i] = i;
             _original_paths[i] = tmp;
@@ -268,7 +343,7 @@ void NdpSrc::set_paths(vector<const Route*>* rt_list){
 }
 
 void NdpSrc::startflow(){
-    cout << "startflow " <<  _flow._name <<  " CWND " << _cwnd << " rts " << _rts << " at " << timeAsUs(eventlist().now()) << endl;
+    cout << "startflow " <<  _flow.str() <<  " CWND " << _cwnd << " rts " << _rts << " at " << timeAsUs(eventlist().now()) << endl;
     _highest_sent = 0;
     _last_acked = 0;
     
@@ -276,6 +351,7 @@ void NdpSrc::startflow(){
     _packets_sent = 0;
     _rtx_timeout_pending = false;
     _rtx_timeout = timeInf;
+    rtx_timer_update();
     _pull_window = 0;
     
     _flight_size = 0;
@@ -335,7 +411,7 @@ void NdpSrc::connect(Route* routeout, Route* routeback, NdpSink& sink, simtime_p
     
     _sink = &sink;
     _flow.set_id(get_id()); // identify the packet flow with the NDP source that generated it
-    _flow._name = _name;
+    _flow.copyName(*this);
     _sink->connect(*this, routeback);
 
     if (starttime != TRIGGER_START) {
@@ -455,12 +531,12 @@ void NdpSrc::processRTS(NdpPacket& pkt){
     assert(pkt.bounced());
     pkt.unbounce(NdpPacket::ACKSIZE + _mss);
     
-    _sent_times.erase(pkt.seqno());
+    clear_sent_time(pkt_index(pkt.seqno()));
     //resend from front of RTX
     //queue on any other path than the one we tried last time
     pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_CREATE);
     //_rtx_queue.push_front(&pkt);
-    _rtx_queue[pkt.seqno()] = &pkt;
+    queue_rtx(pkt_index(pkt.seqno()), &pkt);
 
     count_bounce(pkt.route()->path_id());
 
@@ -511,7 +587,7 @@ void NdpSrc::processNack(const NdpNack& nack){
 */
     
     bool last_packet = (nack.ackno() + _mss - 1) >= _flow_size;
-    _sent_times.erase(nack.ackno());
+    clear_sent_time(pkt_index(nack.ackno()));
 
     count_nack(nack.path_id());
     if (nack.ecn_echo()) {
@@ -561,7 +637,7 @@ void NdpSrc::processNack(const NdpNack& nack){
     
     // need to add packet to rtx queue
     p->flow().logTraffic(*p,*this,TrafficLogger::PKT_CREATE);
-    _rtx_queue[seqno] = p;
+    queue_rtx(pkt_index(seqno), p);
 
     if (nack.pull() || _last_pull < _max_pull) {
         if (nack.pull())
@@ -595,9 +671,16 @@ void NdpSrc::processAck(const NdpAck& ack) {
       else
       printf("Receive ACK (----): %s\n", ack.pull_bitmap().to_string().c_str());
     */
-    log_rtt(_first_sent_times[ackno]);
-    _first_sent_times.erase(ackno);
-    _sent_times.erase(ackno);
+    uint64_t n = pkt_index(ackno);
+    if (_tx_records.get(n).first_sent) {
+        sendRecord& record = _tx_records[n];
+        log_rtt(record.first_sent_time);
+        record.first_sent = false;
+    } else {
+        log_rtt(0);
+    }
+    clear_sent_time(n);
+    release_send_records();
 
     count_ack(path_id);
     if (ack.ecn_echo()) {
@@ -658,10 +741,12 @@ void NdpSrc::processAck(const NdpAck& ack) {
     assert(_flight_size>=0);
 
     if (cum_ackno >= _flow_size){
-        cout << "Flow " << _name << " flow_id " << flow_id() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << cum_ackno << endl;
-        if (_end_trigger) {
+        cout << "Flow " << str() << " flow_id " << flow_id() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << cum_ackno << endl;
+        // late ACKs can bring us back here, but the flow only ends once
+        if (_end_trigger && !_finished) {
             _end_trigger->activate();
         }
+        _finished = true;
         return;
     }
 
@@ -876,11 +961,21 @@ void NdpSrc::pull_packets(NdpPull::seq_t pull_no, NdpPull::seq_t pacer_no) {
 int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
     NdpPacket* p = NULL;
     int packets_sent = 0;
-    if (!_rtx_queue.empty()) {
+    if (!_rtx_queue.empty() || !_late_rtx_queue.empty()) {
         // There are packets in the RTX queue for us to send
 
-        p = _rtx_queue.begin()->second;
-        _rtx_queue.erase(_rtx_queue.begin());
+        // lowest sequence number first; late ones are below the window
+        uint64_t n;
+        if (!_late_rtx_queue.empty()) {
+            n = *_late_rtx_queue.begin();
+            _late_rtx_queue.erase(_late_rtx_queue.begin());
+        } else {
+            n = _rtx_queue.first();
+            _rtx_queue.erase(n);
+        }
+        sendRecord& record = tx_record(n);
+        p = record.rtx_pkt;
+        record.rtx_pkt = NULL;
         p->flow().logTraffic(*p,*this,TrafficLogger::PKT_SEND);
         p->set_ts(eventlist().now());
         p->set_pacerno(pacer_no);
@@ -921,12 +1016,13 @@ int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
         //feeder queue isn't a FIFO but that would be hard to
         //implement in a real system, so this is a rough proxy.
         uint32_t service_time = q->serviceTime(*p);  
-        _sent_times[p->seqno()] = eventlist().now() + service_time;
+        set_sent_time(n, eventlist().now() + service_time);
         _packets_sent ++;
         _rtx_packets_sent++;
         update_rtx_time();
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }
     } else {
         // there are no packets in the RTX queue, so we'll send a new one
@@ -1008,78 +1104,124 @@ int NdpSrc::send_packet(NdpPull::seq_t pacer_no) {
         //implement in a real system, so this is a rough proxy.
         uint32_t service_time = q->serviceTime(*p);  
         //cout << "service_time2: " << service_time << endl;
-        _sent_times[p->seqno()] = eventlist().now() + service_time;
-        _first_sent_times[p->seqno()] = eventlist().now();
+        uint64_t n = pkt_index(p->seqno());
+        set_sent_time(n, eventlist().now() + service_time);
+        _tx_records[n].first_sent_time = eventlist().now();
+        _tx_records[n].first_sent = true;
 
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }
     }
     return packets_sent;
 }
 
+NdpSrc::sendRecord& 
+NdpSrc::tx_record(uint64_t n) {
+    if (n < _tx_records.base())
+        return _late_records[n];
+    return _tx_records[n];
+}
+
+NdpSrc::sendRecord 
+NdpSrc::get_tx_record(uint64_t n) const {
+    if (n < _tx_records.base()) {
+        map<uint64_t, sendRecord>::const_iterator i = _late_records.find(n);
+        return i == _late_records.end() ? sendRecord() : i->second;
+    }
+    return _tx_records.get(n);
+}
+
 void 
-NdpSrc::update_rtx_time() {
-    //simtime_picosec now = eventlist().now();
-    if (_sent_times.empty()) {
-        _rtx_timeout = timeInf;
+NdpSrc::set_sent_time(uint64_t n, simtime_picosec sent_time) {
+    sendRecord& record = tx_record(n);
+    record.sent_time = sent_time;
+    record.in_flight = true;
+    _sent_heap.push_back(make_pair(sent_time, n));
+    push_heap(_sent_heap.begin(), _sent_heap.end(), greater<pair<simtime_picosec, uint64_t> >());
+}
+
+void 
+NdpSrc::clear_sent_time(uint64_t n) {
+    // the heap entry goes when it reaches the top
+    if (n < _tx_records.base()) {
+        map<uint64_t, sendRecord>::iterator i = _late_records.find(n);
+        if (i == _late_records.end())
+            return;
+        i->second.in_flight = false;
+        if (!i->second.rtx_pkt)
+            _late_records.erase(i);
         return;
     }
-    map<NdpPacket::seq_t, simtime_picosec>::iterator i;
-    simtime_picosec first_senttime = timeInf;
-    int c = 0;
-    for (i = _sent_times.begin(); i != _sent_times.end(); i++) {
-        simtime_picosec sent = i->second;
-        if (sent < first_senttime || first_senttime == timeInf) {
-            first_senttime = sent;
-        }
-        c++;
+    if (_tx_records.get(n).in_flight)
+        _tx_records[n].in_flight = false;
+}
+
+void 
+NdpSrc::queue_rtx(uint64_t n, NdpPacket* pkt) {
+    tx_record(n).rtx_pkt = pkt;
+    if (n < _tx_records.base())
+        _late_rtx_queue.insert(n);
+    else
+        _rtx_queue.insert(n);
+}
+
+void 
+NdpSrc::release_send_records() {
+    // forget packets at the bottom of the window once we're done with them
+    uint64_t next = _highest_sent / _mss;
+    while (_tx_records.base() < next) {
+        const sendRecord& record = _tx_records.get(_tx_records.base());
+        if (record.in_flight || record.first_sent || record.rtx_pkt)
+            break;
+        _tx_records.advance(_tx_records.base() + 1);
     }
-    _rtx_timeout = first_senttime + _rto;
+    _rtx_queue.discard(_tx_records.base());
 }
- 
+
 void 
-NdpSrc::process_cumulative_ack(NdpPacket::seq_t cum_ackno) {
-    map<NdpPacket::seq_t, simtime_picosec>::iterator i, i_next;
-    i = _sent_times.begin();
-    while (i != _sent_times.end()) {
-        if (i->first <= cum_ackno) {
-            i_next = i; //juggling to keep i valid
-            i_next++;
-            _sent_times.erase(i);
-            i = i_next;
-        } else {
-            return;
-        }
+NdpSrc::update_rtx_time() {
+    //simtime_picosec now = eventlist().now();
+    while (!_sent_heap.empty()) {
+        const pair<simtime_picosec, uint64_t>& top = _sent_heap.front();
+        sendRecord record = get_tx_record(top.second);
+        if (record.in_flight && record.sent_time == top.first)
+            break;
+        pop_heap(_sent_heap.begin(), _sent_heap.end(), greater<pair<simtime_picosec, uint64_t> >());
+        _sent_heap.pop_back();
     }
-    //need to call update_rtx_time right after this!
+    if (_sent_heap.empty()) {
+        _rtx_timeout = timeInf;
+        rtx_timer_update();
+        return;
+    }
+    _rtx_timeout = _sent_heap.front().first + _rto;
+    rtx_timer_update();
 }
 
 void 
 NdpSrc::retransmit_packet() {
     //cout << "starting retransmit_packet\n";
     NdpPacket* p = NULL;
-    map<NdpPacket::seq_t, simtime_picosec>::iterator i, i_next;
-    i = _sent_times.begin();
-    list <NdpPacket::seq_t> rtx_list;
-    // we build a list first because otherwise we're adding to and
-    // removing from _sent_times and the iterator gets confused
-    while (i != _sent_times.end()) {
-        if (i->second + _rto <= eventlist().now()) {
-            //cout << "_sent_time: " << timeAsUs(i->second) << "us rto " << timeAsUs(_rto) << "us now " << timeAsUs(eventlist().now()) << "us\n";
-            //this one is due for retransmission
-            rtx_list.push_back(i->first);
-            i_next = i; //we're about to invalidate i when we call erase
-            i_next++;
-            _sent_times.erase(i);
-            i = i_next;
-        } else {
-            i++;
-        }
-    }
-    list <NdpPacket::seq_t>::iterator j;
-    for (j = rtx_list.begin(); j != rtx_list.end(); j++) {
-        NdpPacket::seq_t seqno = *j;
+    vector<uint64_t> rtx_list;
+    // packets whose sent time is more than an RTO ago come off the top
+    // of the heap; they're resent in sequence order
+    while (!_sent_heap.empty() && _sent_heap.front().first + _rto <= eventlist().now()) {
+        uint64_t n = _sent_heap.front().second;
+        simtime_picosec sent = _sent_heap.front().first;
+        pop_heap(_sent_heap.begin(), _sent_heap.end(), greater<pair<simtime_picosec, uint64_t> >());
+        _sent_heap.pop_back();
+        sendRecord record = get_tx_record(n);
+        if (!record.in_flight || record.sent_time != sent)
+            continue;
+        //this one is due for retransmission
+        tx_record(n).in_flight = false;
+        rtx_list.push_back(n);
+    }
+    sort(rtx_list.begin(), rtx_list.end());
+    for (size_t j = 0; j < rtx_list.size(); j++) {
+        NdpPacket::seq_t seqno = rtx_list[j] * _mss + 1;
         bool last_packet = (seqno + _mss - 1) >= _flow_size;
         switch (_route_strategy) {
         case SCATTER_PERMUTE:
@@ -1138,6 +1280,19 @@ NdpSrc::retransmit_packet() {
     update_rtx_time();
 }
 
+simtime_picosec NdpSrc::rtx_timer_due() const {
+#ifndef RESEND_ON_TIMEOUT
+    return RtxTimerClient::IDLE;
+#else
+    if (_rtx_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    // rtx_timer_hook acts up to a scan period early, and schedules
+    // the retransmit for the timeout proper
+    simtime_picosec period = rtx_timer_wheel()->scanPeriod();
+    return _rtx_timeout > period ? _rtx_timeout - period : 0;
+#endif
+}
+
 void NdpSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
 #ifndef RESEND_ON_TIMEOUT
     return;  // if we're using RTS, we shouldn't need to also use
@@ -1282,6 +1437,47 @@ void NdpSink::set_end_trigger(Trigger& end_trigger) {
     _end_trigger = &end_trigger;
 }
 
+void NdpSink::reset() {
+    _src = 0;
+    _route = NULL;
+    _srcaddr = UINT32_MAX;
+    _end_trigger = 0;
+    _cumulative_ack = 0;
+    _drops = 0;
+    _total_received = 0;
+    _ooo = 0;
+    _received.clear();
+    _pull_no = 0;
+    _last_packet_seqno = 0;
+    _highest_seqno = 0;
+    _path_history.clear();
+    _path_hist_index = -1;
+    _path_hist_first = -1;
+
+    _parked_cwnd = 0;
+    _parked_increase = 0;
+    _ecn_decrease = 0;
+    _marked_bytes = 0;
+    _acked_bytes = 0;
+    _alpha = 0.0;
+#ifdef RECORD_PATH_LENS
+    for (uint32_t i = 0; i < MAX_PATH_LEN+1; i++) {
+        _path_lens[i]=0;
+        _trimmed_path_lens[i]=0;
+    }
+#endif
+
+    // the paths were copied for this flow's src
+    for (size_t i = 0; i < _paths.size(); i++) {
+        delete _paths[i];
+    }
+    _paths.clear();
+    _original_paths.clear();
+    _path_ids.clear();
+    _crt_path = 0;
+    _log_me = false;
+}
+
 void NdpSink::log_me() {
     // avoid looping
     if (_log_me == true)
@@ -1328,16 +1524,25 @@ void NdpSink::connect(NdpSrc& src, Route* route)
 
 /* sets the set of paths to be used when sending from this NdpSink back to the NdpSrc */
 void NdpSink::set_paths(vector<const Route*>* rt_list){
+    PathList paths(*rt_list);
+    set_paths(paths, 0, 0);
+}
+
+void NdpSink::set_paths(PathSource& paths, uint32_t src, uint32_t dest){
     switch (_route_strategy) {
     case SCATTER_PERMUTE:
     case SCATTER_RANDOM:
     case PULL_BASED:
     case SCATTER_ECMP:
+    {
         assert(_paths.size() == 0);
-        _paths.resize(rt_list->size());
-        _path_ids.resize(rt_list->size());
-        for (unsigned int i=0;i<rt_list->size();i++){
-            Route* t = new Route(*(rt_list->at(i)), *_src);
+        uint32_t no_of_paths = paths.no_of_paths(src, dest);
+        _paths.resize(no_of_paths);
+        _path_ids.resize(no_of_paths);
+        for (unsigned int i=0;i<no_of_paths;i++){
+            const Route* path = paths.get_path(src, dest, i);
+            Route* t = new Route(*path, *_src);
+            paths.put_path(path);
             //Route* t = new Route(*(rt_list->at(i)));
             t->add_endpoints(this, _src);
             _paths[i]=t;
@@ -1346,6 +1551,7 @@ void NdpSink::set_paths(vector<const Route*>* rt_list){
         _crt_path = 0;
         permute_paths();
         break;
+    }
     case SINGLE_PATH:
     case ECMP_FIB:
     case ECMP_FIB_ECN:
@@ -1549,35 +1755,23 @@ void NdpSink::receivePacket(Packet& pkt) {
     if (seqno == _cumulative_ack+1) { // it's the next expected seq no
                 _cumulative_ack = seqno + size - 1;
                 // are there any additional received packets we can now ack?
-                while (!_received.empty() && (_received.front() == _cumulative_ack+1) ) {
-                        _received.pop_front();
-                        _cumulative_ack+= size;
-                        if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
+                uint64_t held = _received.consume(_cumulative_ack / size);
+                _cumulative_ack += held * size;
+                if (_buffer_logger) {
+                        for (uint64_t i = 0; i < held; i++)
+                                _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
                 }
     } else if (seqno < _cumulative_ack+1) {
                 //must have been a bad retransmit
     } else { // it's not the next expected sequence number
-                if (_received.empty()) {
-                        _received.push_front(seqno);
+                uint64_t n = (seqno - 1) / size;
+                if (!_received.contains(n)) { // else it's a bad retransmit
+                        _received.insert(n);
                         if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                        
+
                         //commenting out the code below, probably copied from TCP and innacurate for NDP where reordering is expected
                         //it's a drop in this simulator there are no reorderings.
                         //_drops += (size + seqno-_cumulative_ack-1)/size;
-                } else if (seqno > _received.back()) { // likely case
-                        _received.push_back(seqno);
-                        if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                } 
-                else { // uncommon case - it fills a hole
-                        list<uint64_t>::iterator i;
-                        for (i = _received.begin(); i != _received.end(); i++) {
-                                if (seqno == *i) break; // it's a bad retransmit
-                                if (seqno < (*i)) {
-                                        _received.insert(i, seqno);
-                                        if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                                        break;
-                                }
-                    }
                 }
                 if (_ooo < _received.size())
                         _ooo = _received.size();
@@ -2117,32 +2311,3 @@ void NdpRTSPacer::doNextEvent(){
         cout << "Empty RTS pacer queue at " << timeAsMs(eventlist().now()) << endl;
     }
 }
-
-
-////////////////////////////////////////////////////////////////
-//  NDP RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-NdpRtxTimerScanner::NdpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-  : EventSource(eventlist,"RtxScanner"), 
-    _scanPeriod(scanPeriod)
-{
-    eventlist.sourceIsPendingRel(*this, 0);
-}
-
-void 
-NdpRtxTimerScanner::registerNdp(NdpSrc &tcpsrc)
-{
-    _tcps.push_back(&tcpsrc);
-}
-
-void
-NdpRtxTimerScanner::doNextEvent() 
-{
-    simtime_picosec now = eventlist().now();
-    tcps_t::iterator i;
-    for (i = _tcps.begin(); i!=_tcps.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
@@ -9,12 +9,17 @@
 
 #include <list>
 #include <map>
+#include <set>
 #include "config.h"
 #include "network.h"
 #include "ndppacket.h"
 #include "priopullqueue.h"
 #include "trigger.h"
 #include "eventlist.h"
+#include "rtx_timer.h"
+#include "memory_account.h"
+#include "seq_ring.h"
+#include "seq_bitmap.h"
 
 #define timeInf 0
 #define NDP_PACKET_SCATTER
@@ -47,9 +52,10 @@ class ReceiptEvent {
     bool _is_header;
 };
 
-class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
+class NdpSrc : public PacketSink, public EventSource, public TriggerTarget, public RtxTimerClient {
     friend class NdpSink;
  public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     NdpSrc(NdpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist, bool rts = false, NdpRTSPacer* pacer = NULL);
     virtual void connect(Route* routeout, Route* routeback, NdpSink& sink, simtime_picosec startTime);
 
@@ -76,6 +82,11 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
 
     void set_end_trigger(Trigger& trigger);
 
+    // once a flow is done, forget it so the src can be connected
+    // again.  It keeps its loggers, RTS pacer, end trigger and flow id,
+    // and frees the copies of the paths it was given.
+    void reset();
+
     virtual void doNextEvent();
     virtual void receivePacket(Packet& pkt);
 
@@ -86,9 +97,12 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     void replace_route(Route* newroute);
 
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due() const;
     
     //used by all routing strategies except SINGLE and ECMP_FIB
     void set_paths(vector<const Route*>* rt);
+    // the same, taking copies of the paths from src to dest by index
+    void set_paths(PathSource& paths, uint32_t src, uint32_t dest);
 
     //used by ECMP_FIB strategy
     void set_paths(uint32_t path_count);
@@ -133,8 +147,27 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     vector <int16_t> _avoid_score; //keeps path scores
     vector <bool> _bad_path; //keeps path scores
 
-    map<NdpPacket::seq_t, simtime_picosec> _sent_times;
-    map<NdpPacket::seq_t, simtime_picosec> _first_sent_times;
+    // What we know about each packet of the window, by packet number
+    // - (seqno-1)/_mss.  A packet is in flight from when it's sent
+    // until it's acked, nacked or bounced; its first send time is kept
+    // until it's acked, for the RTT histogram.
+    struct sendRecord {
+        sendRecord() : sent_time(0), first_sent_time(0), rtx_pkt(NULL), in_flight(false), first_sent(false) {};
+        simtime_picosec sent_time; // when it's expected to leave the host queue
+        simtime_picosec first_sent_time;
+        NdpPacket* rtx_pkt; // when it's waiting in _rtx_queue
+        bool in_flight;
+        bool first_sent;
+    };
+    SeqRing<sendRecord> _tx_records;
+    // Records for packets the window has already moved past, which come
+    // back when a late NACK or bounce asks for one to be resent.  Almost
+    // always empty.
+    map<uint64_t, sendRecord> _late_records;
+    // (sent_time, packet) of packets in flight, earliest first; entries
+    // are left behind when a packet stops being in flight or is resent,
+    // and dropped when they reach the top
+    vector<pair<simtime_picosec, uint64_t> > _sent_heap;
 
     void print_stats();
 
@@ -188,6 +221,7 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     NdpLogger* _logger;
     TrafficLogger* _pktlogger;
     Trigger* _end_trigger;
+    bool _finished; // the end trigger has fired for this flow
 
     // Connectivity
     PacketFlow _flow;
@@ -206,7 +240,13 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     void retransmit_packet();
     void permute_paths();
     void update_rtx_time();
-    void process_cumulative_ack(NdpPacket::seq_t cum_ackno);
+    uint64_t pkt_index(NdpPacket::seq_t seqno) const {return (seqno - 1) / _mss;}
+    sendRecord& tx_record(uint64_t n);
+    sendRecord get_tx_record(uint64_t n) const;
+    void set_sent_time(uint64_t n, simtime_picosec sent_time);
+    void clear_sent_time(uint64_t n);
+    void queue_rtx(uint64_t n, NdpPacket* pkt);
+    void release_send_records();
     inline void count_ack(int32_t path_id) {count_feedback(path_id, ACK);}
     inline void count_nack(int32_t path_id) {count_feedback(path_id, NACK);}
     inline void count_bounce(int32_t path_id) {count_feedback(path_id, BOUNCE);}
@@ -218,7 +258,8 @@ class NdpSrc : public PacketSink, public EventSource, public TriggerTarget {
     NdpPull::seq_t _max_pull;
     uint64_t _flow_size;  //The flow size in bytes.  Stop sending after this amount.
     simtime_picosec _stop_time;
-    map <NdpPacket::seq_t, NdpPacket*> _rtx_queue; //Packets queued for (hopefuly) imminent retransmission
+    SeqBitmap _rtx_queue; // packets queued for (hopefully) imminent retransmission; they're in _tx_records
+    set<uint64_t> _late_rtx_queue; // the same, for packets in _late_records; these go first
 };
 
 class NdpPullPacer;
@@ -227,6 +268,7 @@ class NdpRTSPacer;
 class NdpSink : public PacketSink, public DataReceiver {
     friend class NdpSrc;
  public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     NdpSink(EventList& ev, linkspeed_bps linkspeed, double pull_rate_modifier);
     NdpSink(NdpPullPacer* pacer);
 
@@ -253,7 +295,10 @@ class NdpSink : public PacketSink, public DataReceiver {
     void set_src(uint32_t s) {_srcaddr = s;}
     void set_end_trigger(Trigger& trigger);
 
-    list<NdpAck::seq_t> _received; // list of packets above a hole, that we've received
+    // the same as NdpSrc::reset(), keeping the pull pacer
+    void reset();
+
+    SeqBitmap _received; // packets above a hole that we've received, by (seqno-1)/size
  
     NdpSrc* _src;
 
@@ -265,6 +310,8 @@ class NdpSink : public PacketSink, public DataReceiver {
     
     //needed by all strategies except SINGLE and ECMP_FIB
     void set_paths(vector<const Route*>* rt);
+    // the same, taking copies of the paths from src to dest by index
+    void set_paths(PathSource& paths, uint32_t src, uint32_t dest);
     void set_paths(uint32_t no_of_paths);
 
 #ifdef RECORD_PATH_LENS
@@ -414,17 +461,5 @@ class NdpRTSPacer : public EventSource {
     simtime_picosec _packet_drain_time;
 };
 
-
-class NdpRtxTimerScanner : public EventSource {
- public:
-    NdpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerNdp(NdpSrc &tcpsrc);
- private:
-    simtime_picosec _scanPeriod;
-    typedef list<NdpSrc*> tcps_t;
-    tcps_t _tcps;
-};
-
 #endif
 
@@ -76,6 +76,13 @@ NdpSrcTransfer::receivePacket(Packet& pkt){
   }
 }
 
+simtime_picosec NdpSrcTransfer::rtx_timer_due() const {
+    // we report timeouts even when NdpSrc won't act on them
+    if (_rtx_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    return min(_rtx_timeout + 1, NdpSrc::rtx_timer_due());
+}
+
 void NdpSrcTransfer::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
   if (!_is_active) return;
 
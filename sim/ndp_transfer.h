@@ -25,6 +25,7 @@ public:
     void connect(route_t* routeout, route_t* routeback, NdpSink& sink, simtime_picosec starttime);
 
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due() const;
     virtual void receivePacket(Packet& pkt);
     void reset(uint64_t bb, int rs);
     virtual void doNextEvent();
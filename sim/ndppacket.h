@@ -108,15 +108,15 @@ protected:
     seq_t _pacerno;  // the pacer sequence number from the pull, seq space is common to all flows on that pacer
     simtime_picosec _ts;
 
-    bool _retransmitted;
     int32_t _no_of_paths;  // how many paths are in the sender's
     // list.  A real implementation would not
     // send this in every packet, but this is
     // simulation, and this is easiest to
     // implement
-    bool _last_packet;  // set to true in the last packet in a flow.
     int32_t _trim_hop;
-    packet_direction _trim_direction;
+    packet_direction _trim_direction : 8;
+    bool _retransmitted;
+    bool _last_packet;  // set to true in the last packet in a flow.
     static PacketDB<NdpPacket> _packetdb;
 };
 
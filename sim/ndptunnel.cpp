@@ -133,6 +133,7 @@ void NdpTunnelSrc::startflow(){
     _packets_sent = 0;
     _rtx_timeout_pending = false;
     _rtx_timeout = timeInf;
+    rtx_timer_update();
     _pull_window = 0;
     
     _flight_size = 0;
@@ -150,7 +151,7 @@ void NdpTunnelSrc::connect(Route& routeout, Route& routeback, NdpTunnelSink& sin
     
     _sink = &sink;
     _flow.set_id(get_id()); // identify the packet flow with the NDP source that generated it
-    _flow._name = _name;
+    _flow.copyName(*this);
     _sink->connect(*this, routeback);
   
     //debugging hacks
@@ -177,23 +178,12 @@ void NdpTunnelSrc::processNack(const NdpNack& nack){
     NdpTunnelPacket* p = NULL;
     
     //bool last_packet = (nack.ackno() + _mss - 1) >= _flow_size;
-    _sent_times.erase(nack.ackno());
 
     //_flight_size -= _mss;
-    //remove packet from _inflight
-    list <NdpTunnelPacket*>::iterator rit;
-
-    bool found = false;
-    for (rit = _inflight.begin(); rit!=_inflight.end(); ++rit){
-        p = (NdpTunnelPacket*)*rit;        
-        if (p->seqno() == nack.ackno()){
-            found = true;
-            _inflight.erase(rit);
-            break;
-        }
-    };
-
-    assert(found);
+    //it's no longer in flight
+    uint64_t n = pkt_index(nack.ackno());
+    p = _sent_packets.get(n);
+    assert(p);
     assert(_flight_size>=0);
     
     //p = NdpTunnelPacket::newpkt(_flow, *_route, nack.ackno(), 0, _mss, true,
@@ -235,10 +225,6 @@ void NdpTunnelSrc::processAck(const NdpAck& ack) {
       else
       printf("Receive ACK (----): %s\n", ack.pull_bitmap().to_string().c_str());
     */
-    log_rtt(_first_sent_times[ackno]);
-    _first_sent_times.erase(ackno);
-    _sent_times.erase(ackno);
-
     // Compute rtt.  This comes originally from TCP, and may not be optimal for NDP */
     uint64_t m = eventlist().now()-ts;
 
@@ -277,21 +263,12 @@ void NdpTunnelSrc::processAck(const NdpAck& ack) {
 
     //_flight_size -= _mss;
 
-    //remove packet from _inflight
-    list<NdpTunnelPacket*>::iterator rit;
-
-    bool found = false;
-    NdpTunnelPacket* crt = NULL;
-    for (rit = _inflight.begin(); rit!=_inflight.end(); ++rit){
-        crt = (NdpTunnelPacket*)*rit;        
-        if (crt->seqno() == ackno){
-            found = true;
-            _inflight.erase(rit);
-            break;
-        }
-    };
-
-    assert(found);
+    //we're done with the packet
+    uint64_t n = pkt_index(ackno);
+    NdpTunnelPacket* crt = _sent_packets.get(n);
+    assert(crt);
+    _sent_packets[n] = NULL;
+    release_sent_packets();
     crt->free();
     
     assert(_flight_size>=0);
@@ -459,7 +436,6 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
             p->set_route(*rt);
         }
 
-        _inflight.push_back(p);
         _flight_size += _mss;
         
         p->sendOn();
@@ -469,6 +445,7 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
         update_rtx_time();
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }
         return 1;
     }
@@ -506,7 +483,7 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
         p->set_ts(eventlist().now());
       
         _flight_size += _mss;
-        _inflight.push_back(p);
+        _sent_packets[pkt_index(p->seqno())] = p;
 
         //refcount to remember we saved this locally.
         p->save_state();
@@ -521,6 +498,7 @@ int NdpTunnelSrc::send_packet(NdpPull::seq_t pacer_no) {
       
         if (_rtx_timeout == timeInf) {
             _rtx_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }
         return 1;
     }
@@ -539,39 +517,18 @@ void NdpTunnelSrc::permute_paths() {
 
 void 
 NdpTunnelSrc::update_rtx_time() {
-    //simtime_picosec now = eventlist().now();
-    if (_sent_times.empty()) {
-        _rtx_timeout = timeInf;
-        return;
-    }
-    map<NdpTunnelPacket::seq_t, simtime_picosec>::iterator i;
-    simtime_picosec first_senttime = timeInf;
-    int c = 0;
-    for (i = _sent_times.begin(); i != _sent_times.end(); i++) {
-        simtime_picosec sent = i->second;
-        if (sent < first_senttime || first_senttime == timeInf) {
-            first_senttime = sent;
-        }
-        c++;
-    }
-    _rtx_timeout = first_senttime + _rto;
+    // send times aren't tracked until retransmit_packet is implemented,
+    // so there's never anything to time out
+    _rtx_timeout = timeInf;
+    rtx_timer_update();
 }
- 
+
 void 
-NdpTunnelSrc::process_cumulative_ack(NdpTunnelPacket::seq_t cum_ackno) {
-    map<NdpTunnelPacket::seq_t, simtime_picosec>::iterator i, i_next;
-    i = _sent_times.begin();
-    while (i != _sent_times.end()) {
-        if (i->first <= cum_ackno) {
-            i_next = i; //juggling to keep i valid
-            i_next++;
-            _sent_times.erase(i);
-            i = i_next;
-        } else {
-            return;
-        }
-    }
-    //need to call update_rtx_time right after this!
+NdpTunnelSrc::release_sent_packets() {
+    // move the window past packets that have been acked
+    uint64_t next = _highest_sent / _mss;
+    while (_sent_packets.base() < next && !_sent_packets.get(_sent_packets.base()))
+        _sent_packets.advance(_sent_packets.base() + 1);
 }
 
 void 
@@ -645,6 +602,19 @@ NdpTunnelSrc::retransmit_packet() {
     update_rtx_time();*/
 }
 
+simtime_picosec NdpTunnelSrc::rtx_timer_due() const {
+#ifndef RESEND_ON_TIMEOUT
+    return RtxTimerClient::IDLE;
+#else
+    if (_rtx_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    // rtx_timer_hook acts up to a scan period early, and schedules
+    // the retransmit for the timeout proper
+    simtime_picosec period = rtx_timer_wheel()->scanPeriod();
+    return _rtx_timeout > period ? _rtx_timeout - period : 0;
+#endif
+}
+
 void NdpTunnelSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
 #ifndef RESEND_ON_TIMEOUT
     return;  // if we're using RTS, we shouldn't need to also use
@@ -714,6 +684,7 @@ NdpTunnelSink::NdpTunnelSink(EventList& event, linkspeed_bps linkspeed, double p
     _last_packet_seqno = 0;
     _log_me = false;
     _total_received = 0;
+    _received_count = 0;
 }
 
 /* Use this constructor when there are multiple flows to one receiver
@@ -728,6 +699,7 @@ NdpTunnelSink::NdpTunnelSink(NdpTunnelPullPacer* pacer) : DataReceiver("ndp_sink
     _last_packet_seqno = 0;
     _log_me = false;
     _total_received = 0;
+    _received_count = 0;
 }
 
 void NdpTunnelSink::log_me() {
@@ -858,41 +830,34 @@ void NdpTunnelSink::receivePacket(Packet& pkt) {
         //p->free();
   
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (_received.front()->seqno() == _cumulative_ack+1) ) {
-            NdpTunnelPacket * f = _received.front();
+        uint64_t next = _cumulative_ack / size;
+        while (_received_count > 0 && _received.get(next)) {
+            NdpTunnelPacket * f = _received.get(next);
 
             //cout << "Out of order delivery new PKT " << seqno << " ACK " << _cumulative_ack << " flow " << p->flow().flow_id() << endl;          
             inner = f->inner_packet();
             f->free();
 
-            _received.pop_front();
+            _received[next] = NULL;
+            _received_count--;
+            next++;
 
             inner->sendOn();
             //send this packet ON!
             _cumulative_ack+= size;
         }
+        _received.advance(next);
     } else if (seqno < _cumulative_ack+1) {
 
         assert(0);
 
     } else { // it's not the next expected sequence number
-        p->inc_ref_count();
-        p->inner_packet()->inc_ref_count();
-      
-        if (_received.empty()) {
-            _received.push_front(p);
-        } else if (seqno > _received.back()->seqno()) { // likely case
-            _received.push_back(p);
-        } 
-        else { // uncommon case - it fills a hole
-            list<NdpTunnelPacket*>::iterator i;
-            for (i = _received.begin(); i != _received.end(); i++) {
-                if (seqno == (*i)->seqno()) break; // it's a bad retransmit
-                if (seqno < (*i)->seqno()) {
-                    _received.insert(i, p);
-                    break;
-                }
-            }
+        NdpTunnelPacket*& slot = _received[(seqno - 1) / size];
+        if (!slot) { // else it's a bad retransmit
+            p->inc_ref_count();
+            p->inner_packet()->inc_ref_count();
+            slot = p;
+            _received_count++;
         }
     }
     send_ack(ts, seqno, pacer_no);
@@ -1190,32 +1155,3 @@ void NdpTunnelPullPacer::doNextEvent(){
         //    cout << "Empty pacer queue at " << timeAsMs(eventlist().now()) << endl; 
     }
 }
-
-
-////////////////////////////////////////////////////////////////
-//  NDP TUNNEL RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-NdpTunnelRtxTimerScanner::NdpTunnelRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-  : EventSource(eventlist,"RtxScanner"), 
-    _scanPeriod(scanPeriod)
-{
-    eventlist.sourceIsPendingRel(*this, 0);
-}
-
-void 
-NdpTunnelRtxTimerScanner::registerNdp(NdpTunnelSrc &tcpsrc)
-{
-    _tcps.push_back(&tcpsrc);
-}
-
-void
-NdpTunnelRtxTimerScanner::doNextEvent() 
-{
-    simtime_picosec now = eventlist().now();
-    tcps_t::iterator i;
-    for (i = _tcps.begin(); i!=_tcps.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
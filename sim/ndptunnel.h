@@ -22,6 +22,8 @@ enum RouteStrategy {NOT_SET, SINGLE_PATH, SCATTER_PERMUTE, SCATTER_RANDOM, PULL_
 #include "ndptunnelpacket.h"
 #include "fairpullqueue.h"
 #include "eventlist.h"
+#include "rtx_timer.h"
+#include "seq_ring.h"
 
 #define timeInf 0
 #define NDP_PACKET_SCATTER
@@ -32,7 +34,7 @@ enum RouteStrategy {NOT_SET, SINGLE_PATH, SCATTER_PERMUTE, SCATTER_RANDOM, PULL_
 
 class NdpTunnelSink;
 
-class NdpTunnelSrc : public PacketSink, public EventSource {
+class NdpTunnelSrc : public PacketSink, public EventSource, public RtxTimerClient {
     friend class NdpTunnelSink;
 
 public:
@@ -57,6 +59,7 @@ public:
     void replace_route(Route* newroute);
 
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due() const;
     void set_paths(vector<const Route*>* rt);
 
     // should really be private, but loggers want to see:
@@ -81,9 +84,6 @@ public:
     vector<const Route*> _paths;
     vector<const Route*> _original_paths; //paths in original permutation order
 
-    map<NdpTunnelPacket::seq_t, simtime_picosec> _sent_times;
-    map<NdpTunnelPacket::seq_t, simtime_picosec> _first_sent_times;
-
     int _pull_window; // Used to keep track of expected pulls so we
                       // can handle return-to-sender cleanly.
                       // Increase by one for each Ack/Nack received.
@@ -143,7 +143,8 @@ public:
     void retransmit_packet();
     void permute_paths();
     void update_rtx_time();
-    void process_cumulative_ack(NdpTunnelPacket::seq_t cum_ackno);
+    uint64_t pkt_index(NdpTunnelPacket::seq_t seqno) const {return (seqno - 1) / _mss;}
+    void release_sent_packets();
 
     void log_rtt(simtime_picosec sent_time);
     NdpPull::seq_t _last_pull;
@@ -151,8 +152,10 @@ public:
 
     uint32_t _qs,_maxqs;
     list<Packet*> _queue;
-    list<NdpTunnelPacket*> _inflight;
-    list<NdpTunnelPacket*> _rtx_queue; //Packets queued for (hopefuly) imminent retransmission
+    // packets sent and not yet acked, by (seqno-1)/_mss; they're in
+    // flight unless they're in _rtx_queue
+    SeqRing<NdpTunnelPacket*> _sent_packets;
+    list<NdpTunnelPacket*> _rtx_queue; //Packets queued for (hopefuly) imminent retransmission, oldest NACK first
 };
 
 class NdpTunnelPullPacer;
@@ -166,14 +169,15 @@ class NdpTunnelSink : public PacketSink, public DataReceiver {
     void receivePacket(Packet& pkt);
     NdpAck::seq_t _cumulative_ack; // the packet we have cumulatively acked
     uint32_t _drops;
-    uint64_t cumulative_ack() { return _cumulative_ack + _received.size()*9000;}
+    uint64_t cumulative_ack() { return _cumulative_ack + _received_count*9000;}
     uint64_t total_received() const { return _total_received;}
     uint32_t drops(){ return _src->_drops;}
     virtual const string& nodename() { return _nodename; }
     void increase_window() {_pull_no++;} 
     static void setRouteStrategy(RouteStrategy strat) {_route_strategy = strat;}
 
-    list<NdpTunnelPacket*> _received; // list of packets above a hole, that we've received
+    SeqRing<NdpTunnelPacket*> _received; // packets above a hole that we've received, by (seqno-1)/size
+    uint64_t _received_count;
  
     NdpTunnelSrc* _src;
 
@@ -259,17 +263,5 @@ class NdpTunnelPullPacer : public EventSource {
     int _preferred_flow;
 };
 
-
-class NdpTunnelRtxTimerScanner : public EventSource {
- public:
-    NdpTunnelRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerNdp(NdpTunnelSrc &tcpsrc);
- private:
-    simtime_picosec _scanPeriod;
-    typedef list<NdpTunnelSrc*> tcps_t;
-    tcps_t _tcps;
-};
-
 #endif
 
@@ -105,14 +105,16 @@ protected:
     seq_t _seqno;
     seq_t _pacerno;  // the pacer sequence number from the pull, seq space is common to all flows on that pacer
     simtime_picosec _ts;
-    bool _retransmitted;
+    Packet* _encap_packet;
     int32_t _no_of_paths;  // how many paths are in the sender's
     // list.  A real implementation would not
     // send this in every packet, but this is
     // simulation, and this is easiest to
     // implement
 
-    Packet* _encap_packet;
+    // the header save_state() keeps while the packet is trimmed
+    uint16_t _oldsize, _oldnexthop;
+    bool _retransmitted;
     bool _last_packet;  // set to true in the last packet in a flow.
     
     static PacketDB<NdpTunnelPacket> _packetdb;
@@ -1,9 +1,11 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*- 
+#include <algorithm>
+#include <cxxabi.h>
+#include <stdio.h>
+#include <sys/mman.h>
 #include "network.h"
+#include "checkpoint.h"
 
-#define DEFAULTDATASIZE 1500
-int Packet::_data_packet_size = DEFAULTDATASIZE;
-bool Packet::_packet_size_fixed = false;
 PacketFlow Packet::_defaultFlow(nullptr);
 
 // use set_attrs only when we want to do a late binding of the route -
@@ -12,10 +14,8 @@ void
 Packet::set_attrs(PacketFlow& flow, int pkt_size, packetid_t id){
     _flow = &flow;
     _size = pkt_size;
-    _oldsize = pkt_size;
     _id = id;
     _nexthop = 0;
-    _oldnexthop = 0;
     //_detour = NULL;
     _route = 0;
     _is_header = 0;
@@ -28,10 +28,8 @@ Packet::set_route(PacketFlow& flow, const Route &route, int pkt_size,
                   packetid_t id){
     _flow = &flow;
     _size = pkt_size;
-    _oldsize = pkt_size;
     _id = id;
     _nexthop = 0;
-    _oldnexthop = 0;    
     //_detour = NULL;
     _route = &route;
     _is_header = 0;
@@ -143,6 +141,31 @@ void
 Packet::free() {
 }
 
+void
+Packet::checkpoint(CheckpointArchive& archive) {
+    archive.route(_route);
+    archive.ref(_next_routed_hop);
+    archive.ref(_flow);
+    archive.io(_id);
+    archive.io(_flags);
+    archive.io(_dst);
+    archive.io(_src);
+    archive.io(_pathid);
+    archive.io(_size);
+    archive.io(_nexthop);
+    packet_type type = _type;
+    packet_direction direction = _direction;
+    archive.io(type);
+    archive.io(direction);
+    _type = type;
+    _direction = direction;
+    archive.io(_refcount);
+    archive.io(_is_header);
+    archive.io(_bounced);
+    archive.io(_path_len);
+    archive.io(_ingressport);
+}
+
 string
 Packet::str() const {
     string s;
@@ -247,15 +270,138 @@ Packet::str() const {
     return s;
 }
 
-// flow ids above this are dynamically allocated; ones less than this can be manually allocated
-#define FLOW_ID_DYNAMIC_BASE 1000000000
-flowid_t PacketFlow::_max_flow_id = FLOW_ID_DYNAMIC_BASE;
+// Slabs come straight from mmap, so that trimming them really does
+// give the memory back rather than leaving it in the malloc heap.
+#define PACKET_SLAB_BYTES (64*1024)
+
+PacketPoolBase::PacketPoolBase(const std::type_info& type, size_t packet_bytes)
+    : _live(0), _high_water(0), _slabs_released(0), _packet_bytes(packet_bytes)
+{
+    int status;
+    char* name = abi::__cxa_demangle(type.name(), NULL, NULL, &status);
+    _type_name = (status == 0) ? name : type.name();
+    ::free(name);
+
+    _per_slab = max((size_t)1, PACKET_SLAB_BYTES / packet_bytes);
+    _slab_bytes = _per_slab * packet_bytes;
+    PacketArena::current().add(this);
+}
+
+uint64_t
+PacketPoolBase::constructed() const {
+    uint64_t n = 0;
+    for (size_t s = 0; s < _slabs.size(); s++)
+        n += _slabs[s].constructed;
+    return n;
+}
+
+void
+PacketPoolBase::add_slab() {
+    void* mem = mmap(NULL, _slab_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        perror("mmap");
+        abort();
+    }
+    Slab slab;
+    slab.mem = (char*)mem;
+    slab.constructed = 0;
+    _slabs.push_back(slab);
+}
+
+void
+PacketPoolBase::release_slab(const Slab& slab) {
+    munmap(slab.mem, _slab_bytes);
+    _slabs_released++;
+}
+
+vector<size_t>
+PacketPoolBase::slabs_by_address() const {
+    vector<size_t> by_address(_slabs.size());
+    for (size_t s = 0; s < _slabs.size(); s++)
+        by_address[s] = s;
+    sort(by_address.begin(), by_address.end(),
+         [this](size_t a, size_t b) {return _slabs[a].mem < _slabs[b].mem;});
+    return by_address;
+}
+
+size_t
+PacketPoolBase::find_slab(const void* p, const vector<size_t>& by_address) const {
+    // the last slab starting at or below p
+    size_t lo = 0, hi = by_address.size();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (_slabs[by_address[mid]].mem <= (const char*)p)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    if (hi == 0 || (const char*)p < _slabs[by_address[lo]].mem
+        || (const char*)p >= _slabs[by_address[lo]].mem + _slab_bytes)
+        return NONE;
+    return by_address[lo];
+}
+
+size_t
+PacketArena::trim() {
+    size_t released = 0;
+    for (size_t i = 0; i < _pools.size(); i++)
+        released += _pools[i]->trim();
+    return released;
+}
+
+size_t
+PacketArena::bytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < _pools.size(); i++)
+        bytes += _pools[i]->slabs() * _pools[i]->slab_bytes();
+    return bytes;
+}
+
+uint64_t
+PacketArena::packets() const {
+    uint64_t packets = 0;
+    for (size_t i = 0; i < _pools.size(); i++)
+        packets += _pools[i]->constructed();
+    return packets;
+}
+
+void
+PacketArena::report(ostream& out) {
+    vector<PacketPoolBase*> pools(_pools);
+    sort(pools.begin(), pools.end(), [](PacketPoolBase* a, PacketPoolBase* b) {
+            return a->high_water() * (int64_t)a->packet_bytes() > b->high_water() * (int64_t)b->packet_bytes();
+        });
+    size_t bytes = 0, slabs = 0;
+    int64_t leaked = 0;
+    for (size_t i = 0; i < pools.size(); i++) {
+        bytes += pools[i]->slabs() * pools[i]->slab_bytes();
+        slabs += pools[i]->slabs();
+        leaked += pools[i]->live();
+    }
+    out << "Packet memory: " << bytes / 1024 << " KB in " << slabs << " slabs" << endl;
+    for (size_t i = 0; i < pools.size(); i++) {
+        PacketPoolBase* p = pools[i];
+        out << "  " << p->type_name() << " (" << p->packet_bytes() << " bytes): "
+            << p->slabs() << " slabs, " << p->constructed() << " packets, high water "
+            << p->high_water() << ", live " << p->live();
+        if (p->slabs_released())
+            out << ", " << p->slabs_released() << " slabs trimmed";
+        out << endl;
+    }
+    if (leaked > 0) {
+        out << "Packets never freed (in flight at the end, or leaked): " << leaked << ",";
+        for (size_t i = 0; i < pools.size(); i++)
+            if (pools[i]->live() > 0)
+                out << " " << pools[i]->type_name() << " " << pools[i]->live();
+        out << endl;
+    }
+}
 
 PacketFlow::PacketFlow(TrafficLogger* logger)
     : Logged("PacketFlow"),
       _logger(logger)
 {
-    _flow_id = _max_flow_id++;
+    _flow_id = SimContext::current().new_flow_id();
 }
 
 void PacketFlow::set_flowid(flowid_t id) {
@@ -270,6 +416,14 @@ void PacketFlow::set_logger(TrafficLogger *logger) {
     _logger = logger;
 }
 
+void
+PacketFlow::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(PacketFlow));
+    archive.check(_flow_id, "flow ID");
+    if (_logger)
+        archive.fail("can't save a flow's traffic logger");
+}
+
 void 
 PacketFlow::logTraffic(Packet& pkt, Logged& location, TrafficLogger::TrafficEvent ev) {
     if (_logger)
@@ -285,5 +439,3 @@ void print_route(const Route& route) {
     }
     cout << endl;
 }
-
-Logged::id_t Logged::LASTIDNUM = 1;
@@ -4,8 +4,11 @@
 
 #include <vector>
 #include <iostream>
+#include <typeinfo>
+#include <new>
 #include "config.h"
 #include "loggertypes.h"
+#include "simcontext.h"
 #include "route.h"
 
 class Packet;
@@ -14,6 +17,10 @@ class PacketSink;
 typedef uint32_t packetid_t;
 typedef uint32_t flowid_t;
 
+#define DEFAULTDATASIZE 1500
+// flow ids above this are dynamically allocated; ones less than this can be manually allocated
+#define FLOW_ID_DYNAMIC_BASE 1000000000
+
 void print_route(const Route& route);
 
 class DataReceiver : public Logged {
@@ -35,8 +42,8 @@ class PacketFlow : public Logged {
     void set_flowid(flowid_t id);
     inline flowid_t flow_id() const {return _flow_id;}
     bool log_me() const {return _logger != NULL;}
+    virtual void checkpoint(CheckpointArchive& archive);
  protected:
-    static packetid_t _max_flow_id;
     flowid_t _flow_id;
     TrafficLogger* _logger;
 };
@@ -59,8 +66,6 @@ class VirtualQueue {
     virtual void completedService(Packet& pkt) = 0;
 };
 
-class LosslessInputQueue;
-
 // See tcppacket.h to illustrate how Packet is typically used.
 class Packet {
     friend class PacketFlow;
@@ -70,7 +75,7 @@ class Packet {
     
     /* empty constructor; Packet::set must always be called as
        well. It's a separate method, for convenient reuse */
-    Packet() {_is_header = false; _bounced = false; _type = IP; _flags = 0; _refcount = 0; _dst = UINT32_MAX; _pathid = UINT32_MAX; _direction = NONE; _ingressqueue = NULL;} 
+    Packet() {_is_header = false; _bounced = false; _type = IP; _flags = 0; _refcount = 0; _dst = UINT32_MAX; _pathid = UINT32_MAX; _direction = NONE; _ingressport = NO_PORT;} 
 
     /* say "this packet is no longer wanted". (doesn't necessarily
        destroy it, so it can be reused) */
@@ -83,13 +88,15 @@ class Packet {
         // If someone has already read the value of packet size, no
         // longer allow it to be changed, or all hell will break
         // loose.
-        assert(_packet_size_fixed == false);
-        _data_packet_size = packet_size;
+        SimContext& ctx = SimContext::current();
+        assert(ctx.packet_size_fixed == false);
+        ctx.data_packet_size = packet_size;
     }
 
     static int data_packet_size() {
-        _packet_size_fixed = true;
-        return _data_packet_size;
+        SimContext& ctx = SimContext::current();
+        ctx.packet_size_fixed = true;
+        return ctx.data_packet_size;
     }
 
     virtual PacketSink* sendOn(); // "go on to the next hop along your route"
@@ -133,7 +140,7 @@ class Packet {
         if ((_direction == NONE) || (_direction == UP && d==DOWN)) 
             _direction = d; 
         else {
-            cout << "Current direction is " << _direction << " trying to change it to " << d << endl;
+            cout << "Current direction is " << (int)_direction << " trying to change it to " << d << endl;
             abort();
         }
     }
@@ -154,54 +161,65 @@ class Packet {
     virtual void set_route(const Route *route=nullptr);
     virtual void set_route(PacketFlow& flow, const Route &route, int pkt_size, packetid_t id);
 
-    void set_ingress_queue(LosslessInputQueue* t){assert(!_ingressqueue); _ingressqueue = t;}
-    LosslessInputQueue* get_ingress_queue(){assert(_ingressqueue); return _ingressqueue;}
-    void clear_ingress_queue(){assert(_ingressqueue); _ingressqueue = NULL;}
+    // the switch port of the lossless input queue a packet is waiting
+    // in, while it crosses a switch - see Switch::getIngressPort()
+    static const uint16_t NO_PORT = UINT16_MAX;
+    void set_ingress_port(uint16_t port){assert(_ingressport == NO_PORT); _ingressport = port;}
+    uint16_t ingress_port() const {assert(_ingressport != NO_PORT); return _ingressport;}
+    void clear_ingress_port(){assert(_ingressport != NO_PORT); _ingressport = NO_PORT;}
 
     //    void set_detour(PacketSink* n, int rewind) {_detour = n;_nexthop -= rewind;}
     
     string str() const;
+    // Save or restore the packet; see CheckpointArchive::packet().
+    // Subclasses add their own fields.
+    virtual void checkpoint(CheckpointArchive& archive);
  protected:
     void set_attrs(PacketFlow& flow, int pkt_size, packetid_t id);
 
-    static int _data_packet_size; // default size of a TCP or NDP data packet,
-                                  // measured in bytes
-    static bool _packet_size_fixed; //prevent foot-shooting
-    
-    packet_type _type;
-    
-    uint16_t _size,_oldsize;
-    
-    
-    bool _is_header;
-    bool _bounced; // packet has hit a full queue, and is being bounced back to the sender
+    // Millions of these can be in flight, so they're kept small: with
+    // the vtable pointer, everything here fits in one 64 byte cache
+    // line, the fields every hop touches first.  State only some
+    // packets need lives elsewhere, such as the tunnel's saved header
+    // in NdpTunnelPacket.
+    // print_packet_sizes() shows what each packet type comes to.
+
+    // A packet can contain a route or a routegraph, but not both.
+    // Eventually switch over entirely to RouteGraph?
+    const Route* _route;
+
+    //used when using routing tables in switches, i.e. the packet has no route.
+    PacketSink* _next_routed_hop;
+
+    PacketFlow* _flow{nullptr};
+    packetid_t _id;
     uint32_t _flags; // used for ECN & friends
 
     uint32_t _dst; //used for packets that do not have a route in switched networks.    
     uint32_t _src; // used to return the packet to the source in switched networks.
     uint32_t _pathid;  //used for ECMP hashing.
-    packet_direction _direction; //used to avoid loop in FatTrees.   
-
-    // A packet can contain a route or a routegraph, but not both.
-    // Eventually switch over entirely to RouteGraph?
-    const Route* _route;
 
+    uint16_t _size;
     //PacketSink* _detour;
-    uint32_t _nexthop,_oldnexthop;
+    uint16_t _nexthop;
+
+    packet_type _type : 8;
+    packet_direction _direction : 8; //used to avoid loop in FatTrees.   
 
     //used for tunneling purposes when one packet can be referenced by multiple classes
     uint8_t _refcount;
 
-    //used when using routing tables in switches, i.e. the packet has no route.
-    PacketSink* _next_routed_hop;
+    bool _is_header;
+    bool _bounced; // packet has hit a full queue, and is being bounced back to the sender
+    uint8_t _path_len; // length of the path in hops - used in BCube priority routing with NDP
+    uint16_t _ingressport; // used by lossless switches, in what would otherwise be padding
 
-    packetid_t _id;
-    PacketFlow* _flow{nullptr};
     static PacketFlow _defaultFlow;
-    LosslessInputQueue* _ingressqueue;
-    uint32_t _path_len; // length of the path in hops - used in BCube priority routing with NDP
 };
 
+// sizeof each packet type, for the drivers' start-up output
+void print_packet_sizes(ostream& out);
+
 class PacketSink {
  public:
     PacketSink() { _remoteEndpoint = NULL; }
@@ -226,43 +244,169 @@ class PacketSink {
 // new packet, we can just reuse old packets. Care, though -- the set()
 // method will need to be invoked properly for each new/reused packet
 
+// The free list itself is per simulation, kept in the SimContext.  New
+// packets come a slab at a time - a block of memory holding many
+// packets of one type, constructed as they're first handed out - so
+// each type's packets sit together.  Slabs are only given back by
+// PacketArena::trim(), and only once every packet in them is free.
+class PacketPoolBase : public SimState {
+ public:
+    PacketPoolBase(const std::type_info& type, size_t packet_bytes);
+
+    const string& type_name() const {return _type_name;}
+    size_t packet_bytes() const {return _packet_bytes;}
+    size_t slabs() const {return _slabs.size();}
+    size_t slab_bytes() const {return _slab_bytes;}
+    uint64_t constructed() const;
+    // handed out and not yet freed.  PdesEngine's LPs free each other's
+    // packets, so there only the sum over the LPs means anything.
+    int64_t live() const {return _live;}
+    int64_t high_water() const {return _high_water;}
+    uint64_t slabs_released() const {return _slabs_released;}
+
+    // release slabs holding only free packets; returns the bytes released
+    virtual size_t trim() = 0;
+
+ protected:
+    struct Slab {
+        char* mem;
+        uint32_t constructed;
+    };
+    void add_slab();
+    void release_slab(const Slab& slab);
+    // index into _slabs of the slab holding p, given the slab indices
+    // sorted by address; NONE for a packet from another simulation's pool
+    static const size_t NONE = SIZE_MAX;
+    size_t find_slab(const void* p, const vector<size_t>& by_address) const;
+    vector<size_t> slabs_by_address() const;
+
+    vector<Slab> _slabs;
+    uint32_t _per_slab;
+    int64_t _live, _high_water;
+    uint64_t _slabs_released;
+ private:
+    string _type_name;
+    size_t _packet_bytes;
+    size_t _slab_bytes;
+};
+
 template<class P>
-class PacketDB {
+class PacketPool : public PacketPoolBase {
  public:
-    PacketDB() : _alloc_count(0) {}
-    ~PacketDB() {
-        //cout << "Pkt count: " << _alloc_count << endl;
-        //cout << "Pkt mem used: " << _alloc_count * sizeof(P) << endl;
+    PacketPool() : PacketPoolBase(typeid(P), sizeof(P)) {}
+    ~PacketPool() {
+        for (size_t s = 0; s < _slabs.size(); s++)
+            destroy_slab(_slabs[s]);
     }
     P* allocPacket() {
+        P* p;
         if (_freelist.empty()) {
-            P* p = new P();
-            p->inc_ref_count();
-            /*
-            if (_alloc_count == 0) {
-                cout << "Packet size: " << sizeof(P) << endl;
-            }
-            */
-            _alloc_count++;
-            return p;
+            p = new_packet();
         } else {
-            P* p = _freelist.back();
+            p = _freelist.back();
             _freelist.pop_back();
-            p->inc_ref_count();
-            return p;
         }
+        p->inc_ref_count();
+        if (++_live > _high_water)
+            _high_water = _live;
+        return p;
     };
     void freePacket(P* pkt) {
         assert(pkt->ref_count()>=1);
         pkt->dec_ref_count();
 
-        if (!pkt->ref_count())
+        if (!pkt->ref_count()) {
             _freelist.push_back(pkt);
+            _live--;
+        }
     };
 
+    virtual size_t trim() {
+        vector<size_t> by_address = slabs_by_address();
+        vector<uint32_t> free(_slabs.size(), 0);
+        for (size_t i = 0; i < _freelist.size(); i++) {
+            size_t s = find_slab(_freelist[i], by_address);
+            if (s != NONE)
+                free[s]++;
+        }
+
+        vector<bool> idle(_slabs.size(), false);
+        bool any = false;
+        for (size_t s = 0; s < _slabs.size(); s++) {
+            idle[s] = (free[s] == _slabs[s].constructed);
+            any |= idle[s];
+        }
+        if (!any)
+            return 0;
+
+        // keep the rest of the free list in the order it was in
+        size_t kept = 0;
+        for (size_t i = 0; i < _freelist.size(); i++) {
+            size_t s = find_slab(_freelist[i], by_address);
+            if (s == NONE || !idle[s])
+                _freelist[kept++] = _freelist[i];
+        }
+        _freelist.resize(kept);
+
+        size_t released = 0;
+        kept = 0;
+        for (size_t s = 0; s < _slabs.size(); s++) {
+            if (idle[s]) {
+                destroy_slab(_slabs[s]);
+                released += slab_bytes();
+            } else {
+                _slabs[kept++] = _slabs[s];
+            }
+        }
+        _slabs.resize(kept);
+        return released;
+    }
+
  protected:
+    P* new_packet() {
+        if (_slabs.empty() || _slabs.back().constructed == _per_slab)
+            add_slab();
+        Slab& slab = _slabs.back();
+        P* p = new (reinterpret_cast<P*>(slab.mem) + slab.constructed) P();
+        slab.constructed++;
+        return p;
+    }
+    void destroy_slab(const Slab& slab) {
+        P* packets = reinterpret_cast<P*>(slab.mem);
+        for (uint32_t i = 0; i < slab.constructed; i++)
+            packets[i].~P();
+        release_slab(slab);
+    }
+
     vector<P*> _freelist; // Irek says it's faster with vector than with list
-    int _alloc_count;
+};
+
+// Every PacketPool of a simulation, for reporting on them all at once.
+class PacketArena : public SimState {
+ public:
+    static PacketArena& current() {return SimContext::current().state<PacketArena>();}
+
+    void add(PacketPoolBase* pool) {_pools.push_back(pool);}
+    // Give every slab holding only free packets back to the OS - after
+    // an incast, say.  Returns the bytes released.
+    size_t trim();
+    // Slab memory, high water mark and live packets per packet type.
+    // At the end of a run every packet should have been freed unless
+    // it's still in flight, so the live ones are listed too: they may
+    // be leaks.
+    void report(ostream& out);
+    size_t bytes() const;    // in all the slabs
+    uint64_t packets() const; // ever constructed, free or not
+
+ private:
+    vector<PacketPoolBase*> _pools;
+};
+
+template<class P>
+class PacketDB {
+ public:
+    P* allocPacket() {return SimContext::current().state<PacketPool<P> >().allocPacket();}
+    void freePacket(P* pkt) {SimContext::current().state<PacketPool<P> >().freePacket(pkt);}
 };
 
 
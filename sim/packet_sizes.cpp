@@ -0,0 +1,30 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "network.h"
+#include "tcppacket.h"
+#include "eqdspacket.h"
+#include "rocepacket.h"
+#include "hpccpacket.h"
+#include "constant_cca_packet.h"
+#include "swiftpacket.h"
+#include "strackpacket.h"
+#include "eth_pause_packet.h"
+// ndppacket.h #defines ACKSIZE, which breaks the others' ACKSIZE constants
+#include "ndppacket.h"
+#include "ndptunnelpacket.h"
+
+#define PKTSIZE(T) " " #T " " << sizeof(T)
+
+void
+print_packet_sizes(ostream& out) {
+    out << "Packet sizes (bytes):" << PKTSIZE(Packet) << PKTSIZE(EthPausePacket) << endl;
+    out << " " << PKTSIZE(TcpPacket) << PKTSIZE(TcpAck) << endl;
+    out << " " << PKTSIZE(NdpPacket) << PKTSIZE(NdpAck) << PKTSIZE(NdpNack)
+        << PKTSIZE(NdpPull) << PKTSIZE(NdpRTS) << PKTSIZE(NdpTunnelPacket) << endl;
+    out << " " << PKTSIZE(EqdsDataPacket) << PKTSIZE(EqdsAckPacket) << PKTSIZE(EqdsNackPacket)
+        << PKTSIZE(EqdsPullPacket) << PKTSIZE(EqdsRtsPacket) << endl;
+    out << " " << PKTSIZE(ConstantCcaPacket) << PKTSIZE(ConstantCcaAck) << endl;
+    out << " " << PKTSIZE(SwiftPacket) << PKTSIZE(SwiftAck)
+        << PKTSIZE(STrackPacket) << PKTSIZE(STrackAck) << endl;
+    out << " " << PKTSIZE(RocePacket) << PKTSIZE(RoceAck) << PKTSIZE(RoceNack) << endl;
+    out << " " << PKTSIZE(HPCCPacket) << PKTSIZE(HPCCAck) << PKTSIZE(HPCCNack) << endl;
+}
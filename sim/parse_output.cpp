@@ -375,6 +375,9 @@ int main(int argc, char** argv){
             case Logger::FLOW_EVENT:
                 out = FlowEventLoggerSimple::event_to_str(event);
                 break;
+            case Logger::MEMORY_ACCOUNT:
+                out = MemoryLoggerSampling::event_to_str(event);
+                break;
             }
             bool do_output = true;
             for (size_t f=0; f < filters.size(); f++) {
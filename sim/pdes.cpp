@@ -0,0 +1,402 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include <algorithm>
+#include <iostream>
+#include "pdes.h"
+
+PdesMailbox::PdesMailbox()
+    : _tail(new Block()), _head(_tail), _read(0)
+{
+}
+
+PdesMailbox::~PdesMailbox() {
+    while (_head) {
+        Block* next = _head->next.load(std::memory_order_relaxed);
+        delete _head;
+        _head = next;
+    }
+}
+
+void
+PdesMailbox::push(const pktrecord_t& record) {
+    // only this thread writes published, so it can read it relaxed
+    uint32_t n = _tail->published.load(std::memory_order_relaxed);
+    if (n == BLOCK) {
+        Block* block = new Block();
+        _tail->next.store(block, std::memory_order_release);
+        _tail = block;
+        n = 0;
+    }
+    _tail->records[n] = record;
+    _tail->published.store(n + 1, std::memory_order_release);
+}
+
+bool
+PdesMailbox::pop(pktrecord_t& record) {
+    while (true) {
+        if (_read < _head->published.load(std::memory_order_acquire)) {
+            record = _head->records[_read++];
+            return true;
+        }
+        if (_read < BLOCK)
+            return false;
+        // the sender has moved on from a full block once it links the next
+        Block* next = _head->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        delete _head;
+        _head = next;
+        _read = 0;
+    }
+}
+
+PdesLink::PdesLink(PdesEngine& engine, simtime_picosec delay, uint32_t from, uint32_t to)
+    : Pipe(delay, engine.eventlist(to)), _engine(engine), _from(from), _to(to)
+{
+}
+
+void
+PdesLink::receivePacket(Packet& pkt) {
+    simtime_picosec arrival = _engine.eventlist(_from).now() + delay();
+    if (_engine.sequential()) {
+        // the receiving LP can't have got as far as arrival yet
+        enqueue(pkt, arrival);
+        _engine._lps[_from]->sent++;
+        return;
+    }
+    pktrecord_t r;
+    r.time = arrival;
+    r.pkt = &pkt;
+    _mailbox.push(r);
+    _engine.sent(_from, arrival);
+}
+
+uint32_t
+PdesLink::deliver() {
+    uint32_t n = 0;
+    pktrecord_t r;
+    while (_mailbox.pop(r)) {
+        enqueue(*r.pkt, r.time);
+        n++;
+    }
+    return n;
+}
+
+// While the LPs' threads run a window, cout writes to one of these,
+// which files what each thread writes under its LP, the time it was
+// written at and the order of the source whose event wrote it - and of
+// the client whose hook wrote it, if that was a timer wheel.  Anything
+// else - there shouldn't be anything - goes straight through.
+class PdesEngine::Capture : public std::streambuf {
+public:
+    Capture(std::streambuf* out) : _out(out) {}
+    std::streambuf* out() const {return _out;}
+
+protected:
+    virtual std::streamsize xsputn(const char* s, std::streamsize n) {
+        Lp* lp = PdesEngine::_current_lp;
+        if (!lp)
+            return _out->sputn(s, n);
+        EventList& el = *lp->context->eventlist();
+        simtime_picosec now = el.now();
+        uint32_t order = el.running() ? el.running()->order() : 0;
+        EventSource* client = lp->context->random_source();
+        uint32_t sub = client && client != el.running() ? client->order() : 0;
+        vector<OutputChunk>& output = lp->output;
+        if (output.empty() || output.back().when != now
+            || output.back().order != order || output.back().sub != sub) {
+            output.push_back(OutputChunk());
+            output.back().when = now;
+            output.back().order = order;
+            output.back().sub = sub;
+        }
+        output.back().text.append(s, n);
+        return n;
+    }
+    virtual int_type overflow(int_type c) {
+        if (traits_type::eq_int_type(c, traits_type::eof()))
+            return traits_type::not_eof(c);
+        char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+    virtual int sync() {
+        return PdesEngine::_current_lp ? 0 : _out->pubsync();
+    }
+
+private:
+    std::streambuf* _out;
+};
+
+thread_local PdesEngine::Lp* PdesEngine::_current_lp = NULL;
+
+PdesEngine::PdesEngine(uint32_t lps)
+    : _sequential(false), _endtime(0), _lookahead(0), _window_start(0), _window_end(0),
+      _generation(0), _running(0), _stopping(false),
+      _windows(0), _critical_path(0)
+{
+    assert(lps > 0);
+    SimContext& parent = SimContext::current();
+    for (uint32_t lp = 0; lp < lps; lp++) {
+        Lp* l = new Lp();
+        l->context = new SimContext();
+        l->context->data_packet_size = parent.data_packet_size;
+        l->context->packet_size_fixed = parent.packet_size_fixed;
+        l->context->copy_random(parent);
+        l->context->bind();
+        new EventList();
+        l->earliest_sent = UINT64_MAX;
+        l->window_events = 0;
+        l->events = 0;
+        l->sent = 0;
+        _lps.push_back(l);
+    }
+    parent.bind();
+}
+
+PdesEngine::~PdesEngine() {
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stopping = true;
+    }
+    _start.notify_all();
+    for (size_t i = 0; i < _threads.size(); i++)
+        _threads[i].join();
+    // the contexts, and everything built in them, outlive the engine
+    for (size_t i = 0; i < _lps.size(); i++)
+        delete _lps[i];
+}
+
+void
+PdesEngine::setEndtime(simtime_picosec endtime) {
+    _endtime = endtime;
+    for (uint32_t lp = 0; lp < lps(); lp++)
+        eventlist(lp).setEndtime(endtime);
+}
+
+PdesLink*
+PdesEngine::new_link(simtime_picosec delay, uint32_t from, uint32_t to) {
+    assert(from < lps() && to < lps() && from != to);
+    assert(delay > 0);
+    PdesLink* link = new PdesLink(*this, delay, from, to);
+    _links.push_back(link);
+    _lps[to]->inbound.push_back(link);
+    if (_lookahead == 0 || delay < _lookahead)
+        _lookahead = delay;
+    return link;
+}
+
+bool
+PdesEngine::next_time(simtime_picosec& when) {
+    // packets still in the mailboxes count as pending
+    bool any = false;
+    for (uint32_t lp = 0; lp < lps(); lp++) {
+        simtime_picosec t;
+        if (eventlist(lp).nextEventTime(t) && (!any || t < when)) {
+            when = t;
+            any = true;
+        }
+        t = _lps[lp]->earliest_sent;
+        if (t != UINT64_MAX && (!any || t < when)) {
+            when = t;
+            any = true;
+        }
+    }
+    return any;
+}
+
+bool
+PdesEngine::run_until(simtime_picosec limit) {
+    if (_sequential)
+        return run_sequential(limit);
+    simtime_picosec start;
+    while (next_time(start)) {
+        if (start >= limit)
+            return true;
+        simtime_picosec end = _lookahead ? start + _lookahead : UINT64_MAX;
+        run_parallel(start, min(end, limit));
+    }
+    return false;
+}
+
+bool
+PdesEngine::run_window() {
+    simtime_picosec start;
+    if (!next_time(start))
+        return false;
+    simtime_picosec end = _lookahead ? start + _lookahead : UINT64_MAX;
+    if (_sequential) {
+        _window_start = start;
+        run_sequential(end);
+    } else {
+        run_parallel(start, end);
+    }
+    return true;
+}
+
+void
+PdesEngine::run_parallel(simtime_picosec start, simtime_picosec end) {
+    _window_start = start;
+    _window_end = end;
+    _windows++;
+    for (uint32_t lp = 0; lp < lps(); lp++)
+        _lps[lp]->earliest_sent = UINT64_MAX;
+
+    Capture capture(cout.rdbuf());
+    cout.rdbuf(&capture);
+    {
+        std::unique_lock<std::mutex> guard(_lock);
+        if (_threads.empty())
+            for (uint32_t lp = 0; lp < lps(); lp++)
+                _threads.push_back(std::thread(&PdesEngine::worker, this, lp));
+        _running = lps();
+        _generation++;
+        _start.notify_all();
+        _done.wait(guard, [this] {return _running == 0;});
+    }
+    cout.rdbuf(capture.out());
+
+    uint64_t busiest = 0;
+    for (uint32_t lp = 0; lp < lps(); lp++)
+        busiest = max(busiest, _lps[lp]->window_events);
+    _critical_path += busiest;
+    write_output(UINT64_MAX);
+}
+
+void
+PdesEngine::worker(uint32_t lp) {
+    Lp& me = *_lps[lp];
+    me.context->bind();
+    _current_lp = &me;
+    if (_thread_init)
+        _thread_init();
+    EventList& el = eventlist(lp);
+    uint64_t generation = 0;
+    while (true) {
+        simtime_picosec end;
+        {
+            std::unique_lock<std::mutex> guard(_lock);
+            _start.wait(guard, [&] {return _stopping || _generation != generation;});
+            if (_stopping)
+                return;
+            generation = _generation;
+            end = _window_end;
+        }
+        for (size_t i = 0; i < me.inbound.size(); i++)
+            me.inbound[i]->deliver();
+        uint64_t events = 0;
+        while (el.doNextEventBefore(end))
+            events++;
+        me.window_events = events;
+        me.events += events;
+        std::lock_guard<std::mutex> guard(_lock);
+        if (--_running == 0)
+            _done.notify_one();
+    }
+}
+
+void
+PdesEngine::write_output(simtime_picosec before) {
+    // each LP's chunks are in the order its events ran already, and
+    // events on different LPs never share a source
+    vector<const OutputChunk*> chunks;
+    vector<size_t> written(lps(), 0);
+    for (uint32_t lp = 0; lp < lps(); lp++) {
+        vector<OutputChunk>& output = _lps[lp]->output;
+        while (written[lp] < output.size() && output[written[lp]].when < before)
+            chunks.push_back(&output[written[lp]++]);
+    }
+    if (chunks.empty())
+        return;
+    stable_sort(chunks.begin(), chunks.end(),
+                [](const OutputChunk* a, const OutputChunk* b) {
+                    if (a->when != b->when)
+                        return a->when < b->when;
+                    if (a->order != b->order)
+                        return a->order < b->order;
+                    return a->sub < b->sub;
+                });
+    for (size_t i = 0; i < chunks.size(); i++)
+        cout << chunks[i]->text;
+    cout.flush();
+    for (uint32_t lp = 0; lp < lps(); lp++) {
+        vector<OutputChunk>& output = _lps[lp]->output;
+        output.erase(output.begin(), output.begin() + written[lp]);
+    }
+}
+
+bool
+PdesEngine::run_sequential(simtime_picosec limit) {
+    static const uint32_t NONE = UINT32_MAX;
+    SimContext& parent = SimContext::current();
+    // Output is held back and merged as in a parallel run, so that
+    // what LPs write at the same time comes out in the same order.
+    Capture capture(cout.rdbuf());
+    cout.rdbuf(&capture);
+    bool more = false;
+    while (true) {
+        // the LP with the earliest event, and the one after it, ties
+        // going to the lower numbered LP
+        uint32_t first_lp = NONE, second_lp = NONE;
+        simtime_picosec first = 0, second = 0;
+        for (uint32_t lp = 0; lp < lps(); lp++) {
+            simtime_picosec when;
+            if (!eventlist(lp).nextEventTime(when))
+                continue;
+            if (first_lp == NONE || when < first) {
+                second = first;
+                second_lp = first_lp;
+                first = when;
+                first_lp = lp;
+            } else if (second_lp == NONE || when < second) {
+                second = when;
+                second_lp = lp;
+            }
+        }
+        if (first_lp == NONE)
+            break;
+        // nothing can still be written before first
+        write_output(first);
+        if (first >= limit) {
+            more = true;
+            break;
+        }
+
+        // Nothing first_lp does can put an event on another LP before
+        // the lookahead has passed, so it can run on until then, or
+        // until second_lp is due.
+        Lp& l = *_lps[first_lp];
+        l.context->bind();
+        _current_lp = &l;
+        EventList& el = eventlist(first_lp);
+        simtime_picosec horizon = _lookahead ? min(first + _lookahead, limit) : limit;
+        simtime_picosec when;
+        do {
+            el.doNextEvent();
+            l.events++;
+        } while (el.nextEventTime(when) && when < horizon
+                 && (second_lp == NONE || when < second || (when == second && first_lp < second_lp)));
+    }
+    _current_lp = NULL;
+    parent.bind();
+    cout.rdbuf(capture.out());
+    write_output(UINT64_MAX);
+    return more;
+}
+
+void
+PdesEngine::report(ostream& out) {
+    uint64_t events = 0, sent = 0;
+    for (uint32_t lp = 0; lp < lps(); lp++) {
+        events += _lps[lp]->events;
+        sent += _lps[lp]->sent;
+    }
+    out << "PDES: " << lps() << " LPs " << (_sequential ? "run sequentially" : "on threads")
+        << ", " << _links.size() << " links between them, lookahead " << timeAsUs(_lookahead) << "us" << endl;
+    out << "PDES: " << events << " events, " << sent << " packets between LPs";
+    if (_windows)
+        out << ", " << _windows << " windows, " << (double)sent / _windows << " packets per window";
+    out << endl;
+    for (uint32_t lp = 0; lp < lps(); lp++)
+        out << "PDES: LP " << lp << " " << _lps[lp]->events << " events" << endl;
+    if (_critical_path > 0)
+        out << "PDES: best case speedup " << (double)events / _critical_path << endl;
+}
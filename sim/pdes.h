@@ -0,0 +1,216 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef PDES_H
+#define PDES_H
+
+/*
+ * Conservative parallel execution of a partitioned simulation.
+ *
+ * A conservative PDES splits the event sources into logical processes
+ * (LPs), each with its own event list, and only lets an LP run events
+ * that nothing on another LP can still get in ahead of.  In htsim
+ * packets only cross from one part of the network to another through
+ * a Pipe, so the smallest delay of any pipe joining two LPs is the
+ * lookahead: in YAWNS style, if the earliest pending event anywhere is
+ * at T, every LP can safely run everything before T + lookahead, then
+ * all of them wait for each other and the next window starts.
+ *
+ * PdesEngine runs a simulation that way.  Each LP gets its own
+ * SimContext - event list, random numbers and packet pools - and its
+ * own thread, and the topology builds each LP's part of the network on
+ * that LP's event list (see FatTreeTopology::set_pdes_engine and
+ * MultiDatacenterTopology).  The pipes between LPs are PdesLinks.  A
+ * packet sent into one goes into the link's mailbox, a lock-free queue
+ * with the sending LP's thread at one end and the receiving LP's at
+ * the other, and the receiving LP takes it out at the start of its
+ * next window.  Nothing else may pass between LPs while they run.
+ *
+ * A run is deterministic whatever the thread timing, and matches a
+ * run of the whole network on one event list exactly, for the same
+ * seed:
+ *
+ *  - The queues order events due at the same time by their sources'
+ *    IDs (see eventqueue.h), not by when they were scheduled, and IDs
+ *    are handed out on the driver's thread as the network is built,
+ *    just as they would be for one event list.  So each LP runs its
+ *    events in the order one event list would have, however late in
+ *    the window a packet from another LP was delivered.
+ *
+ *  - While an event runs, rand() draws from its source's own stream,
+ *    seeded from the seed and the source's ID (see simcontext.h), so
+ *    what it draws doesn't depend on what other LPs have drawn.  Each
+ *    LP's context starts with the driver's seed.
+ *
+ *  - Events on different LPs at the same time can't affect each other,
+ *    as a packet takes at least the lookahead to cross.  So the order
+ *    they run in only shows in the output: whatever the LPs' threads
+ *    write to cout during a window is held back and written out at the
+ *    end of it in the order the events that wrote it would have run
+ *    on one event list.
+ *
+ * set_sequential() makes the engine run the same LPs on the calling
+ * thread instead, one event at a time in order of time, handing
+ * packets straight to the receiving LP.  That's a second reference a
+ * parallel run can be checked against, with no threads involved.
+ */
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <string>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "config.h"
+#include "eventlist.h"
+#include "simcontext.h"
+#include "pipe.h"
+
+class PdesEngine;
+
+// Packets in flight from one LP to another: a lock-free unbounded
+// single-producer, single-consumer queue.  The sending LP's thread
+// pushes and the receiving LP's thread pops, possibly both at once.
+// It grows a block at a time, so the sender never waits; the receiver
+// frees each block once it's read it all.
+class PdesMailbox {
+public:
+    PdesMailbox();
+    ~PdesMailbox();
+    void push(const pktrecord_t& record); // sending LP's thread only
+    bool pop(pktrecord_t& record);        // receiving LP's thread only
+
+private:
+    static const uint32_t BLOCK = 256;
+    struct Block {
+        Block() : published(0), next(NULL) {}
+        pktrecord_t records[BLOCK];
+        std::atomic<uint32_t> published; // records the sender has finished writing
+        std::atomic<Block*> next;        // set once this block is full
+    };
+
+    Block* _tail; // the sender's
+    char _pad[64]; // keep the two ends off each other's cache line
+    Block* _head; // the receiver's
+    uint32_t _read;
+};
+
+// A pipe from one LP to another.  Its events are on the receiving LP's
+// event list.
+class PdesLink : public Pipe {
+public:
+    PdesLink(PdesEngine& engine, simtime_picosec delay, uint32_t from, uint32_t to);
+    // called on the sending LP's thread
+    virtual void receivePacket(Packet& pkt);
+    // Move whatever has been sent so far into the pipe.  Only on the
+    // receiving LP's thread.  Returns the number of packets.
+    uint32_t deliver();
+    uint32_t from() const {return _from;}
+    uint32_t to() const {return _to;}
+
+private:
+    PdesEngine& _engine;
+    uint32_t _from, _to;
+    PdesMailbox _mailbox;
+};
+
+class PdesEngine {
+    friend class PdesLink;
+public:
+    // Creates each LP's SimContext and EventList.  They take their data
+    // packet size and random seed from the current context, so create
+    // the engine once those are set.
+    PdesEngine(uint32_t lps);
+    ~PdesEngine();
+
+    uint32_t lps() const {return _lps.size();}
+    SimContext& context(uint32_t lp) {return *_lps[lp]->context;}
+    EventList& eventlist(uint32_t lp) {return *_lps[lp]->context->eventlist();}
+    void setEndtime(simtime_picosec endtime);
+    // The lookahead is the smallest link delay.  With no links at all
+    // the LPs are independent and each runs to the end in one window.
+    PdesLink* new_link(simtime_picosec delay, uint32_t from, uint32_t to);
+    simtime_picosec lookahead() const {return _lookahead;}
+
+    // Run the LPs one event at a time on the calling thread, in order
+    // of time, rather than on threads.  Off by default.
+    void set_sequential(bool sequential) {_sequential = sequential;}
+    bool sequential() const {return _sequential;}
+    // Each LP's thread calls init once it has bound the LP's context,
+    // before it runs anything, to copy any other per-thread settings
+    // over from the driver's thread - FatTreeTopology::thread_settings(),
+    // say.
+    void set_thread_init(std::function<void()> init) {_thread_init = init;}
+
+    // Run every event due before limit.  Returns false once no LP has
+    // any events left.
+    bool run_until(simtime_picosec limit);
+    // Run the next window: everything due before the lookahead has
+    // passed from the earliest pending event.  Returns false, having
+    // run nothing, once no LP has any events left.
+    bool run_window();
+    // the start of the last window run
+    simtime_picosec now() const {return _window_start;}
+    // When the earliest event pending on any LP is due, counting the
+    // packets still in the links.  False if there are none.
+    bool next_time(simtime_picosec& when);
+    void report(ostream& out);
+
+private:
+    // what an LP's thread wrote to cout during one event; see Capture
+    struct OutputChunk {
+        simtime_picosec when;
+        uint32_t order;   // of the event's source
+        uint32_t sub;     // of the timer wheel's client, during a tick
+        string text;
+    };
+    struct Lp {
+        SimContext* context;
+        vector<PdesLink*> inbound; // in the order they were made
+        // Written by the LP's own thread during a window, and read by
+        // the driver's thread between them.  Each Lp is allocated on
+        // its own, so the threads don't share cache lines.
+        simtime_picosec earliest_sent; // the earliest arrival sent this window
+        uint64_t window_events;
+        uint64_t events;
+        uint64_t sent;
+        vector<OutputChunk> output;
+    };
+    class Capture;
+
+    void run_parallel(simtime_picosec start, simtime_picosec end);
+    bool run_sequential(simtime_picosec limit);
+    // write out, in order, what the LPs wrote before the given time
+    void write_output(simtime_picosec before);
+    void worker(uint32_t lp);
+    inline void sent(uint32_t from, simtime_picosec arrival) {
+        Lp& lp = *_lps[from];
+        // the receiving LP won't schedule anything past the end
+        if (arrival < lp.earliest_sent && (_endtime == 0 || arrival < _endtime))
+            lp.earliest_sent = arrival;
+        lp.sent++;
+    }
+
+    static thread_local Lp* _current_lp; // the LP running, if any
+
+    vector<Lp*> _lps;
+    vector<PdesLink*> _links;
+    vector<std::thread> _threads; // started by the first parallel window
+    std::function<void()> _thread_init;
+    bool _sequential;
+    simtime_picosec _endtime;
+    simtime_picosec _lookahead;
+    simtime_picosec _window_start, _window_end;
+
+    // the workers wait for _generation to change, then run to _window_end
+    std::mutex _lock;
+    std::condition_variable _start, _done;
+    uint64_t _generation;
+    uint32_t _running;
+    bool _stopping;
+
+    uint64_t _windows;
+    uint64_t _critical_path; // sum over windows of the busiest LP's events
+};
+
+#endif
@@ -1,5 +1,6 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-        
 #include "pipe.h"
+#include "checkpoint.h"
 #include <iostream>
 #include <sstream>
 
@@ -20,11 +21,17 @@ void
 Pipe::receivePacket(Packet& pkt)
 {
     //pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_ARRIVE);
+    enqueue(pkt, eventlist().now() + _delay);
+}
+
+void
+Pipe::enqueue(Packet& pkt, simtime_picosec arrival)
+{
     //if (_inflight.empty()){
     if (_count == 0){
         /* no packets currently inflight; need to notify the eventlist
            we've an event pending */
-            eventlist().sourceIsPendingRel(*this,_delay);
+            eventlist().sourceIsPending(*this,arrival);
     }
     _count++;
     if (_count == _size) {
@@ -43,7 +50,7 @@ Pipe::receivePacket(Packet& pkt)
         }
         _size += _size;
     }
-    _inflight_v[_next_insert].time = eventlist().now() + _delay;
+    _inflight_v[_next_insert].time = arrival;
     _inflight_v[_next_insert].pkt = &pkt;
     _next_insert = (_next_insert +1) % _size;
     //_inflight.push_front(make_pair(eventlist().now() + _delay, &pkt));
@@ -72,3 +79,32 @@ Pipe::doNextEvent() {
         _eventlist.sourceIsPending(*this, nexteventtime);
     }
 }
+
+void
+Pipe::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(Pipe));
+    checkpoint_inflight(archive);
+}
+
+void
+Pipe::checkpoint_inflight(CheckpointArchive& archive) {
+    checkpoint_random(archive);
+    archive.check(_delay, "pipe delay");
+    uint32_t count = _count;
+    archive.io(count);
+    if (archive.restoring()) {
+        // oldest first from the start of the ring; the pending event
+        // for the first is restored with the event list
+        while (_size <= (int)count)
+            _size *= 2;
+        _inflight_v.assign(_size, pktrecord_t());
+        _next_pop = 0;
+        _next_insert = count;
+        _count = count;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        pktrecord_t& r = _inflight_v[(_next_pop + i) % _size];
+        archive.io(r.time);
+        archive.packet(r.pkt);
+    }
+}
@@ -13,6 +13,7 @@
 #include "network.h"
 #include "loggertypes.h"
 #include "drawable.h"
+#include "memory_account.h"
 
 typedef struct pktrecord {
     simtime_picosec time;
@@ -21,6 +22,7 @@ typedef struct pktrecord {
 
 class Pipe : public EventSource, public PacketSink, public Drawable {
  public:
+    MEMORY_ACCOUNTED(PIPES)
     Pipe(simtime_picosec delay, EventList& eventlist=EventList::getTheEventList());
     virtual void receivePacket(Packet& pkt); // inherited from PacketSink
     virtual void doNextEvent(); // inherited from EventSource
@@ -34,7 +36,13 @@ class Pipe : public EventSource, public PacketSink, public Drawable {
     PacketSink* next() const {
             return _next_sink;
     }
+    virtual void checkpoint(CheckpointArchive& archive);
 protected:
+    // add pkt to the packets in flight, to come out at arrival
+    void enqueue(Packet& pkt, simtime_picosec arrival);
+    // save or restore the packets in flight, for checkpoint()
+    void checkpoint_inflight(CheckpointArchive& archive);
+
     string _nodename;
     //typedef pair<simtime_picosec,Packet*> pktrecord_t;
     //list<pktrecord_t> _inflight; // the packets in flight (or being serialized)
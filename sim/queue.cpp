@@ -4,15 +4,18 @@
 #include "queue.h"
 #include "ndppacket.h"
 #include "queue_lossless.h"
+#include "checkpoint.h"
 
 simtime_picosec BaseQueue::_update_period = timeFromUs(0.1);
+simtime_picosec BaseQueue::_utilization_window = timeFromUs(30.0);
 
 // base queue is a generic queue that we can log, but doesn't actually store anything
 BaseQueue::BaseQueue(linkspeed_bps bitrate, EventList& eventlist, QueueLogger* logger)
-    : EventSource(eventlist, "Queue"), _logger(logger), _bitrate(bitrate), _switch(NULL) {
+    : EventSource(eventlist, "Queue"), _logger(logger), _bitrate(bitrate), _switch(NULL), _loss(NULL) {
     _ps_per_byte = (simtime_picosec)((pow(10.0, 12.0) * 8) / _bitrate);
-    _window = timeFromUs(30.0);
-    _busy = 0;
+    for (int i = 0; i < UTIL_SLOTS; i++)
+        _busy[i] = 0;
+    _busy_slot = 0;
 
     _last_update_qs = 0;
     _last_update_utilization = 0;
@@ -20,53 +23,33 @@ BaseQueue::BaseQueue(linkspeed_bps bitrate, EventList& eventlist, QueueLogger* l
     _last_utilization = 0;
 }
 
+void
+BaseQueue::advance_utilization(simtime_picosec now) {
+    uint64_t slot = now / (_utilization_window / UTIL_SLOTS);
+    if (slot == _busy_slot)
+        return;
+    // empty the slots we've moved past, which are the ones we reuse
+    uint64_t passed = min(slot - _busy_slot, (uint64_t)UTIL_SLOTS);
+    for (uint64_t i = 1; i <= passed; i++)
+        _busy[(_busy_slot + i) % UTIL_SLOTS] = 0;
+    _busy_slot = slot;
+}
+
 void 
 BaseQueue::log_packet_send(simtime_picosec duration){
-    //a packet tranmission has just finished; it lasted from a to b.
-    simtime_picosec b = eventlist().now();
-    simtime_picosec a = b - duration;
-    _busystart.push(a);
-    _busyend.push(b);
-
-    _busy += duration;
-
-    simtime_picosec y = _busyend.back();
-    while (y < b - _window){
-        simtime_picosec x = _busystart.pop();
-        _busyend.pop();
-
-        _busy -= (y-x);
-
-        if (!_busyend.empty())
-            y = _busyend.back();
-        else
-            break;
-    }
+    //a packet tranmission has just finished; it lasted duration.
+    advance_utilization(eventlist().now());
+    _busy[_busy_slot % UTIL_SLOTS] += min(duration, _utilization_window);
 }
 
 uint16_t
 BaseQueue::average_utilization(){
     //how much time have we spent being busy in the current measurement window?
-    if (_busystart.empty())
-        return 0;
-    
-    simtime_picosec y = _busyend.back();
-    simtime_picosec b = eventlist().now(); 
-
-    while (y < b - _window){
-        simtime_picosec x = _busystart.pop();
-        _busyend.pop();
-
-        _busy -= (y-x);
-        assert(_busy>=0);
-
-        if (!_busyend.empty())
-            y = _busyend.back();
-        else
-            break;
-
-    }
-    return (_busy*100/_window);
+    advance_utilization(eventlist().now());
+    simtime_picosec busy = 0;
+    for (int i = 0; i < UTIL_SLOTS; i++)
+        busy += _busy[i];
+    return (busy*100/_utilization_window);
 }
 
 uint8_t
@@ -114,23 +97,55 @@ BaseQueue::quantized_queuesize(){
     return _last_qs;
 }
 
+void
+BaseQueue::checkpoint_base(CheckpointArchive& archive) {
+    if (_loss)
+        archive.fail("can't save a queue's loss model");
+    checkpoint_random(archive);
+    archive.check(_bitrate, "queue bitrate");
+    archive.io(_busy);
+    archive.io(_busy_slot);
+    archive.io(_last_update_qs);
+    archive.io(_last_update_utilization);
+    archive.io(_last_qs);
+    archive.io(_last_utilization);
+}
+
+QueueLossModel::QueueLossModel()
+    : _stochastic_loss_rate(0), _bursty_loss(false), _burst_arrival_rate_mean(0),
+      _next_burst_arrival(0), _in_burst(false), _burst_duration_mean(0), _burst_end(0)
+{
+}
+
+void
+QueueLossModel::setBurstArrivalRate(simtime_picosec mean_interarrival_time) {
+    _burst_arrival_rate_mean = mean_interarrival_time;
+    _burst_arrival_rate = std::poisson_distribution<>(mean_interarrival_time);
+}
+
+void
+QueueLossModel::setBurstDuration(simtime_picosec mean_duration) {
+    _burst_duration_mean = mean_duration;
+    _burst_duration = std::exponential_distribution<>(1.0 / _burst_duration_mean);
+}
+
 bool 
-BaseQueue::checkBurstyLoss() {
+QueueLossModel::checkBurstyLoss(simtime_picosec now) {
     // enter existing burst of loss or start a new one
-    if (_bursty_loss && (_next_burst_arrival <= eventlist().now() || _in_burst)) {
+    if (_bursty_loss && (_next_burst_arrival <= now || _in_burst)) {
         if (!_in_burst) { // begin burst and set next burst time
             _in_burst = true;
             std::mt19937 engine = get_random_engine();
             simtime_picosec interarrival = (simtime_picosec)_burst_arrival_rate(engine);
-            _next_burst_arrival = eventlist().now() + interarrival;
+            _next_burst_arrival = now + interarrival;
             simtime_picosec burst_duration = (simtime_picosec)_burst_duration(engine);
-            _burst_end = eventlist().now() + burst_duration;
+            _burst_end = now + burst_duration;
             if(_burst_end > _next_burst_arrival) {
-                _next_burst_arrival = eventlist().now() + interarrival + burst_duration;
+                _next_burst_arrival = now + interarrival + burst_duration;
             }
         }
 
-        if (eventlist().now() > _burst_end) { // end the burst
+        if (now > _burst_end) { // end the burst
             _in_burst = false;
         } else { // drop the packet
             return true;
@@ -232,6 +247,21 @@ Queue::serviceTime() {
     return _queuesize * _ps_per_byte;
 }
 
+void
+Queue::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(Queue));
+    checkpoint_base(archive);
+    checkpoint_fifo(archive);
+}
+
+void
+Queue::checkpoint_fifo(CheckpointArchive& archive) {
+    archive.check(_maxsize, "queue size");
+    archive.io(_queuesize);
+    archive.packets(_enqueued);
+    archive.io(_num_drops);
+}
+
 PriorityQueue::PriorityQueue(linkspeed_bps bitrate, mem_b maxsize, 
                              EventList& eventlist, QueueLogger* logger)
     : HostQueue(bitrate, maxsize, eventlist, logger) 
@@ -359,7 +389,7 @@ PriorityQueue::completeService()
     //assert(!_queue[_servicing].empty());
 
     if (_servicing == Q_NONE || _queue[_servicing].empty()){
-        cout << _name << " trying to deque " << _servicing << ", qsize " << queuesize () << endl;
+        cout << str() << " trying to deque " << _servicing << ", qsize " << queuesize () << endl;
     }
     else {
         Packet* pkt = _queue[_servicing].back();
@@ -539,7 +569,7 @@ FairPriorityQueue::completeService()
         return;
 
     if (_servicing == Q_NONE || _sending == NULL){
-        cout << _name << " trying to deque " << _servicing << ", qsize " << queuesize () << endl;
+        cout << str() << " trying to deque " << _servicing << ", qsize " << queuesize () << endl;
     }
     else {
         /* dequeue the packet */
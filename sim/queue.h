@@ -17,6 +17,31 @@
 #include "drawable.h"
 #include "switch.h"
 #include "circular_buffer.h"
+#include "memory_account.h"
+
+// Packet loss injected where packets enter a queue, to model a lossy
+// link: independent losses at a fixed rate, and bursts of loss arriving
+// as a Poisson process.  Few queues have any, so a BaseQueue only gets
+// one when a loss parameter is set.
+class QueueLossModel {
+ public:
+    QueueLossModel();
+    void setBurstArrivalRate(simtime_picosec mean_interarrival_time);
+    void setBurstDuration(simtime_picosec mean_duration);
+    // true if a packet arriving now falls in a burst of loss
+    bool checkBurstyLoss(simtime_picosec now);
+
+    double _stochastic_loss_rate;
+
+    bool _bursty_loss;
+    simtime_picosec _burst_arrival_rate_mean;
+    std::poisson_distribution<> _burst_arrival_rate;
+    simtime_picosec _next_burst_arrival;
+    bool _in_burst;
+    simtime_picosec _burst_duration_mean;
+    std::exponential_distribution<> _burst_duration;
+    simtime_picosec _burst_end;
+};
 
 // BaseQueue is a generic queue, but doesn't actually implement any
 // queuing discipline.  Subclasses implement different queuing
@@ -25,7 +50,9 @@ class Switch;
 
 class BaseQueue  : public EventSource, public PacketSink, public Drawable {
  public:
+    MEMORY_ACCOUNTED(QUEUES)
     BaseQueue(linkspeed_bps bitrate, EventList &eventlist, QueueLogger* logger);
+    virtual ~BaseQueue() {delete _loss;}
     virtual void setLogger(QueueLogger* logger) {
             _logger = logger;
     }
@@ -66,35 +93,35 @@ class BaseQueue  : public EventSource, public PacketSink, public Drawable {
     virtual uint8_t quantized_utilization();
 
     static simtime_picosec _update_period;
+    // average_utilization() is over about this long
+    static simtime_picosec _utilization_window;
 
     void setStochasticLossRate(double rate) {
-        _stochastic_loss_rate = rate;
+        lossModel()._stochastic_loss_rate = rate;
     }
     double getStochasticLossRate() {
-        return _stochastic_loss_rate;
+        return _loss ? _loss->_stochastic_loss_rate : 0;
     }
 
     void setBurstArrivalRate(simtime_picosec mean_interarrival_time) {
-        _burst_arrival_rate_mean = mean_interarrival_time;
-        _burst_arrival_rate = std::poisson_distribution<>(mean_interarrival_time);
+        lossModel().setBurstArrivalRate(mean_interarrival_time);
     }
     double getBurstArrivalRateMean() {
-        return _burst_arrival_rate_mean;
+        return _loss ? _loss->_burst_arrival_rate_mean : 0;
     }
 
     void setBurstDuration(simtime_picosec mean_duration) {
-        _burst_duration_mean = mean_duration;
-        _burst_duration = std::exponential_distribution<>(1.0 / _burst_duration_mean);
+        lossModel().setBurstDuration(mean_duration);
     }
     double getBurstDurationMean() {
-        return _burst_duration_mean;
+        return _loss ? _loss->_burst_duration_mean : 0;
     }
 
     void setBurstyLoss(bool is_enabled) {
-        _bursty_loss = is_enabled;
+        lossModel()._bursty_loss = is_enabled;
     }
     double getBurstyLoss() {
-        return _bursty_loss;
+        return _loss ? _loss->_bursty_loss : false;
     }
 
     void setBurstyLossParameters(simtime_picosec mean_interarrival_time, simtime_picosec mean_duration) {
@@ -102,10 +129,12 @@ class BaseQueue  : public EventSource, public PacketSink, public Drawable {
         setBurstDuration(mean_duration);
         setBurstyLoss(true);
         std::mt19937 engine = get_random_engine();
-        _next_burst_arrival = eventlist().now() + (simtime_picosec)_burst_arrival_rate(engine);
+        _loss->_next_burst_arrival = eventlist().now() + (simtime_picosec)_loss->_burst_arrival_rate(engine);
     }
 
-    bool checkBurstyLoss();
+    bool checkBurstyLoss() {
+        return _loss && _loss->checkBurstyLoss(eventlist().now());
+    }
 
 
 protected:
@@ -115,32 +144,36 @@ protected:
     linkspeed_bps _bitrate; 
     simtime_picosec _ps_per_byte;  // service time, in picoseconds per byte
     string _nodename;
-    
-    CircularBuffer<simtime_picosec> _busystart;
-    CircularBuffer<simtime_picosec> _busyend;
 
-    //how much time have we spent being busy in the current measurement window?
-    simtime_picosec _busy;
-    simtime_picosec _idle;
-    simtime_picosec _window;
+    QueueLossModel& lossModel() {
+        if (!_loss)
+            _loss = new QueueLossModel();
+        return *_loss;
+    }
+    // save or restore what every queue keeps, for checkpoint()
+    void checkpoint_base(CheckpointArchive& archive);
+    
+    // How much time have we spent busy in the current measurement
+    // window?  The window is split into UTIL_SLOTS slots, each adding
+    // up the service time of the packets that finished in it, so a
+    // packet sent costs one addition and old slots are dropped as the
+    // window moves on.
+    static const int UTIL_SLOTS = 8;
+    void advance_utilization(simtime_picosec now);
+    simtime_picosec _busy[UTIL_SLOTS]; // a slot can be busy for longer than 2^32ps
+    uint64_t _busy_slot; // the slot number now falls in, since time 0
 
     simtime_picosec _last_update_qs, _last_update_utilization;
     uint8_t _last_qs, _last_utilization;
 
     Switch* _switch;//which switch is this queue part of?
 
-    double _stochastic_loss_rate = 0;
-
-    bool _bursty_loss = false;
-    simtime_picosec _burst_arrival_rate_mean = 0;
-    std::poisson_distribution<> _burst_arrival_rate;
-    simtime_picosec _next_burst_arrival = 0;
-    bool _in_burst = false;
-    simtime_picosec _burst_duration_mean = 0;
-    std::exponential_distribution<> _burst_duration;
-    simtime_picosec _burst_end = 0;
+    QueueLossModel* _loss; // NULL if no loss is injected
 };
 
+// sizeof the queue types, to see what a big topology costs per queue
+void print_queue_sizes(ostream& out);
+
 
 // A standard FIFO packet queue of fixed size
 class Queue : public BaseQueue {
@@ -157,6 +190,7 @@ class Queue : public BaseQueue {
     simtime_picosec serviceTime();
     int num_drops() const {return _num_drops;}
     void reset_drops() {_num_drops = 0;}
+    virtual void checkpoint(CheckpointArchive& archive);
 
  protected:
     // Mechanism
@@ -166,6 +200,9 @@ class Queue : public BaseQueue {
     // wrap up serving the item at the head of the queue
     virtual void completeService(); 
 
+    // save or restore the queued packets, for checkpoint()
+    void checkpoint_fifo(CheckpointArchive& archive);
+
     mem_b _queuesize;
     CircularBuffer<Packet*> _enqueued;
     int _num_drops;
@@ -17,6 +17,7 @@ LosslessInputQueue::LosslessInputQueue(EventList& eventlist)
     assert(_high_threshold > _low_threshold);
 
     _wire = NULL;
+    _ingress_port = Packet::NO_PORT;
 }
 
 LosslessInputQueue::LosslessInputQueue(EventList& eventlist,BaseQueue* peer)
@@ -28,11 +29,12 @@ LosslessInputQueue::LosslessInputQueue(EventList& eventlist,BaseQueue* peer)
     assert(_high_threshold > _low_threshold);
 
     stringstream ss;
-    ss << "VirtualQueue("<< peer->_name<< ")";
+    ss << "VirtualQueue("<< peer->str()<< ")";
     _nodename = ss.str();
     _remoteEndpoint = peer;
     _switch = NULL;
     _wire = NULL;
+    _ingress_port = Packet::NO_PORT;
 
     peer->setRemoteEndpoint(this);
 }
@@ -46,7 +48,7 @@ LosslessInputQueue::LosslessInputQueue(EventList& eventlist,BaseQueue* peer, Swi
     assert(_high_threshold > _low_threshold);
 
     stringstream ss;
-    ss << "VirtualQueue("<< peer->_name<< ")";
+    ss << "VirtualQueue("<< peer->str()<< ")";
     _nodename = ss.str();
     _remoteEndpoint = peer;
     _switch = sw;
@@ -54,6 +56,7 @@ LosslessInputQueue::LosslessInputQueue(EventList& eventlist,BaseQueue* peer, Swi
     _wire = new CallbackPipe(wire_latency, eventlist, _remoteEndpoint);
 
     assert(_switch);
+    _ingress_port = _switch->addIngressPort(this);
 
     peer->setRemoteEndpoint(this);
 }
@@ -76,7 +79,7 @@ LosslessInputQueue::receivePacket(Packet& pkt)
     //cout << timeAsMs(eventlist().now()) << " queue " << _name << " switch (" << _switch->_name << ") "<< " recv when paused pkt " << pkt.type() << " sz " << _queuesize << endl;        
 
     if (_queuesize > _maxsize){
-        cout << " Queue " << _name << " LOSSLESS not working! I should have dropped this packet" << _queuesize / Packet::data_packet_size() << endl;
+        cout << " Queue " << str() << " LOSSLESS not working! I should have dropped this packet" << _queuesize / Packet::data_packet_size() << endl;
     }
     
     //tell the output queue we're here!
@@ -87,7 +90,7 @@ LosslessInputQueue::receivePacket(Packet& pkt)
     }
     else {
         assert(_switch);
-        pkt.set_ingress_queue(this);
+        pkt.set_ingress_port(_ingress_port);
         _switch->receivePacket(pkt);
     }
 }
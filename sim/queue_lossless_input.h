@@ -41,6 +41,7 @@ public:
 
 private:
     int _state_recv;
+    uint16_t _ingress_port; // our index in _switch's ingress ports
     CallbackPipe* _wire;
 };
 
@@ -33,8 +33,10 @@ LosslessOutputQueue::receivePacket(Packet& pkt){
     if (pkt.type()==ETH_PAUSE)
         receivePacket(pkt,NULL);
     else {
-        LosslessInputQueue* q = pkt.get_ingress_queue();
-        pkt.clear_ingress_queue();
+        // the packet came in on one of our switch's lossless input queues
+        assert(_switch);
+        LosslessInputQueue* q = _switch->getIngressPort(pkt.ingress_port());
+        pkt.clear_ingress_port();
         receivePacket(pkt,dynamic_cast<VirtualQueue*>(q));
     }
 }
@@ -87,7 +89,7 @@ LosslessOutputQueue::receivePacket(Packet& pkt,VirtualQueue* prev)
     _queuesize += pkt.size();
 
     if (_queuesize > _maxsize){
-        cout << " Queue " << _name << " LOSSLESS not working! I should have dropped this packet" << _queuesize / Packet::data_packet_size() << endl;
+        cout << " Queue " << str() << " LOSSLESS not working! I should have dropped this packet" << _queuesize / Packet::data_packet_size() << endl;
     }
 
     if (_logger) 
@@ -0,0 +1,23 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include "queue.h"
+#include "pipe.h"
+#include "randomqueue.h"
+#include "ecnqueue.h"
+#include "compositequeue.h"
+#include "compositeprioqueue.h"
+#include "aeolusqueue.h"
+#include "queue_lossless.h"
+#include "queue_lossless_input.h"
+#include "queue_lossless_output.h"
+
+#define QSIZE(T) " " #T " " << sizeof(T)
+
+void
+print_queue_sizes(ostream& out) {
+    out << "Queue sizes (bytes):" << QSIZE(BaseQueue) << QSIZE(Queue) << QSIZE(Pipe)
+        << " loss model " << sizeof(QueueLossModel) << endl;
+    out << " " << QSIZE(RandomQueue) << QSIZE(ECNQueue) << QSIZE(CompositeQueue)
+        << QSIZE(CompositePrioQueue) << QSIZE(AeolusQueue) << endl;
+    out << " " << QSIZE(LosslessQueue) << QSIZE(LosslessInputQueue)
+        << QSIZE(LosslessOutputQueue) << endl;
+}
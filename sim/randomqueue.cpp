@@ -30,7 +30,7 @@ RandomQueue::receivePacket(Packet& pkt)
         return;
     }
 
-    if (drand() < _stochastic_loss_rate) {
+    if (drand() < getStochasticLossRate()) {
         pkt.free();
         return;
     }
@@ -0,0 +1,98 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+
+/*
+ * The packets a sink has received above a hole in the sequence space,
+ * for sinks with byte sequence numbers that used to keep them in a
+ * sorted list<seq_t> or a set<seq_t>.
+ *
+ * Packets are expected to be the same size, starting at 1 + k*size;
+ * those are held in a SeqBitmap indexed by k, so an insert is O(1) and
+ * moving the cumulative ack over a run of held packets costs a bit
+ * scan rather than a list walk.  The stride is taken from the first
+ * packet inserted.  Anything off that grid - a short packet, say - goes
+ * into a small overflow set, so the cumulative ack comes out the same
+ * as it would with the list.
+ */
+
+#include <set>
+#include "config.h"
+#include "seq_bitmap.h"
+
+template<class Seq>
+class ReorderBuffer {
+public:
+    ReorderBuffer() : _stride(0) {}
+
+    // forget everything, for a sink that's being reused
+    void clear() {
+        _stride = 0;
+        _bitmap.clear();
+        _overflow.clear();
+    }
+
+    // hold seqno, which is above the hole; returns false if it's
+    // already held (a bad retransmit)
+    bool insert(Seq seqno, uint32_t size) {
+        if (_stride == 0)
+            _stride = size;
+        if (on_grid(seqno)) {
+            uint64_t n = (seqno - 1) / _stride;
+            if (_bitmap.contains(n))
+                return false;
+            _bitmap.insert(n);
+            return true;
+        }
+        return _overflow.insert(seqno).second;
+    }
+
+    bool contains(Seq seqno) const {
+        if (on_grid(seqno))
+            return _bitmap.contains((seqno - 1) / _stride);
+        return _overflow.find(seqno) != _overflow.end();
+    }
+
+    // cumulative_ack is the last byte acked: move it on over the held
+    // packets that follow it, size bytes each, and return how many
+    // there were
+    uint64_t advance(Seq& cumulative_ack, uint32_t size) {
+        uint64_t released = 0;
+        if (_stride != 0 && size == _stride && cumulative_ack % _stride == 0) {
+            // the common case - all of a run of held packets at once
+            uint64_t next = cumulative_ack / _stride;
+            _bitmap.discard(next);
+            released = _bitmap.consume(next);
+            cumulative_ack += released * size;
+        } else {
+            while (!empty() && contains(cumulative_ack + 1)) {
+                erase(cumulative_ack + 1);
+                cumulative_ack += size;
+                released++;
+            }
+        }
+        // nothing below the cumulative ack will ever be released
+        while (!_overflow.empty() && *_overflow.begin() <= cumulative_ack)
+            _overflow.erase(_overflow.begin());
+        return released;
+    }
+
+    bool empty() const {return _bitmap.empty() && _overflow.empty();}
+    size_t size() const {return _bitmap.size() + _overflow.size();}
+
+private:
+    bool on_grid(Seq seqno) const {return _stride != 0 && (seqno - 1) % _stride == 0;}
+
+    void erase(Seq seqno) {
+        if (on_grid(seqno))
+            _bitmap.erase((seqno - 1) / _stride);
+        else
+            _overflow.erase(seqno);
+    }
+
+    uint32_t _stride;     // the size of the first packet inserted
+    SeqBitmap _bitmap;    // packets at 1 + k*_stride, by k
+    set<Seq> _overflow;   // anything else
+};
+
+#endif
@@ -107,7 +107,7 @@ void RoceSrc::log_me() {
 }
 
 void RoceSrc::startflow(){
-    cout << "startflow " << _flow._name << " at " << timeAsUs(eventlist().now()) << endl;
+    cout << "startflow " << _flow.str() << " at " << timeAsUs(eventlist().now()) << endl;
     _flow_started = true;
     _highest_sent = 0;
     _last_acked = 0;
@@ -134,7 +134,7 @@ void RoceSrc::connect(Route* routeout, Route* routeback, RoceSink& sink, simtime
     
     _sink = &sink;
     _flow.set_id(get_id()); // identify the packet flow with the ROCE source that generated it
-    _flow._name = _name;
+    _flow.copyName(*this);
     _sink->connect(*this, routeback);
 
     if (starttime != TRIGGER_START) {
@@ -211,7 +211,7 @@ void RoceSrc::processAck(const RoceAck& ack) {
     if (_log_me)
         cout << "Src " << get_id() << " ackno " << ackno << endl;
     if (ackno >= _flow_size){
-        cout << "Flow " << _name << " " << get_id() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ackno << endl;
+        cout << "Flow " << str() << " " << get_id() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ackno << endl;
         _done = true;
         if (_end_trigger) {
             _end_trigger->activate();
@@ -315,7 +315,7 @@ void RoceSrc::send_packet() {
     if (_flow_size && _highest_sent + _mss >= _flow_size) {
         last_packet = true;
         if (_log_me) {
-            cout << _name << " " << get_id() << " sending last packet with SEQNO " << _highest_sent+1 << " at " << timeAsUs(eventlist().now()) << endl;
+            cout << str() << " " << get_id() << " sending last packet with SEQNO " << _highest_sent+1 << " at " << timeAsUs(eventlist().now()) << endl;
         }
     }
 
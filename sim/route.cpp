@@ -1,5 +1,7 @@
 // -*- c-basic-offset: 4; indent-tabs-mode: nil -*-  
 #include <climits>
+#include <string.h>
+#include <new>
 #include "route.h"
 #include "network.h"
 #include "queue.h"
@@ -7,13 +9,39 @@
 
 #define MAXQUEUES 10
 
-Route::Route() : _hop_count(0), _reverse(NULL) {};
+Route::Route() : _hops(NULL), _sinks(NULL), _size(0), _hop_count(0), _reverse(NULL),
+                 _path_id(0), _no_of_paths(0), _interned(false) {};
 
-Route::Route(int size) : _hop_count(0), _reverse(NULL) {
+Route::Route(int size) : _hops(NULL), _sinks(NULL), _size(0), _hop_count(0), _reverse(NULL),
+                         _path_id(0), _no_of_paths(0), _interned(false) {
     _sinklist.reserve(size);
+    sync();
 };
 
-Route::Route(const Route& orig, PacketSink& dst) : _sinklist(orig.size()+1){
+// A copy is never interned, even if the original is, so it can be
+// added to.
+Route::Route(const Route& orig) : _sinks(NULL), _interned(false) {
+    *this = orig;
+}
+
+Route&
+Route::operator=(const Route& orig) {
+    if (this == &orig)
+        return *this;
+    assert(!_interned);
+    _sinklist.resize(orig.size());
+    for (size_t i = 0; i < orig.size(); i++) {
+        _sinklist[i] = orig.at(i);
+    }
+    sync();
+    _hop_count = orig._hop_count;
+    _reverse = orig._reverse;
+    _path_id = orig._path_id;
+    _no_of_paths = orig._no_of_paths;
+    return *this;
+}
+
+Route::Route(const Route& orig, PacketSink& dst) : _sinklist(orig.size()+1), _sinks(NULL), _interned(false) {
     //_sinklist.resize(orig.size()+1);
     _path_id = orig.path_id();
     _reverse = orig._reverse;
@@ -23,6 +51,7 @@ Route::Route(const Route& orig, PacketSink& dst) : _sinklist(orig.size()+1){
         _sinklist[i] = orig.at(i);
     }
     _sinklist[orig.size()] = &dst;
+    sync();
     _hop_count++;
 }
 
@@ -43,10 +72,11 @@ Route::clone() const {
       copy->push_back(*i);
       }
     */
-    copy->_sinklist.resize(_sinklist.size());
-    for (uint32_t i = 0; i < _sinklist.size(); i++) {
-        copy->_sinklist[i] = _sinklist[i];
+    copy->_sinklist.resize(_size);
+    for (uint32_t i = 0; i < _size; i++) {
+        copy->_sinklist[i] = at(i);
     }
+    copy->sync();
     return copy;
 }
 
@@ -89,3 +119,135 @@ void check_non_null(Route* rt){
         assert(0);
     }
 }
+
+////////////////////////////////////////////////////////////////
+//  ROUTE STORE
+////////////////////////////////////////////////////////////////
+
+#define ROUTE_CHUNK_BYTES (64*1024)
+
+RouteStore::RouteStore()
+    : _compact(false), _chunk_used(ROUTE_CHUNK_BYTES), _arena_bytes(0), _hops(0), _requests(0) {
+}
+
+RouteStore::~RouteStore() {
+    // the Routes themselves are in the arena
+    for (unordered_map<RouteKey, Route*, RouteKeyHash>::iterator i = _routes.begin(); i != _routes.end(); i++)
+        i->second->~Route();
+    for (size_t i = 0; i < _chunks.size(); i++)
+        delete[] _chunks[i];
+}
+
+bool
+RouteStore::HopSeqEqual::operator()(const HopSeq& a, const HopSeq& b) const {
+    return a.size == b.size && a.width == b.width
+        && memcmp(a.hops, b.hops, (size_t)a.size * a.width) == 0;
+}
+
+size_t
+RouteStore::RouteKeyHash::operator()(const RouteKey& k) const {
+    size_t h = (size_t)k.hops;
+    h = h * 31 + (size_t)k.reverse;
+    h = h * 31 + k.path_id;
+    h = h * 31 + k.no_of_paths;
+    h = h * 31 + k.hop_count;
+    return h;
+}
+
+void*
+RouteStore::allocate(size_t bytes) {
+    bytes = (bytes + 7) & ~(size_t)7;
+    if (bytes > ROUTE_CHUNK_BYTES / 4) {
+        // too big to pack; give it a chunk of its own, leaving the
+        // current one to carry on filling
+        char* mem = new char[bytes];
+        _chunks.insert(_chunks.end() - (_chunks.empty() ? 0 : 1), mem);
+        _arena_bytes += bytes;
+        return mem;
+    }
+    if (_chunk_used + bytes > ROUTE_CHUNK_BYTES) {
+        _chunks.push_back(new char[ROUTE_CHUNK_BYTES]);
+        _arena_bytes += ROUTE_CHUNK_BYTES;
+        _chunk_used = 0;
+    }
+    void* mem = _chunks.back() + _chunk_used;
+    _chunk_used += bytes;
+    return mem;
+}
+
+const void*
+RouteStore::intern_hops(const void* hops, uint32_t size, uint32_t width) {
+    // FNV-1a over the bytes of the hops
+    size_t hash = 14695981039346656037ULL;
+    const unsigned char* bytes = (const unsigned char*)hops;
+    for (size_t i = 0; i < (size_t)size * width; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    HopSeq seq = {hops, size, width, hash};
+    unordered_set<HopSeq, HopSeqHash, HopSeqEqual>::iterator i = _sequences.find(seq);
+    if (i != _sequences.end())
+        return i->hops;
+
+    void* copy = allocate((size_t)size * width);
+    memcpy(copy, hops, (size_t)size * width);
+    seq.hops = copy;
+    _sequences.insert(seq);
+    _hops += size;
+    return copy;
+}
+
+const Route*
+RouteStore::intern(const Route& route) {
+    _requests++;
+    if (route._interned)
+        return &route;
+
+    const void* hops;
+    if (_compact) {
+        vector<uint32_t> index(route.size());
+        for (size_t i = 0; i < route.size(); i++) {
+            PacketSink* sink = route.at(i);
+            unordered_map<const PacketSink*, uint32_t>::iterator s = _sink_index.find(sink);
+            if (s == _sink_index.end()) {
+                s = _sink_index.insert(make_pair(sink, (uint32_t)_sinks.size())).first;
+                _sinks.push_back(sink);
+            }
+            index[i] = s->second;
+        }
+        hops = intern_hops(index.data(), index.size(), sizeof(uint32_t));
+    } else {
+        hops = intern_hops(route._hops, route.size(), sizeof(PacketSink*));
+    }
+
+    RouteKey key = {hops, route._reverse, route._path_id, route._no_of_paths, route._hop_count};
+    unordered_map<RouteKey, Route*, RouteKeyHash>::iterator i = _routes.find(key);
+    if (i != _routes.end())
+        return i->second;
+
+    Route* interned = new (allocate(sizeof(Route))) Route();
+    if (_compact) {
+        interned->_index = (const uint32_t*)hops;
+        interned->_sinks = &_sinks;
+    } else {
+        interned->_hops = (PacketSink* const*)hops;
+    }
+    interned->_size = route.size();
+    interned->_hop_count = route._hop_count;
+    interned->_reverse = route._reverse;
+    interned->_path_id = route._path_id;
+    interned->_no_of_paths = route._no_of_paths;
+    interned->_interned = true;
+    _routes.insert(make_pair(key, interned));
+    return interned;
+}
+
+void
+RouteStore::report(ostream& out) {
+    out << "Routes: " << _routes.size() << " interned for " << _requests << " requests, "
+        << _sequences.size() << " hop sequences of " << _hops << " hops, "
+        << _arena_bytes / 1024 << " KB arena";
+    if (!_sinks.empty())
+        out << ", " << _sinks.size() << " sinks indexed";
+    out << endl;
+}
@@ -1,63 +1,210 @@
-// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-        
-#ifndef ROUTE_H
-#define ROUTE_H
-
-/*
- * A Route, carried by packets, to allow routing
- */
-
-#include "config.h"
-#include <list>
-#include <vector>
-
-class PacketSink;
-class Route {
-  public:
-    Route();
-    Route(int size);
-    Route(const Route& orig, PacketSink& dst);
-    Route* clone() const;
-    inline PacketSink* at(size_t n) const {return _sinklist.at(n);}
-    void push_back(PacketSink* sink) {
-        assert(sink != NULL);
-        _sinklist.push_back(sink);
-        update_hopcount(sink);
-    }
-    void push_at(PacketSink* sink,int id) {
-        _sinklist.insert(_sinklist.begin()+id, sink);
-            update_hopcount(sink);
-    }
-    void push_front(PacketSink* sink) {
-        _sinklist.insert(_sinklist.begin(), sink);
-            update_hopcount(sink);
-    }
-    void add_endpoints(PacketSink *src, PacketSink* dst);
-    inline size_t size() const {return _sinklist.size();}
-    typedef vector<PacketSink*>::const_iterator const_iterator;
-    //typedef vector<PacketSink*>::iterator iterator;
-    inline const_iterator begin() const {return _sinklist.begin();}
-    inline const_iterator end() const {return _sinklist.end();}
-    void set_reverse(Route* reverse) {_reverse = reverse;}
-    inline const Route* reverse() const {return _reverse;}
-    void set_path_id(int path_id, int no_of_paths) {
-        _path_id = path_id;
-        _no_of_paths = no_of_paths;
-    }
-    inline int path_id() const {return _path_id;}
-    inline int no_of_paths() const {return _no_of_paths;}
-    inline uint32_t hop_count() const {return _hop_count;}
- private:
-    void update_hopcount(PacketSink* sink);
-    vector<PacketSink*> _sinklist;
-    uint32_t _hop_count;
-    Route* _reverse;
-    int _path_id; //path identifier for this path
-    int _no_of_paths; //total number of paths sender is using
-};
-//typedef vector<PacketSink*> route_t;
-typedef Route route_t;
-typedef vector<route_t*> routes_t;
-
-void check_non_null(Route* rt);
-
-#endif
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef ROUTE_H
+#define ROUTE_H
+
+/*
+ * A Route, carried by packets, to allow routing
+ */
+
+#include "config.h"
+#include "simcontext.h"
+#include "memory_account.h"
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <ostream>
+
+class PacketSink;
+class Route {
+    friend class RouteStore;
+  public:
+    MEMORY_ACCOUNTED(ROUTES)
+    Route();
+    Route(int size);
+    Route(const Route& orig);
+    Route(const Route& orig, PacketSink& dst);
+    Route& operator=(const Route& orig);
+    Route* clone() const;
+    inline PacketSink* at(size_t n) const {
+        assert(n < _size);
+        if (!_sinks)
+            return _hops[n];
+        return (*_sinks)[_index[n]];
+    }
+    void push_back(PacketSink* sink) {
+        assert(sink != NULL);
+        assert(!_interned);
+        _sinklist.push_back(sink);
+        sync();
+        update_hopcount(sink);
+    }
+    void push_at(PacketSink* sink,int id) {
+        assert(!_interned);
+        _sinklist.insert(_sinklist.begin()+id, sink);
+        sync();
+            update_hopcount(sink);
+    }
+    void push_front(PacketSink* sink) {
+        assert(!_interned);
+        _sinklist.insert(_sinklist.begin(), sink);
+        sync();
+            update_hopcount(sink);
+    }
+    void add_endpoints(PacketSink *src, PacketSink* dst);
+    inline size_t size() const {return _size;}
+    class const_iterator {
+      public:
+        const_iterator(const Route* route, size_t n) : _route(route), _n(n) {}
+        PacketSink* operator*() const {return _route->at(_n);}
+        const_iterator& operator++() {_n++; return *this;}
+        bool operator==(const const_iterator& other) const {return _n == other._n;}
+        bool operator!=(const const_iterator& other) const {return _n != other._n;}
+      private:
+        const Route* _route;
+        size_t _n;
+    };
+    inline const_iterator begin() const {return const_iterator(this, 0);}
+    inline const_iterator end() const {return const_iterator(this, _size);}
+    void set_reverse(Route* reverse) {assert(!_interned); _reverse = reverse;}
+    inline const Route* reverse() const {return _reverse;}
+    void set_path_id(int path_id, int no_of_paths) {
+        assert(!_interned);
+        _path_id = path_id;
+        _no_of_paths = no_of_paths;
+    }
+    inline int path_id() const {return _path_id;}
+    inline int no_of_paths() const {return _no_of_paths;}
+    inline uint32_t hop_count() const {return _hop_count;}
+    // shared by everyone holding it, and never changes; see RouteStore
+    inline bool interned() const {return _interned;}
+ private:
+    void update_hopcount(PacketSink* sink);
+    // the hops of a route being built live in _sinklist
+    void sync() {_hops = _sinklist.data(); _size = _sinklist.size();}
+
+    vector<PacketSink*> _sinklist;
+    union {
+        PacketSink* const* _hops;
+        const uint32_t* _index;  // when interned compact: into *_sinks
+    };
+    const vector<PacketSink*>* _sinks; // NULL unless interned compact
+    uint32_t _size;
+    uint32_t _hop_count;
+    Route* _reverse;
+    int _path_id; //path identifier for this path
+    int _no_of_paths; //total number of paths sender is using
+    bool _interned;
+};
+//typedef vector<PacketSink*> route_t;
+typedef Route route_t;
+typedef vector<route_t*> routes_t;
+
+void check_non_null(Route* rt);
+
+// Paths between two hosts by index, for transports that choose among
+// many.  A path from get_path() stays valid until it's handed back with
+// put_path(), so copy it to keep it any longer.  Its reverse, if it has
+// one, stays valid for the rest of the run.
+class PathSource {
+ public:
+    virtual ~PathSource() {}
+    virtual uint32_t no_of_paths(uint32_t src, uint32_t dest) = 0;
+    virtual const Route* get_path(uint32_t src, uint32_t dest, uint32_t k) = 0;
+    virtual void put_path(const Route* path) = 0;
+};
+
+// The paths in a vector, for whoever has them all already: the same
+// paths whichever hosts are asked about.
+class PathList : public PathSource {
+ public:
+    PathList(const vector<const Route*>& paths) : _paths(paths) {}
+    virtual uint32_t no_of_paths(uint32_t src, uint32_t dest) {return _paths.size();}
+    virtual const Route* get_path(uint32_t src, uint32_t dest, uint32_t k) {return _paths.at(k);}
+    virtual void put_path(const Route* path) {}
+ private:
+    const vector<const Route*>& _paths;
+};
+
+/*
+ * Interned routes.
+ *
+ * Most routes are copies.  Each connection copies its path out of the
+ * topology's path lists, each subflow copies that again to append its
+ * sink, and a switch builds a fresh FIB route through the same port
+ * for every destination it learns.  A RouteStore keeps one immutable
+ * Route for each distinct route - the same hops, reverse, path id and
+ * hop count - and hands that one out to everyone asking for it.  The
+ * hop sequences are interned separately, in a flat arena, so routes
+ * that only differ in their reverse or path id share their hops, and
+ * an interned route needs no heap allocation of its own.
+ *
+ * In compact mode hops are stored as 32-bit indices into a table of
+ * the sinks seen, which halves the hop arena at the cost of one more
+ * load per hop.  It applies to routes interned after it is set.
+ *
+ * Interned routes live as long as the SimContext.
+ */
+class RouteStore : public SimState {
+ public:
+    RouteStore();
+    virtual ~RouteStore();
+    static RouteStore& current() {return SimContext::current().state<RouteStore>();}
+
+    // The interned copy of route, which can be a temporary.
+    const Route* intern(const Route& route);
+
+    void set_compact(bool compact) {_compact = compact;}
+    bool compact() const {return _compact;}
+
+    void report(ostream& out);
+    size_t routes() const {return _routes.size();}
+    size_t bytes() const {return _arena_bytes;}
+
+ private:
+    struct HopSeq {
+        const void* hops;
+        uint32_t size;
+        uint32_t width; // bytes per hop
+        size_t hash;
+    };
+    struct HopSeqHash {
+        size_t operator()(const HopSeq& s) const {return s.hash;}
+    };
+    struct HopSeqEqual {
+        bool operator()(const HopSeq& a, const HopSeq& b) const;
+    };
+    struct RouteKey {
+        const void* hops;
+        const Route* reverse;
+        int path_id;
+        int no_of_paths;
+        uint32_t hop_count;
+        bool operator==(const RouteKey& other) const {
+            return hops == other.hops && reverse == other.reverse
+                && path_id == other.path_id && no_of_paths == other.no_of_paths
+                && hop_count == other.hop_count;
+        }
+    };
+    struct RouteKeyHash {
+        size_t operator()(const RouteKey& k) const;
+    };
+
+    // the arena copy of these hops, shared with any earlier identical ones
+    const void* intern_hops(const void* hops, uint32_t size, uint32_t width);
+    void* allocate(size_t bytes);
+
+    bool _compact;
+    vector<PacketSink*> _sinks; // compact mode's index -> sink
+    unordered_map<const PacketSink*, uint32_t> _sink_index;
+    unordered_set<HopSeq, HopSeqHash, HopSeqEqual> _sequences;
+    unordered_map<RouteKey, Route*, RouteKeyHash> _routes;
+
+    vector<char*> _chunks;
+    size_t _chunk_used;  // bytes of the last chunk handed out
+    size_t _arena_bytes; // in all the chunks
+    uint64_t _hops;      // in all the interned sequences
+    uint64_t _requests;
+};
+
+#endif
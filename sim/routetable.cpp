@@ -4,8 +4,9 @@
 #include "network.h"
 #include "queue.h"
 #include "pipe.h"
+#include "checkpoint.h"
 
-void RouteTable::addRoute(int destination, Route* port, int cost, packet_direction direction){  
+void RouteTable::addRoute(int destination, const Route* port, int cost, packet_direction direction){  
     if (_fib.find(destination) == _fib.end())
         _fib[destination] = new vector<FibEntry*>(); 
     
@@ -14,7 +15,7 @@ void RouteTable::addRoute(int destination, Route* port, int cost, packet_directi
     _fib[destination]->push_back(new FibEntry(port,cost,direction));
 }
 
-void RouteTable::addHostRoute(int destination, Route* port, int flowid){  
+void RouteTable::addHostRoute(int destination, const Route* port, int flowid){  
     if (_hostfib.find(destination) == _hostfib.end())
         _hostfib[destination] = new unordered_map<int, HostFibEntry*>(); 
     
@@ -23,6 +24,17 @@ void RouteTable::addHostRoute(int destination, Route* port, int flowid){
     (*_hostfib[destination])[flowid] = new HostFibEntry(port,flowid);
 }
 
+void RouteTable::removeHostRoute(int destination, int flowid){
+    unordered_map<int, unordered_map<int,HostFibEntry*>*>::iterator i = _hostfib.find(destination);
+    if (i == _hostfib.end())
+        return;
+    unordered_map<int,HostFibEntry*>::iterator e = i->second->find(flowid);
+    if (e == i->second->end())
+        return;
+    delete e->second;
+    i->second->erase(e);
+}
+
 
 vector<FibEntry*>* RouteTable::getRoutes(int destination){
     if (_fib.find(destination) == _fib.end())
@@ -44,4 +56,60 @@ HostFibEntry* RouteTable::getHostRoute(int destination,int flowid){
 
 void RouteTable::setRoutes(int destination, vector<FibEntry*>* routes){
     _fib[destination] = routes;
-}
\ No newline at end of file
+}
+void RouteTable::checkpoint(CheckpointArchive& archive){
+    struct DestTable {
+        int dest;
+        uint32_t table;
+    };
+    vector<vector<FibEntry*>*> tables;
+    unordered_map<vector<FibEntry*>*, uint32_t> table_index;
+    vector<DestTable> dests;
+    if (archive.saving()) {
+        for (unordered_map<int,vector<FibEntry*>*>::iterator i = _fib.begin(); i != _fib.end(); i++) {
+            if (table_index.find(i->second) == table_index.end()) {
+                table_index[i->second] = tables.size();
+                tables.push_back(i->second);
+            }
+            dests.push_back(DestTable{i->first, table_index[i->second]});
+        }
+    } else {
+        for (unordered_map<int,vector<FibEntry*>*>::iterator i = _fib.begin(); i != _fib.end(); i++) {
+            if (table_index.insert(make_pair(i->second, 0)).second) {
+                for (size_t e = 0; e < i->second->size(); e++)
+                    delete (*i->second)[e];
+                delete i->second;
+            }
+        }
+        _fib.clear();
+        table_index.clear();
+    }
+
+    uint64_t n = tables.size();
+    archive.io(n);
+    tables.resize(n);
+    for (size_t t = 0; t < n; t++) {
+        uint64_t entries = archive.saving() ? tables[t]->size() : 0;
+        archive.io(entries);
+        if (archive.restoring())
+            tables[t] = new vector<FibEntry*>();
+        for (size_t e = 0; e < entries; e++) {
+            FibEntry* entry = archive.saving() ? (*tables[t])[e] : NULL;
+            const Route* out = archive.saving() ? entry->getEgressPort() : NULL;
+            uint32_t cost = archive.saving() ? entry->getCost() : 0;
+            packet_direction direction = archive.saving() ? entry->getDirection() : NONE;
+            archive.route(out);
+            archive.io(cost);
+            archive.io(direction);
+            if (archive.restoring())
+                tables[t]->push_back(new FibEntry(out, cost, direction));
+        }
+    }
+    archive.io(dests);
+    for (size_t d = 0; d < dests.size(); d++) {
+        if (dests[d].table >= tables.size())
+            archive.fail("a route to nowhere");
+        if (archive.restoring())
+            _fib[dests[d].dest] = tables[dests[d].table];
+    }
+}
@@ -7,6 +7,7 @@
  */
 
 #include "queue.h"
+#include "memory_account.h"
 
 #include <list>
 #include <vector>
@@ -14,39 +15,47 @@
 
 class FibEntry{
 public:
-    FibEntry(Route* outport, uint32_t cost, packet_direction direction){ _out = outport; _cost = cost;_direction = direction;}
+    MEMORY_ACCOUNTED(FIB)
+    FibEntry(const Route* outport, uint32_t cost, packet_direction direction){ _out = outport; _cost = cost;_direction = direction;}
 
-    Route* getEgressPort(){return _out;}
+    const Route* getEgressPort(){return _out;}
     uint32_t getCost(){return _cost;}
     packet_direction getDirection(){return _direction;}
     
 protected:
-    Route* _out;
+    const Route* _out;
     uint32_t _cost;
     packet_direction _direction;
 };
 
 class HostFibEntry{
 public:
-    HostFibEntry(Route* outport, int flowid){ _flowid = flowid; _out = outport;}
+    MEMORY_ACCOUNTED(FIB)
+    HostFibEntry(const Route* outport, int flowid){ _flowid = flowid; _out = outport;}
 
-    Route* getEgressPort(){return _out;}
+    const Route* getEgressPort(){return _out;}
     int getFlowID(){return _flowid;}
 
 protected:
-    Route* _out;
+    const Route* _out;
     uint32_t _flowid;
 
 };
 
 class RouteTable {
 public:
+    MEMORY_ACCOUNTED(FIB)
     RouteTable() {};
-    void addRoute(int destination, Route* port, int cost, packet_direction direction);  
-    void addHostRoute(int destination, Route* port, int flowid);  
+    void addRoute(int destination, const Route* port, int cost, packet_direction direction);  
+    void addHostRoute(int destination, const Route* port, int flowid);  
+    void removeHostRoute(int destination, int flowid);
     void setRoutes(int destination, vector<FibEntry*>* routes);  
     vector <FibEntry*>* getRoutes(int destination);
     HostFibEntry* getHostRoute(int destination, int flowid);
+    // Save or restore the routes learned, keeping destinations that
+    // share a set of routes sharing it.  Host routes are set up by the
+    // driver, so are left as they are.
+    void checkpoint(CheckpointArchive& archive);
     
 private:
     unordered_map<int,vector<FibEntry*>* > _fib;
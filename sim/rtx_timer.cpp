@@ -1,114 +1,224 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include <algorithm>
 #include "rtx_timer.h"
+#include "checkpoint.h"
 
-RtxTimer::RtxTimer(EventList& list):
-  _eventList(list)
+RtxTimerClient::RtxTimerClient()
+    : _rtx_wheel(NULL), _rtx_prev(NULL), _rtx_next(NULL), _rtx_slot(NULL),
+      _rtx_tick(0), _rtx_order(0), _rtx_firing(false), _rtx_source(NULL)
 {
-  TimerBucket* bucket;
-  simtime_picosec now;
-  now = _eventList().now();
-
-  for (int i=50;i<=400;i*=2){
-    bucket = new TimerBucket();
-    bucket->base = timeFromMs(i);
-    bucket->expire  = now + bucket->base;
-  }
 }
 
-//time is absolute!
-void RtxTimer::schedule_timer(TcpSrc* who,simtime_picosec when){
-  timer_entry * t;
-
-  if (active_timers.find(who)!=active_timers.end()){
-    t = remove_timer(who);
-  }
-  else {
-    t = new timer_entry();
-    active_timers.insert(who);
-  }
-  t->who = who;
-  t->when = when;
-  
-  simtime_picosec now = _eventList().now(), delta = when-now;
-
-  vector<TimerBucket*>::iterator it;
-  TimerBucket* crt = NULL;
-  int j = -1;
-
-  for (int i = 0;i<_buckets.size();i++){
-    crt = _buckets[i];
-    
-    if (crt->base>delta){
-      j = i-1;
-      break;
+RtxTimerClient::~RtxTimerClient() {
+    if (_rtx_wheel)
+        _rtx_wheel->cancel(this);
+}
+
+void
+RtxTimerClient::rtx_timer_update() {
+    if (_rtx_wheel)
+        _rtx_wheel->schedule(this);
+}
+
+void
+RtxTimerClient::checkpoint_rtx_timer(CheckpointArchive& archive) {
+    if (_rtx_firing)
+        archive.fail("retransmit timers can only be checkpointed between ticks");
+    archive.check(_rtx_order, "retransmit timer registration order");
+    bool filed = (_rtx_slot != NULL);
+    archive.io(filed);
+    archive.io(_rtx_tick);
+    if (archive.restoring()) {
+        if (_rtx_slot)
+            _rtx_wheel->unlink(this);
+        if (filed) {
+            if (!_rtx_wheel)
+                archive.fail("a retransmit timer with no wheel");
+            // the level may not be the one it was filed at, but it
+            // fires on the same tick all the same
+            _rtx_wheel->link(this, _rtx_tick);
+        }
+    }
+}
+
+RtxTimerWheel::RtxTimerWheel(simtime_picosec scanPeriod, EventList& eventlist)
+    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod)
+{
+    assert(_scanPeriod > 0);
+    runFirst();
+    _origin = eventlist.now();
+    _next_tick = 1;
+    _next_order = 0;
+    for (unsigned l = 0; l < LEVELS; l++)
+        for (uint64_t s = 0; s < SLOTS; s++)
+            _slots[l][s] = NULL;
+    _firing_pos = 0;
+    _firing_order = 0;
+    _scanning = false;
+    eventlist.sourceIsPendingRel(*this, _scanPeriod);
+}
+
+void
+RtxTimerWheel::registerSrc(RtxTimerClient& src) {
+    assert(src._rtx_wheel == NULL);
+    src._rtx_wheel = this;
+    src._rtx_order = _next_order++;
+    src._rtx_source = dynamic_cast<EventSource*>(&src);
+    schedule(&src);
+}
+
+void
+RtxTimerWheel::link(RtxTimerClient* src, uint64_t tick) {
+    // the level is set by how far away the tick is, the slot by the
+    // tick itself, so a slot comes round again just as the ticks
+    // filed in it are about to fall within the level below
+    uint64_t delta = tick - _next_tick;
+    unsigned level = 0;
+    while (delta >= SLOTS) {
+        delta >>= SLOT_BITS;
+        level++;
     }
-    else j = i;
-  }
-
-  if (j<0){
-    _soon[t->when] = t;
-  }
-  else{
-    //insert in that timerbucket;
-    _buckets[j]->timers[who] = t;
-    _timer_to_bucket[who] = _buckets[j];
-  }
+    RtxTimerClient** head = &_slots[level][(tick >> (level * SLOT_BITS)) & (SLOTS - 1)];
+    src->_rtx_slot = head;
+    src->_rtx_tick = tick;
+    src->_rtx_prev = NULL;
+    src->_rtx_next = *head;
+    if (*head)
+        (*head)->_rtx_prev = src;
+    *head = src;
 }
 
-void RtxTimer::reschedule_timer(TcpSrc* who,simtime_picosec when){
-  //fast case only!
-  if (_active_timers.find(who)==_active_timers.end()){
-    return schedule_timer(who,when);
-  }  
-  bool ok = false;
-  
-  if (_timer_to_bucket.find(who)!=_timer_to_bucket.end()){
-    TimerBucket* bucket = _timer_to_bucket[who];
-    simtime_picosec now = _eventList().now(), delta = when-now;
-    if (delta>bucket->base) //ok to reschedule here!
-      if (bucket->timers.find(who)!=bucket->timers.end()){
-        t = bucket->timers[who];
-        t->when = when;
-        ok = true;
-      }
-  }
-
-  if (!ok) 
-    schedule_timer(who,when);
+void
+RtxTimerWheel::unlink(RtxTimerClient* src) {
+    if (src->_rtx_prev)
+        src->_rtx_prev->_rtx_next = src->_rtx_next;
+    else
+        *src->_rtx_slot = src->_rtx_next;
+    if (src->_rtx_next)
+        src->_rtx_next->_rtx_prev = src->_rtx_prev;
+    src->_rtx_slot = NULL;
 }
 
-void RtxTimer::remove_timer(TcpSrc* who){
-  timer_entry * t = NULL;
+void
+RtxTimerWheel::schedule(RtxTimerClient* src) {
+    if (src->_rtx_slot)
+        unlink(src);
+    if (src->_rtx_firing) {
+        // the scan in progress will look at it again after its hook
+        return;
+    }
+    simtime_picosec due = src->rtx_timer_due();
+    if (due == RtxTimerClient::IDLE)
+        return;
+
+    simtime_picosec now = eventlist().now();
+    if (_scanning && due <= now && src->_rtx_order > _firing_order) {
+        // due now and the scanner hadn't reached it yet this tick
+        vector<RtxTimerClient*>::iterator i = _firing.begin() + _firing_pos + 1;
+        while (i != _firing.end() && (*i == NULL || (*i)->_rtx_order < src->_rtx_order))
+            i++;
+        _firing.insert(i, src);
+        src->_rtx_firing = true;
+        return;
+    }
+
+    uint64_t tick = _next_tick;
+    if (due > tick_time(tick))
+        tick = (due - _origin + _scanPeriod - 1) / _scanPeriod;
+    link(src, tick);
+}
 
-  if (_active_timers.find(who)==_active_timers.end()){
-    return NULL;
-  }  
+void
+RtxTimerWheel::cancel(RtxTimerClient* src) {
+    if (src->_rtx_slot)
+        unlink(src);
+    if (src->_rtx_firing) {
+        for (size_t i = _firing_pos; i < _firing.size(); i++) {
+            if (_firing[i] == src)
+                _firing[i] = NULL;
+        }
+    }
+}
 
-  _active_timers.erase(who);
+void
+RtxTimerWheel::cascade(unsigned level, uint64_t slot) {
+    RtxTimerClient* src = _slots[level][slot];
+    _slots[level][slot] = NULL;
+    while (src) {
+        RtxTimerClient* next = src->_rtx_next;
+        link(src, src->_rtx_tick);
+        src = next;
+    }
+}
 
-  if (_timer_to_bucket.find(who)!=_timer_to_bucket.end()){
-    TimerBucket* bucket = _timer_to_bucket[who];
-    if (bucket->timers.find(who)!=bucket->timers.end()){
-      t = bucket->timers[who];
-      bucket->timers.erase(who);
+void
+RtxTimerWheel::doNextEvent() {
+    simtime_picosec now = eventlist().now();
+    uint64_t tick = _next_tick;
+    assert(now == tick_time(tick));
+
+    // each time a level wraps, bring the next slot of the level above
+    // down to where it can expire
+    for (unsigned l = 1; l < LEVELS; l++) {
+        if ((tick >> ((l - 1) * SLOT_BITS)) & (SLOTS - 1))
+            break;
+        cascade(l, (tick >> (l * SLOT_BITS)) & (SLOTS - 1));
     }
 
-    _timer_to_bucket.erase(_timer_to_bucket.find(who).second);
-  }
-  else {
-    list<timer_entry*>::iterator it;
-    bool found = false;
-
-    for (it = _soon.begin();it!=_soon.end();it++){
-      t = _soon[*it];
-      if (t->who==who){
-        found = true;
-        _soon.erase(it);
-        break;
-      }
+    RtxTimerClient** head = &_slots[0][tick & (SLOTS - 1)];
+    _firing.clear();
+    for (RtxTimerClient* src = *head; src; src = src->_rtx_next) {
+        src->_rtx_slot = NULL;
+        src->_rtx_firing = true;
+        _firing.push_back(src);
+    }
+    *head = NULL;
+    sort(_firing.begin(), _firing.end(),
+         [](const RtxTimerClient* a, const RtxTimerClient* b) {return a->_rtx_order < b->_rtx_order;});
+
+    _next_tick = tick + 1;
+    _scanning = true;
+    for (_firing_pos = 0; _firing_pos < _firing.size(); _firing_pos++) {
+        RtxTimerClient* src = _firing[_firing_pos];
+        if (!src)
+            continue;
+        _firing_order = src->_rtx_order;
+        // the hook draws from the source's own random stream
+        if (src->_rtx_source)
+            eventlist().context().set_random_source(src->_rtx_source);
+        src->rtx_timer_hook(now, _scanPeriod);
+        eventlist().context().set_random_source(this);
+        src = _firing[_firing_pos];
+        if (!src)
+            continue;
+        // still due means the hook did nothing this time: the scanners
+        // would have called it again next tick, so we do too
+        src->_rtx_firing = false;
+        schedule(src);
     }
-    if (!found)
-      t = NULL;
-  }
+    _scanning = false;
+    _firing.clear();
 
-  return t;
+    eventlist().sourceIsPendingRel(*this, _scanPeriod);
+}
+
+void
+RtxTimerWheel::checkpoint(CheckpointArchive& archive) {
+    archive.check_class(*this, typeid(RtxTimerWheel));
+    if (_scanning)
+        archive.fail("retransmit timers can only be checkpointed between ticks");
+    checkpoint_random(archive);
+    archive.check(_scanPeriod, "retransmit timer scan period");
+    archive.check(_origin, "retransmit timer origin");
+    archive.check(_next_order, "retransmit timers registered");
+    archive.io(_next_tick);
+    if (archive.restoring()) {
+        for (unsigned l = 0; l < LEVELS; l++) {
+            for (uint64_t s = 0; s < SLOTS; s++) {
+                for (RtxTimerClient* src = _slots[l][s]; src; src = src->_rtx_next)
+                    src->_rtx_slot = NULL;
+                _slots[l][s] = NULL;
+            }
+        }
+    }
 }
@@ -1,78 +1,103 @@
-#ifndef __RTX_TIMER
-#define __RTX_TIMER
-
-#include <list>
-#include <hash_map>
-#include <map>
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef RTX_TIMER_H
+#define RTX_TIMER_H
+
+/*
+ * Retransmission timer service shared by all the transports.
+ *
+ * Transports used to register with a per-protocol RtxTimerScanner,
+ * which called every source's rtx_timer_hook() every scan period
+ * whether or not its timer was anywhere near expiring.  With
+ * thousands of flows and a 10ns scan period that dominated the run
+ * time.
+ *
+ * RtxTimerWheel keeps the same scan ticks (every scanPeriod from when
+ * it is created), but only calls the hooks of sources whose timers
+ * are due.  Each source says when its hook may next have work to do
+ * via rtx_timer_due(), and calls rtx_timer_update() whenever that may
+ * have changed.  The source is then filed in a hierarchical timing
+ * wheel (64 slots per level, cascading down as time advances), so
+ * arming, re-arming and cancelling are O(1) and each tick only
+ * touches the sources that expire on it.
+ *
+ * The hooks see exactly what the scanners showed them: a source is
+ * called on every tick from its due time onwards until it re-arms or
+ * goes idle, and sources due on the same tick are called in the order
+ * they were registered.  A tick runs ahead of every other event due at
+ * the same time, and a hook draws from its source's random stream, so
+ * it makes no difference whether the sources share one wheel or the
+ * network is split across several event lists, each with its own.
+ */
+
+#include <vector>
 #include "config.h"
-#include "network.h"
-#include "tcppacket.h"
 #include "eventlist.h"
 
+class RtxTimerWheel;
+
+class RtxTimerClient {
+    friend class RtxTimerWheel;
+public:
+    // rtx_timer_due() value for a source with no timer running
+    static const simtime_picosec IDLE = UINT64_MAX;
+
+    RtxTimerClient();
+    virtual ~RtxTimerClient();
+    virtual void rtx_timer_hook(simtime_picosec now, simtime_picosec period) = 0;
+    // Earliest time at which rtx_timer_hook() may act, or IDLE.  It
+    // is fine to be early (the hook is simply called for nothing), but
+    // never late.
+    virtual simtime_picosec rtx_timer_due() const = 0;
+protected:
+    // call after changing anything rtx_timer_due() depends on
+    void rtx_timer_update();
+    RtxTimerWheel* rtx_timer_wheel() const {return _rtx_wheel;}
+    // Save or restore where we're filed, for the client's checkpoint();
+    // the wheel must have been restored first.
+    void checkpoint_rtx_timer(CheckpointArchive& archive);
+private:
+    RtxTimerWheel* _rtx_wheel;
+    RtxTimerClient* _rtx_prev;
+    RtxTimerClient* _rtx_next;
+    RtxTimerClient** _rtx_slot; // head of the slot we're filed in, or NULL
+    uint64_t _rtx_tick;         // the tick we're filed for
+    uint64_t _rtx_order;        // registration order
+    bool _rtx_firing;           // in the tick currently being scanned
+    EventSource* _rtx_source;   // us, if we're an EventSource
+};
 
-class RtxTimer {
- public:
-  RtxTimer(EventList & list);
-
-  void schedule_timer(TcpSrc* who,simtime_picosec when);
-  void reschedule_timer(TcpSrc* who,simtime_picosec when);
-  void remove_timer(TcpSrc* who);
-
-  void check_lists(); 
-
-  struct timer_entry {
-    TcpSrc* who;
-    simtime_picosec when;
-  };
-
-  EventList& _eventList;
-
-  struct eqint
-  {
-    bool operator()(const int i1, const int i2) const
-    {
-      return i1==i2;
-    }
-  };
-
-  struct ltint
-  {
-    bool operator()(const int i1, const int i2) const
-    {
-      return i1<i2;
-    }
-  };
-
-  struct lttime
-  {
-    bool operator()(const simtime_picosec i1, const simtime_picosec i2) const
-    {
-      return i1<i2;
-    }
-  };
-
-
-  struct eqtcp
-  {
-    bool operator()(const TcpSrc* src1, const TcpSrc* src2) const
-    {
-      return src1==src2;
-    }
-  };
-
-  typedef hash_map<const TcpSrc*, timer_entry*, hash<int>,eqtcp> Timers;
-
-  struct TimerBucket {
-    Timers timers;
-    simtime_picosec base;
-    simtime_picosec expire;
-  }
-
-  map<simtime_picosec,timer_entry*,lttime> _soon;
-  vector<TimerBucket*> _buckets;
-
-  hash_set<const TcpSrc*, hash<int>, eqint> _active_timers;
-  hash_map<const TcpSrc*, TimerBucket*,hash<int>,eqint> _timer_to_bucket;
+class RtxTimerWheel : public EventSource {
+public:
+    RtxTimerWheel(simtime_picosec scanPeriod, EventList& eventlist);
+    void doNextEvent();
+    void registerSrc(RtxTimerClient& src);
+    simtime_picosec scanPeriod() const {return _scanPeriod;}
+    // restoring empties the wheel, for the clients to file themselves again
+    virtual void checkpoint(CheckpointArchive& archive);
+private:
+    friend class RtxTimerClient;
+    static const unsigned SLOT_BITS = 6;
+    static const uint64_t SLOTS = 1 << SLOT_BITS;
+    static const unsigned LEVELS = 11; // enough for any 64 bit tick
+
+    void schedule(RtxTimerClient* src);
+    void cancel(RtxTimerClient* src);
+    void link(RtxTimerClient* src, uint64_t tick);
+    void unlink(RtxTimerClient* src);
+    void cascade(unsigned level, uint64_t slot);
+    inline simtime_picosec tick_time(uint64_t tick) const {return _origin + tick * _scanPeriod;}
+
+    simtime_picosec _scanPeriod;
+    simtime_picosec _origin;  // tick n happens at _origin + n * _scanPeriod
+    uint64_t _next_tick;      // the first tick not yet scanned
+    uint64_t _next_order;
+    RtxTimerClient* _slots[LEVELS][SLOTS];
+
+    // the tick being scanned, in registration order
+    vector<RtxTimerClient*> _firing;
+    size_t _firing_pos;
+    uint64_t _firing_order;
+    bool _scanning;
 };
 
 #endif
@@ -0,0 +1,149 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef SEQ_BITMAP_H
+#define SEQ_BITMAP_H
+
+/*
+ * The packets a receiver holds beyond its cumulative ack, one bit per
+ * packet, for sinks that used to keep them in a set<seq_t>.
+ *
+ * Packets are numbered by the caller - typically (seqno-1)/mss - and
+ * everything before the next expected packet must already have been
+ * consumed.  The bits live in a ring of 64-bit words covering a window
+ * that starts at the word holding the next expected packet; the ring
+ * doubles when a packet arrives beyond it, and is never allocated at
+ * all while packets arrive in order.  Moving the cumulative ack on is a
+ * count-trailing-ones per word rather than a set erase per packet.
+ *
+ * A sender can keep a set of marked packets the same way, finding the
+ * lowest with first() and dropping those it no longer cares about with
+ * discard().
+ */
+
+#include <vector>
+#include <assert.h>
+#include "config.h"
+
+class SeqBitmap {
+public:
+    SeqBitmap() : _base(0), _mask(0), _count(0) {}
+
+    // forget everything, keeping the words for the next connection
+    void clear() {
+        for (size_t i = 0; i < _words.size(); i++)
+            _words[i] = 0;
+        _base = 0;
+        _count = 0;
+    }
+
+    // packet n arrived out of order; n must be past the next expected
+    // packet given to the last consume()
+    void insert(uint64_t n) {
+        assert(n >= _base);
+        if (n - _base >= (uint64_t)_words.size() * 64)
+            grow(n);
+        uint64_t& w = word(n);
+        uint64_t bit = (uint64_t)1 << (n & 63);
+        if (!(w & bit)) {
+            w |= bit;
+            _count++;
+        }
+    }
+
+    void erase(uint64_t n) {
+        if (!contains(n))
+            return;
+        word(n) &= ~((uint64_t)1 << (n & 63));
+        _count--;
+    }
+
+    bool contains(uint64_t n) const {
+        if (n < _base || n - _base >= (uint64_t)_words.size() * 64)
+            return false;
+        return _words[(n >> 6) & _mask] & ((uint64_t)1 << (n & 63));
+    }
+
+    // Everything before packet next is in: remove the run of packets
+    // held from next on and return how long it was.  next must not go
+    // backwards between calls.
+    uint64_t consume(uint64_t next) {
+        assert(next >= _base);
+        uint64_t n = next;
+        while (_count > 0) {
+            uint64_t& w = word(n);
+            uint32_t shift = n & 63;
+            uint64_t ones = ~(w >> shift);
+            uint32_t run = ones ? __builtin_ctzll(ones) : 64 - shift;
+            if (run == 0)
+                break;
+            if (run == 64)
+                w = 0;
+            else
+                w &= ~((((uint64_t)1 << run) - 1) << shift);
+            _count -= run;
+            n += run;
+            if (n & 63)
+                break; // the run ended inside this word
+        }
+        // nothing is held before n, so the window can start at its word
+        _base = n & ~(uint64_t)63;
+        return n - next;
+    }
+
+    // forget the packets before next, which must not go backwards
+    void discard(uint64_t next) {
+        assert(next >= _base);
+        for (uint64_t n = _base; _count > 0 && n < next; n = (n | 63) + 1) {
+            uint64_t& w = word(n);
+            uint64_t below = next - (n & ~(uint64_t)63) >= 64
+                ? ~(uint64_t)0 : ((uint64_t)1 << (next & 63)) - 1;
+            _count -= __builtin_popcountll(w & below);
+            w &= ~below;
+        }
+        _base = next & ~(uint64_t)63;
+    }
+
+    // the lowest packet held; there must be one
+    uint64_t first() const {
+        assert(_count > 0);
+        for (uint64_t n = _base; ; n += 64) {
+            uint64_t w = _words[(n >> 6) & _mask];
+            if (w)
+                return n + __builtin_ctzll(w);
+        }
+    }
+
+    bool empty() const {return _count == 0;}
+    size_t size() const {return _count;}
+    size_t bytes() const {return _words.capacity() * sizeof(uint64_t);}
+
+    // save or restore the packets held; see CheckpointArchive
+    template<class Archive> void checkpoint(Archive& archive) {
+        archive.io(_words);
+        archive.io(_base);
+        archive.io(_mask);
+        archive.io(_count);
+    }
+
+private:
+    uint64_t& word(uint64_t n) {return _words[(n >> 6) & _mask];}
+
+    // make room for packet n, keeping the words of the current window
+    void grow(uint64_t n) {
+        size_t words = _words.empty() ? 1 : _words.size();
+        while (n - _base >= (uint64_t)words * 64)
+            words *= 2;
+        vector<uint64_t> grown(words, 0);
+        uint64_t first = _base >> 6;
+        for (size_t i = 0; i < _words.size(); i++)
+            grown[(first + i) & (words - 1)] = _words[(first + i) & _mask];
+        _words.swap(grown);
+        _mask = words - 1;
+    }
+
+    vector<uint64_t> _words; // a power of two of them
+    uint64_t _base;          // first packet of the window, a multiple of 64
+    uint64_t _mask;          // _words.size() - 1
+    size_t _count;           // bits set
+};
+
+#endif
@@ -0,0 +1,91 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef SEQ_RING_H
+#define SEQ_RING_H
+
+/*
+ * Per-packet state for a sliding window of packets, for senders that
+ * used to keep it in a map<seq_t, T> keyed by sequence number.
+ *
+ * Packets are numbered by the caller - typically (seqno-1)/mss - and
+ * the window starts at the first packet still wanted, moved on with
+ * advance().  The slots are a ring indexed by packet number modulo its
+ * size, a power of two that doubles when a packet lands past the end
+ * of the window, so once a connection's window has been reached a
+ * lookup or store is an index and never allocates.  A slot that was
+ * never stored to reads as T().
+ */
+
+#include <vector>
+#include <assert.h>
+#include "config.h"
+
+template<class T>
+class SeqRing {
+public:
+    SeqRing() : _base(0), _mask(0) {}
+
+    // forget everything, keeping the slots for the next connection
+    void clear() {
+        for (size_t i = 0; i < _slots.size(); i++)
+            _slots[i] = T();
+        _base = 0;
+    }
+
+    // what's stored for packet n, or T() if nothing is
+    T get(uint64_t n) const {
+        if (n < _base || n - _base >= _slots.size())
+            return T();
+        return _slots[n & _mask];
+    }
+
+    // the slot for packet n, which must not be before the window
+    T& operator[](uint64_t n) {
+        assert(n >= _base);
+        if (n - _base >= _slots.size())
+            grow(n);
+        return _slots[n & _mask];
+    }
+
+    // forget packets before n
+    void advance(uint64_t n) {
+        if (n <= _base)
+            return;
+        if (n - _base >= _slots.size()) {
+            for (size_t i = 0; i < _slots.size(); i++)
+                _slots[i] = T();
+        } else {
+            for (uint64_t i = _base; i < n; i++)
+                _slots[i & _mask] = T();
+        }
+        _base = n;
+    }
+
+    uint64_t base() const {return _base;}
+    size_t bytes() const {return _slots.capacity() * sizeof(T);}
+
+    // save or restore the window; see CheckpointArchive
+    template<class Archive> void checkpoint(Archive& archive) {
+        archive.io(_slots);
+        archive.io(_base);
+        archive.io(_mask);
+    }
+
+private:
+    // make room for packet n, keeping the slots of the current window
+    void grow(uint64_t n) {
+        size_t slots = _slots.empty() ? 16 : _slots.size();
+        while (n - _base >= slots)
+            slots *= 2;
+        vector<T> grown(slots, T());
+        for (uint64_t i = _base; i < _base + _slots.size(); i++)
+            grown[i & (slots - 1)] = _slots[i & _mask];
+        _slots.swap(grown);
+        _mask = slots - 1;
+    }
+
+    vector<T> _slots; // a power of two of them
+    uint64_t _base;   // first packet of the window
+    uint64_t _mask;   // _slots.size() - 1
+};
+
+#endif
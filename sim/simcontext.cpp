@@ -0,0 +1,72 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#include <atomic>
+#include <sstream>
+#include "simcontext.h"
+#include "network.h"
+#include "checkpoint.h"
+
+thread_local SimContext* SimContext::_current = NULL;
+
+SimContext::SimContext()
+    : data_packet_size(DEFAULTDATASIZE), packet_size_fixed(false),
+      _eventlist(NULL), _random_seed(std::mt19937::default_seed), _random_epoch(1),
+      _random_source(NULL), _next_log_id(1),
+      _next_flow_id(FLOW_ID_DYNAMIC_BASE), _next_switch_id(0)
+{
+}
+
+SimContext::~SimContext() {
+    for (size_t i = 0; i < _state.size(); i++)
+        delete _state[i];
+    if (_current == this)
+        _current = NULL;
+}
+
+void
+SimContext::seed_random(unsigned seed) {
+    _random_engine = std::mt19937(seed);
+    _random_seed = seed;
+    _random_epoch++;
+}
+
+void
+SimContext::copy_random(const SimContext& other) {
+    _random_engine = other._random_engine;
+    _random_seed = other._random_seed;
+    _random_epoch = other._random_epoch;
+}
+
+void
+SimContext::checkpoint(CheckpointArchive& archive) {
+    if (_random_source)
+        archive.fail("the context can only be checkpointed between events");
+    archive.check(_next_log_id, "the next log ID");
+    archive.check(_next_flow_id, "the next flow ID");
+    archive.check(_next_switch_id, "the next switch ID");
+    archive.io(_random_seed);
+    archive.io(_random_epoch);
+    stringstream engine;
+    engine << _random_engine;
+    string state = engine.str();
+    archive.io(state);
+    if (archive.restoring()) {
+        engine.str(state);
+        engine >> _random_engine;
+    }
+}
+
+size_t
+SimContext::new_slot() {
+    // slots are shared by all contexts, and may be handed out from any thread
+    static std::atomic<size_t> next(0);
+    return next++;
+}
+
+SimState*
+SimContext::add_state(size_t slot, SimState* state) {
+    if (slot >= _state.size())
+        _state.resize(slot + 1, NULL);
+    assert(_state[slot] == NULL);
+    _state[slot] = state;
+    return state;
+}
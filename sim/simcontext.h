@@ -0,0 +1,127 @@
+// -*- c-basic-offset: 4; indent-tabs-mode: nil -*-
+#ifndef SIMCONTEXT_H
+#define SIMCONTEXT_H
+
+/*
+ * The state one simulation used to keep in statics.
+ *
+ * The event list, the random number generator, the data packet size,
+ * the packet free lists and the counters that hand out log, flow and
+ * switch IDs all used to be process-wide, so a process could only
+ * ever run one simulation.  They now live in a SimContext.
+ *
+ * Each thread has a current context.  A thread that never binds one
+ * gets a default context the first time anything asks for it, which
+ * is all the usual single-simulation drivers need: nothing changes for
+ * them.  To run several simulations in one process, give each its own
+ * thread, and have the thread bind() a fresh SimContext before it
+ * builds anything.  The EventList, topology and transports it then
+ * creates all belong to that context.  Read-only inputs such as a
+ * parsed connection matrix can be shared between the threads.
+ *
+ * EventList is no longer static: each instance belongs to the context
+ * it was created in (see EventList::context()).  Code above libhtsim
+ * can keep its own per-simulation state in a context with state<T>().
+ * The fat-tree settings drivers make before building a topology (the
+ * tiers, latencies, routing strategy and so on) are still statics, but
+ * thread_local ones, so each simulation thread has its own.
+ *
+ * Random numbers come from the context too, but not all from one
+ * generator.  While an event runs, rand() draws from its source's own
+ * stream (see EventSource::random()), seeded from the context's seed
+ * and the source's ID, so what a source draws doesn't depend on what
+ * every other source drew before it.  That's what lets a network split
+ * across several event lists (see pdes.h) draw exactly what it draws
+ * on one.  Outside events - while the driver sets up, say - rand()
+ * draws from random_engine().
+ */
+
+#include <vector>
+#include <random>
+#include "config.h"
+#include "loggertypes.h"
+
+class EventList;
+class EventSource;
+
+// base for anything kept with state<T>(); deleted with the context
+class SimState {
+public:
+    virtual ~SimState() {}
+};
+
+class SimContext {
+    friend class EventList;
+public:
+    SimContext();
+    ~SimContext();
+
+    static inline SimContext& current() {
+        if (!_current)
+            _current = new SimContext();
+        return *_current;
+    }
+    // make this the calling thread's current context
+    void bind() {_current = this;}
+
+    // the EventList created in this context, if there is one yet
+    EventList* eventlist() const {return _eventlist;}
+
+    std::mt19937& random_engine() {return _random_engine;}
+    // reseed random_engine() and every source's stream; what srand() does
+    void seed_random(unsigned seed);
+    // the sources' streams are seeded from this; a new epoch reseeds them
+    uint64_t random_seed() const {return _random_seed;}
+    uint32_t random_epoch() const {return _random_epoch;}
+    // Whose stream rand() draws from: set by the EventList while a
+    // source's event runs, and NULL between events.
+    EventSource* random_source() const {return _random_source;}
+    void set_random_source(EventSource* src) {_random_source = src;}
+    // Start with the same seed as other, without drawing anything from
+    // it, for a context that runs part of other's network.
+    void copy_random(const SimContext& other);
+    // save or restore the random numbers, checking the IDs handed out
+    void checkpoint(CheckpointArchive& archive);
+
+    // the default size of a TCP or NDP data packet, in bytes; see
+    // Packet::set_packet_size()
+    int data_packet_size;
+    bool packet_size_fixed;
+
+    Logged::id_t new_log_id() {return _next_log_id++;}
+    Logged::id_t next_log_id() const {return _next_log_id;}
+    LoggedManager& logged_manager() {return _logged_manager;}
+    uint32_t new_flow_id() {return _next_flow_id++;}
+    uint32_t new_switch_id() {return _next_switch_id++;}
+
+    // One T per context, created on first use.
+    template<class T> T& state() {
+        size_t s = slot<T>();
+        if (s >= _state.size() || !_state[s])
+            return *static_cast<T*>(add_state(s, new T()));
+        return *static_cast<T*>(_state[s]);
+    }
+
+private:
+    template<class T> static size_t slot() {
+        static const size_t s = new_slot();
+        return s;
+    }
+    static size_t new_slot();
+    SimState* add_state(size_t slot, SimState* state);
+
+    static thread_local SimContext* _current;
+
+    EventList* _eventlist;
+    std::mt19937 _random_engine;
+    uint64_t _random_seed;
+    uint32_t _random_epoch;
+    EventSource* _random_source;
+    Logged::id_t _next_log_id;
+    LoggedManager _logged_manager;
+    uint32_t _next_flow_id;
+    uint32_t _next_switch_id;
+    vector<SimState*> _state;
+};
+
+#endif
@@ -10,7 +10,7 @@ uint32_t STrackSrc::_default_cwnd = 12;
 //  STRACK SOURCE
 ////////////////////////////////////////////////////////////////
 
-STrackSrc::STrackSrc(STrackRtxTimerScanner& rtx_scanner, STrackLogger* logger,
+STrackSrc::STrackSrc(RtxTimerWheel& rtx_scanner, STrackLogger* logger,
                      TrafficLogger* pktlogger, 
                      EventList &eventlst)
     : EventSource(eventlst,"strack"),
@@ -156,10 +156,12 @@ STrackSrc::handle_ack(STrackAck::seq_t ackno) {
     simtime_picosec now = eventlist().now();
     if (ackno > _last_acked) { // a brand new ack
         _RFC2988_RTO_timeout = now + _rto;// RFC 2988 5.3
+        rtx_timer_update();
     
         if (ackno >= _highest_sent) {
             _highest_sent = ackno;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
+            rtx_timer_update();
         }
 
         if (!_in_fast_recovery) {
@@ -272,6 +274,7 @@ STrackSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return sent_count;
@@ -329,6 +332,7 @@ STrackSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
             //cout << timeAsUs(eventlist().now()) << " " << nodename() << " RTO at " << timeAsUs(_RFC2988_RTO_timeout) << "us" << endl;
         }
     }
@@ -392,6 +396,7 @@ STrackSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -444,6 +449,14 @@ STrackSrc::receivePacket(Packet& pkt)
     handle_ack(ackno);
 }
 
+simtime_picosec
+STrackSrc::rtx_timer_due() const {
+    // rtx_timer_hook does nothing until we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void
 STrackSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     //cout << timeAsUs(eventlist().now()) << " " << nodename() << " rtx_timer_hook" << endl;
@@ -483,6 +496,7 @@ STrackSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
         //if (_rto > timeFromMs(1000))
         //  _rto = timeFromMs(1000);
         _RFC2988_RTO_timeout = now + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -674,6 +688,7 @@ STrackSrc::targetDelay(const Route& route) {
 STrackPacer::STrackPacer(STrackSrc& src, EventList& event_list)
     : EventSource(event_list,"strack_pacer"), _src(&src), _interpacket_delay(0) {
     _last_send = eventlist().now();
+    _next_send_handle = eventlist().nullHandle();
 }
 
 void
@@ -689,14 +704,14 @@ STrackPacer::schedule_send(simtime_picosec delay) {
         doNextEvent();
         return;
     }
-    eventlist().sourceIsPending(*this, _next_send);
+    _next_send_handle = eventlist().sourceIsPendingGetHandle(*this, _next_send);
 }
 
 void
 STrackPacer::cancel() {
     _interpacket_delay = 0;
     _next_send = 0;
-    eventlist().cancelPendingSource(*this);
+    eventlist().cancelPendingSourceByHandle(*this, _next_send_handle);
 }
 
 // called when we're in window-mode to update the send time so it's always correct if we
@@ -764,11 +779,11 @@ STrackSink::receivePacket(Packet& pkt) {
         _cumulative_ack = seqno + size - 1;
         _total_received += size;
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (_received.front() == _cumulative_ack+1) ) {
-            _received.pop_front();
-            _cumulative_ack += size;
-            _total_received += size;
-            if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
+        uint64_t released = _received.advance(_cumulative_ack, size);
+        _total_received += released * size;
+        if (_buffer_logger) {
+            for (uint64_t i = 0; i < released; i++)
+                _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
         }
     } else if (seqno < _cumulative_ack+1) {
         // it is before the next expected sequence - must be a spurious retransmit.
@@ -776,22 +791,8 @@ STrackSink::receivePacket(Packet& pkt) {
         cout << "Spurious retransmit received!\n";
     } else {
         // it's not the next expected sequence number
-        if (_received.empty()) {
-            _received.push_front(seqno);
-        } else if (seqno > _received.back()) {
-            // likely case - new packet above a hole
-            _received.push_back(seqno);
-        } else {
-            // uncommon case - it fills a hole, but not first hole
-            list<uint64_t>::iterator i;
-            for (i = _received.begin(); i != _received.end(); i++) {
-                if (seqno == *i) break; // it's a bad retransmit
-                if (seqno < (*i)) {
-                    _received.insert(i, seqno);
-                    if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
-                    break;
-                }
-            }
+        if (_received.insert(seqno, size)) { // else it's a bad retransmit
+            if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
         }
     }
     if (_ooo < _received.size())
@@ -821,26 +822,3 @@ uint32_t
 STrackSink::drops() {
     return _src ? _src->drops() : 0;
 }
-
-////////////////////////////////////////////////////////////////
-//  STRACK RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-STrackRtxTimerScanner::STrackRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod) {
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-STrackRtxTimerScanner::registerSrc(STrackSrc &src) {
-    _srcs.push_back(&src);
-}
-
-void STrackRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    srcs_t::iterator i;
-    for (i = _srcs.begin(); i!=_srcs.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
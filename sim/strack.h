@@ -14,6 +14,8 @@
 #include "swift_scheduler.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "rtx_timer.h"
+#include "reorder_buffer.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
 
@@ -21,7 +23,6 @@
 
 class STrackSink;
 class STrackSrc;
-class STrackRtxTimerScanner;
 class BaseScheduler;
 
 class STrackPacer : public EventSource {
@@ -37,14 +38,14 @@ private:
     simtime_picosec _interpacket_delay; // the interpacket delay, or zero if we're not pacing
     simtime_picosec _last_send;  // when the last packet was sent (always set, even when we're not pacing)
     simtime_picosec _next_send;  // when the next scheduled packet should be sent
+    EventList::Handle _next_send_handle; // the event for _next_send, so cancel() is cheap
 };
 
-class STrackSrc : public EventSource, public PacketSink, public ScheduledSrc {
+class STrackSrc : public EventSource, public PacketSink, public ScheduledSrc, public RtxTimerClient {
     friend class STrackSink;
-    friend class STrackRtxTimerScanner;
     //friend class STrackSubflowSrc;
  public:
-    STrackSrc(STrackRtxTimerScanner& rtx_scanner, STrackLogger* logger, TrafficLogger* pktlogger, EventList &eventlist);
+    STrackSrc(RtxTimerWheel& rtx_scanner, STrackLogger* logger, TrafficLogger* pktlogger, EventList &eventlist);
     void log(STrackLogger::STrackEvent event);
     virtual void connect(const Route& routeout, const Route& routeback, 
                          STrackSink& sink, simtime_picosec startTime);
@@ -133,6 +134,7 @@ class STrackSrc : public EventSource, public PacketSink, public ScheduledSrc {
     void move_path();
     void reroute(const Route &route);
     void rtx_timer_hook(simtime_picosec now, simtime_picosec period);
+    simtime_picosec rtx_timer_due() const;
     inline simtime_picosec pacing_delay() const {return _pacing_delay;}
     PacketFlow& flow() {return _flow;}
     uint32_t drops() { return _drops;}
@@ -182,7 +184,7 @@ private:
     STrackLogger* _logger;
     TrafficLogger* _traffic_logger;
     BaseScheduler* _scheduler;
-    STrackRtxTimerScanner* _rtx_timer_scanner;
+    RtxTimerWheel* _rtx_timer_scanner;
 
     // Mechanism
     void clear_timer(uint64_t start,uint64_t end);
@@ -222,8 +224,8 @@ class STrackSink : public PacketSink, public DataReceiver {
     // Mechanism
     void send_ack(simtime_picosec ts);
 
-    list<STrackAck::seq_t> _received; /* list of packets above a hole, that 
-                                      we've received */
+    ReorderBuffer<STrackAck::seq_t> _received; /* packets above a hole, that
+                                                  we've received */
     uint64_t _ooo; // out of order max
     uint64_t _total_received;
     string _nodename;
@@ -232,15 +234,4 @@ class STrackSink : public PacketSink, public DataReceiver {
     ReorderBufferLogger* _buffer_logger;
 };
 
-class STrackRtxTimerScanner : public EventSource {
- public:
-    STrackRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerSrc(STrackSrc &src);
- private:
-    simtime_picosec _scanPeriod;
-    typedef list<STrackSrc*> srcs_t;
-    srcs_t _srcs;
-};
-
 #endif
@@ -41,8 +41,8 @@ public:
     virtual PktPriority priority() const {return Packet::PRIO_NONE;}
 protected:
     seq_t _seqno;
-    bool _syn;
     simtime_picosec _ts;
+    bool _syn;
     static PacketDB<STrackPacket> _packetdb;
 };
 
@@ -175,11 +175,13 @@ SwiftSubflowSrc::handle_ack(SwiftAck::seq_t ackno) {
     simtime_picosec now = eventlist().now();
     if (ackno > _last_acked) { // a brand new ack
         _RFC2988_RTO_timeout = now + _rto;// RFC 2988 5.3
+        rtx_timer_update();
     
         if (ackno >= _highest_sent) {
             _highest_sent = ackno;
             //cout << timeAsUs(now) << " " << nodename() << " highest_sent now  " << _highest_sent << endl;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
+            rtx_timer_update();
         }
 
         if (!_in_fast_recovery) {
@@ -297,6 +299,7 @@ SwiftSubflowSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return sent_count;
@@ -354,6 +357,7 @@ SwiftSubflowSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
             //cout << timeAsUs(eventlist().now()) << " " << nodename() << " RTO at " << timeAsUs(_RFC2988_RTO_timeout) << "us" << endl;
         }
     }
@@ -365,6 +369,7 @@ SwiftSubflowSrc::send_next_packet_paced() {
     bool sent = send_next_packet();
     if(sent && (_RFC2988_RTO_timeout == timeInf)) {// still need timers even in paced mode
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
     return sent;
 }
@@ -485,6 +490,7 @@ SwiftSubflowSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -525,6 +531,14 @@ SwiftSubflowSrc::receivePacket(Packet& pkt)
     handle_ack(ackno);
 }
 
+simtime_picosec
+SwiftSubflowSrc::rtx_timer_due() const {
+    // rtx_timer_hook does nothing until we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void
 SwiftSubflowSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     //cout << timeAsUs(eventlist().now()) << " " << nodename() << " rtx_timer_hook" << endl;
@@ -569,12 +583,14 @@ SwiftSubflowSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
         //if (_rto > timeFromMs(1000))
         //  _rto = timeFromMs(1000);
         _RFC2988_RTO_timeout = now + _rto;
+        rtx_timer_update();
     }
 }
 
 void SwiftSubflowSrc::doNextEvent() {
     if(_last_acked >= _src._flow_size) {
         _RFC2988_RTO_timeout = timeInf;
+        rtx_timer_update();
         return;
     }
     if(_rtx_timeout_pending) {
@@ -673,7 +689,7 @@ double SwiftSubflowSrc::max_mdf() const {return _src.max_mdf();}
 //  SWIFT SOURCE
 ////////////////////////////////////////////////////////////////
 
-SwiftSrc::SwiftSrc(SwiftRtxTimerScanner& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, 
+SwiftSrc::SwiftSrc(RtxTimerWheel& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, 
                    EventList &eventlst)
     : EventSource(eventlst,"swift"),  _logger(logger), _traffic_logger(pktlogger), _rtx_timer_scanner(&rtx_scanner)
 {
@@ -716,7 +732,7 @@ SwiftSrc::SwiftSrc(SwiftRtxTimerScanner& rtx_scanner, SwiftLogger* logger, Traff
     _fs_beta = - _fs_alpha / sqrt(_fs_max_cwnd);
 }
 
-SwiftSrc::SwiftSrc(SwiftRtxTimerScanner& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, 
+SwiftSrc::SwiftSrc(RtxTimerWheel& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, 
                    EventList &eventlst, uint32_t addr) 
     : SwiftSrc(rtx_scanner, logger, pktlogger, eventlst)
 {
@@ -775,10 +791,18 @@ SwiftSrc::set_hdiv(double hdiv) {
 
 void
 SwiftSrc::set_paths(vector<const Route*>* rt_list){
-    size_t no_of_paths = rt_list->size();
+    PathList paths(*rt_list);
+    set_paths(paths, _destination);
+}
+
+void
+SwiftSrc::set_paths(PathSource& paths, uint32_t destination){
+    size_t no_of_paths = paths.no_of_paths(_addr, destination);
     _paths.resize(no_of_paths);
     for (size_t i=0; i < no_of_paths; i++){
-        Route* rt_tmp = new Route(*(rt_list->at(i)));
+        const Route* path = paths.get_path(_addr, destination, i);
+        Route* rt_tmp = new Route(*path);
+        paths.put_path(path);
         if (!_scheduler) {
             _scheduler = dynamic_cast<BaseScheduler*>(rt_tmp->at(0));
             assert(_scheduler);
@@ -786,7 +810,7 @@ SwiftSrc::set_paths(vector<const Route*>* rt_list){
             // sanity check all paths share the same scheduler.  If we ever want to use multiple NICs, this will need fixing
             assert(_scheduler == dynamic_cast<BaseScheduler*>(rt_tmp->at(0)));
         }
-        rt_tmp->set_path_id(i, rt_list->size());
+        rt_tmp->set_path_id(i, no_of_paths);
         _paths[i] = rt_tmp;
     }
     permute_paths();
@@ -837,7 +861,7 @@ SwiftSrc::connect(const Route& routeout, const Route& routeback, SwiftSink& sink
     _subs.push_back(sub);
     // Note: if we call set_paths after connect, this route will not (immediately) be used
     sub->connect(sink, routeout, routeback, get_id(), _scheduler);
-    _rtx_timer_scanner->registerSubflow(*sub);
+    _rtx_timer_scanner->registerSrc(*sub);
     _sink=&sink;
 
     eventlist().sourceIsPending(*this,starttime);
@@ -866,7 +890,7 @@ SwiftSrc::multipath_connect(SwiftSink& sink, simtime_picosec starttime, uint32_t
         const Route* routeback = _paths[i%_paths.size()]->reverse();
         assert(routeback);
         subflow->connect(sink, *routeout, *routeback, get_id(), _scheduler);
-        _rtx_timer_scanner->registerSubflow(*subflow);
+        _rtx_timer_scanner->registerSrc(*subflow);
     }
     eventlist().sourceIsPending(*this,starttime);
     // cout << "starttime " << timeAsUs(starttime) << endl;
@@ -906,7 +930,7 @@ void SwiftSrc::update_dsn_ack(SwiftAck::seq_t ds_ackno) {
     //cout << "Flow " << _name << " dsn ack " << ds_ackno << endl;
     if (ds_ackno >= _flow_size && _completion_time == 0){
         _completion_time = eventlist().now();
-        cout << "Flow " << _name << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ds_ackno << endl;
+        cout << "Flow " << str() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ds_ackno << endl;
     }
 }
 
@@ -942,6 +966,7 @@ void SwiftSrc::doNextEvent() {
 SwiftPacer::SwiftPacer(SwiftSubflowSrc& sub, EventList& event_list)
     : EventSource(event_list,"swift_pacer"), _sub(&sub), _interpacket_delay(0) {
     _last_send = eventlist().now();
+    _next_send_handle = eventlist().nullHandle();
 }
 
 void
@@ -957,14 +982,14 @@ SwiftPacer::schedule_send(simtime_picosec delay) {
         doNextEvent();
         return;
     }
-    eventlist().sourceIsPending(*this, _next_send);
+    _next_send_handle = eventlist().sourceIsPendingGetHandle(*this, _next_send);
 }
 
 void
 SwiftPacer::cancel() {
     _interpacket_delay = 0;
     _next_send = 0;
-    eventlist().cancelPendingSource(*this);
+    eventlist().cancelPendingSourceByHandle(*this, _next_send_handle);
 }
 
 // called when we're in window-mode to update the send time so it's always correct if we
@@ -1032,10 +1057,7 @@ SwiftSubflowSink::receivePacket(Packet& pkt) {
     if (seqno == _cumulative_ack+1) { // it's the next expected seq no
         _cumulative_ack = seqno + size - 1;
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (*(_received.begin()) == _cumulative_ack+1) ) {
-            _received.erase(_received.begin());
-            _cumulative_ack += size;
-        }
+        _received.advance(_cumulative_ack, size);
     } else if (seqno < _cumulative_ack+1) {
         // it is before the next expected sequence - must be a spurious retransmit.
         // We want to see if this happens - it generally shouldn't
@@ -1043,7 +1065,7 @@ SwiftSubflowSink::receivePacket(Packet& pkt) {
         spurious_retransmits++;
     } else {
         // it's not the next expected sequence number
-        _received.insert(seqno);
+        _received.insert(seqno, size);
         // if (_received.empty()) {
         //     _received.push_front(seqno);
         //     //it's a drop - in this simulator there are no reorderings.
@@ -1138,16 +1160,16 @@ SwiftSink::receivePacket(Packet& pkt) {
     //cout << "SwiftSink received dsn " << dsn << endl;
     if (dsn == _cumulative_data_ack+1) {
         _cumulative_data_ack = dsn + size - 1;
-        while (!_dsn_received.empty() && (*(_dsn_received.begin()) == _cumulative_data_ack+1) ) {
-            _dsn_received.erase(_dsn_received.begin());
-            _cumulative_data_ack+= size;
-            if (_buffer_logger) _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
+        uint64_t released = _dsn_received.advance(_cumulative_data_ack, size);
+        if (_buffer_logger) {
+            for (uint64_t i = 0; i < released; i++)
+                _buffer_logger->logBuffer(ReorderBufferLogger::BUF_DEQUEUE);
         }
     } else if (dsn < _cumulative_data_ack+1) {
         // cout << "Dup DSN received!\n";
     } else {
         // hole in sequence space
-        _dsn_received.insert(dsn);
+        _dsn_received.insert(dsn, size);
         if (_buffer_logger) {
             // cout << "BUF_ENQUEUE\n";
             _buffer_logger->logBuffer(ReorderBufferLogger::BUF_ENQUEUE);
@@ -1173,26 +1195,3 @@ uint32_t SwiftSink::spurious_retransmits() {
     }
     return spurious_retransmits;
 }
-
-////////////////////////////////////////////////////////////////
-//  SWIFT RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-SwiftRtxTimerScanner::SwiftRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod) {
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-SwiftRtxTimerScanner::registerSubflow(SwiftSubflowSrc &subflow_src) {
-    _subflows.push_back(&subflow_src);
-}
-
-void SwiftRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    subflows_t::iterator i;
-    for (i = _subflows.begin(); i!=_subflows.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
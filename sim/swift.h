@@ -14,6 +14,8 @@
 #include "swift_scheduler.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "rtx_timer.h"
+#include "reorder_buffer.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
 
@@ -22,7 +24,6 @@
 class SwiftSink;
 class SwiftSubflowSrc;
 class SwiftSubflowSink;
-class SwiftRtxTimerScanner;
 class BaseScheduler;
 
 class SwiftPacer : public EventSource {
@@ -38,10 +39,11 @@ private:
     simtime_picosec _interpacket_delay; // the interpacket delay, or zero if we're not pacing
     simtime_picosec _last_send;  // when the last packet was sent (always set, even when we're not pacing)
     simtime_picosec _next_send;  // when the next scheduled packet should be sent
+    EventList::Handle _next_send_handle; // the event for _next_send, so cancel() is cheap
 };
 
 // stuff that is specific to a subflow rather than the whole connection
-class SwiftSubflowSrc : public EventSource, public PacketSink, public ScheduledSrc {
+class SwiftSubflowSrc : public EventSource, public PacketSink, public ScheduledSrc, public RtxTimerClient {
     friend class SwiftSrc;
     friend class SwiftLoggerSimple;
 public:
@@ -58,6 +60,7 @@ public:
     void reroute(const Route &route);
     void doNextEvent();
     void rtx_timer_hook(simtime_picosec now, simtime_picosec period);
+    simtime_picosec rtx_timer_due() const;
     inline simtime_picosec pacing_delay() const {return _pacing_delay;}
     PacketFlow& flow() {return _flow;}
     uint32_t drops() const { return _drops;}
@@ -128,11 +131,10 @@ private:
 
 class SwiftSrc : public EventSource {
     friend class SwiftSink;
-    friend class SwiftRtxTimerScanner;
     //friend class SwiftSubflowSrc;
 public:
-SwiftSrc(SwiftRtxTimerScanner& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, EventList &eventlist);
-    SwiftSrc(SwiftRtxTimerScanner& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, EventList &eventlist, uint32_t addr);
+SwiftSrc(RtxTimerWheel& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, EventList &eventlist);
+    SwiftSrc(RtxTimerWheel& rtx_scanner, SwiftLogger* logger, TrafficLogger* pktlogger, EventList &eventlist, uint32_t addr);
     void log(SwiftSubflowSrc* sub, SwiftLogger::SwiftEvent event);
     virtual void connect(const Route& routeout, const Route& routeback, 
                          SwiftSink& sink, simtime_picosec startTime);
@@ -175,6 +177,8 @@ SwiftSrc(SwiftRtxTimerScanner& rtx_scanner, SwiftLogger* logger, TrafficLogger*
     // add paths for PLB
     void enable_plb() {_plb = true;}
     void set_paths(vector<const Route*>* rt);
+    // the same, taking copies of the paths to destination by index
+    void set_paths(PathSource& paths, uint32_t destination);
     void permute_paths();
     bool _plb;
     inline bool plb() const {return _plb;}
@@ -245,7 +249,7 @@ private:
     SwiftLogger* _logger;
     TrafficLogger* _traffic_logger;
     BaseScheduler* _scheduler;
-    SwiftRtxTimerScanner* _rtx_timer_scanner;
+    RtxTimerWheel* _rtx_timer_scanner;
 
     // Mechanism
     void clear_timer(uint64_t start,uint64_t end);
@@ -278,7 +282,7 @@ public:
     // stats
     uint32_t spurious_retransmits;
 
-    set<SwiftAck::seq_t> _received; 
+    ReorderBuffer<SwiftAck::seq_t> _received;
 private:
     // Connectivity
     void connect(SwiftSubflowSrc& src, const Route& route);
@@ -310,7 +314,7 @@ public:
                                           // cumulatively acked
     virtual const string& nodename() { return _nodename; }
 
-    set <SwiftPacket::seq_t> _dsn_received; // use a map because multipath packets will arrive out of order
+    ReorderBuffer<SwiftPacket::seq_t> _dsn_received; // multipath packets will arrive out of order
 
     SwiftSrc* _src;
     uint64_t cumulative_ack();
@@ -325,15 +329,4 @@ private:
     ReorderBufferLogger* _buffer_logger;
 };
 
-class SwiftRtxTimerScanner : public EventSource {
-public:
-    SwiftRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerSubflow(SwiftSubflowSrc &subflow_src);
-private:
-    simtime_picosec _scanPeriod;
-    typedef list<SwiftSubflowSrc*> subflows_t;
-    subflows_t _subflows;
-};
-
 #endif
@@ -648,7 +648,7 @@ SwiftSrc::receivePacket(Packet& pkt)
     _sub->adjust_cwnd(ackno, delay);
     
     if (ackno >= _flow_size){
-	cout << "Flow " << _name << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ackno << endl;
+	cout << "Flow " << str() << " finished at " << timeAsUs(eventlist().now()) << " total bytes " << ackno << endl;
 	//	return;
     }
 
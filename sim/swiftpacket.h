@@ -49,8 +49,8 @@ public:
 protected:
     seq_t _seqno;
     seq_t _dsn;
-    bool _syn;
     simtime_picosec _ts;
+    bool _syn;
     static PacketDB<SwiftPacket> _packetdb;
 };
 
@@ -7,8 +7,6 @@
 #include "queue_lossless_input.h"
 #include "loggers.h"
 
-uint32_t Switch::id = 0;
-
 int Switch::addPort(BaseQueue* q){
     _ports.push_back(q);
     q->setSwitch(this);
@@ -16,8 +14,14 @@ int Switch::addPort(BaseQueue* q){
     
 }
 
+uint16_t Switch::addIngressPort(LosslessInputQueue* q){
+    assert(_ingress_ports.size() < Packet::NO_PORT);
+    _ingress_ports.push_back(q);
+    return _ingress_ports.size()-1;
+}
+
 void Switch::sendPause(LosslessQueue* problem, unsigned int wait){
-    cout << "Switch " << _name << " link " << problem->_name << " blocked, sending pause " << wait << endl;
+    cout << "Switch " << _name << " link " << problem->str() << " blocked, sending pause " << wait << endl;
 
     for (size_t i = 0;i < _ports.size();i++){
         LosslessQueue* q = (LosslessQueue*)_ports.at(i);
@@ -25,7 +29,7 @@ void Switch::sendPause(LosslessQueue* problem, unsigned int wait){
         if (q==problem || !(q->getRemoteEndpoint()))
             continue;
 
-        cout << "Informing " << q->_name << endl;
+        cout << "Informing " << q->str() << endl;
         EthPausePacket* pkt = EthPausePacket::newpkt(wait,_id);
         q->getRemoteEndpoint()->receivePacket(*pkt);
     }
@@ -20,6 +20,7 @@
 #include "loggertypes.h"
 #include "drawable.h"
 #include "routetable.h"
+#include "memory_account.h"
 
 class BaseQueue;
 class LosslessQueue;
@@ -29,11 +30,13 @@ class RouteTable;
 
 class Switch : public EventSource, public Drawable, public PacketSink {
  public:
-    Switch(EventList& eventlist) : EventSource(eventlist, "none") { _name = "none"; _id = id++;};
-    Switch(EventList& eventlist, string s) : EventSource(eventlist, s) { _name= s; _id = id++;}
+    MEMORY_ACCOUNTED(SWITCHES)
+    Switch(EventList& eventlist) : EventSource(eventlist, "none") { _name = "none"; _id = SimContext::current().new_switch_id();};
+    Switch(EventList& eventlist, string s) : EventSource(eventlist, s) { _name= s; _id = SimContext::current().new_switch_id();}
 
     virtual int addPort(BaseQueue* q);
     virtual void addHostPort(int addr, int flowid, PacketSink* transport) { abort();};
+    virtual void removeHostPort(int addr, int flowid) { abort();};
 
     uint32_t getID(){return _id;};
     virtual uint32_t getType() {return 0;}
@@ -44,11 +47,16 @@ class Switch : public EventSource, public Drawable, public PacketSink {
     virtual void doNextEvent() {abort();}
 
     //used when route strategy is ECMP_FIB and variants. 
-    virtual Route* getNextHop(Packet& pkt) { return getNextHop(pkt, NULL);}
-    virtual Route* getNextHop(Packet& pkt, BaseQueue* ingress_port) {abort();};
+    virtual const Route* getNextHop(Packet& pkt) { return getNextHop(pkt, NULL);}
+    virtual const Route* getNextHop(Packet& pkt, BaseQueue* ingress_port) {abort();};
 
     BaseQueue* getPort(int id) { assert(id >= 0); if ((unsigned int)id<_ports.size()) return _ports.at(id); else return NULL;}
 
+    // lossless input queues register here, so a packet crossing the
+    // switch need only carry its input queue's index
+    uint16_t addIngressPort(LosslessInputQueue* q);
+    LosslessInputQueue* getIngressPort(uint16_t id) { return _ingress_ports[id];}
+
     unsigned int portCount(){ return _ports.size();}
 
     void sendPause(LosslessQueue* problem, unsigned int wait);
@@ -63,11 +71,10 @@ class Switch : public EventSource, public Drawable, public PacketSink {
 
 protected:
     vector<BaseQueue*> _ports;
+    vector<LosslessInputQueue*> _ingress_ports;
     uint32_t _id;
     string _name;
 
     RouteTable* _fib;
- 
-    static uint32_t id;
 };
 #endif
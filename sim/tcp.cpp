@@ -45,6 +45,7 @@ TcpSrc::TcpSrc(TcpLogger* logger, TrafficLogger* pktlogger,
     _recoverq = 0;
     _in_fast_recovery = false;
     _mSrc = NULL;
+    _mptcp_window = 0;
     _drops = 0;
 
 #ifdef PACKET_SCATTER
@@ -84,6 +85,7 @@ void TcpSrc::set_app_limit(int pktps) {
     }
     _ssthresh = 0xffffffff;
     _app_limited = pktps;
+    update_mptcp_window();
     send_packets();
 }
 
@@ -92,6 +94,7 @@ TcpSrc::startflow() {
     _unacked = _cwnd;
     _established = false;
 
+    update_mptcp_window();
     send_packets();
 }
 
@@ -99,6 +102,16 @@ uint32_t TcpSrc::effective_window() {
     return _in_fast_recovery?_ssthresh:_cwnd;
 }
 
+void TcpSrc::update_mptcp_window() {
+    if (!_mSrc)
+        return;
+    uint32_t window = effective_window();
+    if (window != _mptcp_window) {
+        _mSrc->subflow_window_changed(_mptcp_window, window);
+        _mptcp_window = window;
+    }
+}
+
 void TcpSrc::replace_route(const Route* newroute) {
     _old_route = _route;
     _route = newroute;
@@ -126,6 +139,16 @@ TcpSrc::connect(const Route& routeout, const Route& routeback, TcpSink& sink,
 
 void
 TcpSrc::receivePacket(Packet& pkt) 
+{
+    // subclasses and drivers may have changed the window since we last
+    // reported it
+    update_mptcp_window();
+    handle_ack(pkt);
+    update_mptcp_window();
+}
+
+void
+TcpSrc::handle_ack(Packet& pkt)
 {   //cerr << eventlist().now() / 1e12 << " " << __PRETTY_FUNCTION__ << ":(" << int(pkt.dst()) << "," << int(pkt.flow_id()) << ")" << endl;
     simtime_picosec ts;
     TcpAck *p = (TcpAck*)(&pkt);
@@ -196,11 +219,13 @@ TcpSrc::receivePacket(Packet& pkt)
             }
         }
         _RFC2988_RTO_timeout = eventlist().now() + _rto;// RFC 2988 5.3
+        rtx_timer_update();
         _last_ping = eventlist().now();
     
         if (seqno >= _highest_sent) {
             _highest_sent = seqno;
             _RFC2988_RTO_timeout = timeInf;// RFC 2988 5.2
+            rtx_timer_update();
             _last_ping = timeInf;
         }
 
@@ -393,6 +418,7 @@ TcpSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }        
         //cout << "Sending SYN, waiting for SYN/ACK" << endl;
         return;
@@ -471,6 +497,7 @@ TcpSrc::send_packets() {
 
         if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
             _RFC2988_RTO_timeout = eventlist().now() + _rto;
+            rtx_timer_update();
         }
     }
 }
@@ -526,9 +553,17 @@ TcpSrc::retransmit_packet() {
 
     if(_RFC2988_RTO_timeout == timeInf) {// RFC2988 5.1
         _RFC2988_RTO_timeout = eventlist().now() + _rto;
+        rtx_timer_update();
     }
 }
 
+simtime_picosec TcpSrc::rtx_timer_due() const {
+    // rtx_timer_hook does nothing until we're past the timeout
+    if (_RFC2988_RTO_timeout == timeInf)
+        return RtxTimerClient::IDLE;
+    return _RFC2988_RTO_timeout + 1;
+}
+
 void TcpSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
     if (now <= _RFC2988_RTO_timeout || _RFC2988_RTO_timeout==timeInf) 
         return;
@@ -566,6 +601,7 @@ void TcpSrc::rtx_timer_hook(simtime_picosec now, simtime_picosec period) {
         //if (_rto > timeFromMs(1000))
         //  _rto = timeFromMs(1000);
         _RFC2988_RTO_timeout = now + _rto;
+        rtx_timer_update();
     }
 }
 
@@ -605,8 +641,10 @@ void TcpSrc::doNextEvent() {
         _sawtooth = 0;
         _rtt_cum = timeFromMs(0);
 
-        if (_mSrc)
+        if (_mSrc) {
+            update_mptcp_window();
             _mSrc->window_changed();
+        }
     } else {
         //cout << "Starting flow" << endl;
         startflow();
@@ -658,28 +696,14 @@ TcpSink::receivePacket(Packet& pkt) {
         _cumulative_ack = seqno + size - 1;
         //cout << "New cumulative ack is " << _cumulative_ack << endl;
         // are there any additional received packets we can now ack?
-        while (!_received.empty() && (_received.front() == _cumulative_ack+1) ) {
-            _received.pop_front();
-            _cumulative_ack+= size;
-        }
+        _received.advance(_cumulative_ack, size);
     } else if (seqno < _cumulative_ack+1) {
     } else { // it's not the next expected sequence number
         if (_received.empty()) {
-            _received.push_front(seqno);
             //it's a drop in this simulator there are no reorderings.
             _drops += (1000 + seqno-_cumulative_ack-1)/1000;
-        } else if (seqno > _received.back()) { // likely case
-            _received.push_back(seqno);
-        } else { // uncommon case - it fills a hole
-            list<uint64_t>::iterator i;
-            for (i = _received.begin(); i != _received.end(); i++) {
-                if (seqno == *i) break; // it's a bad retransmit
-                if (seqno < (*i)) {
-                    _received.insert(i, seqno);
-                    break;
-                }
-            }
         }
+        _received.insert(seqno, size); // ignored if it's a bad retransmit
     }
     send_ack(ts,marked);
 }
@@ -725,26 +749,3 @@ void TcpSink::set_paths(vector<const Route*>* rt) {
     }
 }
 #endif
-
-////////////////////////////////////////////////////////////////
-//  TCP RETRANSMISSION TIMER
-////////////////////////////////////////////////////////////////
-
-TcpRtxTimerScanner::TcpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist)
-    : EventSource(eventlist,"RtxScanner"), _scanPeriod(scanPeriod) {
-    eventlist.sourceIsPendingRel(*this, _scanPeriod);
-}
-
-void 
-TcpRtxTimerScanner::registerTcp(TcpSrc &tcpsrc) {
-    _tcps.push_back(&tcpsrc);
-}
-
-void TcpRtxTimerScanner::doNextEvent() {
-    simtime_picosec now = eventlist().now();
-    tcps_t::iterator i;
-    for (i = _tcps.begin(); i!=_tcps.end(); i++) {
-        (*i)->rtx_timer_hook(now,_scanPeriod);
-    }
-    eventlist().sourceIsPendingRel(*this, _scanPeriod);
-}
@@ -12,6 +12,9 @@
 #include "tcppacket.h"
 #include "eventlist.h"
 #include "sent_packets.h"
+#include "rtx_timer.h"
+#include "memory_account.h"
+#include "reorder_buffer.h"
 
 //#define MODEL_RECEIVE_WINDOW 1
 
@@ -26,9 +29,10 @@ class TcpSink;
 class MultipathTcpSrc;
 class MultipathTcpSink;
 
-class TcpSrc : public PacketSink, public EventSource {
+class TcpSrc : public PacketSink, public EventSource, public RtxTimerClient {
     friend class TcpSink;
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     TcpSrc(TcpLogger* logger, TrafficLogger* pktlogger, EventList &eventlist);
     virtual void connect(const Route& routeout, const Route& routeback, 
                          TcpSink& sink, simtime_picosec startTime);
@@ -48,13 +52,14 @@ public:
     }
     flowid_t getFlowId() {return _flow.flow_id();}
     
-    void set_ssthresh(uint64_t s){_ssthresh = s;}
-    void set_cwnd(uint64_t s){_cwnd = s;}
+    void set_ssthresh(uint64_t s){_ssthresh = s; update_mptcp_window();}
+    void set_cwnd(uint64_t s){_cwnd = s; update_mptcp_window();}
     void set_dst(int d){_dst=d;}
     int  get_dst(){return _dst;}
 
     uint32_t effective_window();
     virtual void rtx_timer_hook(simtime_picosec now,simtime_picosec period);
+    virtual simtime_picosec rtx_timer_due() const;
     virtual const string& nodename() { return _nodename; }
 
     // should really be private, but loggers want to see:
@@ -93,6 +98,11 @@ public:
     TcpSink* _sink;
     int _dst{-1};
     MultipathTcpSrc* _mSrc;
+    // Tell _mSrc if our effective window has changed since it last saw
+    // it.  Called on the way in and out of anything that changes the
+    // window, so the connection's total is current whenever another
+    // subflow reads it.
+    void update_mptcp_window();
     simtime_picosec _RFC2988_RTO_timeout;
     bool _rtx_timeout_pending;
 
@@ -118,6 +128,9 @@ public:
     virtual void deflate_window();
 
 private:
+    void handle_ack(Packet& pkt);
+    uint32_t _mptcp_window; // our effective window as _mSrc last saw it
+
     const Route* _old_route;
     uint64_t _last_packet_with_old_route;
 
@@ -142,6 +155,7 @@ private:
 class TcpSink : public PacketSink, public DataReceiver {
     friend class TcpSrc;
 public:
+    MEMORY_ACCOUNTED(TRANSPORT)
     TcpSink();
     void set_dst(int d) {_dst=d;}
     int  get_dst() {return _dst;}    
@@ -158,8 +172,8 @@ public:
     virtual const string& nodename() { return _nodename; }
 
     MultipathTcpSink* _mSink;
-    list<TcpAck::seq_t> _received; /* list of packets above a hole, that 
-                                      we've received */
+    ReorderBuffer<TcpAck::seq_t> _received; /* packets above a hole, that
+                                               we've received */
 
 #ifdef PACKET_SCATTER
     vector<const Route*>* _paths;
@@ -182,15 +196,4 @@ private:
     string _nodename;
 };
 
-class TcpRtxTimerScanner : public EventSource {
-public:
-    TcpRtxTimerScanner(simtime_picosec scanPeriod, EventList& eventlist);
-    void doNextEvent();
-    void registerTcp(TcpSrc &tcpsrc);
-private:
-    simtime_picosec _scanPeriod;
-    typedef list<TcpSrc*> tcps_t;
-    tcps_t _tcps;
-};
-
 #endif
@@ -31,10 +31,12 @@ void TcpSrcPeriodic::reset(){
   _mdev = 0;
   _recoverq = 0;
   _in_fast_recovery = false;
+  update_mptcp_window();
   _mSrc = NULL;
 
   _rtx_timeout_pending = false;
   _RFC2988_RTO_timeout = timeInf;
+  rtx_timer_update();
 }
 
 void 
@@ -48,9 +48,11 @@ void TcpSrcTransfer::reset(uint64_t bb, int shouldRestart){
     _recoverq = 0;
     _in_fast_recovery = false;
     _established = false;
+    update_mptcp_window();
   
     _rtx_timeout_pending = false;
     _RFC2988_RTO_timeout = timeInf;
+    rtx_timer_update();
   
     //_bytes_to_send = bb;
 
@@ -115,7 +117,7 @@ TcpSrcTransfer::receivePacket(Packet& pkt){
                     //reset all the subflows, including this one.
                     int bb = generateFlowSize();
                   
-                    list<TcpSrc*>::iterator it;
+                    vector<TcpSrc*>::iterator it;
                     int subflows_to_activate = bb >= 1000000 ? 8:1;
                     int crt_subflow = 0;
                   
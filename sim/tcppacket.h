@@ -48,8 +48,8 @@ public:
     virtual PktPriority priority() const {return Packet::PRIO_LO;}
 protected:
     seq_t _seqno,_data_seqno;
-    bool _syn;
     simtime_picosec _ts;
+    bool _syn;
     static PacketDB<TcpPacket> _packetdb;
 };
 
@@ -158,7 +158,7 @@ int main(int argc, char **argv) {
     queue_back.setName("queue_back"); 
     logfile.writeName(queue_back);
 
-    TcpRtxTimerScanner tcpRtxScanner(timeFromMs(10), eventlist);
+    RtxTimerWheel tcpRtxScanner(timeFromMs(10), eventlist);
 
     //TCP flows on path 1
     TcpSrc* tcpSrc;
@@ -177,7 +177,7 @@ int main(int argc, char **argv) {
         tcpSnk->setName("TcpSink1"); 
         logfile.writeName(*tcpSnk);
         
-        tcpRtxScanner.registerTcp(*tcpSrc);
+        tcpRtxScanner.registerSrc(*tcpSrc);
         
         pqueue = new Queue(SERVICE1*2, memFromPkt(FEEDER_BUFFER), 
                            eventlist,NULL); 
@@ -214,7 +214,7 @@ int main(int argc, char **argv) {
         tcpSnk->setName("TcpSink2"); 
         logfile.writeName(*tcpSnk);
 
-        tcpRtxScanner.registerTcp(*tcpSrc);
+        tcpRtxScanner.registerSrc(*tcpSrc);
         
         pqueue = new Queue(SERVICE2*2, memFromPkt(FEEDER_BUFFER), 
                            eventlist, NULL); 
@@ -261,7 +261,7 @@ int main(int argc, char **argv) {
     logfile.writeName(*tcpSnk);
 
     tcpSrc->_cap = CAP;
-    tcpRtxScanner.registerTcp(*tcpSrc);
+    tcpRtxScanner.registerSrc(*tcpSrc);
         
     // tell it the route
     routeout = new route_t(); 
@@ -300,7 +300,7 @@ int main(int argc, char **argv) {
     tcpSnk->setName("Subflow2Sink"); 
     logfile.writeName(*tcpSnk);
 
-    tcpRtxScanner.registerTcp(*tcpSrc);
+    tcpRtxScanner.registerSrc(*tcpSrc);
         
     // tell it the route
     routeout = new route_t(); 
@@ -103,7 +103,7 @@ int main(int argc, char **argv) {
     NdpSrc* ndpSrc[4];
     NdpSink* ndpSnk[4];
     
-    NdpRtxTimerScanner ndpRtxScanner(timeFromUs((uint32_t)100), eventlist);
+    RtxTimerWheel ndpRtxScanner(timeFromUs((uint32_t)100), eventlist);
     NdpSinkLoggerSampling sinkLogger = NdpSinkLoggerSampling(timeFromUs((uint32_t)100),eventlist);
     logfile.addLogger(sinkLogger);
     
@@ -122,7 +122,7 @@ int main(int argc, char **argv) {
         ndpSnk[i]->setName("NDPSink" + std::to_string(i));
         ndpSnk[i]->setRouteStrategy(SINGLE_PATH);
         logfile.writeName(*ndpSnk[i]);
-        ndpRtxScanner.registerNdp(*ndpSrc[i]);
+        ndpRtxScanner.registerSrc(*ndpSrc[i]);
     }
 
     for (int i = 0; i < 1; i++) {
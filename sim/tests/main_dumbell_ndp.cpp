@@ -124,7 +124,7 @@ int main(int argc, char **argv) {
     NdpSink* ndpSnk;
     NdpSinkLoggerSampling sinkLogger(timeFromUs((uint32_t)25),eventlist);
     logfile.addLogger(sinkLogger);
-    NdpRtxTimerScanner ndpRtxScanner(timeFromMs(1),eventlist);
+    RtxTimerWheel ndpRtxScanner(timeFromMs(1),eventlist);
     route_t* routeout;
     route_t* routein;
 
@@ -147,7 +147,7 @@ int main(int argc, char **argv) {
         ndpSnk->setRouteStrategy(SINGLE_PATH);
         logfile.writeName(*ndpSnk);
         
-        ndpRtxScanner.registerNdp(*ndpSrc);
+        ndpRtxScanner.registerSrc(*ndpSrc);
         
         // tell it the route
         routeout = new route_t();
@@ -66,8 +66,8 @@ int main(int argc, char **argv) {
     TcpSrc* tcpSrc;
     TcpSink* tcpSnk;
     
-    NdpTunnelRtxTimerScanner ndpRtxScanner(timeFromMs(1),eventlist);
-    TcpRtxTimerScanner tcpRtxScanner(timeFromMs(10), eventlist);
+    RtxTimerWheel ndpRtxScanner(timeFromMs(1),eventlist);
+    RtxTimerWheel tcpRtxScanner(timeFromMs(10), eventlist);
 
     TcpSinkLoggerSampling sinkLogger = TcpSinkLoggerSampling(timeFromMs(100),eventlist);
     logfile.addLogger(sinkLogger);
@@ -90,7 +90,7 @@ int main(int argc, char **argv) {
         ndpSnk->setRouteStrategy(SINGLE_PATH);
         logfile.writeName(*ndpSnk);
         
-        ndpRtxScanner.registerNdp(*ndpSrc);
+        ndpRtxScanner.registerSrc(*ndpSrc);
 
         tcpSrc = new TcpSrc(NULL,NULL,eventlist);
         //tcpSrc = new TcpSrcTransfer(NULL,NULL,eventlist,90000,NULL,NULL);
@@ -100,7 +100,7 @@ int main(int argc, char **argv) {
         //tcpSnk = new TcpSinkTransfer();
         tcpSnk->setName("TCPSink"+ntoa(i)); logfile.writeName(*tcpSnk);
 
-        tcpRtxScanner.registerTcp(*tcpSrc);
+        tcpRtxScanner.registerSrc(*tcpSrc);
         
         // tell it the route
         routeout = new route_t(); 
@@ -95,7 +95,7 @@ int main(int argc, char **argv) {
     STrackSrc* strackSrc;
     STrackSink* strackSnk;
     
-    STrackRtxTimerScanner strackRtxScanner(timeFromMs(10), eventlist);
+    RtxTimerWheel strackRtxScanner(timeFromMs(10), eventlist);
     STrackSinkLoggerSampling sinkLogger = STrackSinkLoggerSampling(timeFromUs((uint32_t)1000),eventlist);
     logfile.addLogger(sinkLogger);
     
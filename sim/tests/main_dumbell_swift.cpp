@@ -96,7 +96,7 @@ int main(int argc, char **argv) {
     SwiftSrc* swiftSrc;
     SwiftSink* swiftSnk;
     
-    SwiftRtxTimerScanner swiftRtxScanner(timeFromMs(10), eventlist);
+    RtxTimerWheel swiftRtxScanner(timeFromMs(10), eventlist);
     SwiftSinkLoggerSampling sinkLogger = SwiftSinkLoggerSampling(timeFromUs((uint32_t)1000),eventlist);
     logfile.addLogger(sinkLogger);
     
@@ -78,7 +78,7 @@ int main(int argc, char **argv) {
     TcpSrc* tcpSrc;
     TcpSink* tcpSnk;
     
-    TcpRtxTimerScanner tcpRtxScanner(timeFromMs(10), eventlist);
+    RtxTimerWheel tcpRtxScanner(timeFromMs(10), eventlist);
     TcpSinkLoggerSampling sinkLogger = TcpSinkLoggerSampling(timeFromMs(100),eventlist);
     logfile.addLogger(sinkLogger);
     
@@ -94,7 +94,7 @@ int main(int argc, char **argv) {
         //tcpSnk = new TcpSinkTransfer();
         tcpSnk->setName("TCPSink"+ntoa(i)); logfile.writeName(*tcpSnk);
 
-        tcpRtxScanner.registerTcp(*tcpSrc);
+        tcpRtxScanner.registerSrc(*tcpSrc);
         
         // tell it the route
         routeout = new route_t();
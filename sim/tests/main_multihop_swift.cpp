@@ -140,7 +140,7 @@ int main(int argc, char **argv) {
     SwiftSrc* swiftSrc[4];
     SwiftSink* swiftSnk[4];
     
-    SwiftRtxTimerScanner swiftRtxScanner(timeFromUs((uint32_t)100), eventlist);
+    RtxTimerWheel swiftRtxScanner(timeFromUs((uint32_t)100), eventlist);
     SwiftSinkLoggerSampling sinkLogger = SwiftSinkLoggerSampling(timeFromUs((uint32_t)100),eventlist);
     logfile.addLogger(sinkLogger);
     
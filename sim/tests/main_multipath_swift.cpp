@@ -119,7 +119,7 @@ int main(int argc, char **argv) {
     SwiftSrc* swiftSrc[2];
     SwiftSink* swiftSnk[2];
     
-    SwiftRtxTimerScanner swiftRtxScanner(timeFromUs((uint32_t)100), eventlist);
+    RtxTimerWheel swiftRtxScanner(timeFromUs((uint32_t)100), eventlist);
     SwiftSinkLoggerSampling sinkLogger = SwiftSinkLoggerSampling(timeFromUs((uint32_t)100),eventlist);
     logfile.addLogger(sinkLogger);
     
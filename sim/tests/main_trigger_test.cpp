@@ -55,7 +55,7 @@ int main(int argc, char **argv) {
     NdpSink* ndpSnk;
     NdpSinkLoggerSampling sinkLogger(timeFromUs((uint32_t)10),eventlist);
     logfile.addLogger(sinkLogger);
-    NdpRtxTimerScanner ndpRtxScanner(timeFromMs(1),eventlist);
+    RtxTimerWheel ndpRtxScanner(timeFromMs(1),eventlist);
     route_t* routeout;
     route_t* routein;
 
@@ -71,7 +71,7 @@ int main(int argc, char **argv) {
         ndpSnk->setRouteStrategy(SINGLE_PATH);
         logfile.writeName(*ndpSnk);
         
-        ndpRtxScanner.registerNdp(*ndpSrc[i]);
+        ndpRtxScanner.registerSrc(*ndpSrc[i]);
         
         // tell it the route
         routeout = new route_t();